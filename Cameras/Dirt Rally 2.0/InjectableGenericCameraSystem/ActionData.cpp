@@ -28,59 +28,12 @@
 #include "stdafx.h"
 #include "ActionData.h"
 
-#include "Globals.h"
-#include "Utils.h"
-
 using namespace std;
 
 namespace IGCS
 {
 	ActionData::~ActionData() {}
 
-	// altCtrlOptional is only effective for actions which don't have alt/ctrl as a required key. Actions which do have one or more of these
-	// keys as required, will ignore altCtrlOptional and always test for these keys. 
-    bool ActionData::isActive(bool altCtrlOptional)
-    {
-        if (!_available) {
-            return false;
-        }
-
-        // Handle based on input source
-        if (_inputSource == InputSource::Keyboard)
-        {
-            bool toReturn = (Utils::keyDown(_keyCode)) && (_shiftRequired == Utils::shiftPressed());
-            if ((_altRequired || _ctrlRequired) || !altCtrlOptional)
-            {
-                toReturn = toReturn && (Utils::altPressed() == _altRequired) && (Utils::ctrlPressed() == _ctrlRequired);
-            }
-            return toReturn;
-        }
-        else if (_inputSource == InputSource::Gamepad)
-        {
-            // For gamepad, the _keyCode corresponds to a button code defined in Gamepad::button_t
-            auto& gamepad = Globals::instance().gamePad();
-            if (!gamepad.isConnected()) {
-                return false;
-            }
-
-            // Check if the main button is pressed
-            bool mainButtonPressed = gamepad.isButtonPressed(static_cast<Gamepad::button_t>(_keyCode));
-            if (!mainButtonPressed) {
-                return false;
-            }
-
-            // Check modifiers
-            bool rbPressed = gamepad.isButtonPressed(Gamepad::button_t::RB);
-            bool lbPressed = gamepad.isButtonPressed(Gamepad::button_t::LB);
-
-            // ALWAYS do exact modifier matching for gamepad inputs
-            // This ensures bindings with no modifiers won't activate when modifiers are pressed
-            return (rbPressed == _altRequired) && (lbPressed == _ctrlRequired);
-        }
-
-        return false;
-    }
-
 	void ActionData::setKeyCode(int newKeyCode)
 	{
 		// if we have a keycode set and this is a different one, we will reset alt/ctrl/shift key requirements as it's a different key altogether.
@@ -102,7 +102,6 @@ namespace IGCS
 
 		~ActionData();
 
-		bool isActive(bool ignoreAltCtrl);
 		void clear();
 		void update(int newKeyCode, bool altRequired, bool ctrlRequired, bool shiftRequired, bool isGamepad);
 		void setKeyCode(int newKeyCode);
@@ -115,6 +114,9 @@ namespace IGCS
 		void setAltRequired() { _altRequired = true; }
 		void setCtrlRequired() { _ctrlRequired = true; }
 		void setShiftRequired() { _shiftRequired = true; }
+		bool getAltRequired() const { return _altRequired; }
+		bool getCtrlRequired() const { return _ctrlRequired; }
+		bool getShiftRequired() const { return _shiftRequired; }
 
 		InputSource getInputSource() const { return _inputSource; }
 		void setInputSource(InputSource source) { _inputSource = source; }
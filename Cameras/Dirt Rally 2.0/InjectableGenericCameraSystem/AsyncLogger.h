@@ -0,0 +1,257 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <thread>
+#include "LogFormat.h"
+#include "MpscQueue.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// Logging without I/O or formatting on the calling thread. A caller copies the format string pointer and its arguments (see
+// LogFormat.h) into a fixed size record in a bounded multi-producer queue, stamped with the wall clock time: no lock, no
+// allocation, no system call. One writer thread drains the queue every kDrainIntervalMs, formats the messages, adds the
+// timestamp and hands the lines to the sinks (console, file, pipe), so a slow console or a client not reading the pipe never
+// holds up a frame. Format strings must be string literals. When the queue is full the message is dropped and counted, and the
+// writer reports how many were lost. Records logged before start() wait in the queue.
+namespace IGCS
+{
+	enum class LogLevel : uint8_t
+	{
+		Line,
+		Error,
+		Debug,
+	};
+
+	// Receives the formatted lines. Only called on the writer thread.
+	class ILogSink
+	{
+	public:
+		virtual ~ILogSink() = default;
+		// line is zero terminated, without a line end.
+		virtual void write(LogLevel level, const char* line, size_t length) = 0;
+		// After each batch of lines.
+		virtual void flush() {}
+	};
+
+	class AsyncLogger
+	{
+	public:
+		static constexpr size_t kTextSize = 480;		// for the arguments; longer messages are cut off and end in "..."
+		static constexpr size_t kQueueSize = 1024;
+		static constexpr int kDrainIntervalMs = 10;
+		static constexpr size_t kMaxSinks = 4;
+
+		AsyncLogger() = default;
+		// IMPORTANT: no cleanup in the destructor, it may run under loader lock. Use stop().
+		~AsyncLogger() = default;
+		AsyncLogger(const AsyncLogger&) = delete;
+		AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+		// Any thread. Returns false if the queue was full and the message was dropped.
+		bool log(LogLevel level, const char* fmt, va_list args) noexcept
+		{
+			const int64_t time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+			const bool pushed = _queue.tryPush([&](Record& record)
+			{
+				record.time = time;
+				record.format = fmt;
+				record.level = level;
+				size_t used = 0;
+				record.deferred = LogFormat::capture(fmt, args, record.data, kTextSize, used);
+				if (!record.deferred)
+				{
+					// a conversion which can't be deferred, format it here
+					const FormatResult text = formatToVa(reinterpret_cast<char*>(record.data), kTextSize, fmt, args);
+					record.truncated = text.truncated;
+					record.length = static_cast<uint16_t>(text.text.size());
+				}
+			});
+			if (!pushed)
+			{
+				_dropped.fetch_add(1, std::memory_order_relaxed);
+			}
+			return pushed;
+		}
+
+		bool logf(LogLevel level, const char* fmt, ...) noexcept
+		{
+			va_list args;
+			va_start(args, fmt);
+			const bool pushed = log(level, fmt, args);
+			va_end(args);
+			return pushed;
+		}
+
+		// Starts the writer thread. The sinks must outlive it.
+		bool start(ILogSink* const sinks[], size_t count)
+		{
+			if (_thread.joinable())
+			{
+				return true;
+			}
+			_sinkCount = count < kMaxSinks ? count : kMaxSinks;
+			for (size_t i = 0; i < _sinkCount; ++i)
+			{
+				_sinks[i] = sinks[i];
+			}
+			_stopRequested = false;
+			_thread = std::thread(&AsyncLogger::run, this);
+			return true;
+		}
+
+		// Writes what is queued and stops the writer. Messages logged after this stay in the queue. From a SAFE context (not
+		// DllMain).
+		void stop()
+		{
+			if (!_thread.joinable())
+			{
+				return;
+			}
+			{
+				std::lock_guard<std::mutex> lock(_wakeMutex);
+				_stopRequested = true;
+			}
+			_wake.notify_one();
+			_thread.join();
+		}
+
+		// Messages dropped because the queue was full, in total.
+		[[nodiscard]] uint64_t dropped() const noexcept { return _dropped.load(std::memory_order_relaxed); }
+		// Lines handed to the sinks, in total. Includes the dropped message reports.
+		[[nodiscard]] uint64_t written() const noexcept { return _written.load(std::memory_order_relaxed); }
+
+	private:
+		struct Record
+		{
+			int64_t time;			// microseconds since the epoch
+			const char* format;
+			LogLevel level;
+			bool deferred;			// data holds the arguments, else the formatted text
+			bool truncated;			// text only
+			uint16_t length;		// text only
+			uint8_t data[kTextSize];
+		};
+
+		void run()
+		{
+#ifdef _WIN32
+			SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#endif
+			while (true)
+			{
+				drain();
+				std::unique_lock<std::mutex> lock(_wakeMutex);
+				if (_wake.wait_for(lock, std::chrono::milliseconds(kDrainIntervalMs), [this] { return _stopRequested; }))
+				{
+					break;
+				}
+			}
+			drain();
+		}
+
+		void drain()
+		{
+			uint64_t lines = 0;
+			while (_queue.tryPop([this](const Record& record) { writeRecord(record); }))
+			{
+				++lines;
+			}
+			const uint64_t dropped = _dropped.load(std::memory_order_relaxed);
+			if (dropped != _droppedReported)
+			{
+				const FormatResult text = formatTo(_line, sizeof(_line), "Log: %llu message(s) dropped, the log queue was full",
+					static_cast<unsigned long long>(dropped - _droppedReported));
+				_droppedReported = dropped;
+				writeLine(LogLevel::Error, text.text.size());
+				++lines;
+			}
+			if (lines > 0)
+			{
+				for (size_t i = 0; i < _sinkCount; ++i)
+				{
+					_sinks[i]->flush();
+				}
+				_written.fetch_add(lines, std::memory_order_relaxed);
+			}
+		}
+
+		void writeRecord(const Record& record)
+		{
+			size_t length = 0;
+			if (LogLevel::Line == record.level)
+			{
+				length = timestamp(record.time);
+			}
+			bool truncated = record.truncated;
+			if (record.deferred)
+			{
+				length += LogFormat::format(record.format, record.data, _line + length, kTextSize, truncated);
+			}
+			else
+			{
+				std::memcpy(_line + length, record.data, record.length);
+				length += record.length;
+			}
+			if (truncated)
+			{
+				std::memcpy(_line + length, "...", 3);
+				length += 3;
+			}
+			_line[length] = '\0';
+			writeLine(record.level, length);
+		}
+
+		void writeLine(LogLevel level, size_t length)
+		{
+			for (size_t i = 0; i < _sinkCount; ++i)
+			{
+				_sinks[i]->write(level, _line, length);
+			}
+		}
+
+		// Writes "[HH:MM:SS] " in local time to the start of _line, converting the time only when the second changes.
+		size_t timestamp(int64_t time)
+		{
+			const std::time_t seconds = static_cast<std::time_t>(time / 1000000);
+			if (seconds != _prefixSecond)
+			{
+				std::tm local{};
+#ifdef _WIN32
+				localtime_s(&local, &seconds);
+#else
+				localtime_r(&seconds, &local);
+#endif
+				_prefixLength = std::strftime(_prefix, sizeof(_prefix), "[%H:%M:%S] ", &local);
+				_prefixSecond = seconds;
+			}
+			std::memcpy(_line, _prefix, _prefixLength);
+			return _prefixLength;
+		}
+
+		MpscQueue<Record, kQueueSize> _queue;
+		std::atomic<uint64_t> _dropped{ 0 };
+		std::atomic<uint64_t> _written{ 0 };
+
+		// writer thread only
+		ILogSink* _sinks[kMaxSinks] = {};
+		size_t _sinkCount = 0;
+		uint64_t _droppedReported = 0;
+		char _line[kTextSize + 32] = {};
+		char _prefix[16] = {};
+		size_t _prefixLength = 0;
+		std::time_t _prefixSecond = -1;
+
+		std::thread _thread;
+		std::mutex _wakeMutex;
+		std::condition_variable _wake;
+		bool _stopRequested = false;		// under _wakeMutex
+	};
+}
@@ -0,0 +1,255 @@
+#pragma once
+#include <cstdint>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+// Key and gamepad bindings compiled into a flat table indexed by action, evaluated against a snapshot of the keyboard and pad
+// state taken once per input sample. Each binding is a key (virtual key code) or a set of XInput buttons plus two modifier
+// masks: the modifiers which must be down and the ones which must be up. Evaluating every action is a couple of bit tests per
+// binding, no lookups and no OS calls.
+//
+// The rules are the ones ActionData always had:
+// keyboard: the key is down, shift matches the binding and alt and ctrl match it too, unless altCtrlOptional is passed and the
+//           binding requires neither alt nor ctrl.
+// gamepad:  any of the binding's buttons is down and RB (alt) and LB (ctrl) match the binding exactly. Shift is ignored.
+namespace IGCS
+{
+	// Set of virtual key codes, 256 bits.
+	class KeySet
+	{
+	public:
+		static constexpr uint32_t kKeys = 256;
+
+		[[nodiscard]] bool test(uint32_t key) const noexcept
+		{
+			return key < kKeys && 0 != (_bits[key >> 6] & bit(key));
+		}
+
+		void set(uint32_t key) noexcept
+		{
+			if (key < kKeys)
+			{
+				_bits[key >> 6] |= bit(key);
+			}
+		}
+
+		void clear() noexcept
+		{
+			for (uint64_t& word : _bits)
+			{
+				word = 0;
+			}
+		}
+
+		// Calls visit(key) for every key in the set, in ascending order.
+		template<typename Visitor>
+		void forEach(Visitor&& visit) const
+		{
+			for (uint32_t word = 0; word < 4; ++word)
+			{
+				uint64_t remaining = _bits[word];
+				while (0 != remaining)
+				{
+					visit(word * 64 + lowestBit(remaining));
+					remaining &= remaining - 1;
+				}
+			}
+		}
+
+	private:
+		static constexpr uint64_t bit(uint32_t key) noexcept { return uint64_t(1) << (key & 63); }
+
+		static uint32_t lowestBit(uint64_t value) noexcept
+		{
+#if defined(_MSC_VER) && !defined(__clang__)
+			unsigned long index;
+			_BitScanForward64(&index, value);
+			return static_cast<uint32_t>(index);
+#else
+			return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+		}
+
+		uint64_t _bits[4] = {};
+	};
+
+	// The keyboard and pad state of one input sample.
+	struct InputSnapshot
+	{
+		KeySet keys;
+		uint16_t padButtons = 0;		// XINPUT_GAMEPAD_* bits, 0 if no pad is connected
+	};
+
+	class BindingTable
+	{
+	public:
+		static constexpr uint32_t kMaxActions = 64;
+
+		// Virtual key codes and XInput button bits the modifiers are made of.
+		static constexpr uint32_t kKeyLeftShift = 0xA0;		// VK_LSHIFT
+		static constexpr uint32_t kKeyRightShift = 0xA1;
+		static constexpr uint32_t kKeyLeftControl = 0xA2;	// VK_LCONTROL
+		static constexpr uint32_t kKeyRightControl = 0xA3;
+		static constexpr uint32_t kKeyLeftAlt = 0xA4;		// VK_LMENU
+		static constexpr uint32_t kKeyRightAlt = 0xA5;
+		static constexpr uint16_t kPadLeftShoulder = 0x0100;	// XINPUT_GAMEPAD_LEFT_SHOULDER, ctrl
+		static constexpr uint16_t kPadRightShoulder = 0x0200;	// XINPUT_GAMEPAD_RIGHT_SHOULDER, alt
+
+		enum Slot : uint32_t
+		{
+			KeyboardSlot = 0,
+			GamepadSlot = 1,
+
+			SlotCount,
+		};
+
+		BindingTable() noexcept
+		{
+			clear();
+		}
+
+		void clear() noexcept
+		{
+			for (auto& action : _bindings)
+			{
+				for (Binding& binding : action)
+				{
+					binding = Binding{};
+				}
+			}
+			_usedKeys.clear();
+			addModifierKeys();
+		}
+
+		// Compiles a keyboard binding. keyCode outside 1..255 leaves the action unbound in this slot.
+		void setKeyBinding(uint32_t action, int keyCode, bool altRequired, bool ctrlRequired, bool shiftRequired) noexcept
+		{
+			if (action >= kMaxActions)
+			{
+				return;
+			}
+			Binding& binding = _bindings[action][KeyboardSlot];
+			binding = Binding{};
+			if (keyCode <= 0 || keyCode >= static_cast<int>(KeySet::kKeys))
+			{
+				return;
+			}
+			binding.code = static_cast<uint16_t>(keyCode);
+			binding.required = modifiers(altRequired, ctrlRequired, shiftRequired);
+			binding.forbidden = static_cast<uint8_t>(kAllModifiers & ~binding.required);
+			// with altCtrlOptional, alt and ctrl don't matter if the binding needs neither
+			binding.forbiddenAltCtrlOptional = (altRequired || ctrlRequired) ? binding.forbidden : static_cast<uint8_t>(binding.forbidden & ~(kAlt | kCtrl));
+			binding.bound = true;
+			_usedKeys.set(static_cast<uint32_t>(keyCode));
+		}
+
+		// Compiles a gamepad binding, buttons being XINPUT_GAMEPAD_* bits. 0 leaves the action unbound in this slot.
+		void setPadBinding(uint32_t action, uint16_t buttons, bool altRequired, bool ctrlRequired) noexcept
+		{
+			if (action >= kMaxActions)
+			{
+				return;
+			}
+			Binding& binding = _bindings[action][GamepadSlot];
+			binding = Binding{};
+			if (0 == buttons)
+			{
+				return;
+			}
+			binding.code = buttons;
+			binding.required = modifiers(altRequired, ctrlRequired, false);
+			binding.forbidden = static_cast<uint8_t>((kAlt | kCtrl) & ~binding.required);
+			binding.forbiddenAltCtrlOptional = binding.forbidden;		// pads always match exactly
+			binding.bound = true;
+		}
+
+		// The keys the bindings look at, modifiers included. Only these have to be captured into the snapshot.
+		[[nodiscard]] const KeySet& usedKeys() const noexcept { return _usedKeys; }
+
+		[[nodiscard]] bool isActive(uint32_t action, const InputSnapshot& snapshot, bool altCtrlOptional = false) const noexcept
+		{
+			if (action >= kMaxActions)
+			{
+				return false;
+			}
+			return isActive(action, snapshot, keyModifiers(snapshot), padModifiers(snapshot), altCtrlOptional);
+		}
+
+		// Bit i set if action i is active.
+		[[nodiscard]] uint64_t activeActions(const InputSnapshot& snapshot, bool altCtrlOptional = false) const noexcept
+		{
+			const uint8_t keyMods = keyModifiers(snapshot);
+			const uint8_t padMods = padModifiers(snapshot);
+			uint64_t active = 0;
+			for (uint32_t action = 0; action < kMaxActions; ++action)
+			{
+				if (isActive(action, snapshot, keyMods, padMods, altCtrlOptional))
+				{
+					active |= uint64_t(1) << action;
+				}
+			}
+			return active;
+		}
+
+	private:
+		static constexpr uint8_t kShift = 1;
+		static constexpr uint8_t kAlt = 2;
+		static constexpr uint8_t kCtrl = 4;
+		static constexpr uint8_t kAllModifiers = kShift | kAlt | kCtrl;
+
+		struct Binding
+		{
+			uint16_t code = 0;						// virtual key or XInput button bits
+			uint8_t required = 0;
+			uint8_t forbidden = 0;
+			uint8_t forbiddenAltCtrlOptional = 0;
+			bool bound = false;
+		};
+
+		static constexpr uint8_t modifiers(bool alt, bool ctrl, bool shift) noexcept
+		{
+			return static_cast<uint8_t>((alt ? kAlt : 0) | (ctrl ? kCtrl : 0) | (shift ? kShift : 0));
+		}
+
+		static uint8_t keyModifiers(const InputSnapshot& snapshot) noexcept
+		{
+			const KeySet& keys = snapshot.keys;
+			return modifiers(keys.test(kKeyLeftAlt) || keys.test(kKeyRightAlt), keys.test(kKeyLeftControl) || keys.test(kKeyRightControl),
+				keys.test(kKeyLeftShift) || keys.test(kKeyRightShift));
+		}
+
+		static uint8_t padModifiers(const InputSnapshot& snapshot) noexcept
+		{
+			return modifiers(0 != (snapshot.padButtons & kPadRightShoulder), 0 != (snapshot.padButtons & kPadLeftShoulder), false);
+		}
+
+		static bool matches(const Binding& binding, uint8_t mods, bool altCtrlOptional) noexcept
+		{
+			const uint8_t forbidden = altCtrlOptional ? binding.forbiddenAltCtrlOptional : binding.forbidden;
+			return (mods & binding.required) == binding.required && 0 == (mods & forbidden);
+		}
+
+		bool isActive(uint32_t action, const InputSnapshot& snapshot, uint8_t keyMods, uint8_t padMods, bool altCtrlOptional) const noexcept
+		{
+			const Binding& key = _bindings[action][KeyboardSlot];
+			if (key.bound && snapshot.keys.test(key.code) && matches(key, keyMods, altCtrlOptional))
+			{
+				return true;
+			}
+			const Binding& pad = _bindings[action][GamepadSlot];
+			return pad.bound && 0 != (snapshot.padButtons & pad.code) && matches(pad, padMods, false);
+		}
+
+		void addModifierKeys() noexcept
+		{
+			for (uint32_t key = kKeyLeftShift; key <= kKeyRightAlt; ++key)
+			{
+				_usedKeys.set(key);
+			}
+		}
+
+		Binding _bindings[kMaxActions][SlotCount];
+		KeySet _usedKeys;
+	};
+}
@@ -0,0 +1,133 @@
+#pragma once
+#include <cstdint>
+
+// Button state of a controller with up to 128 buttons, built from button events (DirectInput's buffered input) instead of
+// polling and comparing every button each frame. A press sets the button's bit in the just pressed set, which lasts till the
+// next frame starts, so a press and release between two frames is still seen as a press. After events were lost (buffer
+// overflow) the state is resynchronized from a full state read and the difference counts as presses.
+namespace IGCS
+{
+	class ButtonSet
+	{
+	public:
+		static constexpr uint32_t kButtons = 128;
+
+		[[nodiscard]] bool test(uint32_t button) const noexcept
+		{
+			return button < kButtons && 0 != (_bits[button >> 6] & bit(button));
+		}
+
+		void set(uint32_t button) noexcept
+		{
+			if (button < kButtons)
+			{
+				_bits[button >> 6] |= bit(button);
+			}
+		}
+
+		void reset(uint32_t button) noexcept
+		{
+			if (button < kButtons)
+			{
+				_bits[button >> 6] &= ~bit(button);
+			}
+		}
+
+		void clear() noexcept
+		{
+			_bits[0] = 0;
+			_bits[1] = 0;
+		}
+
+		[[nodiscard]] bool any() const noexcept { return 0 != (_bits[0] | _bits[1]); }
+
+		// bits set here and not in other
+		[[nodiscard]] ButtonSet without(const ButtonSet& other) const noexcept
+		{
+			ButtonSet result;
+			result._bits[0] = _bits[0] & ~other._bits[0];
+			result._bits[1] = _bits[1] & ~other._bits[1];
+			return result;
+		}
+
+		ButtonSet& operator|=(const ButtonSet& other) noexcept
+		{
+			_bits[0] |= other._bits[0];
+			_bits[1] |= other._bits[1];
+			return *this;
+		}
+
+		bool operator==(const ButtonSet& other) const noexcept { return _bits[0] == other._bits[0] && _bits[1] == other._bits[1]; }
+
+	private:
+		static constexpr uint64_t bit(uint32_t button) noexcept { return uint64_t(1) << (button & 63); }
+
+		uint64_t _bits[2] = {};
+	};
+
+	struct ButtonEvent
+	{
+		uint32_t button = 0;
+		bool pressed = false;
+		uint32_t timestamp = 0;		// milliseconds, as reported by the device
+	};
+
+	class ButtonEdgeTracker
+	{
+	public:
+		// Starts a frame: presses of the previous frame are no longer just pressed.
+		void beginFrame() noexcept
+		{
+			_justPressed.clear();
+		}
+
+		void apply(const ButtonEvent& event) noexcept
+		{
+			if (event.button >= ButtonSet::kButtons)
+			{
+				return;
+			}
+			if (event.pressed)
+			{
+				if (!_down.test(event.button))
+				{
+					_down.set(event.button);
+					_justPressed.set(event.button);
+					_lastPressTimestamp = event.timestamp;
+				}
+			}
+			else
+			{
+				_down.reset(event.button);
+			}
+		}
+
+		// Replaces the state with a full read, after events were lost. Buttons down now which weren't before count as pressed.
+		void resync(const ButtonSet& down) noexcept
+		{
+			_justPressed |= down.without(_down);
+			_down = down;
+		}
+
+		// Forgets all state, e.g. when the device changed.
+		void reset() noexcept
+		{
+			_down.clear();
+			_justPressed.clear();
+			_lastPressTimestamp = 0;
+		}
+
+		[[nodiscard]] bool isDown(uint32_t button) const noexcept { return _down.test(button); }
+		// True only in the frame the button went down.
+		[[nodiscard]] bool isJustPressed(uint32_t button) const noexcept { return _justPressed.test(button); }
+		[[nodiscard]] const ButtonSet& down() const noexcept { return _down; }
+		[[nodiscard]] const ButtonSet& justPressed() const noexcept { return _justPressed; }
+		// device timestamp of the most recent press
+		[[nodiscard]] uint32_t lastPressTimestamp() const noexcept { return _lastPressTimestamp; }
+
+	private:
+		ButtonSet _down;
+		ButtonSet _justPressed;
+		uint32_t _lastPressTimestamp = 0;
+	};
+}
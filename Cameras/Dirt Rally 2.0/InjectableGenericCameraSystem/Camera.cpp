@@ -7,9 +7,9 @@
 #include "GameConstants.h"
 #include "Globals.h"
 #include "CameraManipulator.h"
-#include <windows.h> // For QueryPerformanceCounter, QueryPerformanceFrequency
 #include <DirectXMath.h>
 #include "Config.h"
+#include "SettingsRegistry.h"
 
 using namespace DirectX;
 
@@ -85,6 +85,48 @@ namespace IGCS
         return angle;
     }
 
+    void Camera::loadEffectSettings(const Settings& settings) noexcept
+    {
+        _effectSettingsGeneration = settings.generation;
+        _shakeAmplitude = settings.shakeAmplitude;
+        _shakeFrequency = settings.shakeFrequency;
+        _shakeEnabled = _shakeAmplitude > 0.0f;
+        _handheldIntensity = settings.handheldIntensity;
+        _handheldEnabled = _handheldIntensity > 0.0f;
+        _cameraNoise.reset();
+    }
+
+    // Shake and handheld settings sent by the client. They override the dr2tools.cfg values till the file is reloaded.
+    void Camera::applySettings(const SettingsRegistry& settings, const SettingMask& changed) noexcept
+    {
+        bool effectsChanged = false;
+        auto applyBool = [&](SettingType id, bool& member)
+        {
+            if (changed.test(id)) { member = settings.getBool(id); effectsChanged = true; }
+        };
+        auto applyFloat = [&](SettingType id, float& member)
+        {
+            if (changed.test(id)) { member = settings.getFloat(id); effectsChanged = true; }
+        };
+        applyBool(SettingType::CameraShakeToggle, _shakeEnabled);
+        applyFloat(SettingType::Amplitude, _shakeAmplitude);
+        applyFloat(SettingType::Frequency, _shakeFrequency);
+        applyBool(SettingType::HandheldCameraToggle, _handheldEnabled);
+        applyFloat(SettingType::HandheldIntensity, _handheldIntensity);
+        applyFloat(SettingType::HandheldDriftIntensity, _handheldDriftIntensity);
+        applyFloat(SettingType::HandheldJitterIntensity, _handheldJitterIntensity);
+        applyFloat(SettingType::HandheldBreathingIntensity, _handheldBreathingIntensity);
+        applyFloat(SettingType::HandheldBreatingRate, _handheldBreathingRate);
+        applyFloat(SettingType::HandheldDriftSpeed, _handheldDriftSpeed);
+        applyFloat(SettingType::HandheldRotationDriftSpeed, _handheldRotationDriftSpeed);
+        applyBool(SettingType::HandheldRotationToggle, _handheldRotationEnabled);
+        applyBool(SettingType::HandheldPositionToggle, _handheldPositionEnabled);
+        if (effectsChanged)
+        {
+            _cameraNoise.reset();
+        }
+    }
+
     // --------------------------------------------- FOV helpers ------------------------------------------------------
     void Camera::initFOV() noexcept
     {
@@ -146,6 +188,8 @@ namespace IGCS
 
         // Store the local offset in fixed mount position offset
         XMStoreFloat3(&_fixedMountPositionOffset, localOffset);
+        // New mount, so the head starts at rest
+        _headMotion.reset();
 
         // Calculate and store relative rotation as quaternion
         const XMVECTOR cameraRotVec = generateEulerQuaternion(cameraRotation, MULTIPLICATION_ORDER, false, false, false);
@@ -161,9 +205,17 @@ namespace IGCS
     {
         _hasValidLookAtTarget = false;
 
-        // Get player transform data
-        const XMVECTOR playerPosVec = GameSpecific::CameraManipulator::getCurrentPlayerPosition();
-        const XMVECTOR playerRotVec = GameSpecific::CameraManipulator::getCurrentPlayerRotation();
+        // Get player transform data from this frame's snapshot of the game state
+        const GameSpecific::GameStateSnapshot& gameState = GameSpecific::CameraManipulator::getGameState();
+        if (!GameSpecific::canPoseCamera(gameState))
+        {
+            // No car this frame: nothing is written so the last pose holds, head motion and smoothing keep their state
+            return;
+        }
+        const Smoothing::Vec3& playerPos = gameState.playerPosition;
+        const Smoothing::Quat& playerRot = gameState.playerRotation;
+        const XMVECTOR playerPosVec = XMVectorSet(playerPos.x, playerPos.y, playerPos.z, 0.0f);
+        const XMVECTOR playerRotVec = XMVectorSet(playerRot.x, playerRot.y, playerRot.z, playerRot.w);
 
         //if (DirectX::XMVector3Equal(playerPosVec, previousPlayerPosVec))
         //{
@@ -191,8 +243,42 @@ namespace IGCS
         // Direct quaternion and position calculation (most efficient)
         // This avoids matrix multiplication entirely
 
+        // Head motion: offset in player space driven by the car's acceleration
+        const Settings& settings = IGCS::Config::get();
+        if (settings.generation != _effectSettingsGeneration)
+        {
+            // dr2tools.cfg was reloaded
+            loadEffectSettings(settings);
+        }
+        Smoothing::HeadMotionParams headParams;
+        headParams.strength = settings.headMotionStrength;
+        headParams.damping = settings.headMotionDamping;
+        _headMotion.update(playerPos, playerRot, Globals::instance().getdeltaT(), headParams);
+        const Smoothing::Vec3& headOffset = _headMotion.offset();
+
+        // Shake / handheld noise, position part in player space as well
+        CameraEffects::ShakeParams shakeParams;
+        shakeParams.enabled = _shakeEnabled;
+        shakeParams.amplitude = _shakeAmplitude;
+        shakeParams.frequency = _shakeFrequency;
+        CameraEffects::HandheldParams handheldParams;
+        handheldParams.enabled = _handheldEnabled;
+        handheldParams.intensity = _handheldIntensity;
+        handheldParams.driftIntensity = _handheldDriftIntensity;
+        handheldParams.jitterIntensity = _handheldJitterIntensity;
+        handheldParams.breathingIntensity = _handheldBreathingIntensity;
+        handheldParams.breathingRate = _handheldBreathingRate;
+        handheldParams.driftSpeed = _handheldDriftSpeed;
+        handheldParams.rotationDriftSpeed = _handheldRotationDriftSpeed;
+        handheldParams.positionEnabled = _handheldPositionEnabled;
+        handheldParams.rotationEnabled = _handheldRotationEnabled;
+        _cameraNoise.update(Globals::instance().getdeltaT(), shakeParams, handheldParams);
+        const Smoothing::Vec3& noisePosition = _cameraNoise.positionOffset();
+        const Smoothing::Vec3& noiseRotation = _cameraNoise.rotationOffset();
+
         // Calculate camera position: player position + rotated offset
-        const XMVECTOR localOffset = XMLoadFloat3(&_fixedMountPositionOffset);
+        const XMVECTOR localOffset = XMVectorAdd(XMLoadFloat3(&_fixedMountPositionOffset),
+            XMVectorSet(headOffset.x + noisePosition.x, headOffset.y + noisePosition.y, headOffset.z + noisePosition.z, 0.0f));
         const XMVECTOR worldOffset = XMVector3Rotate(localOffset, playerRotVec);
         const XMVECTOR newCameraPos = XMVectorAdd(playerPosVec, worldOffset);
 
@@ -201,24 +287,26 @@ namespace IGCS
 
         // Calculate camera rotation: relative rotation * player rotation
         const XMVECTOR targetCameraRotQuat = XMQuaternionMultiply(_fixedMountRelativeRotation, playerRotVec);
-        const float blend = IGCS::Config::get().blend;
-        _smoothedCameraQuat = XMQuaternionSlerp(_smoothedCameraQuat, targetCameraRotQuat, blend);
+        XMFLOAT4 target;
+        XMStoreFloat4(&target, targetCameraRotQuat);
+        Smoothing::SmoothingParams smoothingParams;
+        smoothingParams.blend = settings.blend;
+        const Smoothing::Quat smoothed = _rotationSmoother.update({ target.x, target.y, target.z, target.w }, smoothingParams);
+        const XMVECTOR smoothedCameraQuat = XMVectorSet(smoothed.x, smoothed.y, smoothed.z, smoothed.w);
+        // Noise rotation is applied in camera space on top of the smoothed rotation, it's not fed back into the
+        // smoothing. The angles are small angles (radians): the normalized small angle quaternion turns by 2 * atan(a / 2)
+        // instead of a, which is less than 1% short up to 0.35 rad (20 degrees). The shake adds at most 0.05 rad per axis
+        // and the handheld noise at most 5 * (5 * 0.01 + 5 * 0.001), so even with every setting at its maximum the
+        // rotation stays under 0.6 rad and 3% short. That's exact enough for noise and needs no trig.
+        const XMVECTOR noiseQuat = XMQuaternionNormalize(XMVectorSet(noiseRotation.x * 0.5f, noiseRotation.y * 0.5f, noiseRotation.z * 0.5f, 1.0f));
         // Store quaternion directly
-        XMStoreFloat4(&_toolsQuaternion, _smoothedCameraQuat);
-
-        // Update camera data in game memory
-        GameSpecific::CameraManipulator::updateCameraDataInGameData();
-
-        // Get final position and rotation
-        XMFLOAT3 finalPosition = _toolsCoordinates;
-        XMVECTOR finalRotation = XMLoadFloat4(&_toolsQuaternion);
-
-        // Update tools quaternion with final rotation
-        XMStoreFloat4(&_toolsQuaternion, finalRotation);
-
-        // Write final values to game memory
-        GameSpecific::CameraManipulator::writeNewCameraValuesToGameData(finalPosition, finalRotation);
+        XMStoreFloat4(&_toolsQuaternion, XMQuaternionMultiply(noiseQuat, smoothedCameraQuat));
 
+        // Single write of the final pose to game memory, unchanged values are skipped
+        CameraCommit commit;
+        commit.position = _toolsCoordinates;
+        commit.rotation = _toolsQuaternion;
+        GameSpecific::CameraManipulator::commitCameraValues(commit);
     }
 
     // --------------------------------------------- Bridging ---------------------------------------------------------
@@ -240,8 +328,16 @@ namespace IGCS
     }
 
     //--------------------------- Camera Prep
+    void Camera::initialize()
+    {
+        // baking the noise table takes too long for the frame the camera is enabled in
+        _cameraNoise.setTable(new CameraEffects::NoiseTable()); // intentionally leaked on process exit
+    }
+
     void Camera::prepareCamera() noexcept
     {
+        // Shake and handheld settings from dr2tools.cfg
+        loadEffectSettings(IGCS::Config::get());
         // Initialize internal position from game memory
         _toolsCoordinates = GameSpecific::CameraManipulator::getCurrentCameraCoords();
         // Set camera fov to game fov
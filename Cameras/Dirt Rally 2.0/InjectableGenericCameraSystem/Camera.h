@@ -3,13 +3,18 @@
 
 #include <DirectXMath.h>
 #include <algorithm>
+#include "CameraSmoothing.h"
 #include "CameraToolsData.h"
 #include "GameCameraData.h"
+#include "HeadMotionModel.h"
+#include "ProceduralNoise.h"
 #include "Utils.h"
 
 namespace IGCS
 {
 	struct Settings; //forward declaration because
+	class SettingsRegistry;
+	class SettingMask;
 
 	class Camera
     {
@@ -84,6 +89,10 @@ namespace IGCS
         void setTargetYaw(float a) noexcept { _targetyaw = clampAngle(a); }
         void setTargetRoll(float a) noexcept { _targetroll = clampAngle(a); }
         void prepareCamera() noexcept;
+        // Builds what the camera needs before it can be enabled, once, at startup and not on the render thread
+        void initialize();
+        // Takes over the effect settings the client changed. Between frames only.
+        void applySettings(const SettingsRegistry& settings, const SettingMask& changed) noexcept;
 
         //float shortestAngleDifference(float current, float target) noexcept;
 
@@ -199,7 +208,7 @@ namespace IGCS
         XMFLOAT4 _gameQuaternion{};
 
         XMVECTOR _smoothedCameraPos = XMVectorZero();
-        XMVECTOR _smoothedCameraQuat = XMQuaternionIdentity();
+        Smoothing::RotationSmoother _rotationSmoother;  // mounted camera rotation, the smoothing Tools/SmoothingOptimizer tunes
 
         float _lookDirectionInverter{ 1.0f };
         bool  _movementOccurred{ false };
@@ -221,6 +230,7 @@ namespace IGCS
         XMFLOAT3 _fixedMountPositionOffset{ 0.0f, 0.0f, 0.0f };  // relative position in player's local space
         XMMATRIX _fixedMountRelativeTransform{ XMMatrixIdentity() };  // relative transformation matrix from player to camera
         XMVECTOR _fixedMountRelativeRotation{ XMQuaternionIdentity() };
+        Smoothing::HeadMotionModel _headMotion;  // g-force driven head offset added to the mount position
 
         //  Euler order constant (compile time selectable for debug)
 #ifdef DEBUG
@@ -231,8 +241,10 @@ namespace IGCS
 
         //  Helpers -------------------------------------------------------------------------------
         static float clampAngle(float angle) noexcept;
+        void loadEffectSettings(const Settings& settings) noexcept;
 
         // Camera shake (simple effect)
+        uint32_t _effectSettingsGeneration{ 0 };    // Settings::generation the effects were loaded from
         bool _shakeEnabled{ false };
         float _shakeTime{ 0.0f };
         float _shakeAmplitude{ 0.0f };
@@ -252,6 +264,7 @@ namespace IGCS
         bool _handheldRotationEnabled{ true };
         //XMVECTOR _handheldPositionVelocity{ XMVectorZero() };
         //XMVECTOR _handheldRotationVelocity{ XMVectorZero() };
+        CameraEffects::CameraNoise _cameraNoise;  // table driven noise for shake and handheld
 
         // Store the current look-at target position for visualization (only valid in target offset mode)
         XMFLOAT3 _currentLookAtTargetPosition{ 0.0f, 0.0f, 0.0f };
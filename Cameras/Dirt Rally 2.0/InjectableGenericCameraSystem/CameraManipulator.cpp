@@ -33,6 +33,9 @@
 #include "GameCameraData.h"
 #include "MessageHandler.h"
 #include "Console.h"
+#include "GameMemory.h"
+#include "PageValidityCache.h"
+#include "MonotonicClock.h"
 
 using namespace DirectX;
 using namespace std;
@@ -44,74 +47,180 @@ extern "C" {
 	uint8_t* g_carPositionAddress = nullptr;
 	uint8_t* g_timescaleAddress = nullptr;
 	uint8_t* g_dofStrengthAddress = nullptr;
+	// set by carPositionInterceptor each time the game updates the car: TSC timestamp and a running count
+	uint64_t g_carStateTimestamp = 0;
+	uint64_t g_carStateSequence = 0;
 }
 
 namespace IGCS::GameSpecific::CameraManipulator
 {
 	static float cachedGamespeedPause = 1.0f;
 	static float cachedGamespeedSlowMo = 1.0f;
+	// written by the camera commit and read by the frame, both under System's frame mutex whichever thread triggers them
+	static CameraCommitCounters commitCounters;
+	static LatencyHistogram carStateToWriteLatency;
+	static uint64_t lastMeasuredCarSequence = 0;
+	// Records the time from the car state update the camera is based on to now, the moment it's written. The interceptor
+	// stamps the car state with rdtsc, so this needs the TSC calibration of the clock and is skipped without an invariant TSC.
+	static void measureCarStateLatency()
+	{
+		const double tscTicksPerSecond = MonotonicClock::tscTicksPerSecond();
+		if (tscTicksPerSecond <= 0.0)
+		{
+			return;
+		}
+		const uint64_t now = MonotonicClock::readTsc();
+		const uint64_t sequence = g_carStateSequence;
+		if (sequence == lastMeasuredCarSequence)
+		{
+			// no new car state since the last write
+			return;
+		}
+		lastMeasuredCarSequence = sequence;
+		const uint64_t carStateTime = g_carStateTimestamp;
+		if (now > carStateTime)
+		{
+			carStateToWriteLatency.add(static_cast<double>(now - carStateTime) / tscTicksPerSecond);
+		}
+	}
 
-	bool validatePLayerPositionMemory() {
-		if (!g_cameraPositionAddress) {
+	// writes value to destination if it's not already there. Returns true if it wrote.
+	template<typename T>
+	static bool writeIfChanged(void* destination, const T& value)
+	{
+		if (0 == memcmp(destination, &value, sizeof(T)))
+		{
+			++commitCounters.valuesSkipped;
 			return false;
 		}
-		__try {
-			// Try to read critical camera data to validate accessibility
-			volatile float testRead;
-			// Test reading position data
-			const auto pos = reinterpret_cast<float*>(g_carPositionAddress + PLAYER_ROTATION_IN_STRUCT_OFFSET);
-			testRead = *pos;
+		memcpy(destination, &value, sizeof(T));
+		++commitCounters.valuesWritten;
+		return true;
+	}
+
+	// Region lookups for the page validity cache. Readable means committed, not a guard page and not no-access.
+	class HostRegionProvider : public IMemoryRegionProvider
+	{
+	public:
+		bool queryRegion(uintptr_t address, MemoryRegion& region) noexcept override
+		{
+			MEMORY_BASIC_INFORMATION info;
+			if (0 == VirtualQuery(reinterpret_cast<LPCVOID>(address), &info, sizeof(info)))
+			{
+				return false;
+			}
+			const DWORD readableFlags = PAGE_READONLY | PAGE_READWRITE | PAGE_WRITECOPY | PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY;
+			region.start = reinterpret_cast<uintptr_t>(info.BaseAddress);
+			region.end = region.start + info.RegionSize;
+			region.readable = MEM_COMMIT == info.State && 0 != (info.Protect & readableFlags) && 0 == (info.Protect & (PAGE_GUARD | PAGE_NOACCESS));
 			return true;
 		}
-		__except (EXCEPTION_EXECUTE_HANDLER) {
-			// Memory became inaccessible
+	};
 
-			g_cameraPositionAddress = nullptr;
-			return false;
+	// Reads the host's memory directly. Pointers are checked against the page validity cache first, which costs a region
+	// lookup only the first time a page is seen. The copy itself stays guarded (free on x64 unless it faults) for a
+	// page which got freed since it was looked up; its cache entry is dropped then.
+	class HostGameMemory : public IGameMemory
+	{
+	public:
+		explicit HostGameMemory(PageValidityCache& validityCache) : _validityCache(validityCache)
+		{
 		}
-	}
 
+		bool read(const uint8_t* source, void* destination, size_t size) noexcept override
+		{
+			if (!_validityCache.isReadable(source, size))
+			{
+				return false;
+			}
+			if (!guardedCopy(source, destination, size))
+			{
+				_validityCache.invalidate(source);
+				_validityCache.invalidate(source + size - 1);
+				return false;
+			}
+			return true;
+		}
 
-	bool validateCameraMemory() {
-		if (!g_cameraStructAddress) {
-			return false;
+	private:
+		static bool guardedCopy(const uint8_t* source, void* destination, size_t size) noexcept
+		{
+			__try
+			{
+				memcpy(destination, source, size);
+				return true;
+			}
+			__except (EXCEPTION_EXECUTE_HANDLER)
+			{
+				return false;
+			}
 		}
 
-		__try {
-			// Try to read critical camera data to validate accessibility
-			volatile float testRead;
+		PageValidityCache& _validityCache;
+	};
 
-			// Test reading quaternion data
-			const auto q = reinterpret_cast<float*>(g_cameraStructAddress + QUATERNION_IN_STRUCT_OFFSET);
-			testRead = *q;
+	static HostRegionProvider regionProvider;
+	static PageValidityCache validityCache(regionProvider);
+	static HostGameMemory hostMemory(validityCache);
+	static GameStateSnapshot gameState;
 
-			return true;
-		}
-		__except (EXCEPTION_EXECUTE_HANDLER) {
+	void captureGameState()
+	{
+		GameStateAddresses addresses;
+		addresses.carAddress = g_carPositionAddress;
+		addresses.cameraAddress = g_cameraStructAddress;
+		addresses.cameraQuaternionAddress = g_cameraQuaternionAddress;
+		validityCache.nextFrame();
+		GameSpecific::captureGameState(hostMemory, addresses, gameState);
+		if (GameSpecific::cameraStructLost(addresses, gameState))
+		{
 			// Memory became inaccessible
 			g_cameraStructAddress = nullptr;
-			return false;
 		}
 	}
 
-	void updateCameraDataInGameData()
+	const GameStateSnapshot& getGameState()
 	{
-		if (!g_cameraEnabled)
-			return;
+		return gameState;
+	}
 
-		if (!System::instance().isCameraStructValid)
+	// The one place the camera writes to game memory each frame. The camera struct is validated once, then every value
+	// is compared with what's currently in memory and only written if it differs. Comparing with memory instead of a
+	// copy of the last write also catches the game having changed a value in between.
+	void commitCameraValues(const CameraCommit& commit)
+	{
+		if (!g_cameraEnabled || !isCameraFound() || !System::instance().isCameraStructValid)
+		{
+			++commitCounters.commitsRejected;
 			return;
+		}
 
-		static const auto& c = Camera::instance();
-
-		const XMVECTOR newLookQuaternion = c.getToolsQuaternionVector();
-		if (isCameraFound())
+		writeIfChanged(g_cameraStructAddress + COORDS_IN_STRUCT_OFFSET, commit.position);
+		writeIfChanged(g_cameraStructAddress + QUATERNION_IN_STRUCT_OFFSET, commit.rotation);
+		if (commit.writeFov)
+		{
+			writeIfChanged(g_cameraStructAddress + FOV_IN_STRUCT_OFFSET, commit.fov);
+		}
+		if (commit.writeMotionBlur && nullptr != g_cameraQuaternionAddress)
 		{
-			const XMFLOAT3 currentCoords = c.getInternalPosition();
-			XMFLOAT3 newCoords;
-			newCoords = Camera::instance().calculateNewCoords(currentCoords, newLookQuaternion);
-			writeNewCameraValuesToGameData(newCoords, newLookQuaternion);
+			writeIfChanged(g_cameraQuaternionAddress + MOTION_BLUR_STRENGTH_FROM_CAMQUATERNION_OFFSET, commit.motionBlur);
 		}
+		measureCarStateLatency();
+	}
+
+	CameraCommitCounters getCameraCommitCounters()
+	{
+		return commitCounters;
+	}
+
+	const LatencyHistogram& getCarStateLatency()
+	{
+		return carStateToWriteLatency;
+	}
+
+	void resetCarStateLatency()
+	{
+		carStateToWriteLatency.reset();
 	}
 
 	uint8_t* getCameraStructAddress() {
@@ -139,26 +248,12 @@ namespace IGCS::GameSpecific::CameraManipulator
 
 	float getNearZ()
 	{
-		if (!g_cameraQuaternionAddress)
-			return 0.1f;
-
-		if (!System::instance().isCameraStructValid)
-			return 0.1f;
-
-		const auto nearZAddress = reinterpret_cast<float*>(g_cameraQuaternionAddress + NEAR_Z_FROM_QUATERNION_OFFSET);
-		return *nearZAddress;
-
-		//return 0.1f;
+		return gameState.nearZ;
 	}
 
 	float getMotionBlur()
 	{
-		if (!g_cameraStructAddress)
-			return 0.0f;
-		if (!System::instance().isCameraStructValid)
-			return 0.0f;
-		const auto motionBlurAddress = reinterpret_cast<float*>(g_cameraQuaternionAddress + MOTION_BLUR_STRENGTH_FROM_CAMQUATERNION_OFFSET);
-		return *motionBlurAddress;
+		return gameState.motionBlur;
 	}
 
 	void setMotionBlur(float amount)
@@ -215,62 +310,29 @@ namespace IGCS::GameSpecific::CameraManipulator
 
 	float getCurrentFoV()
 	{
-		if (!g_cameraStructAddress)
-			return DEFAULT_FOV;
-
-		const auto fovAddress = reinterpret_cast<float*>(g_cameraStructAddress + FOV_IN_STRUCT_OFFSET);
-		return *fovAddress;
+		return gameState.fov;
 	}
 	
 
 	XMFLOAT3 getCurrentCameraCoords()
 	{
-		if (!g_cameraStructAddress){
-			return { 0.0f, 0.0f, 0.0f }; // Return a default value if the address is not valid
-		}
-
-		if (!System::instance().isCameraStructValid)
-			return { 0.0f, 0.0f, 0.0f };
-
-		const auto coordsInMemory = reinterpret_cast<float*>(g_cameraStructAddress + COORDS_IN_STRUCT_OFFSET);
-		return { coordsInMemory[0], coordsInMemory[1], coordsInMemory[2] };
-
+		return { gameState.cameraCoords.x, gameState.cameraCoords.y, gameState.cameraCoords.z };
 	}
 
 	XMVECTOR getCurrentCameraCoordsVector()
 	{
-		if (!g_cameraStructAddress)
-			return XMVECTOR(XMVectorSet(0.0f, 0.0f, 0.0f, 0.0f)); // Return a default vector if the address is not valid
-
-		if (!System::instance().isPlayerStructValid)
-			return { 0.0f, 0.0f, 0.0f };
-
-		const auto coordsInMemory = reinterpret_cast<float*>(g_cameraStructAddress + COORDS_IN_STRUCT_OFFSET);
-		return XMVECTOR(XMVectorSet(coordsInMemory[0], coordsInMemory[1], coordsInMemory[2], 0.0f));
+		return XMVectorSet(gameState.cameraCoords.x, gameState.cameraCoords.y, gameState.cameraCoords.z, 0.0f);
 	}
 
 	XMVECTOR getCurrentPlayerPosition()
 	{
-		if (!g_carPositionAddress)
-			return XMVECTOR(XMVectorSet(0.0f, 0.0f, 0.0f, 0.0f)); // Return a default vector if the address is not valid
-
-		if (!System::instance().isPlayerStructValid)
-			return XMVECTOR(XMVectorSet(0.0f, 0.0f, 0.0f, 0.0f));
-
-		const auto coordsInMemory = reinterpret_cast<float*>(g_carPositionAddress + PLAYER_POSITION_IN_STRUCT_OFFSET);
-		return XMVECTOR(XMVectorSet(coordsInMemory[0], coordsInMemory[1], coordsInMemory[2], 0.0f));
+		return XMVectorSet(gameState.playerPosition.x, gameState.playerPosition.y, gameState.playerPosition.z, 0.0f);
 	}
 
 	XMVECTOR getCurrentPlayerRotation()
 	{
-		if (!g_carPositionAddress)
-			return XMVECTOR(XMVectorSet(0.0f, 0.0f, 0.0f, 0.0f)); // Return a default vector if the address is not valid
-
-		if (!System::instance().isPlayerStructValid)
-			return XMVECTOR(XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f));
-
-		const auto r = reinterpret_cast<float*>(g_carPositionAddress + PLAYER_ROTATION_IN_STRUCT_OFFSET);
-		return XMVECTOR(XMVectorSet(r[0], r[1], r[2], r[3]));
+		const Smoothing::Quat& r = gameState.playerRotation;
+		return XMVectorSet(r.x, r.y, r.z, r.w);
 	}
 
 	void setCurrentCameraCoords(XMFLOAT3 coords)
@@ -286,35 +348,6 @@ namespace IGCS::GameSpecific::CameraManipulator
 	}
 
 
-	void writeNewCameraValuesToGameData(XMFLOAT3& newCoords,XMVECTOR newLookQuaternion)
-	{
-		if (!isCameraFound())
-			return;
-
-		if (!System::instance().isCameraStructValid)
-			return;
-
-		auto c = reinterpret_cast<float*>(g_cameraStructAddress + COORDS_IN_STRUCT_OFFSET);
-		auto q = reinterpret_cast<XMFLOAT4*>(g_cameraStructAddress + QUATERNION_IN_STRUCT_OFFSET);
-
-		// 1) load position, set w=1
-		XMVECTOR pos = XMVectorSet(newCoords.x,newCoords.y,newCoords.z,1.0f);
-
-		memcpy(c, &pos, 3 * sizeof(float));
-		XMStoreFloat4(q, newLookQuaternion);
-		//memcpy(q, &newLookQuaternion, 4 * sizeof(float));
-
-	}
-
-	// Version that takes XMVECTOR
-	void writeNewCameraValuesToGameData(const XMVECTOR newCoords, const XMVECTOR newLookQuaternion)
-	{
-		// Convert XMVECTOR to XMFLOAT3 and call the other overload
-		XMFLOAT3 coordsFloat3;
-		XMStoreFloat3(&coordsFloat3, newCoords);
-		writeNewCameraValuesToGameData(coordsFloat3, newLookQuaternion);
-	}
-
 	bool isCameraFound()
 	{
 		return nullptr != g_cameraStructAddress;
@@ -416,11 +449,10 @@ namespace IGCS::GameSpecific::CameraManipulator
 
 	void setMatrixRotationVectors()
 	{
-		if (!g_cameraStructAddress) return;
-		if (!System::instance().isCameraStructValid) return;
+		if (!gameState.cameraValid) return;
 
-		const auto q = reinterpret_cast<XMFLOAT4*>(g_cameraStructAddress + QUATERNION_IN_STRUCT_OFFSET);
-		const XMVECTOR qv = XMLoadFloat4(q);
+		const XMFLOAT4 q(gameState.cameraQuaternion.x, gameState.cameraQuaternion.y, gameState.cameraQuaternion.z, gameState.cameraQuaternion.w);
+		const XMVECTOR qv = XMLoadFloat4(&q);
 		const auto m = XMMatrixRotationQuaternion(qv);
 
 		XMFLOAT3 r, u, f;
@@ -431,16 +463,16 @@ namespace IGCS::GameSpecific::CameraManipulator
 		Camera::instance().setRightVector(r);
 		Camera::instance().setUpVector(u);
 		Camera::instance().setForwardVector(f);
-		Camera::instance().setGameQuaternion(*q);
+		Camera::instance().setGameQuaternion(q);
 		Camera::instance().setGameEulers(Utils::QuaternionToEulerAngles(qv, MULTIPLICATION_ORDER));
 	}
 
 	XMFLOAT3 getEulers()
 	{
-		if (!System::instance().isCameraStructValid)
+		if (!gameState.cameraValid)
 			return {0.0f,0.0f,0.0f};
 
-		const auto q = static_cast<XMFLOAT4>(reinterpret_cast<float*>(g_cameraStructAddress + QUATERNION_IN_STRUCT_OFFSET));
+		const XMFLOAT4 q(gameState.cameraQuaternion.x, gameState.cameraQuaternion.y, gameState.cameraQuaternion.z, gameState.cameraQuaternion.w);
 		const XMVECTOR qv = XMLoadFloat4(&q);
 		return Utils::QuaternionToEulerAngles(qv, MULTIPLICATION_ORDER);
 	}
@@ -29,6 +29,8 @@
 #include "stdafx.h"
 
 #include "GameCameraData.h"
+#include "GameStateSnapshot.h"
+#include "LatencyHistogram.h"
 
 
 //extern "C" {
@@ -43,9 +45,10 @@ namespace IGCS::GameSpecific::CameraManipulator
 {
 
 
-	void updateCameraDataInGameData();
-	void writeNewCameraValuesToGameData(DirectX::XMFLOAT3& newCoords, DirectX::XMVECTOR newLookQuaternion);
-	void writeNewCameraValuesToGameData(DirectX::XMVECTOR newCoords, DirectX::XMVECTOR newLookQuaternion);
+	void commitCameraValues(const CameraCommit& commit);
+	CameraCommitCounters getCameraCommitCounters();
+	const LatencyHistogram& getCarStateLatency();
+	void resetCarStateLatency();
 	DirectX::XMFLOAT3 getCurrentCameraCoords();
 	DirectX::XMVECTOR getCurrentCameraCoordsVector();
 	DirectX::XMVECTOR getCurrentPlayerPosition();
@@ -69,8 +72,8 @@ namespace IGCS::GameSpecific::CameraManipulator
 	void setCurrentCameraCoords(DirectX::XMFLOAT3 coords);
 	float getNearZ();
 	uint8_t* getCameraStructAddress();
-	bool validateCameraMemory();
-	bool validatePLayerPositionMemory();
+	void captureGameState();
+	const GameStateSnapshot& getGameState();
 	float getMotionBlur();
 
 	/// <summary>
@@ -0,0 +1,147 @@
+#pragma once
+#include <cmath>
+
+// Platform neutral version of the smoothing done in Camera::updateCamera. Used by the offline tools (see Tools/) so they
+// evaluate exactly what the camera does in game, without needing DirectXMath or Windows. Conventions follow DirectXMath:
+// quaternions are (x, y, z, w) and multiply(a, b) means 'rotate by a, then by b', like XMQuaternionMultiply.
+namespace IGCS::Smoothing
+{
+	struct Vec3
+	{
+		float x = 0.0f;
+		float y = 0.0f;
+		float z = 0.0f;
+	};
+
+	struct Quat
+	{
+		float x = 0.0f;
+		float y = 0.0f;
+		float z = 0.0f;
+		float w = 1.0f;
+	};
+
+	inline float dot(const Quat& a, const Quat& b) noexcept
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+	}
+
+	inline Quat conjugate(const Quat& q) noexcept
+	{
+		return { -q.x, -q.y, -q.z, q.w };
+	}
+
+	inline Quat normalize(const Quat& q) noexcept
+	{
+		const float len = std::sqrt(dot(q, q));
+		if (len <= 0.0f)
+		{
+			return {};
+		}
+		const float inv = 1.0f / len;
+		return { q.x * inv, q.y * inv, q.z * inv, q.w * inv };
+	}
+
+	// Same semantics as XMQuaternionMultiply(a, b): the result rotates by a first, then by b.
+	inline Quat multiply(const Quat& a, const Quat& b) noexcept
+	{
+		return {
+			b.w * a.x + b.x * a.w + b.y * a.z - b.z * a.y,
+			b.w * a.y - b.x * a.z + b.y * a.w + b.z * a.x,
+			b.w * a.z + b.x * a.y - b.y * a.x + b.z * a.w,
+			b.w * a.w - b.x * a.x - b.y * a.y - b.z * a.z
+		};
+	}
+
+	// Mirrors XMQuaternionSlerp, including the shortest-arc sign flip and the linear fallback for nearly equal inputs.
+	inline Quat slerp(const Quat& q0, const Quat& q1, float t) noexcept
+	{
+		float cosOmega = dot(q0, q1);
+		const float sign = cosOmega < 0.0f ? -1.0f : 1.0f;
+		cosOmega *= sign;
+
+		float s0;
+		float s1;
+		if (cosOmega < 1.0f - 0.00001f)
+		{
+			const float sinOmega = std::sqrt(1.0f - cosOmega * cosOmega);
+			const float omega = std::atan2(sinOmega, cosOmega);
+			s0 = std::sin((1.0f - t) * omega) / sinOmega;
+			s1 = std::sin(t * omega) / sinOmega;
+		}
+		else
+		{
+			s0 = 1.0f - t;
+			s1 = t;
+		}
+		s1 *= sign;
+		return { q0.x * s0 + q1.x * s1, q0.y * s0 + q1.y * s1, q0.z * s0 + q1.z * s1, q0.w * s0 + q1.w * s1 };
+	}
+
+	// Rotation angle (radians, 0..pi) needed to go from a to b.
+	inline float angleBetween(const Quat& a, const Quat& b) noexcept
+	{
+		const float d = std::fabs(dot(a, b));
+		return 2.0f * std::acos(d > 1.0f ? 1.0f : d);
+	}
+
+	// Rotation vector (axis * angle) of the relative rotation taking a to b, expressed in a's frame.
+	inline Vec3 relativeRotationVector(const Quat& a, const Quat& b) noexcept
+	{
+		// multiply(b, conj(a)) is conj(a) * b in Hamilton order: the delta applied in a's local frame.
+		Quat d = multiply(b, conjugate(a));
+		if (d.w < 0.0f)
+		{
+			d = { -d.x, -d.y, -d.z, -d.w };
+		}
+		const float sinHalf = std::sqrt(d.x * d.x + d.y * d.y + d.z * d.z);
+		if (sinHalf < 1e-7f)
+		{
+			// small angle: angle ~= 2 * sin(angle/2)
+			return { 2.0f * d.x, 2.0f * d.y, 2.0f * d.z };
+		}
+		const float angle = 2.0f * std::atan2(sinHalf, d.w);
+		const float scale = angle / sinHalf;
+		return { d.x * scale, d.y * scale, d.z * scale };
+	}
+
+	inline Vec3 rotate(const Vec3& v, const Quat& q) noexcept
+	{
+		// v' = v + 2w(u x v) + 2u x (u x v), with u the vector part of q
+		const float tx = 2.0f * (q.y * v.z - q.z * v.y);
+		const float ty = 2.0f * (q.z * v.x - q.x * v.z);
+		const float tz = 2.0f * (q.x * v.y - q.y * v.x);
+		return {
+			v.x + q.w * tx + (q.y * tz - q.z * ty),
+			v.y + q.w * ty + (q.z * tx - q.x * tz),
+			v.z + q.w * tz + (q.x * ty - q.y * tx)
+		};
+	}
+
+	// The parameters Camera::updateCamera reads from dr2tools.cfg.
+	struct SmoothingParams
+	{
+		float blend = 0.12f;
+	};
+
+	// Per-frame rotation smoother, identical to the slerp towards the mounted target rotation in Camera::updateCamera.
+	class RotationSmoother
+	{
+	public:
+		void reset(const Quat& start) noexcept
+		{
+			_state = start;
+		}
+
+		Quat update(const Quat& target, const SmoothingParams& params) noexcept
+		{
+			_state = slerp(_state, target, params.blend);
+			return _state;
+		}
+
+		[[nodiscard]] const Quat& current() const noexcept { return _state; }
+
+	private:
+		Quat _state{};
+	};
+}
@@ -2,14 +2,18 @@
 #include "Config.h"
 
 #include <filesystem>
-#include <fstream>
+#include <sstream>
 #include <string>
 #include <algorithm>
 #include <cctype>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <vector>
 
+#include "FileWatcher.h"
 #include "MessageHandler.h"
+#include "SnapshotStore.h"
 
 namespace fs = std::filesystem;
 
@@ -137,14 +141,180 @@ namespace IGCS
         return false;
     }
 
+    static std::optional<CameraUpdateTrigger> parseUpdateTrigger(const std::string& raw)
+    {
+        std::string v = toLower(raw);
+        trim(v);
+        if (v == "present") return CameraUpdateTrigger::Present;
+        if (v == "backbuffer_bind") return CameraUpdateTrigger::BackBufferBind;
+        if (v == "car_update") return CameraUpdateTrigger::CarUpdate;
+        return std::nullopt;
+    }
+
     static bool isSingleBit(uint16_t v) { return v && ((v & (v - 1)) == 0); }
 
+    // Float settings which only need a range check
+    struct RangedFloatSetting
+    {
+        const char* key;
+        float Settings::* member;
+        float minValue;
+        float maxValue;
+        bool specified = false;
+    };
+
+    static void parseRangedFloat(RangedFloatSetting& setting, const std::string& val, const Settings& current, Settings& result)
+    {
+        setting.specified = true;
+        try
+        {
+            float parsed = std::stof(val);
+            if (parsed < setting.minValue || parsed > setting.maxValue)
+            {
+                result.*setting.member = current.*setting.member;
+                MessageHandler::logError("Config: %s value '%s' out of range (%g..%g). Keeping the current value (%.6f).",
+                    setting.key, val.c_str(), setting.minValue, setting.maxValue, result.*setting.member);
+                return;
+            }
+            result.*setting.member = parsed;
+            MessageHandler::logLine("Config: read %s=%.6f from ini", setting.key, parsed);
+        }
+        catch (...)
+        {
+            result.*setting.member = current.*setting.member;
+            MessageHandler::logError("Config: invalid value for '%s' ('%s'). Keeping the current value (%.6f).", setting.key, val.c_str(),
+                result.*setting.member);
+        }
+    }
+
+    // ---------------- current settings ----------------
+
+    // Constant initialized, Config::get() may be called during the static initialization of other files
+    static SnapshotStore<Settings> s_settings;
+    static FileWatcher* s_watcher = nullptr;
+
+    // Serializes the first load and the reloads. Function local, so it exists whenever the first get() happens.
+    static std::mutex& loadMutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    // contents the current settings were parsed from, under loadMutex()
+    static std::string& loadedContents()
+    {
+        static std::string contents;
+        return contents;
+    }
+
+    class ConfigReloader : public IFileChangeListener
+    {
+    public:
+        void fileChanged(const std::string& contents) override
+        {
+            Config::reload(contents);
+        }
+    };
+    static ConfigReloader s_reloader;
+
     // -------------------------------------------------
 
+    const char* Config::triggerToName(CameraUpdateTrigger trigger)
+    {
+        switch (trigger)
+        {
+        case CameraUpdateTrigger::Present: return "present";
+        case CameraUpdateTrigger::BackBufferBind: return "backbuffer_bind";
+        case CameraUpdateTrigger::CarUpdate: return "car_update";
+        default: return "unknown";
+        }
+    }
+
     const Settings& Config::get()
     {
-        static Settings s = load();
-        return s;
+        const Settings* settings = s_settings.get();
+        return nullptr != settings ? *settings : load();
+    }
+
+    const Settings& Config::load()
+    {
+        std::lock_guard<std::mutex> lock(loadMutex());
+        if (const Settings* settings = s_settings.get())
+        {
+            return *settings;       // another thread was first
+        }
+        const std::wstring cfgPath = findConfigPath();
+        MessageHandler::logLine("Config: loading dr2tools.cfg from '%s'", narrow(cfgPath).c_str());
+        std::string& contents = loadedContents();
+        const bool found = FileWatcher::readFile(cfgPath, contents);
+        s_settings.publish(std::make_unique<const Settings>(parse(contents, found, Settings())));
+        return *s_settings.get();
+    }
+
+    void Config::reload(const std::string& contents)
+    {
+        std::lock_guard<std::mutex> lock(loadMutex());
+        const Settings* current = s_settings.get();
+        MessageHandler::logLine("Config: dr2tools.cfg changed, reloading");
+        auto next = std::make_unique<Settings>(parse(contents, true, *current));
+        next->generation = current->generation + 1;
+        // these are only read when the subsystems start, keep them in line with what is running
+        if (next->ConsoleEnabled != current->ConsoleEnabled)
+        {
+            MessageHandler::logLine("Config: ConsoleEnabled only takes effect after a restart");
+            next->ConsoleEnabled = current->ConsoleEnabled;
+        }
+        if (next->LogFileEnabled != current->LogFileEnabled)
+        {
+            MessageHandler::logLine("Config: LogFileEnabled only takes effect after a restart");
+            next->LogFileEnabled = current->LogFileEnabled;
+        }
+        if (next->cameraEnableGamepadMask != current->cameraEnableGamepadMask)
+        {
+            MessageHandler::logLine("Config: camera_enable_gamepad only takes effect after a restart");
+            next->cameraEnableGamepadMask = current->cameraEnableGamepadMask;
+        }
+        if (next->cameraUpdateTrigger != current->cameraUpdateTrigger)
+        {
+            MessageHandler::logLine("Config: camera_update_trigger only takes effect after a restart");
+            next->cameraUpdateTrigger = current->cameraUpdateTrigger;
+        }
+        if (next->inputPollRate != current->inputPollRate)
+        {
+            MessageHandler::logLine("Config: input_poll_rate only takes effect after a restart");
+            next->inputPollRate = current->inputPollRate;
+        }
+        loadedContents() = contents;
+        s_settings.publish(std::move(next));
+    }
+
+    void Config::startWatching()
+    {
+        if (nullptr != s_watcher)
+        {
+            return;
+        }
+        get();      // the watcher starts from the contents the current settings came from
+        std::string contents;
+        {
+            std::lock_guard<std::mutex> lock(loadMutex());
+            contents = loadedContents();
+        }
+        s_watcher = new FileWatcher(); // intentionally leaked on process exit
+        if (!s_watcher->start(findConfigPath(), s_reloader, contents))
+        {
+            MessageHandler::logError("Config: can't watch dr2tools.cfg for changes, restart the game to apply changes");
+            return;
+        }
+        MessageHandler::logLine("Config: watching dr2tools.cfg for changes");
+    }
+
+    void Config::stopWatching()
+    {
+        if (nullptr != s_watcher)
+        {
+            s_watcher->stop();
+        }
     }
 
     std::wstring Config::findConfigPath()
@@ -165,22 +335,31 @@ namespace IGCS
         return (fs::current_path() / L"dr2tools.cfg").wstring();
     }
 
-    Settings Config::load()
+    std::wstring Config::findLogPath()
     {
-        Settings result; // starts with compile-time defaults
-        bool blendFromIni = false;
-        bool gamepadFromIni = false;
-        bool diToggleFromIni = false;
+        return fs::path(findConfigPath()).replace_extension(L".log").wstring();
+    }
 
-        const std::wstring cfgPath = findConfigPath();
-        const std::string cfgPathUtf8 = narrow(cfgPath);
-        MessageHandler::logLine("Config: loading dr2tools.cfg from '%s'", cfgPathUtf8.c_str());
+    Settings Config::parse(const std::string& contents, bool fileFound, const Settings& current)
+    {
+        Settings result; // starts with compile-time defaults, an invalid value keeps the one in current
+        bool gamepadSpecified = false;
+        bool diToggleSpecified = false;
+        bool triggerSpecified = false;
+        RangedFloatSetting rangedFloats[] = {
+            { "blend", &Settings::blend, 0.0001f, 1.0f },
+            { "head_motion_strength", &Settings::headMotionStrength, 0.0f, 0.1f },
+            { "head_motion_damping", &Settings::headMotionDamping, 0.05f, 5.0f },
+            { "shake_amplitude", &Settings::shakeAmplitude, 0.0f, 0.05f },
+            { "shake_frequency", &Settings::shakeFrequency, 0.1f, 30.0f },
+            { "handheld_intensity", &Settings::handheldIntensity, 0.0f, 5.0f },
+            { "frame_rate_limit", &Settings::frameRateLimit, 0.0f, 500.0f },
+            { "input_poll_rate", &Settings::inputPollRate, 30.0f, 1000.0f },
+        };
 
-        std::ifstream in(cfgPath);
-        if (!in.is_open())
+        if (!fileFound)
         {
             MessageHandler::logLine("Config: file not found. Using built-in defaults.");
-            MessageHandler::logLine("Config: blend=%.6f (default)", result.blend);
             {
                 const uint16_t m = result.cameraEnableGamepadMask;
                 const char* name = maskToName(m);
@@ -188,9 +367,14 @@ namespace IGCS
                 else MessageHandler::logLine("Config: camera_enable_gamepad=0x%04X (default)", m);
             }
             MessageHandler::logLine("Config: direct_input_toggle_button=%d (default)", result.directInputToggleButtonIndex);
+            for (const auto& setting : rangedFloats)
+            {
+                MessageHandler::logLine("Config: %s=%.6f (default)", setting.key, result.*setting.member);
+            }
             return result;
         }
 
+        std::istringstream in(contents);
         std::string line;
         while (std::getline(in, line))
         {
@@ -213,38 +397,30 @@ namespace IGCS
                 result.ConsoleEnabled = (val == "true" || val == "1");
 
             }
-            else if (keyLower == "blend")
+            else if (keyLower == "logfileenabled")
             {
-                try
-                {
-                    float parsed = std::stof(val);
-                    result.blend = parsed;
-                    blendFromIni = true;
-                    MessageHandler::logLine("Config: read blend=%.6f from ini", parsed);
-                }
-                catch (...)
-                {
-                    MessageHandler::logError("Config: invalid value for 'blend' ('%s'). Using default %.6f.", val.c_str(), result.blend);
-                }
+                result.LogFileEnabled = (val == "true" || val == "1");
             }
             else if (keyLower == "camera_enable_gamepad")
             {
+                gamepadSpecified = true;
                 auto parsed = parseGamepadButton(val);
                 if (!parsed.has_value())
                 {
-                    MessageHandler::logError("Config: invalid value for 'camera_enable_gamepad' ('%s'). Keeping default (%s).",
+                    result.cameraEnableGamepadMask = current.cameraEnableGamepadMask;
+                    MessageHandler::logError("Config: invalid value for 'camera_enable_gamepad' ('%s'). Keeping the current value (%s).",
                         val.c_str(), maskToName(result.cameraEnableGamepadMask) ? maskToName(result.cameraEnableGamepadMask) : "unknown");
                     continue;
                 }
                 uint16_t candidate = parsed.value();
                 if (!(isSingleBit(candidate) && isAllowedSingleButton(candidate)))
                 {
-                    MessageHandler::logError("Config: camera_enable_gamepad value '%s' (0x%04X) is not a supported single button. Keeping default (%s).",
+                    result.cameraEnableGamepadMask = current.cameraEnableGamepadMask;
+                    MessageHandler::logError("Config: camera_enable_gamepad value '%s' (0x%04X) is not a supported single button. Keeping the current value (%s).",
                         val.c_str(), candidate, maskToName(result.cameraEnableGamepadMask) ? maskToName(result.cameraEnableGamepadMask) : "unknown");
                     continue;
                 }
                 result.cameraEnableGamepadMask = candidate;
-                gamepadFromIni = true;
                 if (const char* nm = maskToName(candidate))
                     MessageHandler::logLine("Config: read camera_enable_gamepad=%s (0x%04X) from ini", nm, candidate);
                 else
@@ -252,36 +428,59 @@ namespace IGCS
             }
             else if (keyLower == "direct_input_toggle_button")
             {
+                diToggleSpecified = true;
                 try
                 {
                     int parsed = std::stoi(val);
                     if (parsed < 0 || parsed > 127)
                     {
+                        result.directInputToggleButtonIndex = current.directInputToggleButtonIndex;
                         MessageHandler::logError(
-                            "Config: direct_input_toggle_button value '%s' out of range (0..127). Keeping default (%d).",
+                            "Config: direct_input_toggle_button value '%s' out of range (0..127). Keeping the current value (%d).",
                             val.c_str(), result.directInputToggleButtonIndex);
                     }
                     else
                     {
                         result.directInputToggleButtonIndex = parsed;
-                        diToggleFromIni = true;
                         MessageHandler::logLine("Config: read direct_input_toggle_button=%d from ini", parsed);
                     }
                 }
                 catch (...)
                 {
+                    result.directInputToggleButtonIndex = current.directInputToggleButtonIndex;
                     MessageHandler::logError(
-                        "Config: invalid value for 'direct_input_toggle_button' ('%s'). Keeping default (%d).",
+                        "Config: invalid value for 'direct_input_toggle_button' ('%s'). Keeping the current value (%d).",
                         val.c_str(), result.directInputToggleButtonIndex);
                 }
             }
+            else if (keyLower == "camera_update_trigger")
+            {
+                triggerSpecified = true;
+                auto parsed = parseUpdateTrigger(val);
+                if (!parsed.has_value())
+                {
+                    result.cameraUpdateTrigger = current.cameraUpdateTrigger;
+                    MessageHandler::logError("Config: invalid value for 'camera_update_trigger' ('%s'). Keeping the current value (%s).",
+                        val.c_str(), triggerToName(result.cameraUpdateTrigger));
+                    continue;
+                }
+                result.cameraUpdateTrigger = parsed.value();
+                MessageHandler::logLine("Config: read camera_update_trigger=%s from ini", triggerToName(result.cameraUpdateTrigger));
+            }
+            else
+            {
+                for (auto& setting : rangedFloats)
+                {
+                    if (keyLower == setting.key)
+                    {
+                        parseRangedFloat(setting, val, current, result);
+                        break;
+                    }
+                }
+            }
         }
 
-        if (!blendFromIni)
-        {
-            MessageHandler::logLine("Config: blend not specified. Using default %.6f.", result.blend);
-        }
-        if (!gamepadFromIni)
+        if (!gamepadSpecified)
         {
             auto m = result.cameraEnableGamepadMask;
             if (const char* nm = maskToName(m))
@@ -289,11 +488,22 @@ namespace IGCS
             else
                 MessageHandler::logLine("Config: camera_enable_gamepad not specified. Using default 0x%04X.", m);
         }
-        if (!diToggleFromIni)
+        if (!diToggleSpecified)
         {
             MessageHandler::logLine("Config: direct_input_toggle_button not specified. Using default %d.",
                 result.directInputToggleButtonIndex);
         }
+        if (!triggerSpecified)
+        {
+            MessageHandler::logLine("Config: camera_update_trigger not specified. Using default %s.", triggerToName(result.cameraUpdateTrigger));
+        }
+        for (const auto& setting : rangedFloats)
+        {
+            if (!setting.specified)
+            {
+                MessageHandler::logLine("Config: %s not specified. Using default %.6f.", setting.key, result.*setting.member);
+            }
+        }
 
         return result;
     }
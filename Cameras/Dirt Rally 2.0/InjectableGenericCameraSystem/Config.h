@@ -6,6 +6,14 @@
 
 namespace IGCS
 {
+    // Point in the game's frame at which the camera is updated and written
+    enum class CameraUpdateTrigger
+    {
+        Present,            // right after Present returned
+        BackBufferBind,     // first bind of the backbuffer as render target after Present
+        CarUpdate,          // right after the game updated the car's transform
+    };
+
     struct Settings
     {
         // Centralized, compile-time defaults
@@ -13,22 +21,55 @@ namespace IGCS
         static constexpr uint16_t kDefaultCameraEnableGamepadMask = XINPUT_GAMEPAD_RIGHT_THUMB;
         static constexpr int      kDefaultDirectInputToggleButtonIndex = 12;
         static constexpr bool     kDefaultConsoleEnabled = true;
+        static constexpr bool     kDefaultLogFileEnabled = false;
+        static constexpr float    kDefaultHeadMotionStrength = 0.0f;
+        static constexpr float    kDefaultHeadMotionDamping = 0.7f;
+        static constexpr float    kDefaultShakeAmplitude = 0.0f;
+        static constexpr float    kDefaultShakeFrequency = 2.0f;
+        static constexpr float    kDefaultHandheldIntensity = 0.0f;
+        static constexpr CameraUpdateTrigger kDefaultCameraUpdateTrigger = CameraUpdateTrigger::BackBufferBind;
+        static constexpr float    kDefaultFrameRateLimit = 0.0f;
+        static constexpr float    kDefaultInputPollRate = 250.0f;
 
         // Initialized with defaults. If the INI omits a value or parsing fails,
         // these stay as-is and we log that the default was used.
         float    blend = kDefaultBlend;
         bool     ConsoleEnabled = kDefaultConsoleEnabled;
+        bool     LogFileEnabled = kDefaultLogFileEnabled;             // log to dr2tools.log next to dr2tools.cfg
         uint16_t cameraEnableGamepadMask = kDefaultCameraEnableGamepadMask;
         int      directInputToggleButtonIndex = kDefaultDirectInputToggleButtonIndex;
+        float    headMotionStrength = kDefaultHeadMotionStrength;    // metres of head movement per g, 0 = off
+        float    headMotionDamping = kDefaultHeadMotionDamping;      // damping ratio, 1 = critically damped
+        float    shakeAmplitude = kDefaultShakeAmplitude;            // radians, 0 = off
+        float    shakeFrequency = kDefaultShakeFrequency;            // Hz
+        float    handheldIntensity = kDefaultHandheldIntensity;      // 0 = off
+        CameraUpdateTrigger cameraUpdateTrigger = kDefaultCameraUpdateTrigger;
+        float    frameRateLimit = kDefaultFrameRateLimit;            // frames per second, 0 = off
+        float    inputPollRate = kDefaultInputPollRate;              // input thread samples per second
+
+        uint32_t generation = 0;                                    // bumped by every reload
     };
 
+    // dr2tools.cfg, reloaded while the game runs when the file changes. The settings are an immutable snapshot: get() is a
+    // single atomic load, take it once per frame or input sample and don't keep the reference beyond that.
     class Config
     {
     public:
         static const Settings& get();
+        static const char* triggerToName(CameraUpdateTrigger trigger);
+        // dr2tools.log, next to dr2tools.cfg
+        static std::wstring findLogPath();
+        // Starts reloading the settings when the file changes. From a SAFE context (not DllMain).
+        static void startWatching();
+        static void stopWatching();
 
     private:
-        static Settings load();
+        friend class ConfigReloader;
+
+        static const Settings& load();
+        // Keys missing from contents get the compile-time default, an invalid or out of range value keeps the one in current.
+        static Settings parse(const std::string& contents, bool fileFound, const Settings& current);
+        static void reload(const std::string& contents);
         static std::wstring findConfigPath();
     };
 }
\ No newline at end of file
@@ -72,7 +72,7 @@ namespace IGCS::Console
 		}
 	}
 
-	void WriteLine(const string& toWrite, int color)
+	void WriteLine(string_view toWrite, int color)
 	{
 		EnsureConsole();
 		SetColor(color);
@@ -80,7 +80,7 @@ namespace IGCS::Console
 		SetColor(CONSOLE_NORMAL);
 	}
 
-	void WriteLine(const string& toWrite)
+	void WriteLine(string_view toWrite)
 	{
 		EnsureConsole();
 		cout << toWrite << endl;
@@ -88,7 +88,7 @@ namespace IGCS::Console
 	}
 
 
-	void WriteError(const string& error)
+	void WriteError(string_view error)
 	{
 		EnsureConsole();
 		NamedPipeManager::instance().writeMessage(error, true, false);
@@ -27,13 +27,14 @@
 ////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma once
 #include "stdafx.h"
+#include <string_view>
 
 namespace IGCS::Console
 {
 	void Release();
-	void WriteLine(const std::string& toWrite);
-	void WriteLine(const std::string& toWrite, int color);
-	void WriteError(const std::string& error);
+	void WriteLine(std::string_view toWrite);
+	void WriteLine(std::string_view toWrite, int color);
+	void WriteError(std::string_view error);
 	void SetColor(int color);
 	void Init();
 	void Release();
@@ -11,6 +11,11 @@
 #include <d3dcompiler.h>
 #include "Utils.h"
 #include "DummyWindowHelper.h"
+#include "RenderTargetCache.h"
+#include "MonotonicClock.h"
+#include "FramePacer.h"
+#include "PacingClock.h"
+#include "Config.h"
 
 #pragma comment(lib, "d3d11.lib")
 #pragma comment(lib, "dxgi.lib")
@@ -25,6 +30,48 @@ namespace IGCS {
     D3DHook::ResizeBuffers_t D3DHook::_originalResizeBuffers = nullptr;
     D3DHook::OMSetRenderTargets_t D3DHook::_originalOMSetRenderTargets = nullptr;
 
+    // Classifies render target views for the render target cache by comparing the texture they view with the backbuffer.
+    class D3DRenderTargetViews : public IRenderTargetViews
+    {
+    public:
+        void setBackBuffer(ID3D11Texture2D* backBuffer) noexcept { _backBuffer = backBuffer; }
+
+        bool isBackBuffer(void* view) noexcept override
+        {
+            if (!_backBuffer) {
+                return false;
+            }
+            ID3D11Resource* resource = nullptr;
+            static_cast<ID3D11RenderTargetView*>(view)->GetResource(&resource);
+            if (!resource) {
+                return false;
+            }
+            ID3D11Texture2D* tex = nullptr;
+            const HRESULT hr = resource->QueryInterface(__uuidof(ID3D11Texture2D), reinterpret_cast<void**>(&tex));
+            resource->Release();
+            if (FAILED(hr) || !tex) {
+                return false;
+            }
+            // Compare pointer identity to the cached backbuffer
+            const bool result = tex == _backBuffer;
+            tex->Release();
+            return result;
+        }
+
+        void addRef(void* view) noexcept override { static_cast<ID3D11RenderTargetView*>(view)->AddRef(); }
+        void release(void* view) noexcept override { static_cast<ID3D11RenderTargetView*>(view)->Release(); }
+
+    private:
+        ID3D11Texture2D* _backBuffer = nullptr;
+    };
+
+    // Only used from the render thread: OMSetRenderTargets on the immediate context, Present and ResizeBuffers.
+    static D3DRenderTargetViews renderTargetViews;
+    static RenderTargetCache renderTargetCache(renderTargetViews);
+    // Frame rate limiter for frame_rate_limit, render thread only.
+    static SystemPacingClock pacingClock;
+    static FramePacer framePacer(pacingClock);
+
 	//==================================================================================================
 	// Getters, setters and other methods
 	//==================================================================================================
@@ -52,9 +99,7 @@ namespace IGCS {
     // Constructor & Destructor
     //==================================================================================================
 
-    D3DHook::D3DHook()
-    {
-    }
+    D3DHook::D3DHook() = default;
 
     D3DHook::~D3DHook() {
         cleanUp();
@@ -97,7 +142,7 @@ namespace IGCS {
         // Get the Present function address from the temp swap chain's vftable
         void** vftable = *reinterpret_cast<void***>(pTempSwapChain);
         void* presentAddress = vftable[8]; // Present is at index 8
-        //void* resizeBuffersAddress = vftable[13]; // ResizeBuffers is at index 13
+        void* resizeBuffersAddress = vftable[13]; // ResizeBuffers is at index 13
 
         // Hook Present first
 
@@ -129,6 +174,20 @@ namespace IGCS {
 
         MessageHandler::logLine("Successfully hooked Direct3D 11 Present function");
 
+        // ResizeBuffers, to let go of the backbuffer and the views on it before the game resizes
+        status = MH_CreateHook(
+            resizeBuffersAddress,
+            &D3DHook::hookedResizeBuffers,
+            reinterpret_cast<void**>(&_originalResizeBuffers)
+        );
+        if (status == MH_OK) {
+            status = MH_EnableHook(resizeBuffersAddress);
+        }
+        if (status != MH_OK) {
+            // not fatal, the views are then only re-classified when a new backbuffer shows up
+            MessageHandler::logError("D3DHook::initialize: Failed to hook ResizeBuffers, error: %d", status);
+        }
+
         // Clean up temporary objects - we don't need them anymore
         pTempContext->Release();
         pTempDevice->Release();
@@ -247,6 +306,7 @@ namespace IGCS {
         SAFE_RELEASE(_pSwapChain);
 
         // 8. Release Static D3D Resources
+        releaseBackBuffer();
         SAFE_RELEASE(_pLastRTV);
         SAFE_RELEASE(_pLastContext);
         SAFE_RELEASE(_pLastDevice);
@@ -287,6 +347,9 @@ namespace IGCS {
     //==================================================================================================
     HRESULT STDMETHODCALLTYPE D3DHook::hookedPresent(IDXGISwapChain* pSwapChain, const UINT SyncInterval, const UINT Flags)
     {
+        const int64_t hookStart = MonotonicClock::now();
+        const int64_t updateTimeAtStart = instance()._frameUpdateTime.load(std::memory_order_relaxed);
+
         // Device acquisition - if we don't have a device yet
         if (!instance()._pLastDevice && pSwapChain) {
             bool needsInit = false;
@@ -316,23 +379,129 @@ namespace IGCS {
             }
         }
 
+        // one snapshot of the settings for the whole frame
+        const Settings& settings = Config::get();
+        const CameraUpdateTrigger trigger = settings.cameraUpdateTrigger;
+        instance()._updateOnBackBufferBind.store(trigger == CameraUpdateTrigger::BackBufferBind, std::memory_order_relaxed);
+        const uint64_t presentedEpoch = instance()._frameEpoch.load(std::memory_order_relaxed);
+        if (trigger == CameraUpdateTrigger::CarUpdate && Globals::instance().systemActive()) {
+            // The car update only moves the camera, the rest of the frame is done here. Also moves the camera if the car
+            // wasn't updated this frame (paused, menus).
+            System::instance().updateFrameOnce(presentedEpoch);
+        }
+
+        instance().addHookTime(hookStart, updateTimeAtStart);
+
+        // Hold the frame back until it's due. Done outside the hook time, the wait is idle time and not our overhead.
+        framePacer.setTargetRate(settings.frameRateLimit);
+        if (framePacer.enabled()) {
+            framePacer.wait();
+        }
+
         // Call the original Present
         HRESULT hr = _originalPresent(pSwapChain, SyncInterval, Flags);
+        // the game's render targets aren't held past the frame, only the backbuffer views stay cached
+        renderTargetCache.endFrame();
+
+        const int64_t presentReturned = MonotonicClock::now();
+        instance().recordFrame(presentReturned);
+        const int64_t updateTimeAfterPresent = instance()._frameUpdateTime.load(std::memory_order_relaxed);
 
         // After presenting, increment epoch to mark end of the frame
-        instance()._frameEpoch.fetch_add(1, std::memory_order_relaxed);
+        const uint64_t epoch = instance()._frameEpoch.fetch_add(1, std::memory_order_relaxed) + 1;
+
+        if (trigger == CameraUpdateTrigger::Present && Globals::instance().systemActive()) {
+            System::instance().updateFrameOnce(epoch);
+        }
 
         // Cache the backbuffer texture if we don't have it yet
         if (instance()._pSwapChain && instance()._pBackBufferTex == nullptr) {
             ID3D11Texture2D* backbuf = nullptr;
             if (SUCCEEDED(instance()._pSwapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), reinterpret_cast<void**>(&backbuf)))) {
                 instance()._pBackBufferTex = backbuf; // hold a ref returned by GetBuffer
+                // new backbuffer, the cached classification of the views is stale
+                renderTargetCache.invalidate();
+                renderTargetViews.setBackBuffer(backbuf);
             }
         }
 
+        instance().addHookTime(presentReturned, updateTimeAfterPresent);
         return hr;
     }
 
+    void D3DHook::addHookTime(const int64_t start, const int64_t updateTimeAtStart)
+    {
+        const int64_t updateTime = _frameUpdateTime.load(std::memory_order_relaxed) - updateTimeAtStart;
+        const int64_t hookTime = MonotonicClock::now() - start - updateTime;
+        if (hookTime > 0) {
+            _frameHookTime.fetch_add(hookTime, std::memory_order_relaxed);
+        }
+    }
+
+    void D3DHook::recordFrame(const int64_t presentTimestamp)
+    {
+        const int64_t updateTime = _frameUpdateTime.exchange(0, std::memory_order_relaxed);
+        const int64_t hookTime = _frameHookTime.exchange(0, std::memory_order_relaxed);
+        if (0 == _lastPresentTimestamp) {
+            _lastPresentTimestamp = presentTimestamp;
+            return;
+        }
+        FrameRecord record;
+        record.presentInterval = static_cast<float>(MonotonicClock::toSeconds(presentTimestamp - _lastPresentTimestamp));
+        record.updateTime = static_cast<float>(MonotonicClock::toSeconds(updateTime));
+        record.hookTime = static_cast<float>(MonotonicClock::toSeconds(hookTime));
+        _lastPresentTimestamp = presentTimestamp;
+        _frameStats.add(record);
+
+        // The setup needs a steady 60fps or more, say so when a window of frames didn't make it
+        constexpr float minimumFps = 60.0f;
+        FrameStatistics stats;
+        _frameStats.read(stats);
+        const uint32_t windowsDone = static_cast<uint32_t>(stats.frames / FrameStats::kWindowFrames);
+        if (stats.windowFrames > 0 && windowsDone != _slowWindowsReported) {
+            _slowWindowsReported = windowsDone;
+            if (stats.onePercentLowFps < minimumFps) {
+                MessageHandler::logLine("Frame rate drops: %.1f fps average, %.1f fps 1%% low over the last %u frames. Our code: %.3fms / %.3fms per frame (p50 / p99)",
+                    stats.averageFps, stats.onePercentLowFps, stats.windowFrames,
+                    (stats.updateP50 + stats.hookP50) * 1000.0f, (stats.updateP99 + stats.hookP99) * 1000.0f);
+                // the percentiles hide whether it's a few hitches or a steady low rate, the frames themselves tell
+                const size_t copied = _frameStats.copyRecent(_slowWindowFrames, FrameStats::kWindowFrames);
+                size_t slowFrames = 0;
+                size_t worst = 0;
+                for (size_t i = 0; i < copied; ++i) {
+                    slowFrames += _slowWindowFrames[i].presentInterval > 1.0f / minimumFps ? 1 : 0;
+                    worst = _slowWindowFrames[i].presentInterval > _slowWindowFrames[worst].presentInterval ? i : worst;
+                }
+                if (copied > 0) {
+                    MessageHandler::logLine("%zu of %zu frames took longer than %.1fms. Worst: %.3fms, our code %.3fms of it",
+                        slowFrames, copied, 1000.0f / minimumFps, _slowWindowFrames[worst].presentInterval * 1000.0f,
+                        (_slowWindowFrames[worst].updateTime + _slowWindowFrames[worst].hookTime) * 1000.0f);
+                }
+            }
+        }
+    }
+
+
+    HRESULT STDMETHODCALLTYPE D3DHook::hookedResizeBuffers(IDXGISwapChain* pSwapChain, const UINT BufferCount, const UINT Width, const UINT Height, const DXGI_FORMAT NewFormat, const UINT SwapChainFlags)
+    {
+        // ResizeBuffers fails while references to the buffers are outstanding, so drop ours. The backbuffer is fetched
+        // again after the next Present.
+        if (pSwapChain == instance()._pSwapChain) {
+            instance().releaseBackBuffer();
+        }
+        return _originalResizeBuffers(pSwapChain, BufferCount, Width, Height, NewFormat, SwapChainFlags);
+    }
+
+    void D3DHook::releaseBackBuffer()
+    {
+        renderTargetCache.invalidate();
+        renderTargetViews.setBackBuffer(nullptr);
+        if (_pBackBufferTex) {
+            _pBackBufferTex->Release();
+            _pBackBufferTex = nullptr;
+        }
+    }
+
 
     void STDMETHODCALLTYPE D3DHook::hookedOMSetRenderTargets(
         ID3D11DeviceContext* pContext,
@@ -347,43 +516,27 @@ namespace IGCS {
 
         // Call original exactly once
         _originalOMSetRenderTargets(pContext, NumViews, ppRenderTargetViews, pDepthStencilView);
+        const int64_t hookStart = MonotonicClock::now();
+        const int64_t updateTimeAtStart = instance()._frameUpdateTime.load(std::memory_order_relaxed);
 
-        // Only act on the immediate context and when system is active
+        // Only act on the immediate context and when system is active and the camera is updated at the backbuffer bind
         bool shouldUpdate = false;
-        if (pContext && Globals::instance().systemActive()) {
+        if (pContext && Globals::instance().systemActive() && instance()._updateOnBackBufferBind.load(std::memory_order_relaxed)) {
             if (pContext->GetType() == D3D11_DEVICE_CONTEXT_IMMEDIATE) {
 
-                // Identify if RTV[0] is the backbuffer
+                // Identify if RTV[0] is the backbuffer. Views seen before are a table lookup, only new views cost COM calls.
                 if (NumViews > 0 && ppRenderTargetViews && ppRenderTargetViews[0] && instance()._pBackBufferTex) {
-                    ID3D11Resource* r = nullptr;
-                    ppRenderTargetViews[0]->GetResource(&r);
-                    if (r) {
-                        ID3D11Texture2D* tex = nullptr;
-                        HRESULT qhr = r->QueryInterface(__uuidof(ID3D11Texture2D), reinterpret_cast<void**>(&tex));
-                        r->Release();
-
-                        if (SUCCEEDED(qhr) && tex) {
-                            // Compare pointer identity to the cached backbuffer
-                            if (tex == instance()._pBackBufferTex) {
-                                shouldUpdate = true;
-                            }
-                            tex->Release();
-                        }
-                    }
+                    shouldUpdate = renderTargetCache.isBackBuffer(ppRenderTargetViews[0]);
                 }
             }
         }
 
         if (shouldUpdate) {
             // Once-per-frame guard tied to Presents epoch
-            static thread_local uint64_t s_lastEpoch = 0;
-            const uint64_t epoch = instance()._frameEpoch.load(std::memory_order_relaxed);
-            if (s_lastEpoch != epoch) {
-                System::instance().updateFrame();
-                s_lastEpoch = epoch;
-            }
+            System::instance().updateFrameOnce(instance()._frameEpoch.load(std::memory_order_relaxed));
         }
 
+        instance().addHookTime(hookStart, updateTimeAtStart);
         inOurCode = false;
     }
 
@@ -3,6 +3,7 @@
 #include <d3d11.h>
 #include <dxgi.h>
 #include "GameConstants.h"
+#include "FrameStats.h"
 #include <mutex>
 #include <atomic>
 #include <vector>
@@ -44,6 +45,12 @@ namespace IGCS {
         [[nodiscard]] bool needsInitialization() const { return _needsInitialization; }
         void markResourcesForUpdate() {_resourcesNeedUpdate.store(true, std::memory_order_release);}
         void validateAndAcquireDeviceContext();
+        // number of frames presented so far, +1
+        [[nodiscard]] uint64_t frameEpoch() const { return _frameEpoch.load(std::memory_order_relaxed); }
+        // frame timing, readable from any thread
+        [[nodiscard]] const FrameStats& frameStats() const { return _frameStats; }
+        // time spent in System::updateFrame and the car update's camera move, in nanoseconds. Added to the frame being rendered.
+        void addUpdateTime(int64_t nanoseconds) { _frameUpdateTime.fetch_add(nanoseconds, std::memory_order_relaxed); }
 
         void cleanupAllResources();
 
@@ -59,15 +66,33 @@ namespace IGCS {
         // Inside class D3DHook private section near _needsInitialization
         std::atomic<uint64_t> _frameEpoch{ 1 };
         ID3D11Texture2D* _pBackBufferTex = nullptr; // swap chain backbuffer texture for identifying main pass
+        // camera_update_trigger is backbuffer_bind, from the settings snapshot Present takes for the frame
+        std::atomic<bool> _updateOnBackBufferBind{ false };
+
+        // ==== Frame timing ====
+        // closes the record of the frame which was just presented
+        void recordFrame(int64_t presentTimestamp);
+        // time spent in our hook code from start till now, excluding updateFrame which ran since updateTimeAtStart
+        void addHookTime(int64_t start, int64_t updateTimeAtStart);
+        FrameStats _frameStats;
+        std::atomic<int64_t> _frameUpdateTime{ 0 };
+        std::atomic<int64_t> _frameHookTime{ 0 };
+        int64_t _lastPresentTimestamp = 0;
+        uint32_t _slowWindowsReported = 0;
+        // the frames of a slow window, copied out of the ring to report the worst of them
+        FrameRecord _slowWindowFrames[FrameStats::kWindowFrames];
         // ==== Hook function types and implementations ====
         typedef HRESULT(STDMETHODCALLTYPE* Present_t)(IDXGISwapChain* pSwapChain, UINT SyncInterval, UINT Flags);
         typedef HRESULT(STDMETHODCALLTYPE* ResizeBuffers_t)(IDXGISwapChain* pSwapChain, UINT BufferCount, UINT Width, UINT Height, DXGI_FORMAT NewFormat, UINT SwapChainFlags);
         typedef void(STDMETHODCALLTYPE* OMSetRenderTargets_t)(ID3D11DeviceContext* pContext, UINT NumViews, ID3D11RenderTargetView* const* ppRenderTargetViews, ID3D11DepthStencilView* pDepthStencilView);
 
         static HRESULT STDMETHODCALLTYPE hookedPresent(IDXGISwapChain* pSwapChain, UINT SyncInterval, UINT Flags);
-        //static HRESULT STDMETHODCALLTYPE hookedResizeBuffers(IDXGISwapChain* pSwapChain, UINT BufferCount, UINT Width, UINT Height, DXGI_FORMAT NewFormat, UINT SwapChainFlags);
+        static HRESULT STDMETHODCALLTYPE hookedResizeBuffers(IDXGISwapChain* pSwapChain, UINT BufferCount, UINT Width, UINT Height, DXGI_FORMAT NewFormat, UINT SwapChainFlags);
         static void STDMETHODCALLTYPE hookedOMSetRenderTargets(ID3D11DeviceContext* pContext, UINT NumViews, ID3D11RenderTargetView* const* ppRenderTargetViews, ID3D11DepthStencilView* pDepthStencilView);
 
+        // releases the cached backbuffer and the render target views cached with it
+        void releaseBackBuffer();
+
         // ==== Depth buffer management ====
         void setupOMSetRenderTargetsHook();
 
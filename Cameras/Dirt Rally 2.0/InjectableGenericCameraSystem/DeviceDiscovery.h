@@ -0,0 +1,132 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include "DeviceJob.h"
+
+// Finding and opening an input device is slow (DirectInput8Create plus a device enumeration takes milliseconds), so it's done
+// on the device worker thread and the thread reading it only ever picks up a device which is ready to use. The worker runs
+// step() at startup, on a device change notification and when the backoff timer of the last failed attempt expires. A device
+// the reader finds unusable is handed back with reportLost() and closed on the worker, which then searches again.
+namespace IGCS
+{
+	// Opens and closes devices, called on the worker thread only.
+	class IDeviceProvider
+	{
+	public:
+		virtual ~IDeviceProvider() = default;
+
+		// Finds, sets up and acquires a device. Returns nullptr if there's none (yet).
+		virtual void* open() noexcept = 0;
+		virtual void close(void* device) noexcept = 0;
+		// After the last device was closed, release whatever is shared between devices.
+		virtual void shutdown() noexcept {}
+	};
+
+	class DeviceDiscovery : public IDeviceJob
+	{
+	public:
+		static constexpr int64_t kInitialBackoff = 500000000LL;		// 0.5s
+		static constexpr int64_t kMaxBackoff = 30000000000LL;		// 30s
+
+		explicit DeviceDiscovery(IDeviceProvider& provider) noexcept : _provider(provider)
+		{
+		}
+
+		DeviceDiscovery(const DeviceDiscovery&) = delete;
+		DeviceDiscovery& operator=(const DeviceDiscovery&) = delete;
+
+		// The ready device or nullptr. Reading thread.
+		[[nodiscard]] void* device() const noexcept { return _device.load(std::memory_order_acquire); }
+
+		// The reading thread stops using the device and hands it to the worker to close and replace. Returns true if the worker
+		// has to be woken up.
+		bool reportLost(void* device) noexcept
+		{
+			void* expected = device;
+			if (nullptr == device || !_device.compare_exchange_strong(expected, nullptr, std::memory_order_acq_rel))
+			{
+				return false;
+			}
+			_lost.store(device, std::memory_order_release);
+			requestDiscovery();
+			return true;
+		}
+
+		// Search as soon as possible, e.g. after a device was attached. Any thread; the caller wakes the worker.
+		void requestDiscovery() noexcept
+		{
+			_requested.store(true, std::memory_order_release);
+		}
+
+		// Closes a lost device and, if there's no device and a search is due, searches.
+		int64_t step(int64_t now) noexcept override
+		{
+			if (void* lost = _lost.exchange(nullptr, std::memory_order_acq_rel))
+			{
+				_provider.close(lost);
+			}
+			const bool requested = _requested.exchange(false, std::memory_order_acq_rel);
+			if (nullptr != _device.load(std::memory_order_acquire))
+			{
+				// nothing to do till the device is lost
+				return kNoDeadline;
+			}
+			if (requested)
+			{
+				// a notification means the device set changed, search right away and from the shortest backoff again
+				_backoff = 0;
+				_nextAttempt = now;
+			}
+			if (now < _nextAttempt)
+			{
+				return _nextAttempt;
+			}
+
+			++_attempts;
+			void* opened = _provider.open();
+			if (nullptr != opened)
+			{
+				_backoff = 0;
+				_nextAttempt = 0;
+				_device.store(opened, std::memory_order_release);
+				return kNoDeadline;
+			}
+			_backoff = _backoff == 0 ? kInitialBackoff : (_backoff >= kMaxBackoff / 2 ? kMaxBackoff : _backoff * 2);
+			_nextAttempt = now + _backoff;
+			return _nextAttempt;
+		}
+
+		void devicesChanged() noexcept override
+		{
+			requestDiscovery();
+		}
+
+		// Closes the device; the reading thread must not use it anymore.
+		void stop() noexcept override
+		{
+			if (void* lost = _lost.exchange(nullptr, std::memory_order_acq_rel))
+			{
+				_provider.close(lost);
+			}
+			if (void* current = _device.exchange(nullptr, std::memory_order_acq_rel))
+			{
+				_provider.close(current);
+			}
+			_provider.shutdown();
+		}
+
+		[[nodiscard]] uint64_t attempts() const noexcept { return _attempts; }
+		[[nodiscard]] int64_t backoff() const noexcept { return _backoff; }
+
+	private:
+		IDeviceProvider& _provider;
+		std::atomic<void*> _device{ nullptr };
+		std::atomic<void*> _lost{ nullptr };
+		std::atomic<bool> _requested{ true };		// search at startup
+
+		// worker thread only
+		int64_t _backoff = 0;
+		int64_t _nextAttempt = 0;
+		uint64_t _attempts = 0;
+	};
+}
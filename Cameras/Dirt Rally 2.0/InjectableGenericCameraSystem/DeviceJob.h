@@ -0,0 +1,23 @@
+#pragma once
+#include <cstdint>
+
+namespace IGCS
+{
+	// Slow device work (searching, opening, probing) which runs on the device worker thread instead of the render thread, see
+	// DeviceWorker. All methods are called on the worker thread.
+	class IDeviceJob
+	{
+	public:
+		static constexpr int64_t kNoDeadline = INT64_MAX;
+
+		virtual ~IDeviceJob() = default;
+
+		// Does whatever is due at now (MonotonicClock time). Returns when it has to run again if nothing wakes the worker
+		// before, kNoDeadline for never.
+		virtual int64_t step(int64_t now) noexcept = 0;
+		// A device was attached or removed somewhere in the system.
+		virtual void devicesChanged() noexcept = 0;
+		// The worker stops, release what's held.
+		virtual void stop() noexcept {}
+	};
+}
@@ -0,0 +1,145 @@
+#include "stdafx.h"
+#include "DeviceWorker.h"
+#include "MessageHandler.h"
+#include "MonotonicClock.h"
+#include <dbt.h>
+
+namespace IGCS
+{
+	static constexpr const wchar_t* kDeviceChangeClassName = L"DR2ToolsDeviceChangeWindow";
+
+	void DeviceWorker::add(IDeviceJob& job)
+	{
+		{
+			std::lock_guard<std::mutex> lock(_jobsMutex);
+			_jobs.push_back(&job);
+		}
+		wake();
+	}
+
+	bool DeviceWorker::start()
+	{
+		if (_thread.joinable())
+		{
+			return true;
+		}
+		_wakeEvent = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+		if (nullptr == _wakeEvent)
+		{
+			MessageHandler::logError("Device worker: couldn't create wake event. Error code: %lu", GetLastError());
+			return false;
+		}
+		_stopRequested.store(false, std::memory_order_relaxed);
+		_thread = std::thread(&DeviceWorker::run, this);
+		return true;
+	}
+
+	void DeviceWorker::wake()
+	{
+		if (nullptr != _wakeEvent)
+		{
+			SetEvent(_wakeEvent);
+		}
+	}
+
+	void DeviceWorker::stop()
+	{
+		if (_thread.joinable())
+		{
+			_stopRequested.store(true, std::memory_order_release);
+			wake();
+			_thread.join();
+		}
+		if (nullptr != _wakeEvent)
+		{
+			CloseHandle(_wakeEvent);
+			_wakeEvent = nullptr;
+		}
+	}
+
+	LRESULT CALLBACK DeviceWorker::deviceChangeWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
+	{
+		if (msg == WM_DEVICECHANGE && (wParam == DBT_DEVICEARRIVAL || wParam == DBT_DEVICEREMOVECOMPLETE || wParam == DBT_DEVNODES_CHANGED))
+		{
+			auto self = reinterpret_cast<DeviceWorker*>(GetWindowLongPtrW(hwnd, GWLP_USERDATA));
+			if (self)
+			{
+				// sent messages can be dispatched from within a job's device calls, so only flag it here
+				self->_devicesChanged.store(true, std::memory_order_release);
+			}
+		}
+		return DefWindowProcW(hwnd, msg, wParam, lParam);
+	}
+
+	void DeviceWorker::run()
+	{
+		SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+
+		// message-only window to get device arrival notifications
+		WNDCLASSEXW wc{};
+		wc.cbSize = sizeof(wc);
+		wc.lpfnWndProc = deviceChangeWndProc;
+		wc.hInstance = GetModuleHandle(nullptr);
+		wc.lpszClassName = kDeviceChangeClassName;
+		const ATOM windowClass = RegisterClassExW(&wc);
+		HWND window = CreateWindowExW(0, kDeviceChangeClassName, L"", 0, 0, 0, 0, 0, HWND_MESSAGE, nullptr, GetModuleHandle(nullptr), nullptr);
+		HDEVNOTIFY notification = nullptr;
+		if (window)
+		{
+			SetWindowLongPtrW(window, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(this));
+			DEV_BROADCAST_DEVICEINTERFACE_W filter{};
+			filter.dbcc_size = sizeof(filter);
+			filter.dbcc_devicetype = DBT_DEVTYP_DEVICEINTERFACE;
+			notification = RegisterDeviceNotificationW(window, &filter, DEVICE_NOTIFY_WINDOW_HANDLE | DEVICE_NOTIFY_ALL_INTERFACE_CLASSES);
+		}
+		if (!notification)
+		{
+			MessageHandler::logDebug("Device worker: no device notifications (error %lu), devices are only searched on a timer", GetLastError());
+		}
+
+		while (!_stopRequested.load(std::memory_order_acquire))
+		{
+			const int64_t now = MonotonicClock::now();
+			int64_t next = IDeviceJob::kNoDeadline;
+			{
+				std::lock_guard<std::mutex> lock(_jobsMutex);
+				const bool devicesChanged = _devicesChanged.exchange(false, std::memory_order_acq_rel);
+				for (IDeviceJob* job : _jobs)
+				{
+					if (devicesChanged)
+					{
+						job->devicesChanged();
+					}
+					const int64_t jobNext = job->step(now);
+					if (jobNext < next)
+					{
+						next = jobNext;
+					}
+				}
+			}
+			DWORD timeout = INFINITE;
+			if (next != IDeviceJob::kNoDeadline)
+			{
+				const int64_t milliseconds = (next - now + 999999) / 1000000;
+				timeout = milliseconds <= 0 ? 0 : static_cast<DWORD>(milliseconds);
+			}
+			MsgWaitForMultipleObjects(1, &_wakeEvent, FALSE, timeout, QS_ALLINPUT);
+			MSG msg;
+			while (PeekMessageW(&msg, nullptr, 0, 0, PM_REMOVE))
+			{
+				DispatchMessageW(&msg);
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(_jobsMutex);
+			for (IDeviceJob* job : _jobs)
+			{
+				job->stop();
+			}
+		}
+		if (notification) UnregisterDeviceNotification(notification);
+		if (window) DestroyWindow(window);
+		if (windowClass) UnregisterClassW(kDeviceChangeClassName, GetModuleHandle(nullptr));
+	}
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+#include "stdafx.h"
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "DeviceJob.h"
+
+namespace IGCS
+{
+	// Background thread for slow device work: runs the registered jobs when they're due, when woken and when Windows reports a
+	// device change (through a message-only window registered for device interface notifications).
+	class DeviceWorker
+	{
+	public:
+		DeviceWorker() = default;
+		// IMPORTANT: no cleanup in the destructor, it may run under loader lock. Use stop().
+		~DeviceWorker() = default;
+		DeviceWorker(const DeviceWorker&) = delete;
+		DeviceWorker& operator=(const DeviceWorker&) = delete;
+
+		// Jobs must outlive the worker. Any thread.
+		void add(IDeviceJob& job);
+		bool start();
+		// Runs the jobs as soon as possible. Any thread.
+		void wake();
+		// Stops the thread after letting the jobs release their devices. From a SAFE context (not DllMain).
+		void stop();
+
+	private:
+		static LRESULT CALLBACK deviceChangeWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
+		void run();
+
+		std::mutex _jobsMutex;
+		std::vector<IDeviceJob*> _jobs;
+		std::thread _thread;
+		HANDLE _wakeEvent = nullptr;
+		std::atomic<bool> _stopRequested{ false };
+		std::atomic<bool> _devicesChanged{ false };
+	};
+}
\ No newline at end of file
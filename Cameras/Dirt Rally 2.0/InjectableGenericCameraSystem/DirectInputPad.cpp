@@ -1,5 +1,6 @@
 #include "stdafx.h"
 #include "DirectInputPad.h"
+#include "MessageHandler.h"
 
 #pragma comment(lib, "dinput8.lib")
 #pragma comment(lib, "dxguid.lib")
@@ -13,16 +14,60 @@ namespace IGCS
     // NOTE: No cleanup in destructor. Use shutdown() if you need explicit teardown.
     // See comments in header about loader lock and DllMain.
 
-    BOOL CALLBACK DirectInputPad::enumDevicesCallback(const DIDEVICEINSTANCE* pdidInstance, VOID* pContext)
+    // events the device buffers between two frames, and read per GetDeviceData call
+    static constexpr DWORD kEventBufferSize = 64;
+    static constexpr DWORD kEventBatch = 16;
+
+    // Data format with only the buttons of DIJOYSTATE2, so axis movement doesn't fill the event buffer. The offset of a
+    // button is its index.
+    struct ButtonState
+    {
+        BYTE buttons[ButtonSet::kButtons];
+    };
+
+    static const DIDATAFORMAT& buttonDataFormat()
+    {
+        static DIOBJECTDATAFORMAT objects[ButtonSet::kButtons];
+        static DIDATAFORMAT format = []
+        {
+            for (DWORD i = 0; i < ButtonSet::kButtons; ++i)
+            {
+                objects[i] = { nullptr, i, DIDFT_OPTIONAL | DIDFT_BUTTON | DIDFT_ANYINSTANCE, 0 };
+            }
+            DIDATAFORMAT result{};
+            result.dwSize = sizeof(DIDATAFORMAT);
+            result.dwObjSize = sizeof(DIOBJECTDATAFORMAT);
+            result.dwFlags = DIDF_ABSAXIS;
+            result.dwDataSize = sizeof(ButtonState);
+            result.dwNumObjs = ButtonSet::kButtons;
+            result.rgodf = objects;
+            return result;
+        }();
+        return format;
+    }
+
+    BOOL CALLBACK DirectInputDeviceProvider::enumDevicesCallback(const DIDEVICEINSTANCE* pdidInstance, VOID* pContext)
     {
-        auto self = reinterpret_cast<DirectInputPad*>(pContext);
+        auto self = reinterpret_cast<DirectInputDeviceProvider*>(pContext);
         if (!self || !self->_di) return DIENUM_STOP;
 
         const auto type = GET_DIDEVICE_TYPE(pdidInstance->dwDevType);
         const bool isDriving = (type == DI8DEVTYPE_DRIVING);
 
-        if (SUCCEEDED(self->_di->CreateDevice(pdidInstance->guidInstance, &self->_device, nullptr)))
+        IDirectInputDevice8* device = nullptr;
+        if (SUCCEEDED(self->_di->CreateDevice(pdidInstance->guidInstance, &device, nullptr)))
         {
+            if (self->_found)
+            {
+                // only a wheel replaces the controller we already have
+                if (!isDriving)
+                {
+                    device->Release();
+                    return DIENUM_CONTINUE;
+                }
+                self->_found->Release();
+            }
+            self->_found = device;
             if (isDriving) return DIENUM_STOP; // prefer wheels
             // Keep device, continue enumeration to prefer a wheel; if none found, well keep this one.
             return DIENUM_CONTINUE;
@@ -30,129 +75,185 @@ namespace IGCS
         return DIENUM_CONTINUE;
     }
 
-    bool DirectInputPad::initialize(HWND hwnd)
+    void* DirectInputDeviceProvider::open() noexcept
     {
-        if (_initialized) return true;
-        _hwnd = hwnd;
-
-        if (FAILED(DirectInput8Create(GetModuleHandle(nullptr), DIRECTINPUT_VERSION, IID_IDirectInput8,
+        if (!_di && FAILED(DirectInput8Create(GetModuleHandle(nullptr), DIRECTINPUT_VERSION, IID_IDirectInput8,
             reinterpret_cast<void**>(&_di), nullptr)))
         {
-            return false;
-        }
-
-        if (FAILED(_di->EnumDevices(DI8DEVCLASS_GAMECTRL, enumDevicesCallback, this, DIEDFL_ATTACHEDONLY)))
-        {
-            return false;
+            _di = nullptr;
+            return nullptr;
         }
 
-        if (!_device)
+        _found = nullptr;
+        if (FAILED(_di->EnumDevices(DI8DEVCLASS_GAMECTRL, enumDevicesCallback, this, DIEDFL_ATTACHEDONLY)) || !_found)
         {
             // No controller found
-            return false;
+            if (_found) _found->Release();
+            _found = nullptr;
+            return nullptr;
         }
+        IDirectInputDevice8* device = _found;
+        _found = nullptr;
 
-        if (FAILED(_device->SetDataFormat(&c_dfDIJoystick2)))
+        DIPROPDWORD bufferSize{};
+        bufferSize.diph.dwSize = sizeof(DIPROPDWORD);
+        bufferSize.diph.dwHeaderSize = sizeof(DIPROPHEADER);
+        bufferSize.diph.dwHow = DIPH_DEVICE;
+        bufferSize.dwData = kEventBufferSize;
+        if (FAILED(device->SetDataFormat(&buttonDataFormat()))
+            || FAILED(device->SetProperty(DIPROP_BUFFERSIZE, &bufferSize.diph))
+            || FAILED(device->SetCooperativeLevel(_hwnd, DISCL_FOREGROUND | DISCL_NONEXCLUSIVE))
+            || FAILED(device->Acquire()))
         {
-            releaseDevice();
-            return false;
+            device->Release();
+            return nullptr;
         }
 
-        if (FAILED(_device->SetCooperativeLevel(_hwnd, DISCL_FOREGROUND | DISCL_NONEXCLUSIVE)))
+        DIDEVICEINSTANCE instance{};
+        instance.dwSize = sizeof(instance);
+        if (SUCCEEDED(device->GetDeviceInfo(&instance)))
         {
-            releaseDevice();
-            return false;
+            // the log formats narrow strings only
+            char productName[sizeof(instance.tszProductName)];
+            if (0 == WideCharToMultiByte(CP_UTF8, 0, instance.tszProductName, -1, productName, sizeof(productName), nullptr, nullptr))
+            {
+                productName[0] = '\0';
+            }
+            MessageHandler::logDebug("DirectInput: using '%s'", productName);
         }
+        return device;
+    }
 
-        if (!acquireDevice())
+    void DirectInputDeviceProvider::close(void* device) noexcept
+    {
+        auto directInputDevice = static_cast<IDirectInputDevice8*>(device);
+        directInputDevice->Unacquire();
+        directInputDevice->Release();
+    }
+
+    void DirectInputDeviceProvider::shutdown() noexcept
+    {
+        if (_di)
         {
-            releaseDevice();
-            return false;
+            _di->Release();
+            _di = nullptr;
         }
+    }
 
-        ZeroMemory(&_state, sizeof(_state));
-        _prevBtn.fill(false);
-        _curBtn.fill(false);
-        _buttonJustPressed.fill(false);
+    bool DirectInputPad::initialize(HWND hwnd, DeviceWorker& worker)
+    {
+        if (_initialized) return true;
+        if (!hwnd) return false;
 
+        _provider.setWindow(hwnd);
+        _buttons.reset();
+        if (_worker != &worker)
+        {
+            _worker = &worker;
+            worker.add(_discovery);
+        }
+        else
+        {
+            // initialized again after a shutdown, the search is already registered
+            _discovery.requestDiscovery();
+            worker.wake();
+        }
         _initialized = true;
         return true;
     }
 
-    bool DirectInputPad::acquireDevice()
+    void DirectInputPad::loseDevice(IDirectInputDevice8* device)
     {
-        if (!_device) return false;
-        const HRESULT hr = _device->Acquire();
-        return SUCCEEDED(hr);
+        _activeDevice = nullptr;
+        _buttons.reset();
+        if (_discovery.reportLost(device))
+        {
+            _worker->wake();
+        }
     }
 
-    void DirectInputPad::releaseDevice()
+    void DirectInputPad::resyncButtons(IDirectInputDevice8* device)
     {
-        if (_device)
+        ButtonState state{};
+        const HRESULT hr = device->GetDeviceState(sizeof(state), &state);
+        if (FAILED(hr))
         {
-            _device->Unacquire();
-            _device->Release();
-            _device = nullptr;
+            if (hr == DIERR_UNPLUGGED) loseDevice(device);
+            return;
         }
-        if (_di)
+        ButtonSet down;
+        for (uint32_t i = 0; i < ButtonSet::kButtons; ++i)
         {
-            _di->Release();
-            _di = nullptr;
+            if (state.buttons[i] & 0x80) down.set(i);
         }
-        _initialized = false;
+        _buttons.resync(down);
     }
 
-    void DirectInputPad::computeTransitions()
+    void DirectInputPad::update()
     {
-        for (int i = 0; i < 128; ++i)
+        auto device = static_cast<IDirectInputDevice8*>(_discovery.device());
+        if (device != _activeDevice)
         {
-            _buttonJustPressed[i] = (!_prevBtn[i] && _curBtn[i]);
-            _prevBtn[i] = _curBtn[i];
+            // new device (or none), start without any button held
+            _activeDevice = device;
+            _buttons.reset();
         }
-    }
+        _buttons.beginFrame();
+        if (!device) return;
 
-    void DirectInputPad::update()
-    {
-        if (!_initialized)
+        HRESULT hr = device->Poll();
+        if (hr == DIERR_UNPLUGGED)
         {
-            // Lazy init if needed
-            if (!initialize(_hwnd)) return;
+            loseDevice(device);
+            return;
         }
-        if (!_device) return;
-
-        HRESULT hr = _device->Poll();
         if (FAILED(hr))
         {
             // During shutdown/alt-tab/etc., reacquire may fail; just bail.
             if (hr == DIERR_INPUTLOST || hr == DIERR_NOTACQUIRED)
             {
-                if (!acquireDevice()) return;
+                hr = device->Acquire();
+                if (hr == DIERR_UNPLUGGED)
+                {
+                    loseDevice(device);
+                    return;
+                }
+                if (FAILED(hr)) return;
+                // events while not acquired are gone
+                resyncButtons(device);
+                return;
             }
         }
 
-        ZeroMemory(&_state, sizeof(_state));
-        hr = _device->GetDeviceState(sizeof(DIJOYSTATE2), &_state);
-        if (FAILED(hr))
-        {
-            // Dont try hard during teardown; just stop updating.
-            return;
-        }
-
-        for (int i = 0; i < 128; ++i)
+        DIDEVICEOBJECTDATA events[kEventBatch];
+        for (;;)
         {
-            _curBtn[i] = (_state.rgbButtons[i] & 0x80) != 0;
+            DWORD count = kEventBatch;
+            hr = device->GetDeviceData(sizeof(DIDEVICEOBJECTDATA), events, &count, 0);
+            if (FAILED(hr))
+            {
+                if (hr == DIERR_UNPLUGGED) loseDevice(device);
+                // Dont try hard during teardown; just stop updating.
+                return;
+            }
+            for (DWORD i = 0; i < count; ++i)
+            {
+                _buttons.apply({ events[i].dwOfs, (events[i].dwData & 0x80) != 0, events[i].dwTimeStamp });
+            }
+            if (hr == DI_BUFFEROVERFLOW)
+            {
+                resyncButtons(device);
+                return;
+            }
+            if (count < kEventBatch) return;
         }
-
-        computeTransitions();
     }
 
     void DirectInputPad::shutdown()
     {
         // Explicit, safe-context teardown. Do NOT call from DllMain.
-        releaseDevice();
-        _prevBtn.fill(false);
-        _curBtn.fill(false);
-        _buttonJustPressed.fill(false);
-        ZeroMemory(&_state, sizeof(_state));
+        _activeDevice = nullptr;
+        _buttons.reset();
+        _initialized = false;
     }
 }
\ No newline at end of file
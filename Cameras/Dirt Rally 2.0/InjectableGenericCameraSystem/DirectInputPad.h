@@ -1,11 +1,35 @@
 #pragma once
 #include "stdafx.h"
 #include <dinput.h>
-#include <array>
+#include "DeviceDiscovery.h"
+#include "DeviceWorker.h"
+#include "ButtonEdgeTracker.h"
 
 namespace IGCS
 {
-    // Minimal DirectInput poller for one wheel/controller (buttons only)
+    // Opens the first attached game controller, preferring wheels, with only its buttons in buffered mode. Used on the
+    // device worker thread only.
+    class DirectInputDeviceProvider : public IDeviceProvider
+    {
+    public:
+        void setWindow(HWND hwnd) { _hwnd = hwnd; }
+        void* open() noexcept override;
+        void close(void* device) noexcept override;
+        // Releases DirectInput itself, after all devices are closed.
+        void shutdown() noexcept override;
+
+    private:
+        static BOOL CALLBACK enumDevicesCallback(const DIDEVICEINSTANCE* pdidInstance, VOID* pContext);
+
+        HWND _hwnd = nullptr;
+        IDirectInput8* _di = nullptr;
+        IDirectInputDevice8* _found = nullptr;
+    };
+
+    // Minimal DirectInput reader for one wheel/controller (buttons only). Devices are found on the device worker, at
+    // startup, when a device is attached and otherwise with a growing interval, so a missing wheel costs the input thread
+    // nothing but an atomic load per sample. Buttons are read as buffered events, so a sample without presses or releases
+    // only costs one GetDeviceData call.
     class DirectInputPad
     {
     public:
@@ -14,41 +38,38 @@ namespace IGCS
         // Destructor may run during DLL_PROCESS_DETACH under loader lock.
         ~DirectInputPad() = default;
 
-        // Initialize and acquire first attached game controller (e.g., wheel)
-        bool initialize(HWND hwnd);
+        // Registers the device search with the worker, for the given window. Doesn't wait for a device.
+        bool initialize(HWND hwnd, DeviceWorker& worker);
         bool isInitialized() const { return _initialized; }
 
-        // Poll current state; call once per frame
+        // Processes the button events since the last call; call once per sample, on the input thread
         void update();
 
-        // Explicit shutdown to release resources from a SAFE context (not DllMain).
+        // Forgets the device. update() must not run anymore; the worker releases DirectInput when it's stopped.
         void shutdown();
 
-        // Button helpers: 0..127 indices. True only on the frame the button transitions to down.
+        // Button helpers: 0..127 indices. True only in the sample the button transitions to down.
         bool isButtonJustPressed(int index) const
         {
-            if (index < 0 || index >= 128) return false;
-            return _buttonJustPressed[index];
+            if (index < 0) return false;
+            return _buttons.isJustPressed(static_cast<uint32_t>(index));
         }
 
     private:
-        static BOOL CALLBACK enumDevicesCallback(const DIDEVICEINSTANCE* pdidInstance, VOID* pContext);
-
-        bool acquireDevice();
-        void releaseDevice();
-        void computeTransitions();
+        // hands an unusable device back to the worker
+        void loseDevice(IDirectInputDevice8* device);
+        // full state read after buffered events were lost
+        void resyncButtons(IDirectInputDevice8* device);
 
     private:
         bool _initialized = false;
-        HWND _hwnd = nullptr;
-
-        IDirectInput8* _di = nullptr;
-        IDirectInputDevice8* _device = nullptr;
 
-        DIJOYSTATE2 _state{};
+        DirectInputDeviceProvider _provider;
+        DeviceDiscovery _discovery{ _provider };
+        DeviceWorker* _worker = nullptr;
 
-        std::array<bool, 128> _prevBtn{};
-        std::array<bool, 128> _curBtn{};
-        std::array<bool, 128> _buttonJustPressed{};
+        // input thread only: the device of the previous update, to notice a switch
+        IDirectInputDevice8* _activeDevice = nullptr;
+        ButtonEdgeTracker _buttons;
     };
 }
\ No newline at end of file
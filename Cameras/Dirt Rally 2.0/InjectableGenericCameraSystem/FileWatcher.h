@@ -0,0 +1,316 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// Watches a single file for changes on its own thread: ReadDirectoryChangesW on Windows, inotify elsewhere. Both watch the
+// file's directory, so editors which save by writing a temporary file and renaming it over the original are seen too.
+// Notifications are debounced: the file is only read once it has been quiet for kSettleTime, and the listener is only called
+// if the contents differ from the last contents it saw. A file which is deleted or can't be read is skipped, the listener
+// keeps what it had.
+namespace IGCS
+{
+	class IFileChangeListener
+	{
+	public:
+		virtual ~IFileChangeListener() = default;
+		// Called on the watcher thread with the new contents of the file.
+		virtual void fileChanged(const std::string& contents) = 0;
+	};
+
+	class FileWatcher
+	{
+	public:
+		static constexpr int kSettleTimeMs = 150;
+		// a file still being written (locked on Windows) is tried again this many times, kSettleTime apart
+		static constexpr int kReadRetries = 10;
+
+		FileWatcher() = default;
+		// IMPORTANT: no cleanup in the destructor, it may run under loader lock. Use stop().
+		~FileWatcher() = default;
+		FileWatcher(const FileWatcher&) = delete;
+		FileWatcher& operator=(const FileWatcher&) = delete;
+
+		// Reads the whole file. False if it doesn't exist or can't be opened.
+		static bool readFile(const std::filesystem::path& path, std::string& contents)
+		{
+			std::ifstream in(path, std::ios::binary);
+			if (!in.is_open())
+			{
+				return false;
+			}
+			contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+			return !in.bad();
+		}
+
+		// Starts watching path. knownContents is what the listener already has, so an unchanged file isn't reported. The
+		// listener must outlive the watcher.
+		bool start(const std::filesystem::path& path, IFileChangeListener& listener, const std::string& knownContents)
+		{
+			if (_thread.joinable())
+			{
+				return true;
+			}
+			_path = path;
+			_listener = &listener;
+			_contents = knownContents;
+			_stopRequested.store(false, std::memory_order_relaxed);
+			if (!openWatch())
+			{
+				return false;
+			}
+			_thread = std::thread(&FileWatcher::run, this);
+			return true;
+		}
+
+		// From a SAFE context (not DllMain).
+		void stop()
+		{
+			if (_thread.joinable())
+			{
+				_stopRequested.store(true, std::memory_order_release);
+				signalStop();
+				_thread.join();
+			}
+			closeWatch();
+		}
+
+		// Number of times the listener was called.
+		[[nodiscard]] uint32_t changesReported() const noexcept { return _changesReported.load(std::memory_order_relaxed); }
+
+	private:
+		// Reads the file after it has settled. False if it should be tried again later.
+		bool settled()
+		{
+			std::string contents;
+			if (!readFile(_path, contents))
+			{
+				std::error_code error;
+				return !std::filesystem::exists(_path, error);		// deleted: nothing to retry, locked: retry
+			}
+			if (contents != _contents)
+			{
+				_contents.swap(contents);
+				_changesReported.fetch_add(1, std::memory_order_relaxed);
+				_listener->fileChanged(_contents);
+			}
+			return true;
+		}
+
+		bool isOurFile(const std::filesystem::path& name) const
+		{
+#ifdef _WIN32
+			return 0 == _wcsicmp(name.c_str(), _path.filename().c_str());
+#else
+			return name == _path.filename();
+#endif
+		}
+
+#ifdef _WIN32
+		bool openWatch()
+		{
+			const std::filesystem::path directory = _path.has_parent_path() ? _path.parent_path() : std::filesystem::path(L".");
+			_directory = CreateFileW(directory.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+				OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+			_stopEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+			_changeEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+			if (INVALID_HANDLE_VALUE == _directory || nullptr == _stopEvent || nullptr == _changeEvent)
+			{
+				closeWatch();
+				return false;
+			}
+			return true;
+		}
+
+		void closeWatch()
+		{
+			if (INVALID_HANDLE_VALUE != _directory) { CloseHandle(_directory); _directory = INVALID_HANDLE_VALUE; }
+			if (nullptr != _stopEvent) { CloseHandle(_stopEvent); _stopEvent = nullptr; }
+			if (nullptr != _changeEvent) { CloseHandle(_changeEvent); _changeEvent = nullptr; }
+		}
+
+		void signalStop()
+		{
+			SetEvent(_stopEvent);
+		}
+
+		bool issueRead(OVERLAPPED& overlapped)
+		{
+			ResetEvent(_changeEvent);
+			overlapped = OVERLAPPED{};
+			overlapped.hEvent = _changeEvent;
+			return FALSE != ReadDirectoryChangesW(_directory, _buffer, sizeof(_buffer), FALSE,
+				FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE, nullptr, &overlapped, nullptr);
+		}
+
+		// True if the completed read mentions our file. A read with no records means the buffer overflowed: assume it does.
+		bool touchesOurFile(DWORD bytes) const
+		{
+			if (0 == bytes)
+			{
+				return true;
+			}
+			const uint8_t* record = _buffer;
+			while (true)
+			{
+				const FILE_NOTIFY_INFORMATION* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(record);
+				if (isOurFile(std::wstring(info->FileName, info->FileNameLength / sizeof(wchar_t))))
+				{
+					return true;
+				}
+				if (0 == info->NextEntryOffset)
+				{
+					return false;
+				}
+				record += info->NextEntryOffset;
+			}
+		}
+
+		void run()
+		{
+			SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+			OVERLAPPED overlapped;
+			bool reading = issueRead(overlapped);
+			int retries = -1;		// -1: nothing pending
+			const HANDLE handles[] = { _stopEvent, _changeEvent };
+			while (!_stopRequested.load(std::memory_order_acquire) && reading)
+			{
+				const DWORD result = WaitForMultipleObjects(2, handles, FALSE, retries < 0 ? INFINITE : static_cast<DWORD>(kSettleTimeMs));
+				if (WAIT_OBJECT_0 + 1 == result)
+				{
+					DWORD bytes = 0;
+					if (GetOverlappedResult(_directory, &overlapped, &bytes, FALSE) && touchesOurFile(bytes))
+					{
+						retries = kReadRetries;
+					}
+					reading = issueRead(overlapped);
+				}
+				else if (WAIT_TIMEOUT == result)
+				{
+					retries = settled() ? -1 : retries - 1;
+				}
+				else
+				{
+					break;
+				}
+			}
+			if (reading)
+			{
+				CancelIoEx(_directory, &overlapped);
+				DWORD bytes = 0;
+				GetOverlappedResult(_directory, &overlapped, &bytes, TRUE);
+			}
+		}
+
+		HANDLE _directory = INVALID_HANDLE_VALUE;
+		HANDLE _stopEvent = nullptr;
+		HANDLE _changeEvent = nullptr;
+		alignas(DWORD) uint8_t _buffer[4096] = {};
+#else
+		bool openWatch()
+		{
+			const std::filesystem::path directory = _path.has_parent_path() ? _path.parent_path() : std::filesystem::path(".");
+			_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+			if (_inotify < 0 || 0 != pipe2(_stopPipe, O_NONBLOCK | O_CLOEXEC)
+				|| inotify_add_watch(_inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO | IN_CREATE | IN_DELETE) < 0)
+			{
+				closeWatch();
+				return false;
+			}
+			return true;
+		}
+
+		void closeWatch()
+		{
+			if (_inotify >= 0) { close(_inotify); _inotify = -1; }
+			for (int& fd : _stopPipe)
+			{
+				if (fd >= 0) { close(fd); fd = -1; }
+			}
+		}
+
+		void signalStop()
+		{
+			const char stop = 1;
+			[[maybe_unused]] const ssize_t written = write(_stopPipe[1], &stop, 1);
+		}
+
+		// Drains the pending events. True if any of them is about our file.
+		bool readEvents()
+		{
+			bool ours = false;
+			while (true)
+			{
+				const ssize_t bytes = read(_inotify, _buffer, sizeof(_buffer));
+				if (bytes <= 0)
+				{
+					return ours;
+				}
+				for (ssize_t offset = 0; offset < bytes;)
+				{
+					const inotify_event* event = reinterpret_cast<const inotify_event*>(_buffer + offset);
+					if ((event->mask & IN_Q_OVERFLOW) || (event->len > 0 && isOurFile(event->name)))
+					{
+						ours = true;
+					}
+					offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+				}
+			}
+		}
+
+		void run()
+		{
+			int retries = -1;		// -1: nothing pending
+			pollfd fds[2] = { { _stopPipe[0], POLLIN, 0 }, { _inotify, POLLIN, 0 } };
+			while (!_stopRequested.load(std::memory_order_acquire))
+			{
+				const int result = poll(fds, 2, retries < 0 ? -1 : kSettleTimeMs);
+				if (result < 0 || (fds[0].revents & POLLIN))
+				{
+					if (result < 0 && EINTR == errno)
+					{
+						continue;
+					}
+					break;
+				}
+				if (result > 0 && (fds[1].revents & POLLIN))
+				{
+					if (readEvents())
+					{
+						retries = kReadRetries;
+					}
+				}
+				else if (0 == result)
+				{
+					retries = settled() ? -1 : retries - 1;
+				}
+			}
+		}
+
+		int _inotify = -1;
+		int _stopPipe[2] = { -1, -1 };
+		alignas(inotify_event) uint8_t _buffer[4096] = {};
+#endif
+
+		std::filesystem::path _path;
+		IFileChangeListener* _listener = nullptr;
+		std::string _contents;
+		std::thread _thread;
+		std::atomic<bool> _stopRequested{ false };
+		std::atomic<uint32_t> _changesReported{ 0 };
+	};
+}
@@ -0,0 +1,167 @@
+#pragma once
+#include <cstdarg>
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+#include "stb_sprintf.h"
+
+// Printf style formatting into a caller supplied buffer through stb_sprintf: one pass over the format string, no allocation,
+// no locale. The result is a view into the buffer, valid till the buffer is written again, and tells whether the text was cut
+// off to fit. stb_sprintf's own vsnprintf only returns the clamped length, so it's driven through its callback interface here
+// to tell a text which exactly fits from one which didn't. The stb_sprintf implementation is compiled in Utils.cpp.
+// Unlike the CRT, stb_sprintf ignores h, has no hh and no %F, prints a null string as "null" and rounds halfway cases away from
+// zero (%.0f of 0.5 is "1"). l is 32 bits, as with MSVC. A conversion cut off by the end of the format string is left out.
+namespace IGCS
+{
+	struct FormatResult
+	{
+		std::string_view text;
+		bool truncated = false;
+	};
+
+	namespace FormatDetail
+	{
+		// stb_sprintf writes in chunks of up to STB_SPRINTF_MIN characters. While a whole chunk fits, it writes straight into
+		// the target; the tail goes through a local chunk and is copied as far as it fits.
+		struct Target
+		{
+			char* buffer;
+			size_t capacity;		// without the terminating zero
+			size_t length;
+			bool truncated;
+			char chunk[STB_SPRINTF_MIN];
+
+			char* next() noexcept
+			{
+				return capacity - length >= STB_SPRINTF_MIN ? buffer + length : chunk;
+			}
+		};
+
+		inline char* flush(char* written, void* user, int count) noexcept
+		{
+			Target& target = *static_cast<Target*>(user);
+			const size_t length = static_cast<size_t>(count);
+			if (written != target.chunk)
+			{
+				target.length += length;
+				return target.next();
+			}
+			const size_t room = target.capacity - target.length;
+			const size_t copied = length < room ? length : room;
+			std::memcpy(target.buffer + target.length, written, copied);
+			target.length += copied;
+			if (copied < length)
+			{
+				target.truncated = true;
+				return nullptr;		// stops formatting, the rest wouldn't fit anyway
+			}
+			return target.next();
+		}
+
+		inline char* measure(char* written, void* user, int count) noexcept
+		{
+			*static_cast<size_t*>(user) += static_cast<size_t>(count);
+			return written;
+		}
+
+		// Where a conversion at the end of fmt starts if it's cut off ("... 100%", "%l"), else nullptr. stb_sprintf reads past
+		// the terminating zero of such a format string.
+		inline const char* unfinishedConversion(const char* fmt) noexcept
+		{
+			const char* position = fmt + std::strlen(fmt);
+			while (position > fmt && nullptr != std::strchr("-+ #0123456789.*hljztI", position[-1]))
+			{
+				--position;
+			}
+			size_t percents = 0;
+			while (position > fmt && '%' == position[-1])
+			{
+				--position;
+				++percents;
+			}
+			return 0 == (percents & 1) ? nullptr : position + percents - 1;
+		}
+
+		inline void vsprintfcb(STBSP_SPRINTFCB* callback, void* user, char* buf, const char* fmt, va_list args) noexcept
+		{
+			const char* unfinished = unfinishedConversion(fmt);
+			if (nullptr == unfinished)
+			{
+				stbsp_vsprintfcb(callback, user, buf, fmt, args);
+				return;
+			}
+			// format without the cut off conversion. Rare, so a bounded copy is fine; longer format strings give no text.
+			char trimmed[STB_SPRINTF_MIN];
+			const size_t length = static_cast<size_t>(unfinished - fmt);
+			if (length >= sizeof(trimmed))
+			{
+				return;
+			}
+			std::memcpy(trimmed, fmt, length);
+			trimmed[length] = '\0';
+			stbsp_vsprintfcb(callback, user, buf, trimmed, args);
+		}
+	}
+
+	// Formats into buffer, which always ends up zero terminated. size includes the terminating zero.
+	inline FormatResult formatToVa(char* buffer, size_t size, const char* fmt, va_list args) noexcept
+	{
+		if (0 == size)
+		{
+			return FormatResult{ std::string_view(), true };
+		}
+		FormatDetail::Target target;
+		target.buffer = buffer;
+		target.capacity = size - 1;
+		target.length = 0;
+		target.truncated = false;
+		FormatDetail::vsprintfcb(&FormatDetail::flush, &target, target.next(), fmt, args);
+		buffer[target.length] = '\0';
+		return FormatResult{ std::string_view(buffer, target.length), target.truncated };
+	}
+
+	inline FormatResult formatTo(char* buffer, size_t size, const char* fmt, ...) noexcept
+	{
+		va_list args;
+		va_start(args, fmt);
+		const FormatResult result = formatToVa(buffer, size, fmt, args);
+		va_end(args);
+		return result;
+	}
+
+	// The length of the formatted text, without writing it anywhere. For sizing a buffer when a fixed one was too small.
+	inline size_t formattedLengthVa(const char* fmt, va_list args) noexcept
+	{
+		char chunk[STB_SPRINTF_MIN];
+		size_t length = 0;
+		FormatDetail::vsprintfcb(&FormatDetail::measure, &length, chunk, fmt, args);
+		return length;
+	}
+
+	// A fixed buffer to format into, e.g. one per thread.
+	template<size_t Size>
+	class FormatBuffer
+	{
+		static_assert(Size >= 2, "Size includes the terminating zero");
+
+	public:
+		static constexpr size_t kSize = Size;
+
+		FormatResult format(const char* fmt, ...) noexcept
+		{
+			va_list args;
+			va_start(args, fmt);
+			const FormatResult result = formatToVa(_buffer, Size, fmt, args);
+			va_end(args);
+			return result;
+		}
+
+		FormatResult formatVa(const char* fmt, va_list args) noexcept
+		{
+			return formatToVa(_buffer, Size, fmt, args);
+		}
+
+	private:
+		char _buffer[Size] = {};
+	};
+}
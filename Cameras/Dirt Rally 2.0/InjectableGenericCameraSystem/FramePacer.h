@@ -0,0 +1,112 @@
+#pragma once
+#include <cstdint>
+
+// Frame rate limiter for the Present path. Waiting is done in two steps: a sleep for most of the remaining time, then a spin
+// on the clock for the rest. How much a sleep overshoots what was asked differs per machine and timer, so it's measured on
+// every sleep and the sleep is cut short by the expected overshoot plus a few deviations. Deadlines advance by exactly one
+// period from the previous deadline, so the rate doesn't drift; a frame later than a whole period restarts the schedule.
+namespace IGCS
+{
+	// Time source and sleep used by the pacer, in nanoseconds. See PacingClock.h for the system implementation.
+	class IPacingClock
+	{
+	public:
+		virtual ~IPacingClock() = default;
+
+		virtual int64_t now() noexcept = 0;
+		virtual void sleep(int64_t nanoseconds) noexcept = 0;
+		// called in the spin loop, e.g. a pause instruction
+		virtual void spinPause() noexcept {}
+	};
+
+	class FramePacer
+	{
+	public:
+		// margin kept for spinning on top of the expected sleep overshoot
+		static constexpr int64_t kSpinReserve = 100000;		// 0.1ms
+		static constexpr double kOvershootAdaption = 0.1;
+
+		explicit FramePacer(IPacingClock& clock) noexcept : _clock(clock)
+		{
+		}
+
+		// Frames per second to pace to, 0 switches the pacer off.
+		void setTargetRate(double framesPerSecond) noexcept
+		{
+			const int64_t period = framesPerSecond > 0.0 ? static_cast<int64_t>(1e9 / framesPerSecond + 0.5) : 0;
+			if (period != _period)
+			{
+				_period = period;
+				_nextDeadline = 0;
+			}
+		}
+
+		[[nodiscard]] bool enabled() const noexcept { return _period > 0; }
+		[[nodiscard]] int64_t period() const noexcept { return _period; }
+		// expected overshoot of a sleep, in nanoseconds
+		[[nodiscard]] double sleepOvershoot() const noexcept { return _overshootMean; }
+
+		// Waits until the next frame is due. Returns how far past its deadline the frame was released, in nanoseconds.
+		int64_t wait() noexcept
+		{
+			if (!enabled())
+			{
+				return 0;
+			}
+			int64_t now = _clock.now();
+			if (_nextDeadline == 0)
+			{
+				_nextDeadline = now + _period;
+				return 0;
+			}
+			const int64_t deadline = _nextDeadline;
+			if (now >= deadline)
+			{
+				// the frame took longer than the period, no waiting
+				const int64_t lateness = now - deadline;
+				_nextDeadline = lateness > _period ? now + _period : deadline + _period;
+				return lateness;
+			}
+
+			for (;;)
+			{
+				const int64_t margin = static_cast<int64_t>(_overshootMean + 4.0 * _overshootDeviation) + kSpinReserve;
+				const int64_t requested = deadline - now - margin;
+				if (requested <= 0)
+				{
+					break;
+				}
+				_clock.sleep(requested);
+				const int64_t woke = _clock.now();
+				learnOvershoot(static_cast<double>(woke - now - requested));
+				now = woke;
+			}
+			while (now < deadline)
+			{
+				_clock.spinPause();
+				now = _clock.now();
+			}
+			_nextDeadline = deadline + _period;
+			return now - deadline;
+		}
+
+	private:
+		void learnOvershoot(double overshoot) noexcept
+		{
+			if (overshoot < 0.0)
+			{
+				overshoot = 0.0;
+			}
+			const double difference = overshoot - _overshootMean;
+			_overshootMean += kOvershootAdaption * difference;
+			_overshootDeviation += kOvershootAdaption * ((difference < 0.0 ? -difference : difference) - _overshootDeviation);
+		}
+
+		IPacingClock& _clock;
+		int64_t _period = 0;
+		int64_t _nextDeadline = 0;
+		// start pessimistic, a default Windows timer overshoots by up to a scheduler tick
+		double _overshootMean = 1000000.0;
+		double _overshootDeviation = 500000.0;
+	};
+}
@@ -0,0 +1,308 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Per frame timing of the host and of our own code. The render thread adds one FrameRecord per presented frame; the last
+// kRingSize records are kept in a ring and percentiles are estimated while streaming with the P-square algorithm (Jain &
+// Chlamtac), so no samples have to be stored or sorted. The estimators run over windows of kWindowFrames frames and the
+// result of the last complete window is published. Everything can be read from any thread at any moment without locks or
+// allocations; the published values are updated one by one, so a read racing a publish can mix two adjacent windows.
+namespace IGCS
+{
+	struct FrameRecord
+	{
+		float presentInterval = 0.0f;	// seconds since the previous Present
+		float updateTime = 0.0f;		// seconds spent in System::updateFrame
+		float hookTime = 0.0f;			// seconds spent in our hooks, excluding the original functions and updateFrame
+	};
+
+	struct FrameStatistics
+	{
+		uint64_t frames = 0;			// frames recorded so far
+		uint32_t windowFrames = 0;		// frames in the window the values below are from, 0 if there's no complete window yet
+		float averageFps = 0.0f;
+		float onePercentLowFps = 0.0f;	// fps at the 99th percentile frame time
+		float intervalP50 = 0.0f;
+		float intervalP99 = 0.0f;
+		float updateP50 = 0.0f;
+		float updateP99 = 0.0f;
+		float hookP50 = 0.0f;
+		float hookP99 = 0.0f;
+	};
+
+	// Streaming estimate of a single quantile with five markers.
+	class P2Quantile
+	{
+	public:
+		explicit P2Quantile(double quantile = 0.5) noexcept : _p(quantile)
+		{
+			reset();
+		}
+
+		void reset() noexcept
+		{
+			_count = 0;
+			for (int i = 0; i < 5; ++i)
+			{
+				_positions[i] = i + 1;
+			}
+			_desired[0] = 1.0;
+			_desired[1] = 1.0 + 2.0 * _p;
+			_desired[2] = 1.0 + 4.0 * _p;
+			_desired[3] = 3.0 + 2.0 * _p;
+			_desired[4] = 5.0;
+			_increments[0] = 0.0;
+			_increments[1] = _p / 2.0;
+			_increments[2] = _p;
+			_increments[3] = (1.0 + _p) / 2.0;
+			_increments[4] = 1.0;
+		}
+
+		void add(double value) noexcept
+		{
+			if (_count < 5)
+			{
+				// insertion sort of the first five samples
+				int i = static_cast<int>(_count);
+				while (i > 0 && _heights[i - 1] > value)
+				{
+					_heights[i] = _heights[i - 1];
+					--i;
+				}
+				_heights[i] = value;
+				++_count;
+				return;
+			}
+			++_count;
+
+			int cell;
+			if (value < _heights[0])
+			{
+				_heights[0] = value;
+				cell = 0;
+			}
+			else if (value >= _heights[4])
+			{
+				_heights[4] = value;
+				cell = 3;
+			}
+			else
+			{
+				cell = 0;
+				while (value >= _heights[cell + 1])
+				{
+					++cell;
+				}
+			}
+			for (int i = cell + 1; i < 5; ++i)
+			{
+				++_positions[i];
+			}
+			for (int i = 0; i < 5; ++i)
+			{
+				_desired[i] += _increments[i];
+			}
+
+			// move the middle markers to their desired position if they're off by one or more
+			for (int i = 1; i <= 3; ++i)
+			{
+				const double offset = _desired[i] - static_cast<double>(_positions[i]);
+				if ((offset >= 1.0 && _positions[i + 1] - _positions[i] > 1) || (offset <= -1.0 && _positions[i - 1] - _positions[i] < -1))
+				{
+					const int step = offset >= 0.0 ? 1 : -1;
+					const double candidate = parabolic(i, step);
+					if (_heights[i - 1] < candidate && candidate < _heights[i + 1])
+					{
+						_heights[i] = candidate;
+					}
+					else
+					{
+						_heights[i] += step * (_heights[i + step] - _heights[i]) / static_cast<double>(_positions[i + step] - _positions[i]);
+					}
+					_positions[i] += step;
+				}
+			}
+		}
+
+		[[nodiscard]] uint64_t count() const noexcept { return _count; }
+
+		[[nodiscard]] double value() const noexcept
+		{
+			if (_count >= 5)
+			{
+				return _heights[2];
+			}
+			if (_count == 0)
+			{
+				return 0.0;
+			}
+			// few samples: nearest rank on the sorted samples
+			const size_t rank = static_cast<size_t>(_p * static_cast<double>(_count - 1) + 0.5);
+			return _heights[rank];
+		}
+
+	private:
+		[[nodiscard]] double parabolic(int i, int step) const noexcept
+		{
+			const double d = step;
+			const double nPrev = static_cast<double>(_positions[i - 1]);
+			const double n = static_cast<double>(_positions[i]);
+			const double nNext = static_cast<double>(_positions[i + 1]);
+			return _heights[i] + d / (nNext - nPrev) *
+				((n - nPrev + d) * (_heights[i + 1] - _heights[i]) / (nNext - n) + (nNext - n - d) * (_heights[i] - _heights[i - 1]) / (n - nPrev));
+		}
+
+		double _p;
+		uint64_t _count = 0;
+		double _heights[5] = {};
+		int64_t _positions[5] = {};
+		double _desired[5] = {};
+		double _increments[5] = {};
+	};
+
+	class FrameStats
+	{
+	public:
+		static constexpr size_t kRingSize = 1024;
+		static constexpr uint32_t kWindowFrames = 600;
+
+		// Render thread only.
+		void add(const FrameRecord& record) noexcept
+		{
+			const uint64_t index = _written.load(std::memory_order_relaxed);
+			Slot& slot = _ring[index % kRingSize];
+			// a reader that sees any of the stores below also sees _written at index, pairs with the fence in copyRecent
+			std::atomic_thread_fence(std::memory_order_release);
+			slot.presentInterval.store(record.presentInterval, std::memory_order_relaxed);
+			slot.updateTime.store(record.updateTime, std::memory_order_relaxed);
+			slot.hookTime.store(record.hookTime, std::memory_order_relaxed);
+			_written.store(index + 1, std::memory_order_release);
+
+			_intervalP50.add(record.presentInterval);
+			_intervalP99.add(record.presentInterval);
+			_updateP50.add(record.updateTime);
+			_updateP99.add(record.updateTime);
+			_hookP50.add(record.hookTime);
+			_hookP99.add(record.hookTime);
+			_windowIntervalSum += record.presentInterval;
+			if (_intervalP50.count() >= kWindowFrames)
+			{
+				publishWindow();
+			}
+		}
+
+		// Statistics of the last complete window. Any thread.
+		void read(FrameStatistics& destination) const noexcept
+		{
+			destination.frames = _written.load(std::memory_order_acquire);
+			destination.windowFrames = _published.windowFrames.load(std::memory_order_relaxed);
+			destination.averageFps = _published.averageFps.load(std::memory_order_relaxed);
+			destination.onePercentLowFps = _published.onePercentLowFps.load(std::memory_order_relaxed);
+			destination.intervalP50 = _published.intervalP50.load(std::memory_order_relaxed);
+			destination.intervalP99 = _published.intervalP99.load(std::memory_order_relaxed);
+			destination.updateP50 = _published.updateP50.load(std::memory_order_relaxed);
+			destination.updateP99 = _published.updateP99.load(std::memory_order_relaxed);
+			destination.hookP50 = _published.hookP50.load(std::memory_order_relaxed);
+			destination.hookP99 = _published.hookP99.load(std::memory_order_relaxed);
+		}
+
+		// Copies the most recent records, oldest first, into destination. Returns the number copied. Any thread; records
+		// overwritten by the render thread while copying are left out, so once the ring went round it's kRingSize - 1 at most:
+		// the oldest slot is the next one written.
+		size_t copyRecent(FrameRecord* destination, size_t maxRecords) const noexcept
+		{
+			const uint64_t end = _written.load(std::memory_order_acquire);
+			size_t count = static_cast<size_t>(end < kRingSize ? end : kRingSize);
+			if (count > maxRecords)
+			{
+				count = maxRecords;
+			}
+			const uint64_t start = end - count;
+			for (size_t i = 0; i < count; ++i)
+			{
+				const Slot& slot = _ring[(start + i) % kRingSize];
+				destination[i].presentInterval = slot.presentInterval.load(std::memory_order_relaxed);
+				destination[i].updateTime = slot.updateTime.load(std::memory_order_relaxed);
+				destination[i].hookTime = slot.hookTime.load(std::memory_order_relaxed);
+			}
+			// the slots are read before _written is loaded again
+			std::atomic_thread_fence(std::memory_order_acquire);
+			// slots the writer reached in the meantime may hold newer records, drop those from the front. That includes the
+			// slot of record writtenNow, which the writer may be filling in right now.
+			const uint64_t writtenNow = _written.load(std::memory_order_relaxed);
+			const uint64_t overwritten = writtenNow >= start + kRingSize ? writtenNow + 1 - (start + kRingSize) : 0;
+			if (overwritten == 0)
+			{
+				return count;
+			}
+			if (overwritten >= count)
+			{
+				return 0;
+			}
+			const size_t keep = count - static_cast<size_t>(overwritten);
+			for (size_t i = 0; i < keep; ++i)
+			{
+				destination[i] = destination[i + static_cast<size_t>(overwritten)];
+			}
+			return keep;
+		}
+
+	private:
+		struct Slot
+		{
+			std::atomic<float> presentInterval{ 0.0f };
+			std::atomic<float> updateTime{ 0.0f };
+			std::atomic<float> hookTime{ 0.0f };
+		};
+
+		struct Published
+		{
+			std::atomic<uint32_t> windowFrames{ 0 };
+			std::atomic<float> averageFps{ 0.0f };
+			std::atomic<float> onePercentLowFps{ 0.0f };
+			std::atomic<float> intervalP50{ 0.0f };
+			std::atomic<float> intervalP99{ 0.0f };
+			std::atomic<float> updateP50{ 0.0f };
+			std::atomic<float> updateP99{ 0.0f };
+			std::atomic<float> hookP50{ 0.0f };
+			std::atomic<float> hookP99{ 0.0f };
+		};
+
+		void publishWindow() noexcept
+		{
+			const uint32_t frames = static_cast<uint32_t>(_intervalP50.count());
+			const double intervalP99 = _intervalP99.value();
+			_published.averageFps.store(_windowIntervalSum > 0.0 ? static_cast<float>(frames / _windowIntervalSum) : 0.0f, std::memory_order_relaxed);
+			_published.onePercentLowFps.store(intervalP99 > 0.0 ? static_cast<float>(1.0 / intervalP99) : 0.0f, std::memory_order_relaxed);
+			_published.intervalP50.store(static_cast<float>(_intervalP50.value()), std::memory_order_relaxed);
+			_published.intervalP99.store(static_cast<float>(intervalP99), std::memory_order_relaxed);
+			_published.updateP50.store(static_cast<float>(_updateP50.value()), std::memory_order_relaxed);
+			_published.updateP99.store(static_cast<float>(_updateP99.value()), std::memory_order_relaxed);
+			_published.hookP50.store(static_cast<float>(_hookP50.value()), std::memory_order_relaxed);
+			_published.hookP99.store(static_cast<float>(_hookP99.value()), std::memory_order_relaxed);
+			_published.windowFrames.store(frames, std::memory_order_relaxed);
+
+			_intervalP50.reset();
+			_intervalP99.reset();
+			_updateP50.reset();
+			_updateP99.reset();
+			_hookP50.reset();
+			_hookP99.reset();
+			_windowIntervalSum = 0.0;
+		}
+
+		Slot _ring[kRingSize];
+		std::atomic<uint64_t> _written{ 0 };
+		Published _published;
+
+		// render thread only
+		P2Quantile _intervalP50{ 0.5 };
+		P2Quantile _intervalP99{ 0.99 };
+		P2Quantile _updateP50{ 0.5 };
+		P2Quantile _updateP99{ 0.99 };
+		P2Quantile _hookP50{ 0.5 };
+		P2Quantile _hookP99{ 0.99 };
+		double _windowIntervalSum = 0.0;
+	};
+}
@@ -83,6 +83,25 @@ namespace IGCS
 		uint8_t* dofStrengthAddress = nullptr;
 	};
 
+	// Everything the camera writes to the game's camera struct in a frame. Committed once per frame through
+	// CameraManipulator::commitCameraValues, which only writes the values that differ from what's in memory.
+	struct CameraCommit
+	{
+		DirectX::XMFLOAT3 position{ 0.0f, 0.0f, 0.0f };
+		DirectX::XMFLOAT4 rotation{ 0.0f, 0.0f, 0.0f, 1.0f };
+		float fov = 0.0f;
+		float motionBlur = 0.0f;
+		bool writeFov = false;			// fov and motion blur are left alone unless set
+		bool writeMotionBlur = false;
+	};
+
+	struct CameraCommitCounters
+	{
+		uint64_t valuesWritten = 0;		// pose / fov / motion blur values which had to be written
+		uint64_t valuesSkipped = 0;		// values which were already in game memory
+		uint64_t commitsRejected = 0;	// whole commits dropped because the camera struct wasn't usable
+	};
+
 	/// <summary>
 	/// IGCSDOF
 	/// </summary>
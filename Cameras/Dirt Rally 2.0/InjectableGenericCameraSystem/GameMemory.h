@@ -0,0 +1,47 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Access to the host's memory. All reads of game structs go through this interface, so code which interprets those structs
+// (see GameStateSnapshot.h) doesn't depend on running inside the game: in the DLL reads are guarded against access
+// violations, offline a MemoryImage serves them from a buffer.
+namespace IGCS
+{
+	class IGameMemory
+	{
+	public:
+		virtual ~IGameMemory() = default;
+
+		// Copies size bytes from source to destination. Returns false if the memory couldn't be read, destination is
+		// undefined then.
+		virtual bool read(const uint8_t* source, void* destination, size_t size) noexcept = 0;
+	};
+
+	// A block of fake game memory, starting at an arbitrary base address. Reads outside the block fail like reads of
+	// unmapped memory in the game do.
+	class MemoryImage : public IGameMemory
+	{
+	public:
+		MemoryImage(const uint8_t* baseAddress, uint8_t* data, size_t size) noexcept : _baseAddress(baseAddress), _data(data), _size(size)
+		{
+		}
+
+		bool read(const uint8_t* source, void* destination, size_t size) noexcept override
+		{
+			const uintptr_t start = reinterpret_cast<uintptr_t>(source);
+			const uintptr_t base = reinterpret_cast<uintptr_t>(_baseAddress);
+			if (nullptr == source || start < base || start - base > _size || size > _size - (start - base))
+			{
+				return false;
+			}
+			std::memcpy(destination, _data + (start - base), size);
+			return true;
+		}
+
+	private:
+		const uint8_t* _baseAddress;
+		uint8_t* _data;
+		size_t _size;
+	};
+}
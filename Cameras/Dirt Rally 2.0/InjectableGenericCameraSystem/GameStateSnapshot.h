@@ -0,0 +1,113 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include "CameraSmoothing.h"
+#include "GameConstants.h"
+#include "GameMemory.h"
+
+// Everything the camera reads from the game in a frame, copied once at the start of the frame. The values the camera needs
+// sit close together in three structs, so each struct is copied with a single read of the range covering them, and the
+// values are taken from that copy. A struct which can't be read is marked invalid and its values keep their defaults, and
+// so is a car whose transform can't be one, e.g. while the game is still filling it in.
+namespace IGCS::GameSpecific
+{
+	struct GameStateAddresses
+	{
+		const uint8_t* carAddress = nullptr;
+		const uint8_t* cameraAddress = nullptr;
+		const uint8_t* cameraQuaternionAddress = nullptr;
+	};
+
+	struct GameStateSnapshot
+	{
+		bool carValid = false;
+		bool cameraValid = false;
+		bool viewValid = false;
+
+		// car struct
+		Smoothing::Vec3 playerPosition;
+		Smoothing::Quat playerRotation;
+		// camera struct
+		Smoothing::Quat cameraQuaternion;
+		Smoothing::Vec3 cameraCoords;
+		float fov = DEFAULT_FOV;
+		// view values, relative to the camera quaternion
+		float nearZ = 0.1f;
+		float motionBlur = 0.0f;
+	};
+
+	namespace SnapshotLayout
+	{
+		// ranges copied per struct, [start, end)
+		constexpr size_t kCarStart = PLAYER_POSITION_IN_STRUCT_OFFSET;
+		constexpr size_t kCarEnd = PLAYER_ROTATION_IN_STRUCT_OFFSET + 4 * sizeof(float);
+		constexpr size_t kCameraStart = QUATERNION_IN_STRUCT_OFFSET;
+		constexpr size_t kCameraEnd = FOV_IN_STRUCT_OFFSET + sizeof(float);
+		constexpr size_t kViewStart = MOTION_BLUR_STRENGTH_FROM_CAMQUATERNION_OFFSET;
+		constexpr size_t kViewEnd = NEAR_Z_FROM_QUATERNION_OFFSET + sizeof(float);
+
+		static_assert(kCarEnd > kCarStart && kCameraEnd > kCameraStart && kViewEnd > kViewStart, "offsets out of order");
+	}
+
+	// A car transform the camera can follow: all finite and the rotation a unit quaternion, give or take rounding.
+	inline bool isPlausibleCarTransform(const Smoothing::Vec3& position, const Smoothing::Quat& rotation) noexcept
+	{
+		const float lengthSq = Smoothing::dot(rotation, rotation);
+		return std::isfinite(position.x) && std::isfinite(position.y) && std::isfinite(position.z) && std::isfinite(lengthSq)
+			&& std::fabs(lengthSq - 1.0f) < 0.01f;
+	}
+
+	// Fills snapshot from the structs at addresses.
+	inline void captureGameState(IGameMemory& memory, const GameStateAddresses& addresses, GameStateSnapshot& snapshot) noexcept
+	{
+		using namespace SnapshotLayout;
+		snapshot = GameStateSnapshot();
+
+		uint8_t car[kCarEnd - kCarStart];
+		if (nullptr != addresses.carAddress && memory.read(addresses.carAddress + kCarStart, car, sizeof(car)))
+		{
+			Smoothing::Vec3 position;
+			Smoothing::Quat rotation;
+			std::memcpy(&position, car + (PLAYER_POSITION_IN_STRUCT_OFFSET - kCarStart), sizeof(Smoothing::Vec3));
+			std::memcpy(&rotation, car + (PLAYER_ROTATION_IN_STRUCT_OFFSET - kCarStart), sizeof(Smoothing::Quat));
+			if (isPlausibleCarTransform(position, rotation))
+			{
+				snapshot.playerPosition = position;
+				snapshot.playerRotation = rotation;
+				snapshot.carValid = true;
+			}
+		}
+
+		uint8_t camera[kCameraEnd - kCameraStart];
+		if (nullptr != addresses.cameraAddress && memory.read(addresses.cameraAddress + kCameraStart, camera, sizeof(camera)))
+		{
+			std::memcpy(&snapshot.cameraQuaternion, camera + (QUATERNION_IN_STRUCT_OFFSET - kCameraStart), sizeof(Smoothing::Quat));
+			std::memcpy(&snapshot.cameraCoords, camera + (COORDS_IN_STRUCT_OFFSET - kCameraStart), sizeof(Smoothing::Vec3));
+			std::memcpy(&snapshot.fov, camera + (FOV_IN_STRUCT_OFFSET - kCameraStart), sizeof(float));
+			snapshot.cameraValid = true;
+		}
+
+		uint8_t view[kViewEnd - kViewStart];
+		if (nullptr != addresses.cameraQuaternionAddress && memory.read(addresses.cameraQuaternionAddress + kViewStart, view, sizeof(view)))
+		{
+			std::memcpy(&snapshot.motionBlur, view + (MOTION_BLUR_STRENGTH_FROM_CAMQUATERNION_OFFSET - kViewStart), sizeof(float));
+			std::memcpy(&snapshot.nearZ, view + (NEAR_Z_FROM_QUATERNION_OFFSET - kViewStart), sizeof(float));
+			snapshot.viewValid = true;
+		}
+	}
+
+	// Whether the camera can be posed from the snapshot. The pose follows the car, so without a car transform the camera keeps
+	// the last pose written instead of following the defaults to the origin.
+	[[nodiscard]] inline bool canPoseCamera(const GameStateSnapshot& snapshot) noexcept
+	{
+		return snapshot.carValid;
+	}
+
+	// Whether the camera struct was there but can't be read any more: the game freed it, its address has to be dropped till
+	// the interceptor picks up the new one.
+	[[nodiscard]] inline bool cameraStructLost(const GameStateAddresses& addresses, const GameStateSnapshot& snapshot) noexcept
+	{
+		return nullptr != addresses.cameraAddress && !snapshot.cameraValid;
+	}
+}
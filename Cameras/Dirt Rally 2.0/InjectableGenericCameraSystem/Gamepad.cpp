@@ -3,6 +3,7 @@
 //////////////////////////////////////////////////////////////////////
 #include "stdafx.h"
 #include "Gamepad.h"
+#include "PadConnectionManager.h"
 #include <Windows.h>
 #include <Xinput.h>
 #include <algorithm>
@@ -19,9 +20,24 @@ bool Gamepad::isButtonPressed(button_t b) { return (buttonState & b); }
 void Gamepad::setInvertLStickY(bool b) { invertLSY = b; }
 void Gamepad::setInvertRStickY(bool b) { invertRSY = b; }
 
+static_assert(sizeof(IGCS::PadState) == sizeof(XINPUT_STATE), "PadState must match XINPUT_STATE");
+
+void Gamepad::setConnectionManager(IGCS::PadConnectionManager* manager) {
+	connections = manager;
+	if (connections)
+		connections->watch(static_cast<uint32_t>(gpIndex));
+}
+
 void Gamepad::update() {
 	ZeroMemory(&gpState, sizeof(XINPUT_STATE));
-	connected = (XInputGetState(gpIndex, &gpState) == ERROR_SUCCESS);
+	if (connections) {
+		IGCS::PadState state;
+		connected = connections->poll(static_cast<uint32_t>(gpIndex), state);
+		if (connected)
+			memcpy(&gpState, &state, sizeof(XINPUT_STATE));
+	} else {
+		connected = (XInputGetState(gpIndex, &gpState) == ERROR_SUCCESS);
+	}
 	if (buttonState != gpState.Gamepad.wButtons) {
 		WORD stateDiff = buttonState ^ gpState.Gamepad.wButtons;
 		WORD buttonStateCopy = buttonState;
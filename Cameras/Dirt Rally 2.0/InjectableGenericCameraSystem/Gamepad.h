@@ -17,6 +17,8 @@
 #include <Xinput.h>
 using namespace std;
 
+namespace IGCS { class PadConnectionManager; }
+
 /* The positions of the analog sticks will be returned as 'vec2'.
  * If you have your own type similar to 'vec2', feel free
  * to modify the code to use that. As long as it has '.x' and '.y'
@@ -98,6 +100,8 @@ public:
 	void setButtonDownCallback(function<void(button_t)> fn);
 	// Set a function (of type 'void', with a 'button_t' argument) to be called each time a button is released on the gamepad. The value of the argument should be checked against values of the 'button_t' enum to determine which button was released.
 	void setButtonUpCallback(function<void(button_t)> fn);
+	// Read the pad through the connection manager, which only reads connected pads and leaves probing an empty slot to the device worker. Without one, XInputGetState is called every update.
+	void setConnectionManager(IGCS::PadConnectionManager* manager);
 	// Ths update function should be called every cycle of your app (before any other member calls) to keep things up to date. NOTE: All data that other member functions return is actually read from the device at the time you call this function, and will not be updated until you call 'update()' again.
 	void update();
 	// Indicates if the gamepad is connected or not. This should be checked before fetching any data.
@@ -132,4 +136,5 @@ private:
 	bool connected;
 	bool invertLSY;
 	bool invertRSY;
+	IGCS::PadConnectionManager* connections = nullptr;
 };
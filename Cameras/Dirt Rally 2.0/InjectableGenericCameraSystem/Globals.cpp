@@ -66,11 +66,28 @@ namespace IGCS
 	}
 
 	
-	//void Globals::handleSettingMessage(uint8_t payload[], DWORD payloadLength)
-	//{
-	//	_settings.setValueFromMessage(payload, payloadLength);
-	//	
-	//}
+	void Globals::handleSettingMessage(uint8_t payload[], DWORD payloadLength)
+	{
+		SettingUpdate update;
+		switch (SettingsRegistry::decode(payload, payloadLength, update))
+		{
+		case SettingDecodeResult::Ok:
+			_settings.stage(update);
+			break;
+		case SettingDecodeResult::UnknownSetting:
+			MessageHandler::logError("Setting message for unknown setting %u ignored", static_cast<unsigned>(payload[1]));
+			break;
+		case SettingDecodeResult::BadLength:
+			MessageHandler::logError("Setting message with wrong length %lu ignored", payloadLength);
+			break;
+		case SettingDecodeResult::OutOfRange:
+		{
+			const SettingInfo& setting = SettingsRegistry::info(static_cast<SettingType>(payload[1]));
+			MessageHandler::logError("Setting %s: value out of range (%g..%g), ignored", setting.name, setting.minValue, setting.maxValue);
+			break;
+		}
+		}
+	}
 
 	//for handling actions with a payload (like hotsampling)
 	//void Globals::handleActionPayload(uint8_t payload[], DWORD payloadLength)
@@ -79,6 +96,14 @@ namespace IGCS
 
 	//}
 
+	// A staged binding change: the key code or XInput mask in the low 16 bits, then the modifiers
+	static constexpr uint32_t kStagedKeyCodeMask = 0xFFFF;
+	static constexpr uint32_t kStagedAlt = 1u << 16;
+	static constexpr uint32_t kStagedCtrl = 1u << 17;
+	static constexpr uint32_t kStagedShift = 1u << 18;
+	static constexpr uint32_t kStagedKeepKeyCode = 1u << 19;		// an invalid button, only the modifiers change
+	static constexpr uint32_t kStaged = 1u << 31;
+
 	void Globals::handleKeybindingMessage(uint8_t payload[], DWORD payloadLength)
 	{
 		if (payloadLength < 7)
@@ -94,7 +119,8 @@ namespace IGCS
 		bool shiftPressed = payload[5] == 0x01;
 		bool isGamepadButton = payload[6] == 0x01;
 
-		// Determine which ActionData to update
+		// Determine which ActionData to update. The maps are only filled by the constructor, so looking up is fine on this thread;
+		// the ActionData itself is only touched by the input thread.
 		const InputSource inputType = isGamepadButton ? InputSource::Gamepad : InputSource::Keyboard;
 
 		ActionData* toUpdate = (inputType == InputSource::Keyboard) ?
@@ -106,18 +132,50 @@ namespace IGCS
 			return;
 		}
 
-		// Get key code to use - start with current value as default
-		int keyCode = toUpdate->getKeyCode();
+		uint32_t staged = kStaged | (altPressed ? kStagedAlt : 0) | (ctrlPressed ? kStagedCtrl : 0) | (shiftPressed ? kStagedShift : 0);
 
 		// For gamepad buttons, convert ID to XInput mask if valid
 		if (isGamepadButton)
 		{
-			if (const auto xinputMask = Gamepad::idToXInputMask(keyCodeByte); xinputMask.has_value()) keyCode = xinputMask.value();
-			else MessageHandler::logError("Invalid gamepad button ID provided, no update to keyCode");
+			if (const auto xinputMask = Gamepad::idToXInputMask(keyCodeByte); xinputMask.has_value())
+			{
+				staged |= static_cast<uint32_t>(xinputMask.value()) & kStagedKeyCodeMask;
+			}
+			else
+			{
+				MessageHandler::logError("Invalid gamepad button ID provided, no update to keyCode");
+				staged |= kStagedKeepKeyCode;
+			}
 		}
-		else keyCode = keyCodeByte;
+		else staged |= keyCodeByte;
 
-		toUpdate->update(keyCode, altPressed, ctrlPressed, shiftPressed, isGamepadButton);
+		_stagedBindings[static_cast<uint32_t>(inputType)][static_cast<uint32_t>(idOfBinding)].store(staged, std::memory_order_relaxed);
+		// publishes the staged change, the input thread recompiles when it sees the new version
+		_bindingsVersion.fetch_add(1, std::memory_order_acq_rel);
+	}
+
+
+	void Globals::applyStagedBindings()
+	{
+		for (uint32_t source = 0; source < 2; ++source)
+		{
+			for (uint32_t action = 0; action < static_cast<uint32_t>(ActionType::Amount); ++action)
+			{
+				const uint32_t staged = _stagedBindings[source][action].exchange(0, std::memory_order_acquire);
+				if (0 == (staged & kStaged))
+				{
+					continue;
+				}
+				const bool isGamepadButton = static_cast<uint32_t>(InputSource::Gamepad) == source;
+				ActionData* toUpdate = isGamepadButton ? getGamePadActionData(static_cast<ActionType>(action)) : getActionData(static_cast<ActionType>(action));
+				if (nullptr == toUpdate)
+				{
+					continue;
+				}
+				const int keyCode = 0 != (staged & kStagedKeepKeyCode) ? toUpdate->getKeyCode() : static_cast<int>(staged & kStagedKeyCodeMask);
+				toUpdate->update(keyCode, 0 != (staged & kStagedAlt), 0 != (staged & kStagedCtrl), 0 != (staged & kStagedShift), isGamepadButton);
+			}
+		}
 	}
 
 
@@ -141,25 +199,38 @@ namespace IGCS
 		return _gamepadKeyBindingPerActionType.at(type);
 	}
 
-	// Check if any binding for this action is active
-	bool Globals::isAnyBindingActivated(ActionType type, bool altCtrlOptional)
+	void Globals::compileBindings(BindingTable& table)
 	{
-		ActionData* primaryBinding = getActionData(type);
-		ActionData* altBinding = getGamePadActionData(type);
-
-		// Check primary binding
-		if (primaryBinding && primaryBinding->isActive(altCtrlOptional))
+		static_assert(static_cast<uint32_t>(ActionType::Amount) <= BindingTable::kMaxActions, "BindingTable is too small for all actions");
+		static_assert(BindingTable::kKeyLeftShift == VK_LSHIFT && BindingTable::kKeyRightAlt == VK_RMENU, "BindingTable modifier keys don't match");
+		static_assert(BindingTable::kPadLeftShoulder == XINPUT_GAMEPAD_LEFT_SHOULDER && BindingTable::kPadRightShoulder == XINPUT_GAMEPAD_RIGHT_SHOULDER,
+			"BindingTable modifier buttons don't match");
+		applyStagedBindings();
+		table.clear();
+		auto compile = [&table](ActionType type, ActionData* binding)
+		{
+			if (nullptr == binding || !binding->getAvailable())
+			{
+				return;
+			}
+			const uint32_t action = static_cast<uint32_t>(type);
+			if (binding->getInputSource() == InputSource::Gamepad)
+			{
+				table.setPadBinding(action, static_cast<uint16_t>(binding->getKeyCode()), binding->getAltRequired(), binding->getCtrlRequired());
+			}
+			else
+			{
+				table.setKeyBinding(action, binding->getKeyCode(), binding->getAltRequired(), binding->getCtrlRequired(), binding->getShiftRequired());
+			}
+		};
+		for (const auto& [type, binding] : _keyBindingPerActionType)
 		{
-			return true;
+			compile(type, binding);
 		}
-
-		// Check alternate binding
-		if (altBinding && altBinding->isActive(altCtrlOptional))
+		for (const auto& [type, binding] : _gamepadKeyBindingPerActionType)
 		{
-			return true;
+			compile(type, binding);
 		}
-
-		return false;
 	}
 	
 
@@ -32,6 +32,8 @@
 #include <map>
 #include <atomic>
 #include "ActionData.h"
+#include "BindingTable.h"
+#include "SettingsRegistry.h"
 #include <map>
 #include "System.h"
 
@@ -57,8 +59,11 @@ namespace IGCS
 			HideNPC = 2,
 		};
 
-		// Check if any binding for the action is activated
-		bool isAnyBindingActivated(ActionType type, bool altCtrlOptional = false);
+		// Applies the binding changes staged by handleKeybindingMessage, then compiles the key and gamepad bindings into table, see
+		// BindingTable. Input thread, the only one which touches the ActionData after startup.
+		void compileBindings(BindingTable& table);
+		// Changes every time a binding changes, so a compiled table can be refreshed.
+		uint32_t bindingsVersion() const { return _bindingsVersion.load(std::memory_order_acquire); }
 
 		bool inputBlocked() const { return _inputBlocked; }
 		void inputBlocked(bool newValue) { _inputBlocked = newValue; }
@@ -102,7 +107,11 @@ namespace IGCS
 		}
 		ActionData* getActionData(ActionType type);
 		ActionData* getGamePadActionData(ActionType type);
+		// Decodes a key binding message and stages it, the input thread applies it the next time it compiles the bindings. Pipe thread.
 		void handleKeybindingMessage(uint8_t payload[], DWORD payloadLength);
+		// Decodes a setting message and stages it, it's applied at the start of the next frame. Pipe thread.
+		void handleSettingMessage(uint8_t payload[], DWORD payloadLength);
+		SettingsRegistry& settings() { return _settings; }
 
 		void storeCurrentaobBlock(map<string, AOBBlock>* aobBlock) { currentAOBblock = aobBlock; }
 		map<string, AOBBlock>* getCurrentaobBlock() { return currentAOBblock; }
@@ -129,6 +138,7 @@ namespace IGCS
 
 	private:
 		void initializeKeyBindings();
+		void applyStagedBindings();
 		map<string, AOBBlock>* currentAOBblock = nullptr;
 		float* deltaT;
 		bool _inputBlocked = true;
@@ -138,6 +148,10 @@ namespace IGCS
 		HWND _mainWindowHandle;
 		map<ActionType, ActionData*> _keyBindingPerActionType;
 		map<ActionType, ActionData*> _gamepadKeyBindingPerActionType;
+		atomic<uint32_t> _bindingsVersion{ 0 };
+		// binding changes from the pipe, the latest per input source and action, packed by handleKeybindingMessage. 0 is none.
+		atomic<uint32_t> _stagedBindings[2][static_cast<uint32_t>(ActionType::Amount)] = {};
+		SettingsRegistry _settings;
 		bool _hudVisible = true;
 		bool _gamePaused = false;
 		bool _bytePaused = false;
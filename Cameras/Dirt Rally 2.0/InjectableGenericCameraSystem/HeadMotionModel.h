@@ -0,0 +1,149 @@
+#pragma once
+#include <cmath>
+#include "CameraSmoothing.h"
+
+// Spring-damper model of the driver's head, driven by the car's acceleration. The acceleration is estimated from the car
+// positions seen each frame, converted to the car's own frame and fed into a mass-spring-damper which is integrated with
+// a fixed internal timestep. Frame time is collected in an accumulator and consumed in whole substeps, so the model
+// behaves the same at any frame rate and costs at most kMaxSubsteps steps per frame. The result is an offset in car space
+// which is added to the camera's mount position.
+namespace IGCS::Smoothing
+{
+	struct HeadMotionParams
+	{
+		// head displacement in metres for a sustained acceleration of 1 g. 0.0 disables the model.
+		float strength = 0.0f;
+		// damping ratio of the spring. 1.0 is critically damped, lower values let the head overshoot.
+		float damping = 0.7f;
+		// natural frequency of the head/neck in Hz.
+		float frequency = 1.5f;
+		// hard limit for the offset along each axis, in metres.
+		float maxOffset = 0.1f;
+	};
+
+	class HeadMotionModel
+	{
+	public:
+		static constexpr float kTimestep = 1.0f / 240.0f;
+		static constexpr int kMaxSubsteps = 16;
+		// frame gaps longer than this (loading, pause, alt-tab) restart the model instead of integrating the jump
+		static constexpr float kMaxFrameTime = 0.25f;
+		static constexpr float kMaxTeleportDistance = 25.0f;
+
+		void reset() noexcept
+		{
+			_offset = {};
+			_velocity = {};
+			_accumulator = 0.0f;
+			_drive = {};
+			_pendingDt = 0.0f;
+			_samples = 0;
+		}
+
+		// Feeds the car transform of the current frame. frameTime is the time since the previous call, in seconds.
+		void update(const Vec3& carPosition, const Quat& carRotation, float frameTime, const HeadMotionParams& params) noexcept
+		{
+			if (params.strength <= 0.0f || !(frameTime > 0.0f) || frameTime > kMaxFrameTime)
+			{
+				reset();
+				if (params.strength > 0.0f)
+				{
+					addSample(carPosition, 0.0f);
+				}
+				return;
+			}
+			if (_samples > 0 && length(sub(carPosition, _position[0])) > kMaxTeleportDistance)
+			{
+				// restart / recovery teleport
+				reset();
+			}
+			const float omega = 2.0f * 3.14159265f * params.frequency;
+			const float stiffness = omega * omega;
+			const float dampingCoefficient = 2.0f * params.damping * omega;
+			_pendingDt += frameTime;
+			const bool moved = carPosition.x != _position[0].x || carPosition.y != _position[0].y || carPosition.z != _position[0].z;
+			if (_samples == 0 || moved || _pendingDt > kMaxFrameTime)
+			{
+				// the game doesn't move the car every rendered frame; an unchanged position isn't a stop, so the time is
+				// carried over to the next real sample and the last drive is kept meanwhile. Only a position which stays
+				// the same for longer is a car standing still.
+				addSample(carPosition, _pendingDt);
+				_pendingDt = 0.0f;
+				if (_samples < 3)
+				{
+					return;
+				}
+
+				// second difference over the last three, not necessarily equally spaced, samples
+				const float dtNew = _sampleDt[0];
+				const float dtOld = _sampleDt[1];
+				const Vec3 vNew = scale(sub(_position[0], _position[1]), 1.0f / dtNew);
+				const Vec3 vOld = scale(sub(_position[1], _position[2]), 1.0f / dtOld);
+				const Vec3 worldAcceleration = scale(sub(vNew, vOld), 2.0f / (dtNew + dtOld));
+				const Vec3 localAcceleration = rotate(worldAcceleration, conjugate(carRotation));
+				// steady state offset = strength per g, against the direction of the acceleration
+				_drive = scale(localAcceleration, -params.strength * stiffness / 9.81f);
+			}
+			if (_samples < 3)
+			{
+				return;
+			}
+
+			_accumulator += frameTime;
+			int substeps = 0;
+			while (_accumulator >= kTimestep && substeps < kMaxSubsteps)
+			{
+				step(_drive, stiffness, dampingCoefficient, params.maxOffset);
+				_accumulator -= kTimestep;
+				++substeps;
+			}
+			if (substeps == kMaxSubsteps)
+			{
+				// out of budget, drop the remainder instead of letting it pile up
+				_accumulator = 0.0f;
+			}
+		}
+
+		// Head offset in car space, in metres.
+		[[nodiscard]] const Vec3& offset() const noexcept { return _offset; }
+
+	private:
+		static Vec3 sub(const Vec3& a, const Vec3& b) noexcept { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+		static Vec3 scale(const Vec3& v, float s) noexcept { return { v.x * s, v.y * s, v.z * s }; }
+		static float length(const Vec3& v) noexcept { return std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z); }
+		static float clampAxis(float value, float limit) noexcept { return value > limit ? limit : (value < -limit ? -limit : value); }
+
+		void addSample(const Vec3& position, float dt) noexcept
+		{
+			_position[2] = _position[1];
+			_position[1] = _position[0];
+			_position[0] = position;
+			_sampleDt[1] = _sampleDt[0];
+			_sampleDt[0] = dt;
+			if (_samples < 3)
+			{
+				++_samples;
+			}
+		}
+
+		// semi-implicit Euler, stable as long as omega * kTimestep < 2, which holds for any sensible head frequency
+		void step(const Vec3& drive, float stiffness, float dampingCoefficient, float maxOffset) noexcept
+		{
+			_velocity.x += (drive.x - stiffness * _offset.x - dampingCoefficient * _velocity.x) * kTimestep;
+			_velocity.y += (drive.y - stiffness * _offset.y - dampingCoefficient * _velocity.y) * kTimestep;
+			_velocity.z += (drive.z - stiffness * _offset.z - dampingCoefficient * _velocity.z) * kTimestep;
+			_offset.x = clampAxis(_offset.x + _velocity.x * kTimestep, maxOffset);
+			_offset.y = clampAxis(_offset.y + _velocity.y * kTimestep, maxOffset);
+			_offset.z = clampAxis(_offset.z + _velocity.z * kTimestep, maxOffset);
+		}
+
+		Vec3 _offset{};
+		Vec3 _velocity{};
+		float _accumulator = 0.0f;
+		Vec3 _drive{};
+		float _pendingDt = 0.0f;
+		Vec3 _position[3]{};
+		float _sampleDt[2]{};
+		int _samples = 0;
+	};
+}
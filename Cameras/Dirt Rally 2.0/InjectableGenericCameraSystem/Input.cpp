@@ -28,152 +28,133 @@
 #include "stdafx.h"
 #include "Input.h"
 #include "Globals.h"
-#include <atomic>
-#include <array>
-#include <chrono>
-#include <vector>
 #include "MessageHandler.h"
+#include "RawInputAccumulator.h"
 
 namespace IGCS::Input
 {
-    using namespace std::chrono;
-
     // ---------------------------------------------------------------------
     // anonymous?namespace for file?local helpers / state                    
     // ---------------------------------------------------------------------
     namespace
     {
-        // key state bit?patterns (mirrors WinAPI behaviour for consistency)
-        constexpr uint8_t kStateNone = 0x00;
-        constexpr uint8_t kStateDownFrame = 0x88;   // key went down this frame
-        constexpr uint8_t kStateReleased = 0x08;   // key released this frame
-
-        // hammer?protection window (ms)
-        constexpr milliseconds kHammerWindow{ 250 };
-        using Clock = steady_clock;
+        static_assert(RawInputAccumulator::kLeftButtonDown == RI_MOUSE_LEFT_BUTTON_DOWN && RawInputAccumulator::kMiddleButtonUp == RI_MOUSE_MIDDLE_BUTTON_UP
+            && RawInputAccumulator::kWheel == RI_MOUSE_WHEEL && RawInputAccumulator::kKeyBreak == RI_KEY_BREAK
+            && RawInputAccumulator::kMouseMoveAbsolute == MOUSE_MOVE_ABSOLUTE && RawInputAccumulator::kWheelDelta == WHEEL_DELTA,
+            "RawInputAccumulator flags don't match the raw input headers");
 
-        // RAW keyboard / mouse state --------------------------------------
-        std::array<uint8_t, 256> g_keyStates{ };
-        std::array<uint8_t, 3> g_mouseButtonStates{ };
-        std::atomic_long g_mouseDeltaX{ 0 };
-        std::atomic_long g_mouseDeltaY{ 0 };
-        std::atomic_short g_mouseWheelDelta{ 0 };
+        // RAW keyboard / mouse state, written on the message thread --------
+        RawInputAccumulator g_rawInput;
 
-        // last accepted activation per action (for hammer protection) ------
-        std::array<Clock::time_point, static_cast<size_t>(IGCS::ActionType::Amount)> g_lastActionTime{ };
+        // Fixed buffer for draining raw input, message thread only. Room for a few hundred mouse records.
+        constexpr UINT kRawInputBufferSize = 16 * 1024;
+        alignas(8) uint8_t g_rawInputBuffer[kRawInputBufferSize];
 
-        // Helper: are we dealing with a continuous action (move / rotate / FOV
-        // adjust) that must remain unprotected?
-        [[nodiscard]] bool isContinuousAction(IGCS::ActionType type) noexcept
+        void decodeRawInput(const RAWINPUT& raw, RawInputAccumulator::Batch& batch) noexcept
         {
-            using AT = IGCS::ActionType;
-            switch (type)
+            if (raw.header.dwType == RIM_TYPEMOUSE)
             {
-            case AT::MoveLeft: case AT::MoveRight:  case AT::MoveForward: case AT::MoveBackward:
-            case AT::MoveUp:   case AT::MoveDown:
-            case AT::RotateUp: case AT::RotateDown: case AT::RotateLeft:  case AT::RotateRight:
-            case AT::TiltLeft: case AT::TiltRight:
-			case AT::FovIncrease: case AT::FovDecrease: case AT::GamepadFastModifier: case AT::GamepadSlowModifier:
-			case AT::MoveUpTarget: case AT::MoveDownTarget:
-                return true;    // exempt from hammer protection
-            default:
-                return false;   // apply hammer protection
+                const RAWMOUSE& mouse = raw.data.mouse;
+                batch.mouse(mouse.usFlags, mouse.usButtonFlags, mouse.usButtonData, mouse.lLastX, mouse.lLastY);
             }
-        }
-
-        // Helper to safely store a mouse button state change ----------------
-        inline void setMouseButtonStateInternal(int index, bool down) noexcept
-        {
-            if (index < 0 || index >= static_cast<int>(g_mouseButtonStates.size()))
+            else if (raw.header.dwType == RIM_TYPEKEYBOARD && IGCS_SUPPORT_RAWKEYBOARDINPUT)
             {
-                return;
+                if (raw.data.keyboard.VKey != 0xFF)
+                {
+                    batch.key(raw.data.keyboard.VKey, (raw.data.keyboard.Flags & RI_KEY_BREAK) != 0);
+                }
             }
-            g_mouseButtonStates[index] = down ? kStateDownFrame : kStateReleased;
         }
-    }   // anonymous namespace
-
-    // ---------------------------------------------------------------------
-    // PUBLIC API (as declared in Input.h)                                   
-    // ---------------------------------------------------------------------
 
-    // -------------------- key / action helpers ---------------------------
-    bool isActionActivated(ActionType type)
-    {
-        return isActionActivated(type, false);
-    }
-
-    bool isActionActivated(ActionType type, bool altCtrlOptional)
-    {
-        // Check if any binding for this action type is activated
-        if (Globals::instance().isAnyBindingActivated(type, altCtrlOptional))
+        // Decodes the record of the WM_INPUT at hand and then everything queued behind it, in blocks. Records read with
+        // GetRawInputBuffer leave the queue together with their WM_INPUT messages, so a burst costs one message instead of one
+        // per record. Records which don't fit the buffer (large HID reports) are skipped.
+        void drainRawInput(HRAWINPUT current, RawInputAccumulator::Batch& batch) noexcept
         {
-            // continuous actions are NEVER hammer-protected
-            if (isContinuousAction(type))
+            UINT size = kRawInputBufferSize;
+            if (GetRawInputData(current, RID_INPUT, g_rawInputBuffer, &size, sizeof(RAWINPUTHEADER)) != static_cast<UINT>(-1))
             {
-                return true;
+                decodeRawInput(*reinterpret_cast<const RAWINPUT*>(g_rawInputBuffer), batch);
             }
-
-            // hammer protection: ignore re-activations within kHammerWindow
-            auto now = Clock::now();
-            auto& lastTime = g_lastActionTime[static_cast<size_t>(type)];
-            if (now - lastTime < kHammerWindow)
+            while (true)
             {
-                return false;   // still within hammer window - ignore
+                UINT bufferSize = kRawInputBufferSize;
+                const UINT count = GetRawInputBuffer(reinterpret_cast<PRAWINPUT>(g_rawInputBuffer), &bufferSize, sizeof(RAWINPUTHEADER));
+                if (0 == count || static_cast<UINT>(-1) == count)
+                {
+                    break;
+                }
+                const RAWINPUT* raw = reinterpret_cast<const RAWINPUT*>(g_rawInputBuffer);
+                for (UINT i = 0; i < count; ++i)
+                {
+                    decodeRawInput(*raw, batch);
+                    raw = NEXTRAWINPUTBLOCK(raw);
+                }
             }
-            lastTime = now;     // accept & timestamp
-            return true;
         }
 
-        return false;
-    }
+        void keyMessage(WPARAM virtualKey, bool released) noexcept
+        {
+            RawInputAccumulator::Batch batch;
+            batch.key(static_cast<uint32_t>(virtualKey), released);
+            g_rawInput.commit(batch);
+        }
+    }   // anonymous namespace
+
+    // ---------------------------------------------------------------------
+    // PUBLIC API (as declared in Input.h)                                   
+    // ---------------------------------------------------------------------
 
     // -------------------- state resets -----------------------------------
     void resetKeyStates() noexcept
     {
-        for (auto& v : g_keyStates)
-        {
-            v &= ~0x08;   // clear frame?specific bit so next keydown is fresh
-        }
+        // clear frame?specific state so next keydown is fresh
+        g_rawInput.resetKeyTransitions();
     }
 
     void resetMouseState() noexcept
     {
-        for (auto& v : g_mouseButtonStates)
-        {
-            v &= ~0x08;
-        }
-        g_mouseWheelDelta = 0;
+        g_rawInput.resetMouseButtonTransitions();
+        g_rawInput.resetWheel();
     }
 
     // -------------------- mouse deltas -----------------------------------
     void resetMouseDeltas() noexcept
     {
-        g_mouseDeltaX = 0;
-        g_mouseDeltaY = 0;
-        g_mouseWheelDelta = 0;
+        g_rawInput.resetMouseDelta();
     }
 
     void processRawMouseData(const RAWMOUSE* rmouse) noexcept
     {
-        if (rmouse && rmouse->usFlags == MOUSE_MOVE_RELATIVE)
+        if (rmouse)
         {
-            g_mouseDeltaX = rmouse->lLastX;
-            g_mouseDeltaY = rmouse->lLastY;
+            RawInputAccumulator::Batch batch;
+            batch.mouse(rmouse->usFlags, rmouse->usButtonFlags, rmouse->usButtonData, rmouse->lLastX, rmouse->lLastY);
+            g_rawInput.commit(batch);
         }
     }
 
-    long getMouseDeltaX() noexcept { return g_mouseDeltaX; }
-    long getMouseDeltaY() noexcept { return g_mouseDeltaY; }
-    short getMouseWheelDelta()     noexcept { return g_mouseWheelDelta; }
+    long getMouseDeltaX() noexcept { return static_cast<long>(g_rawInput.peekMouseDelta().x); }
+    long getMouseDeltaY() noexcept { return static_cast<long>(g_rawInput.peekMouseDelta().y); }
+    short getMouseWheelDelta()     noexcept { return static_cast<short>(g_rawInput.peekMouseDelta().wheel); }
+
+    void takeMouseDeltas(long& deltaX, long& deltaY, short& wheelDelta) noexcept
+    {
+        const RawInputAccumulator::MouseDelta delta = g_rawInput.takeMouseDelta();
+        deltaX = static_cast<long>(delta.x);
+        deltaY = static_cast<long>(delta.y);
+        wheelDelta = static_cast<short>(delta.wheel);
+    }
+
+    // -------------------- keys / mouse buttons ---------------------------
+    bool isKeyDown(int virtualKey) noexcept
+    {
+        return virtualKey >= 0 && g_rawInput.isKeyDown(static_cast<uint32_t>(virtualKey));
+    }
 
-    // -------------------- mouse buttons ----------------------------------
     bool isMouseButtonDown(int button)
     {
-        if (button < 0 || button >= static_cast<int>(g_mouseButtonStates.size()))
-        {
-            return false;
-        }
-        return (g_mouseButtonStates[button] & 0xF0) == 0x80;
+        return button >= 0 && g_rawInput.isMouseButtonDown(static_cast<uint32_t>(button));
     }
 
     // -------------------- raw?input registration -------------------------
@@ -208,69 +189,40 @@ namespace IGCS::Input
             return false;
         }
 
-        // convert to client?coords for possible downstream use
-        ScreenToClient(mainWnd, &lpMsg->pt);
         bool handled = false;
 
         switch (lpMsg->message)
         {
         case WM_INPUT:
         {
-            UINT size = 0;
-            GetRawInputData(reinterpret_cast<HRAWINPUT>(lpMsg->lParam), RID_INPUT, nullptr, &size, sizeof(RAWINPUTHEADER));
-            std::vector<uint8_t> buffer(size);
-            UINT read = GetRawInputData(reinterpret_cast<HRAWINPUT>(lpMsg->lParam), RID_INPUT, buffer.data(), &size, sizeof(RAWINPUTHEADER));
-            if (read == size)
-            {
-                RAWINPUT* raw = reinterpret_cast<RAWINPUT*>(buffer.data());
-                if (raw->header.dwType == RIM_TYPEMOUSE)
-                {
-                    processRawMouseData(&raw->data.mouse);
-                    // buttons / wheel -------------------------------------------------
-                    if (raw->data.mouse.usButtonFlags & RI_MOUSE_LEFT_BUTTON_DOWN)  setMouseButtonStateInternal(0, true);
-                    if (raw->data.mouse.usButtonFlags & RI_MOUSE_LEFT_BUTTON_UP)    setMouseButtonStateInternal(0, false);
-                    if (raw->data.mouse.usButtonFlags & RI_MOUSE_RIGHT_BUTTON_DOWN) setMouseButtonStateInternal(1, true);
-                    if (raw->data.mouse.usButtonFlags & RI_MOUSE_RIGHT_BUTTON_UP)   setMouseButtonStateInternal(1, false);
-                    if (raw->data.mouse.usButtonFlags & RI_MOUSE_MIDDLE_BUTTON_DOWN)setMouseButtonStateInternal(2, true);
-                    if (raw->data.mouse.usButtonFlags & RI_MOUSE_MIDDLE_BUTTON_UP)  setMouseButtonStateInternal(2, false);
-                    if (raw->data.mouse.usButtonFlags & RI_MOUSE_WHEEL)
-                    {
-                        g_mouseWheelDelta += static_cast<short>(raw->data.mouse.usButtonData) / WHEEL_DELTA;
-                    }
-                }
-                if (raw->header.dwType == RIM_TYPEKEYBOARD && IGCS_SUPPORT_RAWKEYBOARDINPUT)
-                {
-                    if (raw->data.keyboard.VKey != 0xFF)
-                    {
-                        g_keyStates[raw->data.keyboard.VKey] = (raw->data.keyboard.Flags & RI_KEY_BREAK) == 0 ? kStateDownFrame : kStateReleased;
-                    }
-                }
-            }
+            RawInputAccumulator::Batch batch;
+            drainRawInput(reinterpret_cast<HRAWINPUT>(lpMsg->lParam), batch);
+            g_rawInput.commit(batch);
             handled = true;
         }
         break;
 
         // redirect standard key messages so the host game never sees them
         case WM_KEYDOWN:
-            if (lpMsg->wParam < 256) g_keyStates[lpMsg->wParam] = kStateDownFrame;
+            keyMessage(lpMsg->wParam, false);
             handled = true;
             break;
         case WM_KEYUP:
-            if (lpMsg->wParam < 256) g_keyStates[lpMsg->wParam] = kStateReleased;
+            keyMessage(lpMsg->wParam, true);
             handled = true;
             break;
 
         case WM_SYSKEYDOWN:
             if (IGCS_SUPPORT_RAWKEYBOARDINPUT)
             {
-                if (lpMsg->wParam < 256) g_keyStates[lpMsg->wParam] = kStateDownFrame;
+                keyMessage(lpMsg->wParam, false);
                 handled = true;
             }
             break;
         case WM_SYSKEYUP:
             if (IGCS_SUPPORT_RAWKEYBOARDINPUT)
             {
-                if (lpMsg->wParam < 256) g_keyStates[lpMsg->wParam] = kStateReleased;
+                keyMessage(lpMsg->wParam, true);
                 handled = true;
             }
             break;
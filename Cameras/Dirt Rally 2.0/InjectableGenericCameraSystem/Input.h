@@ -37,8 +37,13 @@ namespace IGCS::Input
     long  getMouseDeltaY() noexcept;
     void  processRawMouseData(const RAWMOUSE* rmouse) noexcept;
     void  resetMouseDeltas() noexcept;
+    // Movement and wheel notches accumulated since the last call, once per frame.
+    void  takeMouseDeltas(long& deltaX, long& deltaY, short& wheelDelta) noexcept;
 
     // Windows?message hook ---------------------------------------------------
+    // Feeds the raw input state from a message of the game's queue. Nothing calls it in this tree: the GetMessage/PeekMessage
+    // hooks in InputHooker.cpp aren't installed, so the raw input state stays empty and the camera's keys are read with
+    // GetAsyncKeyState on the input thread.
     bool  handleMessage(LPMSG lpMsg);
     void  registerRawInput();
 
@@ -46,11 +51,8 @@ namespace IGCS::Input
     void  resetKeyStates() noexcept;
     void  resetMouseState() noexcept;
 
-    // IGCS action helpers ----------------------------------------------------
-    bool  isActionActivated(ActionType type);                                    // hammer?protected where applicable
-    bool  isActionActivated(ActionType type, bool altCtrlShiftOptional);
-
-    // Mouse buttons ----------------------------------------------------------
+    // Keys / mouse buttons ---------------------------------------------------
+    bool  isKeyDown(int virtualKey) noexcept;
     bool  isMouseButtonDown(int button);
     short getMouseWheelDelta() noexcept;
 }
\ No newline at end of file
@@ -0,0 +1,123 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include "SpscQueue.h"
+
+// The actions the input thread hands to the render thread. The input thread samples the devices at a fixed rate, turns what
+// it sees into events with InputEventTranslator and pushes them into an InputEventChannel; the render thread drains the
+// channel once per frame and only acts on the events, it never reads a device itself.
+namespace IGCS
+{
+	enum class InputEventType : uint8_t
+	{
+		CameraEnable = 0,
+		ToggleFixedCameraMount,
+
+		Amount,
+	};
+
+	struct InputEvent
+	{
+		InputEventType type = InputEventType::CameraEnable;
+		int64_t timestamp = 0;		// MonotonicClock time of the sample which produced it
+	};
+
+	// Turns samples of the inputs into events. A sample has a bit per InputEventType (1 << type) in two masks:
+	// held: a binding for the action is down. Fires when it goes down and then again every kRepeatWindow while it's held, the
+	//       hammer protection the key bindings always had.
+	// pressed: an edge reported by the device itself (e.g. a buffered DirectInput button press). Always fires.
+	class InputEventTranslator
+	{
+	public:
+		static constexpr int64_t kRepeatWindow = 250000000LL;		// 250ms
+
+		InputEventTranslator() noexcept
+		{
+			reset();
+		}
+
+		static constexpr uint32_t bit(InputEventType type) noexcept { return uint32_t(1) << static_cast<uint32_t>(type); }
+
+		// Returns the mask of the events to fire for the sample taken at now.
+		uint32_t translate(uint32_t held, uint32_t pressed, int64_t now) noexcept
+		{
+			uint32_t fired = 0;
+			for (uint32_t i = 0; i < kTypes; ++i)
+			{
+				const uint32_t mask = uint32_t(1) << i;
+				if ((pressed & mask) || ((held & mask) && now - _lastFired[i] >= kRepeatWindow))
+				{
+					fired |= mask;
+					_lastFired[i] = now;
+				}
+			}
+			return fired;
+		}
+
+		void reset() noexcept
+		{
+			for (int64_t& last : _lastFired)
+			{
+				last = kNever;
+			}
+		}
+
+	private:
+		static constexpr uint32_t kTypes = static_cast<uint32_t>(InputEventType::Amount);
+		// far enough in the past for the first sample to fire, close enough to not overflow now - kNever
+		static constexpr int64_t kNever = INT64_MIN / 2;
+
+		int64_t _lastFired[kTypes];
+	};
+
+	// The queue between the input thread (producer) and the render thread (consumer). Events which don't fit because the
+	// render thread hasn't drained for a while (loading screens) are dropped and counted.
+	class InputEventChannel
+	{
+	public:
+		static constexpr size_t kCapacity = 64;
+
+		// Input thread.
+		bool push(const InputEvent& event) noexcept
+		{
+			if (_queue.tryPush(event))
+			{
+				return true;
+			}
+			_dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+		// Pushes an event for every bit in fired. Input thread.
+		void pushFired(uint32_t fired, int64_t timestamp) noexcept
+		{
+			for (uint32_t i = 0; i < static_cast<uint32_t>(InputEventType::Amount); ++i)
+			{
+				if (fired & (uint32_t(1) << i))
+				{
+					push(InputEvent{ static_cast<InputEventType>(i), timestamp });
+				}
+			}
+		}
+
+		// Calls handle for every queued event, oldest first. Render thread. Returns the number of events handled.
+		template<typename Handler>
+		size_t drain(Handler&& handle)
+		{
+			size_t count = 0;
+			InputEvent event;
+			while (_queue.tryPop(event))
+			{
+				handle(event);
+				++count;
+			}
+			return count;
+		}
+
+		[[nodiscard]] uint64_t dropped() const noexcept { return _dropped.load(std::memory_order_relaxed); }
+
+	private:
+		SpscQueue<InputEvent, kCapacity> _queue;
+		std::atomic<uint64_t> _dropped{ 0 };
+	};
+}
@@ -0,0 +1,119 @@
+#include "stdafx.h"
+#include "InputThread.h"
+#include "DirectInputPad.h"
+#include "DeviceWorker.h"
+#include "Globals.h"
+#include "Config.h"
+#include "MessageHandler.h"
+#include "MonotonicClock.h"
+
+namespace IGCS
+{
+	bool InputThread::start(float rate)
+	{
+		if (_thread.joinable())
+		{
+			return true;
+		}
+		const float clampedRate = rate < kMinRate ? kMinRate : (rate > kMaxRate ? kMaxRate : rate);
+		_period = static_cast<int64_t>(static_cast<double>(MonotonicClock::kNanosecondsPerSecond) / clampedRate);
+		_stopRequested.store(false, std::memory_order_relaxed);
+		_thread = std::thread(&InputThread::run, this);
+		MessageHandler::logLine("Input: sampling at %.0f Hz on the input thread", clampedRate);
+		return true;
+	}
+
+	void InputThread::stop()
+	{
+		if (_thread.joinable())
+		{
+			_stopRequested.store(true, std::memory_order_release);
+			_thread.join();
+		}
+	}
+
+	void InputThread::run()
+	{
+		// above the game's worker threads, so a busy frame doesn't delay a sample
+		SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_ABOVE_NORMAL);
+		SystemPacingClock clock;
+		int64_t next = clock.now();
+		while (!_stopRequested.load(std::memory_order_acquire))
+		{
+			const int64_t now = clock.now();
+			sample(now);
+			next += _period;
+			if (next <= now)
+			{
+				// fell behind (e.g. a stalled driver call), don't try to catch up with a burst of samples
+				next = now + _period;
+			}
+			const int64_t remaining = next - clock.now();
+			if (remaining > 0)
+			{
+				clock.sleep(remaining);
+			}
+		}
+	}
+
+	void InputThread::sample(int64_t now)
+	{
+		Globals& globals = Globals::instance();
+		globals.gamePad().update();
+		if (!_directInput.isInitialized())
+		{
+			// no window at startup, try again
+			_directInput.initialize(globals.mainWindowHandle(), _worker);
+		}
+		_directInput.update();
+
+		// the client can rebind at any time
+		const uint32_t bindingsVersion = globals.bindingsVersion();
+		if (bindingsVersion != _bindingsVersion)
+		{
+			globals.compileBindings(_bindings);
+			_bindingsVersion = bindingsVersion;
+		}
+
+		// one read per key a binding uses. GetAsyncKeyState doesn't care about focus, so only while the game is in the
+		// foreground; pads always count, as before
+		InputSnapshot snapshot;
+		if (GetForegroundWindow() == globals.mainWindowHandle())
+		{
+			_bindings.usedKeys().forEach([&snapshot](uint32_t key)
+			{
+				if (GetAsyncKeyState(static_cast<int>(key)) & 0x8000)
+				{
+					snapshot.keys.set(key);
+				}
+			});
+		}
+		Gamepad& gamepad = globals.gamePad();
+		if (gamepad.isConnected())
+		{
+			snapshot.padButtons = gamepad.getState()->Gamepad.wButtons;
+		}
+		const uint64_t active = _bindings.activeActions(snapshot);
+		auto isBindingActive = [active](ActionType type)
+		{
+			return 0 != (active & (uint64_t(1) << static_cast<uint32_t>(type)));
+		};
+
+		uint32_t held = 0;
+		uint32_t pressed = 0;
+		if (isBindingActive(ActionType::CameraEnable))
+		{
+			held |= InputEventTranslator::bit(InputEventType::CameraEnable);
+		}
+		if (isBindingActive(ActionType::ToggleFixedCameraMount))
+		{
+			held |= InputEventTranslator::bit(InputEventType::ToggleFixedCameraMount);
+		}
+		// configured wheel button, see direct_input_toggle_button
+		if (_directInput.isButtonJustPressed(Config::get().directInputToggleButtonIndex))
+		{
+			pressed |= InputEventTranslator::bit(InputEventType::CameraEnable);
+		}
+		_channel.pushFired(_translator.translate(held, pressed, now), now);
+	}
+}
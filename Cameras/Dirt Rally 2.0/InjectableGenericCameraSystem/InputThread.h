@@ -0,0 +1,52 @@
+#pragma once
+#include "stdafx.h"
+#include <atomic>
+#include <thread>
+#include "BindingTable.h"
+#include "InputEvents.h"
+#include "PacingClock.h"
+
+namespace IGCS
+{
+	class DirectInputPad;
+	class DeviceWorker;
+
+	// Samples the pads, the wheel and the key bindings at a fixed rate on its own thread and pushes the resulting action events
+	// into the channel, so a slow driver call never holds up a frame. The render thread only drains the channel. Owns the
+	// reading side of the Gamepad and the DirectInputPad: nothing else may update or read them while it runs.
+	class InputThread
+	{
+	public:
+		static constexpr float kMinRate = 30.0f;
+		static constexpr float kMaxRate = 1000.0f;
+
+		InputThread(DirectInputPad& directInput, DeviceWorker& worker, InputEventChannel& channel) noexcept
+			: _directInput(directInput), _worker(worker), _channel(channel)
+		{
+		}
+		// IMPORTANT: no cleanup in the destructor, it may run under loader lock. Use stop().
+		~InputThread() = default;
+		InputThread(const InputThread&) = delete;
+		InputThread& operator=(const InputThread&) = delete;
+
+		// Starts sampling at rate samples per second, clamped to kMinRate..kMaxRate.
+		bool start(float rate);
+		// From a SAFE context (not DllMain).
+		void stop();
+
+	private:
+		void run();
+		void sample(int64_t now);
+
+		DirectInputPad& _directInput;
+		DeviceWorker& _worker;
+		InputEventChannel& _channel;
+		InputEventTranslator _translator;
+		// the key bindings, recompiled when _bindingsVersion is behind Globals::bindingsVersion
+		BindingTable _bindings;
+		uint32_t _bindingsVersion = UINT32_MAX;
+		std::thread _thread;
+		std::atomic<bool> _stopRequested{ false };
+		int64_t _period = 0;
+	};
+}
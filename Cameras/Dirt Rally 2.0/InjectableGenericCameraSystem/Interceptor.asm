@@ -49,6 +49,14 @@ EXTERN g_cameraStructAddress: qword
 EXTERN g_cameraQuaternionAddress: qword
 EXTERN g_cameraPositionAddress: qword
 EXTERN g_carPositionAddress: qword
+EXTERN g_carStateSequence: qword
+EXTERN g_carStateTimestamp: qword
+EXTERN g_updateOnCarState: byte
+;---------------------------------------------------------------
+
+;---------------------------------------------------------------
+; C++ functions called from the interceptors
+EXTERN carStateUpdated: proc
 ;---------------------------------------------------------------
 
 ;---------------------------------------------------------------
@@ -253,6 +261,54 @@ carPositionInterceptor PROC
 	movss xmm3,dword ptr [rcx+000002B0h]
 	movss xmm4,dword ptr [rcx+000002B8h]
 	mov [g_carPositionAddress],rcx
+	; timestamp (TSC) and sequence number of the car state update, used to measure the latency until the camera write
+	push rax
+	push rdx
+	rdtsc
+	shl rdx,32
+	or rax,rdx
+	mov [g_carStateTimestamp],rax
+	lock inc qword ptr [g_carStateSequence]
+	pop rdx
+	pop rax
+	cmp byte ptr [g_updateOnCarState],0
+	je carPositionInterceptorExit
+	; camera update triggered by the car state update: call into the system with all volatile registers preserved, the
+	; game's function continues after the return.
+	push rax
+	push rcx
+	push rdx
+	push r8
+	push r9
+	push r10
+	push r11
+	push rbx
+	mov rbx,rsp
+	and rsp,-16
+	sub rsp,60h+20h					; 6 xmm registers + shadow space
+	movdqu [rsp+20h],xmm0
+	movdqu [rsp+30h],xmm1
+	movdqu [rsp+40h],xmm2
+	movdqu [rsp+50h],xmm3
+	movdqu [rsp+60h],xmm4
+	movdqu [rsp+70h],xmm5
+	call carStateUpdated
+	movdqu xmm0,[rsp+20h]
+	movdqu xmm1,[rsp+30h]
+	movdqu xmm2,[rsp+40h]
+	movdqu xmm3,[rsp+50h]
+	movdqu xmm4,[rsp+60h]
+	movdqu xmm5,[rsp+70h]
+	mov rsp,rbx
+	pop rbx
+	pop r11
+	pop r10
+	pop r9
+	pop r8
+	pop rdx
+	pop rcx
+	pop rax
+carPositionInterceptorExit:
 	jmp qword ptr [_carPositionInjectionContinue]
 carPositionInterceptor ENDP
 
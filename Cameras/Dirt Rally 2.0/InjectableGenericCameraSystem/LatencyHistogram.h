@@ -0,0 +1,70 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Fixed bucket histogram of latencies in seconds. Buckets are kBucketWidth wide, everything above the last bucket is
+// counted in it as well. Adding a sample is a division and an increment, so it can be done every frame.
+namespace IGCS
+{
+	class LatencyHistogram
+	{
+	public:
+		static constexpr double kBucketWidth = 0.00025;	// 0.25ms
+		static constexpr size_t kBucketCount = 256;		// up to 64ms
+
+		void add(double seconds) noexcept
+		{
+			if (seconds < 0.0)
+			{
+				seconds = 0.0;
+			}
+			size_t bucket = static_cast<size_t>(seconds / kBucketWidth);
+			if (bucket >= kBucketCount)
+			{
+				bucket = kBucketCount - 1;
+			}
+			++_buckets[bucket];
+			++_count;
+			_sum += seconds;
+			if (seconds > _max)
+			{
+				_max = seconds;
+			}
+		}
+
+		void reset() noexcept
+		{
+			*this = LatencyHistogram();
+		}
+
+		[[nodiscard]] uint64_t count() const noexcept { return _count; }
+		[[nodiscard]] double max() const noexcept { return _max; }
+		[[nodiscard]] double mean() const noexcept { return _count > 0 ? _sum / static_cast<double>(_count) : 0.0; }
+
+		// Upper edge of the bucket holding the given fraction (0..1) of the samples.
+		[[nodiscard]] double percentile(double fraction) const noexcept
+		{
+			if (_count == 0)
+			{
+				return 0.0;
+			}
+			const double target = fraction * static_cast<double>(_count);
+			uint64_t seen = 0;
+			for (size_t i = 0; i < kBucketCount; ++i)
+			{
+				seen += _buckets[i];
+				if (static_cast<double>(seen) >= target && seen > 0)
+				{
+					return static_cast<double>(i + 1) * kBucketWidth;
+				}
+			}
+			return _max;
+		}
+
+	private:
+		uint64_t _buckets[kBucketCount] = {};
+		uint64_t _count = 0;
+		double _sum = 0.0;
+		double _max = 0.0;
+	};
+}
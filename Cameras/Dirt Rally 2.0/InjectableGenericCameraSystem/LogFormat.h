@@ -0,0 +1,356 @@
+#pragma once
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "FormatBuffer.h"
+
+// Printf style formatting split in two, so the expensive half runs on another thread. capture() walks the format string on the
+// calling thread and copies the arguments into a byte buffer: numbers and pointers as 8 bytes, strings as their characters.
+// format() later walks the same format string and formats each conversion from the buffer with stb_sprintf. The format string
+// isn't copied, so it must live as long as the buffer: pass string literals. Conversions capture() doesn't handle (* widths, %n,
+// long double, %F) make it return false and the caller formats the message itself. Wide strings and characters (%ls, %lc)
+// can't be formatted at all, stb_sprintf prints one character of them: capture() takes them, but their text is replaced by
+// kWideText so the log shows the call has to narrow the string first.
+namespace IGCS
+{
+	class LogFormat
+	{
+	public:
+		static constexpr const char* kWideText = "<wide string, narrow it to log it>";
+
+		// Copies the arguments fmt refers to into buffer. False if fmt has a conversion which can't be deferred or the arguments
+		// don't fit. Works on a copy of args, so the caller can still format args itself.
+		static bool capture(const char* fmt, va_list args, uint8_t* buffer, size_t capacity, size_t& used) noexcept
+		{
+			va_list copy;
+			va_copy(copy, args);
+			const bool captured = captureArguments(fmt, copy, buffer, capacity, used);
+			va_end(copy);
+			return captured;
+		}
+
+		// Formats fmt with the arguments capture() stored in buffer into out, zero terminated. Returns the length written;
+		// truncated is set if out was too small.
+		static size_t format(const char* fmt, const uint8_t* buffer, char* out, size_t size, bool& truncated) noexcept
+		{
+			truncated = false;
+			if (0 == size)
+			{
+				truncated = true;
+				return 0;
+			}
+			size_t length = 0;
+			size_t read = 0;
+			const char* position = fmt;
+			while (true)
+			{
+				const char* percent = std::strchr(position, '%');
+				const size_t literal = nullptr == percent ? std::strlen(position) : static_cast<size_t>(percent - position);
+				if (!append(out, size, length, position, literal))
+				{
+					truncated = true;
+					break;
+				}
+				if (nullptr == percent)
+				{
+					break;
+				}
+				Spec spec;
+				parse(percent, spec);
+				position = spec.end;
+				if (Kind::Percent == spec.kind)
+				{
+					if (!append(out, size, length, "%", 1))
+					{
+						truncated = true;
+						break;
+					}
+					continue;
+				}
+				// the spec without its length modifier, numbers are stored as 64 bits and printed as such
+				char conversion[kMaxSpecLength + 3];
+				const size_t prefix = static_cast<size_t>(spec.modifier - percent);
+				std::memcpy(conversion, percent, prefix);
+				size_t conversionLength = prefix;
+				if (Kind::Signed == spec.kind || Kind::Unsigned == spec.kind)
+				{
+					conversion[conversionLength++] = 'l';
+					conversion[conversionLength++] = 'l';
+				}
+				conversion[conversionLength++] = spec.end[-1];
+				conversion[conversionLength] = '\0';
+				FormatResult result;
+				switch (spec.kind)
+				{
+				case Kind::Signed:
+					result = formatTo(out + length, size - length, conversion, static_cast<long long>(take<int64_t>(buffer, read)));
+					break;
+				case Kind::Unsigned:
+					result = formatTo(out + length, size - length, conversion, static_cast<unsigned long long>(take<uint64_t>(buffer, read)));
+					break;
+				case Kind::Character:
+					result = formatTo(out + length, size - length, conversion, static_cast<int>(take<int64_t>(buffer, read)));
+					break;
+				case Kind::Double:
+					result = formatTo(out + length, size - length, conversion, take<double>(buffer, read));
+					break;
+				case Kind::Pointer:
+					result = formatTo(out + length, size - length, conversion, take<const void*>(buffer, read));
+					break;
+				case Kind::String:
+				{
+					const char* value = reinterpret_cast<const char*>(buffer + read);
+					read += std::strlen(value) + 1;
+					result = formatTo(out + length, size - length, conversion, value);
+					break;
+				}
+				case Kind::Wide:
+					result.truncated = !append(out, size, length, kWideText, std::strlen(kWideText));
+					break;
+				default:
+					break;
+				}
+				length += result.text.size();
+				if (result.truncated)
+				{
+					truncated = true;
+					break;
+				}
+			}
+			out[length] = '\0';
+			return length;
+		}
+
+	private:
+		static constexpr size_t kMaxSpecLength = 24;
+
+		enum class Kind : uint8_t
+		{
+			Percent,
+			Signed,
+			Unsigned,
+			Character,
+			Double,
+			Pointer,
+			String,
+			Wide,		// %ls and %lc, not formatted
+		};
+
+		enum class Length : uint8_t
+		{
+			None,
+			Char,			// hh
+			Short,			// h
+			Long,			// l
+			LongLong,		// ll
+			Size,			// z
+			Max,			// j
+			PtrDiff,		// t
+		};
+
+		struct Spec
+		{
+			Kind kind = Kind::Percent;
+			Length length = Length::None;
+			const char* modifier = nullptr;		// where the length modifier starts (or the conversion, without one)
+			const char* end = nullptr;			// past the conversion character
+		};
+
+		// Parses the conversion starting at percent. False if it can't be deferred.
+		static bool parse(const char* percent, Spec& spec) noexcept
+		{
+			const char* position = percent + 1;
+			while (nullptr != std::strchr("-+ #0", *position) && '\0' != *position)
+			{
+				++position;
+			}
+			while (*position >= '0' && *position <= '9')
+			{
+				++position;
+			}
+			if ('.' == *position)
+			{
+				++position;
+				while (*position >= '0' && *position <= '9')
+				{
+					++position;
+				}
+			}
+			spec.modifier = position;
+			switch (*position)
+			{
+			case 'h':
+				spec.length = 'h' == position[1] ? Length::Char : Length::Short;
+				position += Length::Char == spec.length ? 2 : 1;
+				break;
+			case 'l':
+				spec.length = 'l' == position[1] ? Length::LongLong : Length::Long;
+				position += Length::LongLong == spec.length ? 2 : 1;
+				break;
+			case 'z': spec.length = Length::Size; ++position; break;
+			case 'j': spec.length = Length::Max; ++position; break;
+			case 't': spec.length = Length::PtrDiff; ++position; break;
+			default: break;
+			}
+			const char conversion = *position;
+			spec.end = position + 1;
+			if (static_cast<size_t>(spec.end - percent) > kMaxSpecLength)
+			{
+				return false;
+			}
+			const bool noLength = Length::None == spec.length;
+			switch (conversion)
+			{
+			case '%': spec.kind = Kind::Percent; return spec.end == percent + 2;
+			case 'd': case 'i': spec.kind = Kind::Signed; return true;
+			case 'u': case 'x': case 'X': case 'o': spec.kind = Kind::Unsigned; return true;
+			case 'c': spec.kind = noLength ? Kind::Character : Kind::Wide; return noLength || Length::Long == spec.length;
+			case 'f': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A': spec.kind = Kind::Double; return noLength;
+			case 'p': spec.kind = Kind::Pointer; return noLength;
+			case 's': spec.kind = noLength ? Kind::String : Kind::Wide; return noLength || Length::Long == spec.length;
+			default: return false;
+			}
+		}
+
+		static bool captureArguments(const char* fmt, va_list& args, uint8_t* buffer, size_t capacity, size_t& used) noexcept
+		{
+			used = 0;
+			for (const char* position = std::strchr(fmt, '%'); nullptr != position; position = std::strchr(position, '%'))
+			{
+				Spec spec;
+				if (!parse(position, spec))
+				{
+					return false;
+				}
+				position = spec.end;
+				switch (spec.kind)
+				{
+				case Kind::Percent:
+					break;
+				case Kind::Signed:
+				case Kind::Character:
+				{
+					const int64_t value = readSigned(spec.length, args);
+					if (!put(buffer, capacity, used, &value, sizeof(value)))
+					{
+						return false;
+					}
+					break;
+				}
+				case Kind::Unsigned:
+				{
+					const uint64_t value = readUnsigned(spec.length, args);
+					if (!put(buffer, capacity, used, &value, sizeof(value)))
+					{
+						return false;
+					}
+					break;
+				}
+				case Kind::Double:
+				{
+					const double value = va_arg(args, double);
+					if (!put(buffer, capacity, used, &value, sizeof(value)))
+					{
+						return false;
+					}
+					break;
+				}
+				case Kind::Pointer:
+				{
+					const void* value = va_arg(args, void*);
+					if (!put(buffer, capacity, used, &value, sizeof(value)))
+					{
+						return false;
+					}
+					break;
+				}
+				case Kind::String:
+				{
+					const char* value = va_arg(args, const char*);
+					if (nullptr == value)
+					{
+						value = "null";		// what stb_sprintf prints for it
+					}
+					if (!put(buffer, capacity, used, value, std::strlen(value) + 1))
+					{
+						return false;
+					}
+					break;
+				}
+				case Kind::Wide:
+					// only skipped, format() prints kWideText for it
+					if ('s' == spec.end[-1])
+					{
+						static_cast<void>(va_arg(args, const wchar_t*));
+					}
+					else
+					{
+						static_cast<void>(va_arg(args, int));		// wint_t, promoted
+					}
+					break;
+				}
+			}
+			return true;
+		}
+
+		static int64_t readSigned(Length length, va_list& args) noexcept
+		{
+			switch (length)
+			{
+			case Length::Char: return static_cast<signed char>(va_arg(args, int));
+			case Length::Short: return static_cast<short>(va_arg(args, int));
+			case Length::Long: return va_arg(args, long);
+			case Length::LongLong: return va_arg(args, long long);
+			case Length::Size: return static_cast<int64_t>(va_arg(args, size_t));
+			case Length::Max: return va_arg(args, intmax_t);
+			case Length::PtrDiff: return va_arg(args, ptrdiff_t);
+			default: return va_arg(args, int);
+			}
+		}
+
+		static uint64_t readUnsigned(Length length, va_list& args) noexcept
+		{
+			switch (length)
+			{
+			case Length::Char: return static_cast<unsigned char>(va_arg(args, unsigned int));
+			case Length::Short: return static_cast<unsigned short>(va_arg(args, unsigned int));
+			case Length::Long: return va_arg(args, unsigned long);
+			case Length::LongLong: return va_arg(args, unsigned long long);
+			case Length::Size: return va_arg(args, size_t);
+			case Length::Max: return va_arg(args, uintmax_t);
+			case Length::PtrDiff: return static_cast<uint64_t>(va_arg(args, ptrdiff_t));
+			default: return va_arg(args, unsigned int);
+			}
+		}
+
+		static bool put(uint8_t* buffer, size_t capacity, size_t& used, const void* value, size_t size) noexcept
+		{
+			if (size > capacity - used)
+			{
+				return false;
+			}
+			std::memcpy(buffer + used, value, size);
+			used += size;
+			return true;
+		}
+
+		template<typename T>
+		static T take(const uint8_t* buffer, size_t& read) noexcept
+		{
+			T value;
+			std::memcpy(&value, buffer + read, sizeof(T));
+			read += sizeof(T);
+			return value;
+		}
+
+		static bool append(char* out, size_t size, size_t& length, const char* text, size_t count) noexcept
+		{
+			const size_t room = size - 1 - length;
+			const size_t copied = count < room ? count : room;
+			std::memcpy(out + length, text, copied);
+			length += copied;
+			return copied == count;
+		}
+	};
+}
@@ -0,0 +1,182 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Framing of the messages between the dll and the client. The pipes are byte streams, so several messages can go out in one
+// write and a read can end anywhere in a message: every message is sent as a frame, a 4 byte little endian length followed by
+// that many bytes, the message type and its payload:
+//     [length: uint32][type: uint8][payload: length - 1 bytes]
+// The type byte and payload are exactly what the message handlers got before (payload[0] is the type), so a frame's body is
+// handed to them as is.
+namespace IGCS
+{
+	// A piece of a message, to build a frame from several parts without joining them first.
+	struct ConstBuffer
+	{
+		const void* data;
+		size_t size;
+	};
+
+	namespace MessageFraming
+	{
+		static constexpr size_t kHeaderSize = sizeof(uint32_t);
+		// type byte and payload, the largest message either side accepts. Same as IGCS_MAX_MESSAGE_SIZE.
+		static constexpr uint32_t kMaxMessageSize = 10 * 1024;
+
+		inline void writeLength(uint8_t* destination, uint32_t length) noexcept
+		{
+			destination[0] = static_cast<uint8_t>(length);
+			destination[1] = static_cast<uint8_t>(length >> 8);
+			destination[2] = static_cast<uint8_t>(length >> 16);
+			destination[3] = static_cast<uint8_t>(length >> 24);
+		}
+
+		inline uint32_t readLength(const uint8_t* source) noexcept
+		{
+			return static_cast<uint32_t>(source[0]) | (static_cast<uint32_t>(source[1]) << 8) | (static_cast<uint32_t>(source[2]) << 16)
+				| (static_cast<uint32_t>(source[3]) << 24);
+		}
+	}
+
+	// Outgoing frames, written one after the other into a fixed buffer which goes out in one write. Not thread safe.
+	template<size_t Capacity>
+	class FrameBatch
+	{
+	public:
+		// Appends a frame of type followed by the parts. False, leaving the batch as it was, if it doesn't fit or the message is
+		// larger than kMaxMessageSize.
+		bool append(uint8_t type, const ConstBuffer* parts, size_t count) noexcept
+		{
+			size_t payloadSize = 0;
+			for (size_t i = 0; i < count; ++i)
+			{
+				payloadSize += parts[i].size;
+			}
+			if (payloadSize >= MessageFraming::kMaxMessageSize || MessageFraming::kHeaderSize + 1 + payloadSize > Capacity - _size)
+			{
+				return false;
+			}
+			uint8_t* destination = _buffer + _size;
+			MessageFraming::writeLength(destination, static_cast<uint32_t>(1 + payloadSize));
+			destination[MessageFraming::kHeaderSize] = type;
+			destination += MessageFraming::kHeaderSize + 1;
+			for (size_t i = 0; i < count; ++i)
+			{
+				if (parts[i].size > 0)
+				{
+					std::memcpy(destination, parts[i].data, parts[i].size);
+					destination += parts[i].size;
+				}
+			}
+			_size = static_cast<size_t>(destination - _buffer);
+			++_frames;
+			return true;
+		}
+
+		void clear() noexcept
+		{
+			_size = 0;
+			_frames = 0;
+		}
+
+		[[nodiscard]] bool empty() const noexcept { return 0 == _size; }
+		[[nodiscard]] const uint8_t* data() const noexcept { return _buffer; }
+		[[nodiscard]] size_t size() const noexcept { return _size; }
+		[[nodiscard]] size_t frames() const noexcept { return _frames; }
+
+	private:
+		size_t _size = 0;
+		size_t _frames = 0;
+		uint8_t _buffer[Capacity] = {};
+	};
+
+	// Incoming bytes go into a ring buffer, read() straight into the free space, and dispatch() hands every complete frame to a
+	// callback. A frame's body is passed in place; only one which wraps around the end of the ring is copied, into a scratch
+	// buffer. Not thread safe.
+	template<size_t Capacity>
+	class FrameReader
+	{
+		static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+		static_assert(Capacity >= 2 * (MessageFraming::kHeaderSize + MessageFraming::kMaxMessageSize), "Capacity must hold two of the largest frames");
+
+	public:
+		struct Span
+		{
+			uint8_t* data;
+			size_t size;
+		};
+
+		// The free space to read into, up to the end of the ring. Never empty while a frame is incomplete.
+		Span writable() noexcept
+		{
+			const size_t offset = _write & (Capacity - 1);
+			const size_t free = Capacity - (_write - _read);
+			return Span{ _buffer + offset, free < Capacity - offset ? free : Capacity - offset };
+		}
+
+		// Marks count bytes of the span from writable() as filled.
+		void commit(size_t count) noexcept
+		{
+			_write += count;
+		}
+
+		// Calls handle(uint8_t* message, uint32_t length) for every complete frame, in order. message is the type byte followed
+		// by the payload and only valid during the call. False if a frame has an invalid length: the stream can't be followed
+		// any further and the reader has to be reset.
+		template<typename Handle>
+		bool dispatch(Handle&& handle)
+		{
+			while (_write - _read >= MessageFraming::kHeaderSize)
+			{
+				uint8_t header[MessageFraming::kHeaderSize];
+				copyOut(_read, header, sizeof(header));
+				const uint32_t length = MessageFraming::readLength(header);
+				if (0 == length || length > MessageFraming::kMaxMessageSize)
+				{
+					return false;
+				}
+				if (_write - _read < MessageFraming::kHeaderSize + length)
+				{
+					break;
+				}
+				const size_t start = _read + MessageFraming::kHeaderSize;
+				const size_t offset = start & (Capacity - 1);
+				uint8_t* message = _buffer + offset;
+				if (offset + length > Capacity)
+				{
+					copyOut(start, _scratch, length);
+					message = _scratch;
+				}
+				_read = start + length;
+				handle(message, length);
+			}
+			return true;
+		}
+
+		// Drops everything buffered, e.g. when the client reconnects.
+		void reset() noexcept
+		{
+			_read = 0;
+			_write = 0;
+		}
+
+		// Bytes buffered which aren't a complete frame yet.
+		[[nodiscard]] size_t pending() const noexcept { return _write - _read; }
+
+	private:
+		void copyOut(size_t position, uint8_t* destination, size_t count) const noexcept
+		{
+			const size_t offset = position & (Capacity - 1);
+			const size_t first = count < Capacity - offset ? count : Capacity - offset;
+			std::memcpy(destination, _buffer + offset, first);
+			std::memcpy(destination + first, _buffer, count - first);
+		}
+
+		// positions only grow, the offset into the ring is position & (Capacity - 1)
+		size_t _read = 0;
+		size_t _write = 0;
+		uint8_t _buffer[Capacity] = {};
+		uint8_t _scratch[MessageFraming::kMaxMessageSize] = {};
+	};
+}
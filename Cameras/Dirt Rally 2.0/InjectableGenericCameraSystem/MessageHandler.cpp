@@ -28,69 +28,133 @@
 
 #include "stdafx.h"
 #include "MessageHandler.h"
-#include "NamedPipeManager.h"
-#include "Utils.h"
-#include <chrono>
-#include <iomanip>
-#include <sstream>
-#include <ctime>
+#include "AsyncLogger.h"
 #include "Console.h"
 #include "Config.h"
+#include <fstream>
 
 
 namespace IGCS::MessageHandler
 {
 	
     const bool consoleEnabled = IGCS::Config::get().ConsoleEnabled;
+    const bool logFileEnabled = IGCS::Config::get().LogFileEnabled;
+    const bool loggingEnabled = consoleEnabled || logFileEnabled;
 
-	std::string currentTimeString() {
-		using namespace std::chrono;
-		auto now = system_clock::now();
-		std::time_t now_c = system_clock::to_time_t(now);
-		std::tm tm = *std::localtime(&now_c);
-		std::ostringstream oss;
-		oss << std::put_time(&tm, "%H:%M:%S");
-		return oss.str();
-	}
+    // Function local, so it exists for the log calls made during the static initialization of other files.
+    static AsyncLogger& logger()
+    {
+        static AsyncLogger* theLogger = new AsyncLogger(); // intentionally leaked on process exit
+        return *theLogger;
+    }
+
+    // The console window, and the pipe to the client for errors.
+    class ConsoleSink : public ILogSink
+    {
+    public:
+        void write(LogLevel level, const char* line, size_t length) override
+        {
+            const std::string_view text(line, length);
+            if (LogLevel::Error == level)
+            {
+                IGCS::Console::WriteError(text);
+            }
+            else
+            {
+                IGCS::Console::WriteLine(text);
+            }
+        }
+    };
+
+    // dr2tools.log, rewritten every run.
+    class FileSink : public ILogSink
+    {
+    public:
+        bool open(const std::wstring& path)
+        {
+            _file.open(path, std::ios::out | std::ios::trunc);
+            return _file.is_open();
+        }
+
+        void write(LogLevel level, const char* line, size_t length) override
+        {
+            if (LogLevel::Error == level)
+            {
+                _file << "ERROR: ";
+            }
+            _file.write(line, static_cast<std::streamsize>(length));
+            _file << '\n';
+        }
+
+        void flush() override
+        {
+            _file.flush();
+        }
+
+    private:
+        std::ofstream _file;
+    };
+
+    void startLogWriter()
+    {
+        if (!loggingEnabled)
+        {
+            return;
+        }
+        ILogSink* sinks[2] = {};
+        size_t sinkCount = 0;
+        if (consoleEnabled)
+        {
+            sinks[sinkCount++] = new ConsoleSink(); // intentionally leaked on process exit
+        }
+        if (logFileEnabled)
+        {
+            FileSink* fileSink = new FileSink(); // intentionally leaked on process exit
+            if (fileSink->open(IGCS::Config::findLogPath()))
+            {
+                sinks[sinkCount++] = fileSink;
+            }
+            else
+            {
+                logError("Can't open dr2tools.log for writing");
+            }
+        }
+        logger().start(sinks, sinkCount);
+    }
+
+    void stopLogWriter()
+    {
+        logger().stop();
+    }
 
     void logDebug(const char* fmt, ...)
     {
 #ifdef _DEBUG
-        if (!consoleEnabled) return;
+        if (!loggingEnabled) return;
         va_list args;
         va_start(args, fmt);
-        const std::string formattedArgs = Utils::formatStringVa(fmt, args);
+        logger().log(LogLevel::Debug, fmt, args);
         va_end(args);
-
-        IGCS::Console::WriteLine(formattedArgs);
 #endif
     }
 
     void logError(const char* fmt, ...)
     {
-        if (!consoleEnabled) return;
+        if (!loggingEnabled) return;
         va_list args;
         va_start(args, fmt);
-        const std::string formattedArgs = Utils::formatStringVa(fmt, args);
+        logger().log(LogLevel::Error, fmt, args);
         va_end(args);
-
-        IGCS::Console::WriteError(formattedArgs);
     }
 
     void logLine(const char* fmt, ...)
     {
-        if (!consoleEnabled) return;
+        if (!loggingEnabled) return;
         va_list args;
         va_start(args, fmt);
-
-        // Format the variable argument string
-        const std::string formattedArgs = Utils::formatStringVa(fmt, args);
+        // the writer thread prepends the timestamp
+        logger().log(LogLevel::Line, fmt, args);
         va_end(args);
-
-        // Prepend timestamp to the log message (kept as before)
-        std::string logMessage = "[" + currentTimeString() + "] " + formattedArgs;
-
-        IGCS::Console::WriteLine(logMessage);
     }
 
 }
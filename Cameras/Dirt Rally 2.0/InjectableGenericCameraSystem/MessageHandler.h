@@ -30,6 +30,10 @@
 
 namespace IGCS::MessageHandler
 {
+	// The log functions only queue the message, a writer thread writes it to the console and dr2tools.log. Messages logged
+	// before startLogWriter are written once it runs. stopLogWriter from a SAFE context (not DllMain).
+	void startLogWriter();
+	void stopLogWriter();
 	void logDebug(const char* fmt, ...);
 	void logError(const char* fmt, ...);
 	void logLine(const char* fmt, ...);
@@ -0,0 +1,295 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include "MessageFraming.h"
+#include "MessageTransport.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// Serves the client over two streams (see MessageTransport.h): one the client writes messages to, one it reads messages from,
+// each with its own thread so a client which doesn't read never holds up one which writes and neither holds up a frame.
+// Outgoing: send() frames the message (see MessageFraming.h) into the batch being filled, from any thread; the render thread
+// calls flush() once per frame and the writer thread sends the batch in one write while the next one fills. A batch nobody
+// flushes, e.g. during a loading screen, goes out after kMaxBatchDelayMs. Messages sent while no client is connected, or when
+// both batches are full because the client isn't reading, are dropped and counted.
+// Incoming: the reader thread reads into a ring buffer and hands every complete message to the handler, on the reader thread.
+// A frame with an invalid length drops the client, it can reconnect.
+namespace IGCS
+{
+	class IMessageHandler
+	{
+	public:
+		virtual ~IMessageHandler() = default;
+		// message is the type byte followed by the payload, length includes the type byte. Only valid during the call.
+		virtual void handleMessage(uint8_t* message, uint32_t length) = 0;
+	};
+
+	class MessageServer
+	{
+	public:
+		static constexpr size_t kBatchSize = 64 * 1024;
+		static constexpr size_t kReadBufferSize = 32 * 1024;
+		static constexpr int kMaxBatchDelayMs = 50;
+		static constexpr int kRetryDelayMs = 1000;		// after an endpoint failed
+		static constexpr int kStopTimeoutMs = 500;		// for the last batch
+
+		MessageServer() = default;
+		// IMPORTANT: no cleanup in the destructor, it may run under loader lock. Use stop().
+		~MessageServer() = default;
+		MessageServer(const MessageServer&) = delete;
+		MessageServer& operator=(const MessageServer&) = delete;
+
+		// Opens both endpoints and starts the threads. The transports and the handler must outlive the server. False if an
+		// endpoint can't be opened.
+		bool start(IMessageTransport& outbound, IMessageTransport& inbound, IMessageHandler& handler)
+		{
+			if (_writer.joinable())
+			{
+				return true;
+			}
+			if (!outbound.open())
+			{
+				return false;
+			}
+			if (!inbound.open())
+			{
+				outbound.close();
+				return false;
+			}
+			_outbound = &outbound;
+			_inbound = &inbound;
+			_handler = &handler;
+			_stopRequested = false;
+			_flushRequested = false;
+			_writerFinished = false;
+			_writer = std::thread(&MessageServer::runWriter, this);
+			_reader = std::thread(&MessageServer::runReader, this);
+			return true;
+		}
+
+		// Sends what's batched, disconnects the client and stops the threads. From a SAFE context (not DllMain).
+		void stop()
+		{
+			if (!_writer.joinable())
+			{
+				return;
+			}
+			bool clientReading = false;
+			{
+				std::lock_guard<std::mutex> lock(_batchMutex);
+				_stopRequested = true;
+				_flushRequested = true;
+				clientReading = _clientReading;
+			}
+			_batchReady.notify_all();
+			_inbound->cancel();
+			_reader.join();
+			// with a client, the writer sends the last batch first, unless it's stuck on a client which doesn't read
+			if (clientReading)
+			{
+				std::unique_lock<std::mutex> lock(_batchMutex);
+				_writerDone.wait_for(lock, std::chrono::milliseconds(kStopTimeoutMs), [this] { return _writerFinished; });
+			}
+			_outbound->cancel();
+			_writer.join();
+			_outbound->close();
+			_inbound->close();
+		}
+
+		// Any thread. Frames the message from its parts into the current batch. False if it was dropped.
+		bool send(uint8_t type, const ConstBuffer* parts, size_t count) noexcept
+		{
+			bool added = false;
+			{
+				std::lock_guard<std::mutex> lock(_batchMutex);
+				added = _clientReading && _batches[_filling].append(type, parts, count);
+			}
+			(added ? _sent : _dropped).fetch_add(1, std::memory_order_relaxed);
+			return added;
+		}
+
+		bool send(uint8_t type, std::string_view text) noexcept
+		{
+			const ConstBuffer part{ text.data(), text.size() };
+			return send(type, &part, 1);
+		}
+
+		// Render thread, once per frame: hands the batch to the writer thread. If the previous write is still going, the batch
+		// keeps filling and goes out after it.
+		void flush() noexcept
+		{
+			{
+				std::lock_guard<std::mutex> lock(_batchMutex);
+				if (_batches[_filling].empty())
+				{
+					return;
+				}
+				_flushRequested = true;
+			}
+			_batchReady.notify_one();
+		}
+
+		[[nodiscard]] bool clientReading() const noexcept { return _clientReading.load(std::memory_order_relaxed); }
+		[[nodiscard]] bool clientWriting() const noexcept { return _clientWriting.load(std::memory_order_relaxed); }
+		// Messages put in a batch, in total.
+		[[nodiscard]] uint64_t sent() const noexcept { return _sent.load(std::memory_order_relaxed); }
+		// Messages dropped: no client, batches full or too large.
+		[[nodiscard]] uint64_t dropped() const noexcept { return _dropped.load(std::memory_order_relaxed); }
+		// Writes to the client, each carrying a batch.
+		[[nodiscard]] uint64_t writes() const noexcept { return _writes.load(std::memory_order_relaxed); }
+		// Messages passed to the handler, in total.
+		[[nodiscard]] uint64_t received() const noexcept { return _received.load(std::memory_order_relaxed); }
+		// Clients dropped because of an invalid frame.
+		[[nodiscard]] uint64_t protocolErrors() const noexcept { return _protocolErrors.load(std::memory_order_relaxed); }
+
+	private:
+		using Batch = FrameBatch<kBatchSize>;
+
+		void runWriter()
+		{
+#ifdef _WIN32
+			SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#endif
+			while (!stopRequested())
+			{
+				if (!_outbound->accept())
+				{
+					waitBeforeRetry();
+					continue;
+				}
+				{
+					std::lock_guard<std::mutex> lock(_batchMutex);
+					_clientReading = true;
+				}
+				while (Batch* batch = nextBatch())
+				{
+					const ConstBuffer buffer{ batch->data(), batch->size() };
+					const bool written = _outbound->write(&buffer, 1);
+					batch->clear();
+					if (!written)
+					{
+						break;
+					}
+					_writes.fetch_add(1, std::memory_order_relaxed);
+				}
+				{
+					std::lock_guard<std::mutex> lock(_batchMutex);
+					_clientReading = false;
+					_batches[_filling].clear();
+				}
+				_outbound->disconnect();
+			}
+			{
+				std::lock_guard<std::mutex> lock(_batchMutex);
+				_writerFinished = true;
+			}
+			_writerDone.notify_all();
+		}
+
+		// Waits for a flush, or a batch waiting kMaxBatchDelayMs, and swaps batches. nullptr when stopping and nothing's left.
+		Batch* nextBatch()
+		{
+			std::unique_lock<std::mutex> lock(_batchMutex);
+			while (true)
+			{
+				_batchReady.wait_for(lock, std::chrono::milliseconds(kMaxBatchDelayMs), [this] { return _flushRequested || _stopRequested; });
+				_flushRequested = false;
+				Batch& batch = _batches[_filling];
+				if (!batch.empty())
+				{
+					_filling ^= 1;
+					return &batch;
+				}
+				if (_stopRequested)
+				{
+					return nullptr;
+				}
+			}
+		}
+
+		void runReader()
+		{
+#ifdef _WIN32
+			SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#endif
+			while (!stopRequested())
+			{
+				if (!_inbound->accept())
+				{
+					waitBeforeRetry();
+					continue;
+				}
+				_clientWriting.store(true, std::memory_order_relaxed);
+				_frames.reset();
+				while (true)
+				{
+					const auto space = _frames.writable();
+					const size_t bytes = _inbound->read(space.data, space.size);
+					if (0 == bytes)
+					{
+						break;
+					}
+					_frames.commit(bytes);
+					const bool valid = _frames.dispatch([this](uint8_t* message, uint32_t length)
+					{
+						_received.fetch_add(1, std::memory_order_relaxed);
+						_handler->handleMessage(message, length);
+					});
+					if (!valid)
+					{
+						_protocolErrors.fetch_add(1, std::memory_order_relaxed);
+						break;
+					}
+				}
+				_clientWriting.store(false, std::memory_order_relaxed);
+				_inbound->disconnect();
+			}
+		}
+
+		bool stopRequested()
+		{
+			std::lock_guard<std::mutex> lock(_batchMutex);
+			return _stopRequested;
+		}
+
+		// A failed accept: cancelled, or the endpoint is broken. Don't spin on the latter.
+		void waitBeforeRetry()
+		{
+			std::unique_lock<std::mutex> lock(_batchMutex);
+			_batchReady.wait_for(lock, std::chrono::milliseconds(kRetryDelayMs), [this] { return _stopRequested; });
+		}
+
+		IMessageTransport* _outbound = nullptr;
+		IMessageTransport* _inbound = nullptr;
+		IMessageHandler* _handler = nullptr;
+
+		// under _batchMutex
+		std::mutex _batchMutex;
+		std::condition_variable _batchReady;
+		std::condition_variable _writerDone;
+		Batch _batches[2];
+		size_t _filling = 0;
+		bool _flushRequested = false;
+		bool _stopRequested = false;
+		bool _writerFinished = false;
+		std::atomic<bool> _clientReading{ false };		// written under _batchMutex, read anywhere
+
+		std::atomic<bool> _clientWriting{ false };
+		FrameReader<kReadBufferSize> _frames;		// reader thread only
+		std::thread _writer;
+		std::thread _reader;
+
+		std::atomic<uint64_t> _sent{ 0 };
+		std::atomic<uint64_t> _dropped{ 0 };
+		std::atomic<uint64_t> _writes{ 0 };
+		std::atomic<uint64_t> _received{ 0 };
+		std::atomic<uint64_t> _protocolErrors{ 0 };
+	};
+}
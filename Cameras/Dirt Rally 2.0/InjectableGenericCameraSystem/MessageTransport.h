@@ -0,0 +1,339 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include "MessageFraming.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// The server end of one byte stream to the client: an overlapped named pipe on Windows, a Unix domain socket elsewhere, so the
+// whole protocol can be run on Linux (see Tools/PipeProtocolTest). One client at a time. accept(), read(), write() and
+// disconnect() block and are called from one thread only, the one serving the stream; cancel() may be called from any thread and
+// makes the blocked call, and every call after it, fail, so that thread can be stopped.
+namespace IGCS
+{
+	class IMessageTransport
+	{
+	public:
+		virtual ~IMessageTransport() = default;
+		// Creates the endpoint. False if it can't, e.g. the name is taken.
+		virtual bool open() = 0;
+		// Waits for a client. False if cancelled or the endpoint failed.
+		virtual bool accept() = 0;
+		// Waits for data and reads what's there, at most capacity bytes. 0 if the client went away or cancelled.
+		virtual size_t read(uint8_t* buffer, size_t capacity) = 0;
+		// Writes the buffers in order. False if the client went away or cancelled.
+		virtual bool write(const ConstBuffer* buffers, size_t count) = 0;
+		// Drops the client, the endpoint waits for the next one.
+		virtual void disconnect() = 0;
+		virtual void cancel() = 0;
+		virtual void close() = 0;
+	};
+
+#ifdef _WIN32
+	class PipeTransport : public IMessageTransport
+	{
+	public:
+		static constexpr DWORD kPipeBufferSize = 64 * 1024;
+
+		enum class Direction : uint8_t
+		{
+			Inbound,		// the client writes
+			Outbound,		// the client reads
+		};
+
+		PipeTransport(const std::string& name, Direction direction) : _name(endpoint(name)), _direction(direction) {}
+		// IMPORTANT: no cleanup in the destructor, it may run under loader lock. Use close().
+		~PipeTransport() override = default;
+		PipeTransport(const PipeTransport&) = delete;
+		PipeTransport& operator=(const PipeTransport&) = delete;
+
+		// The endpoint of a stream called name: the pipe \\.\pipe\<name>.
+		static std::string endpoint(const std::string& name)
+		{
+			return "\\\\.\\pipe\\" + name;
+		}
+
+		bool open() override
+		{
+			const DWORD access = (Direction::Inbound == _direction ? PIPE_ACCESS_INBOUND : PIPE_ACCESS_OUTBOUND) | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE;
+			_pipe = CreateNamedPipeA(_name.c_str(), access, PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS, 1,
+				kPipeBufferSize, kPipeBufferSize, 0, nullptr);
+			_ioEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+			_cancelEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+			if (INVALID_HANDLE_VALUE == _pipe || nullptr == _ioEvent || nullptr == _cancelEvent)
+			{
+				close();
+				return false;
+			}
+			return true;
+		}
+
+		bool accept() override
+		{
+			OVERLAPPED overlapped = begin();
+			if (ConnectNamedPipe(_pipe, &overlapped))
+			{
+				return true;
+			}
+			const DWORD error = GetLastError();
+			DWORD bytes = 0;
+			return ERROR_PIPE_CONNECTED == error || (ERROR_IO_PENDING == error && complete(overlapped, bytes));
+		}
+
+		size_t read(uint8_t* buffer, size_t capacity) override
+		{
+			OVERLAPPED overlapped = begin();
+			DWORD bytes = 0;
+			const DWORD toRead = capacity < MAXDWORD ? static_cast<DWORD>(capacity) : MAXDWORD;
+			if (!ReadFile(_pipe, buffer, toRead, nullptr, &overlapped) && ERROR_IO_PENDING != GetLastError())
+			{
+				return 0;
+			}
+			return complete(overlapped, bytes) ? bytes : 0;
+		}
+
+		// A pipe write takes one buffer, so the buffers go out one by one. The dll sends one batch per write anyway.
+		bool write(const ConstBuffer* buffers, size_t count) override
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				OVERLAPPED overlapped = begin();
+				DWORD bytes = 0;
+				const DWORD size = static_cast<DWORD>(buffers[i].size);
+				if (!WriteFile(_pipe, buffers[i].data, size, nullptr, &overlapped) && ERROR_IO_PENDING != GetLastError())
+				{
+					return false;
+				}
+				if (!complete(overlapped, bytes) || bytes != size)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		void disconnect() override
+		{
+			DisconnectNamedPipe(_pipe);
+		}
+
+		void cancel() override
+		{
+			SetEvent(_cancelEvent);
+		}
+
+		void close() override
+		{
+			if (INVALID_HANDLE_VALUE != _pipe) { CloseHandle(_pipe); _pipe = INVALID_HANDLE_VALUE; }
+			if (nullptr != _ioEvent) { CloseHandle(_ioEvent); _ioEvent = nullptr; }
+			if (nullptr != _cancelEvent) { CloseHandle(_cancelEvent); _cancelEvent = nullptr; }
+		}
+
+	private:
+		OVERLAPPED begin()
+		{
+			ResetEvent(_ioEvent);
+			OVERLAPPED overlapped{};
+			overlapped.hEvent = _ioEvent;
+			return overlapped;
+		}
+
+		// Waits for the pending operation, or cancels it when cancel() is called.
+		bool complete(OVERLAPPED& overlapped, DWORD& bytes)
+		{
+			const HANDLE handles[] = { _cancelEvent, _ioEvent };
+			if (WAIT_OBJECT_0 + 1 == WaitForMultipleObjects(2, handles, FALSE, INFINITE))
+			{
+				return FALSE != GetOverlappedResult(_pipe, &overlapped, &bytes, FALSE);
+			}
+			CancelIoEx(_pipe, &overlapped);
+			GetOverlappedResult(_pipe, &overlapped, &bytes, TRUE);
+			return false;
+		}
+
+		std::string _name;
+		Direction _direction;
+		HANDLE _pipe = INVALID_HANDLE_VALUE;
+		HANDLE _ioEvent = nullptr;
+		HANDLE _cancelEvent = nullptr;
+	};
+#else
+	class PipeTransport : public IMessageTransport
+	{
+	public:
+		enum class Direction : uint8_t
+		{
+			Inbound,
+			Outbound,
+		};
+
+		// The direction only matters for named pipes, a socket is used one way by the server.
+		PipeTransport(const std::string& name, Direction) : _path(endpoint(name)) {}
+		~PipeTransport() override = default;
+		PipeTransport(const PipeTransport&) = delete;
+		PipeTransport& operator=(const PipeTransport&) = delete;
+
+		// The endpoint of a stream called name: a socket in the temp directory.
+		static std::string endpoint(const std::string& name)
+		{
+			return (std::filesystem::temp_directory_path() / name).string();
+		}
+
+		bool open() override
+		{
+			sockaddr_un address{};
+			if (_path.size() >= sizeof(address.sun_path))
+			{
+				return false;
+			}
+			address.sun_family = AF_UNIX;
+			std::memcpy(address.sun_path, _path.c_str(), _path.size() + 1);
+			unlink(_path.c_str());
+			_listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+			if (_listener < 0 || 0 != pipe2(_cancelPipe, O_NONBLOCK | O_CLOEXEC)
+				|| 0 != bind(_listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) || 0 != listen(_listener, 1))
+			{
+				close();
+				return false;
+			}
+			return true;
+		}
+
+		bool accept() override
+		{
+			if (!waitFor(_listener, POLLIN))
+			{
+				return false;
+			}
+			_client = accept4(_listener, nullptr, nullptr, SOCK_CLOEXEC);
+			return _client >= 0;
+		}
+
+		size_t read(uint8_t* buffer, size_t capacity) override
+		{
+			while (waitFor(_client, POLLIN))
+			{
+				const ssize_t bytes = recv(_client, buffer, capacity, 0);
+				if (bytes > 0)
+				{
+					return static_cast<size_t>(bytes);
+				}
+				if (0 == bytes || EINTR != errno)
+				{
+					break;
+				}
+			}
+			return 0;
+		}
+
+		// One sendmsg for all buffers, continued where it stopped if the socket took only part.
+		bool write(const ConstBuffer* buffers, size_t count) override
+		{
+			static constexpr size_t kMaxBuffers = 16;
+			iovec vectors[kMaxBuffers];
+			size_t vectorCount = count < kMaxBuffers ? count : kMaxBuffers;
+			for (size_t i = 0; i < vectorCount; ++i)
+			{
+				vectors[i].iov_base = const_cast<void*>(buffers[i].data);
+				vectors[i].iov_len = buffers[i].size;
+			}
+			iovec* next = vectors;
+			while (vectorCount > 0)
+			{
+				if (!waitFor(_client, POLLOUT))
+				{
+					return false;
+				}
+				msghdr message{};
+				message.msg_iov = next;
+				message.msg_iovlen = vectorCount;
+				ssize_t sent = sendmsg(_client, &message, MSG_NOSIGNAL);
+				if (sent < 0)
+				{
+					if (EINTR == errno || EAGAIN == errno)
+					{
+						continue;
+					}
+					return false;
+				}
+				while (vectorCount > 0 && static_cast<size_t>(sent) >= next->iov_len)
+				{
+					sent -= static_cast<ssize_t>(next->iov_len);
+					++next;
+					--vectorCount;
+				}
+				if (vectorCount > 0)
+				{
+					next->iov_base = static_cast<uint8_t*>(next->iov_base) + sent;
+					next->iov_len -= static_cast<size_t>(sent);
+				}
+			}
+			return count <= kMaxBuffers || write(buffers + kMaxBuffers, count - kMaxBuffers);
+		}
+
+		void disconnect() override
+		{
+			if (_client >= 0) { ::close(_client); _client = -1; }
+		}
+
+		void cancel() override
+		{
+			const char stop = 1;
+			[[maybe_unused]] const ssize_t written = ::write(_cancelPipe[1], &stop, 1);
+		}
+
+		void close() override
+		{
+			disconnect();
+			if (_listener >= 0)
+			{
+				::close(_listener);
+				_listener = -1;
+				unlink(_path.c_str());
+			}
+			for (int& fd : _cancelPipe)
+			{
+				if (fd >= 0) { ::close(fd); fd = -1; }
+			}
+		}
+
+	private:
+		// Waits till fd is ready for events. False if cancelled or fd failed.
+		bool waitFor(int fd, short events)
+		{
+			if (fd < 0)
+			{
+				return false;
+			}
+			pollfd fds[2] = { { _cancelPipe[0], POLLIN, 0 }, { fd, events, 0 } };
+			while (true)
+			{
+				const int result = poll(fds, 2, -1);
+				if (result < 0 && EINTR == errno)
+				{
+					continue;
+				}
+				// a hang up with data left is still readable, recv reports the end
+				return result > 0 && 0 == (fds[0].revents & POLLIN) && 0 != (fds[1].revents & (events | POLLHUP | POLLERR));
+			}
+		}
+
+		std::string _path;
+		int _listener = -1;
+		int _client = -1;
+		int _cancelPipe[2] = { -1, -1 };
+	};
+#endif
+}
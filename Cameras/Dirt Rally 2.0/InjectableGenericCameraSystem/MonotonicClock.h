@@ -0,0 +1,216 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <intrin.h>
+#else
+#include <time.h>
+#endif
+#if defined(_M_X64) || defined(__x86_64__)
+#define IGCS_CLOCK_HAS_TSC 1
+#ifndef _WIN32
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+#endif
+
+// The time base shared by all subsystems: nanosecond timestamps from a monotonic clock with an arbitrary epoch. The system
+// clock is QueryPerformanceCounter on Windows and CLOCK_MONOTONIC elsewhere. On CPUs with an invariant TSC the fast path can
+// be enabled, after which timestamps are computed from rdtsc with the TSC frequency calibrated against the system clock, which
+// avoids the system call. Timestamps from both paths are continuous, the fast path starts at the system clock's value.
+namespace IGCS
+{
+	class MonotonicClock
+	{
+	public:
+		static constexpr int64_t kNanosecondsPerSecond = 1000000000LL;
+		static constexpr int64_t kDefaultCalibrationTime = 100000000LL;		// 100ms
+
+		[[nodiscard]] static int64_t now() noexcept
+		{
+#ifdef IGCS_CLOCK_HAS_TSC
+			if (_tscEnabled.load(std::memory_order_acquire))
+			{
+				return _tscBaseTime + static_cast<int64_t>(static_cast<double>(readTsc() - _tscBaseTicks) * _nanosecondsPerTscTick);
+			}
+#endif
+			return systemNow();
+		}
+
+		// The system clock, bypassing the TSC fast path.
+		[[nodiscard]] static int64_t systemNow() noexcept
+		{
+#ifdef _WIN32
+			LARGE_INTEGER counter;
+			QueryPerformanceCounter(&counter);
+			const int64_t frequency = qpcFrequency();
+			// split to avoid overflowing the multiplication
+			const int64_t seconds = counter.QuadPart / frequency;
+			const int64_t remainder = counter.QuadPart % frequency;
+			return seconds * kNanosecondsPerSecond + remainder * kNanosecondsPerSecond / frequency;
+#else
+			timespec time;
+			clock_gettime(CLOCK_MONOTONIC, &time);
+			return static_cast<int64_t>(time.tv_sec) * kNanosecondsPerSecond + time.tv_nsec;
+#endif
+		}
+
+		// Calibrates the TSC against the system clock, blocking for calibrationTime, and switches now() to the TSC. Returns
+		// false if the CPU has no invariant TSC, in which case now() keeps using the system clock. Call once at startup.
+		static bool enableTscFastPath(int64_t calibrationTime = kDefaultCalibrationTime) noexcept
+		{
+#ifdef IGCS_CLOCK_HAS_TSC
+			if (_tscEnabled.load(std::memory_order_acquire))
+			{
+				return true;
+			}
+			if (!hasInvariantTsc())
+			{
+				return false;
+			}
+			int64_t startTime = 0;
+			const uint64_t startTicks = sampleTsc(startTime);
+			while (systemNow() - startTime < calibrationTime)
+			{
+			}
+			int64_t endTime = 0;
+			const uint64_t endTicks = sampleTsc(endTime);
+			if (endTicks <= startTicks || endTime <= startTime)
+			{
+				return false;
+			}
+			_tscTicksPerSecond = static_cast<double>(endTicks - startTicks) * static_cast<double>(kNanosecondsPerSecond) / static_cast<double>(endTime - startTime);
+			_tscBaseTicks = endTicks;
+			_tscBaseTime = endTime;
+			_nanosecondsPerTscTick = static_cast<double>(kNanosecondsPerSecond) / _tscTicksPerSecond;
+			_tscEnabled.store(true, std::memory_order_release);
+			return true;
+#else
+			(void)calibrationTime;
+			return false;
+#endif
+		}
+
+		[[nodiscard]] static bool tscFastPathEnabled() noexcept { return _tscEnabled.load(std::memory_order_acquire); }
+
+		// Calibrated TSC frequency, 0 if the fast path isn't enabled. For converting rdtsc values taken elsewhere, e.g. in asm.
+		[[nodiscard]] static double tscTicksPerSecond() noexcept
+		{
+			return _tscEnabled.load(std::memory_order_acquire) ? _tscTicksPerSecond : 0.0;
+		}
+
+		[[nodiscard]] static uint64_t readTsc() noexcept
+		{
+#ifdef IGCS_CLOCK_HAS_TSC
+			return __rdtsc();
+#else
+			return 0;
+#endif
+		}
+
+		[[nodiscard]] static constexpr double toSeconds(int64_t nanoseconds) noexcept { return static_cast<double>(nanoseconds) * 1e-9; }
+		[[nodiscard]] static constexpr double toMilliseconds(int64_t nanoseconds) noexcept { return static_cast<double>(nanoseconds) * 1e-6; }
+		[[nodiscard]] static constexpr int64_t fromSeconds(double seconds) noexcept { return static_cast<int64_t>(seconds * 1e9); }
+		[[nodiscard]] static constexpr int64_t fromMilliseconds(int64_t milliseconds) noexcept { return milliseconds * 1000000LL; }
+		[[nodiscard]] static constexpr int64_t fromMicroseconds(int64_t microseconds) noexcept { return microseconds * 1000LL; }
+
+	private:
+#ifdef _WIN32
+		[[nodiscard]] static int64_t qpcFrequency() noexcept
+		{
+			// constant since boot
+			static const int64_t frequency = []
+			{
+				LARGE_INTEGER value;
+				QueryPerformanceFrequency(&value);
+				return value.QuadPart;
+			}();
+			return frequency;
+		}
+#endif
+
+#ifdef IGCS_CLOCK_HAS_TSC
+		[[nodiscard]] static bool hasInvariantTsc() noexcept
+		{
+			// CPUID 0x80000007, EDX bit 8: the TSC runs at a constant rate in all power states
+#ifdef _WIN32
+			int registers[4];
+			__cpuid(registers, 0x80000000);
+			if (static_cast<unsigned>(registers[0]) < 0x80000007u)
+			{
+				return false;
+			}
+			__cpuid(registers, 0x80000007);
+			return 0 != (registers[3] & (1 << 8));
+#else
+			unsigned eax, ebx, ecx, edx;
+			if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx))
+			{
+				return false;
+			}
+			return 0 != (edx & (1u << 8));
+#endif
+		}
+
+		// A TSC value and the system time at the same moment, taken as the pair with the shortest read in a few tries.
+		static uint64_t sampleTsc(int64_t& time) noexcept
+		{
+			uint64_t bestTicks = 0;
+			uint64_t bestSpread = UINT64_MAX;
+			for (int i = 0; i < 8; ++i)
+			{
+				const uint64_t before = __rdtsc();
+				const int64_t sampled = systemNow();
+				const uint64_t after = __rdtsc();
+				if (after - before < bestSpread)
+				{
+					bestSpread = after - before;
+					bestTicks = before + (after - before) / 2;
+					time = sampled;
+				}
+			}
+			return bestTicks;
+		}
+#endif
+
+		// written once before _tscEnabled is set, read only after
+		static inline uint64_t _tscBaseTicks = 0;
+		static inline int64_t _tscBaseTime = 0;
+		static inline double _nanosecondsPerTscTick = 0.0;
+		static inline double _tscTicksPerSecond = 0.0;
+		static inline std::atomic<bool> _tscEnabled{ false };
+	};
+
+	// Time in the game's time domain: advanced by the real time between frames scaled by the game speed, so it stands still
+	// while the game is paused and runs slower in slow motion. Owned by the thread that advances it.
+	class GameClock
+	{
+	public:
+		// Advances to realNow, a MonotonicClock timestamp, at the given timescale. The first call only sets the start.
+		void advance(int64_t realNow, double timescale) noexcept
+		{
+			if (_lastRealTime != 0 && realNow > _lastRealTime)
+			{
+				const double scale = timescale > 0.0 ? timescale : 0.0;
+				_gameTime += static_cast<int64_t>(static_cast<double>(realNow - _lastRealTime) * scale);
+			}
+			_lastRealTime = realNow;
+		}
+
+		void reset() noexcept
+		{
+			_gameTime = 0;
+			_lastRealTime = 0;
+		}
+
+		// nanoseconds of game time since the first advance
+		[[nodiscard]] int64_t now() const noexcept { return _gameTime; }
+		[[nodiscard]] double seconds() const noexcept { return MonotonicClock::toSeconds(_gameTime); }
+
+	private:
+		int64_t _gameTime = 0;
+		int64_t _lastRealTime = 0;
+	};
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Bounded queue between any number of producer threads and one consumer thread. Every slot carries a sequence number telling
+// whose turn it is, so producers only contend on the tail index: a push claims a slot with one compare-exchange, fills it in
+// place and hands it over with a release store. Nothing ever blocks or allocates; a full queue makes the push fail and the
+// producer decides what to do (drop, count). Values are written and read in place, so T can be large (e.g. a log record).
+namespace IGCS
+{
+	template<typename T, size_t Capacity>
+	class MpscQueue
+	{
+		static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+	public:
+		static constexpr size_t kCapacity = Capacity;
+
+		MpscQueue() noexcept
+		{
+			for (size_t i = 0; i < Capacity; ++i)
+			{
+				_cells[i].sequence.store(i, std::memory_order_relaxed);
+			}
+		}
+		MpscQueue(const MpscQueue&) = delete;
+		MpscQueue& operator=(const MpscQueue&) = delete;
+
+		// Any thread. Claims a slot and calls fill(T&) to write it. Returns false, without calling fill, if the queue is full.
+		template<typename Fill>
+		bool tryPush(Fill&& fill) noexcept
+		{
+			size_t tail = _tail.load(std::memory_order_relaxed);
+			Cell* cell;
+			while (true)
+			{
+				cell = &_cells[tail & (Capacity - 1)];
+				const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+				const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(tail);
+				if (0 == difference)
+				{
+					if (_tail.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed))
+					{
+						break;
+					}
+				}
+				else if (difference < 0)
+				{
+					return false;		// the consumer hasn't freed this slot yet
+				}
+				else
+				{
+					tail = _tail.load(std::memory_order_relaxed);		// another producer took it
+				}
+			}
+			fill(cell->value);
+			cell->sequence.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Consumer thread. Calls consume(const T&) with the oldest value and frees its slot. Returns false if the oldest slot
+		// isn't filled yet, which includes a producer still writing it.
+		template<typename Consume>
+		bool tryPop(Consume&& consume) noexcept
+		{
+			Cell& cell = _cells[_head & (Capacity - 1)];
+			if (cell.sequence.load(std::memory_order_acquire) != _head + 1)
+			{
+				return false;
+			}
+			consume(static_cast<const T&>(cell.value));
+			cell.sequence.store(_head + Capacity, std::memory_order_release);
+			++_head;
+			return true;
+		}
+
+	private:
+		static constexpr size_t kCacheLine = 64;
+
+		struct Cell
+		{
+			std::atomic<size_t> sequence{ 0 };
+			T value{};
+		};
+
+		alignas(kCacheLine) std::atomic<size_t> _tail{ 0 };
+		alignas(kCacheLine) size_t _head = 0;		// consumer only
+		alignas(kCacheLine) Cell _cells[Capacity];
+	};
+}
@@ -34,18 +34,14 @@
 #include "Globals.h"
 #include "InputHooker.h"
 #include "CameraManipulator.h"
+#include "MessageHandler.h"
 
 namespace IGCS
 {
-	// Workaround for having a method as the actual thread func. See: https://stackoverflow.com/a/1372989
-	//static DWORD WINAPI staticListenerThread(LPVOID lpParam)
-	//{
-	//	// our message handling will be very fast so we'll do this on the listener thread, no need to offload that to yet another thread yet.
-	//	auto This = (NamedPipeManager*)lpParam;
-	//	return This->listenerThread();
-	//}
+	static_assert(MessageFraming::kMaxMessageSize == IGCS_MAX_MESSAGE_SIZE, "The framing must accept the messages the client sends");
 
-	NamedPipeManager::NamedPipeManager(): _clientToDllPipe(nullptr), _clientToDllPipeConnected(false), _dllToClientPipe(nullptr), _dllToClientPipeConnected(false)
+	NamedPipeManager::NamedPipeManager() : _dllToClientPipe(IGCS_PIPENAME_DLL_TO_CLIENT, PipeTransport::Direction::Outbound),
+		_clientToDllPipe(IGCS_PIPENAME_CLIENT_TO_DLL, PipeTransport::Direction::Inbound)
 	{
 	}
 		
@@ -54,35 +50,56 @@ namespace IGCS
 
 	NamedPipeManager& NamedPipeManager::instance()
 	{
-		static NamedPipeManager theInstance;
-		return theInstance;
+		// owns threads, which can't be joined when statics are destroyed
+		static NamedPipeManager* theInstance = new NamedPipeManager(); // intentionally leaked on process exit
+		return *theInstance;
 	}
 
-	void NamedPipeManager::writeTextPayload(const std::string& messageText, MessageType typeOfMessage) const
+	void NamedPipeManager::startListening()
 	{
-		if (!_dllToClientPipeConnected)
+		if (_server.start(_dllToClientPipe, _clientToDllPipe, *this))
 		{
-			return;
+			MessageHandler::logDebug("Pipes: waiting for the client on %s and %s", IGCS_PIPENAME_DLL_TO_CLIENT, IGCS_PIPENAME_CLIENT_TO_DLL);
 		}
+		else
+		{
+			MessageHandler::logError("Pipes: can't create the pipes to the client, is the game running twice?");
+		}
+	}
+
+	void NamedPipeManager::stop()
+	{
+		_server.stop();
+		MessageHandler::logDebug("Pipes: stopped. %llu messages sent in %llu writes, %llu dropped, %llu received", _server.sent(), _server.writes(),
+			_server.dropped(), _server.received());
+	}
+
+	void NamedPipeManager::flush()
+	{
+		_server.flush();
+	}
 
-		uint8_t payload[IGCS_MAX_MESSAGE_SIZE];
-		payload[0] = uint8_t(typeOfMessage);
-		strncpy_s((char*)(&payload[1]), IGCS_MAX_MESSAGE_SIZE-2, messageText.c_str(), messageText.length());
-		DWORD numberOfBytesWritten;
-		WriteFile(_dllToClientPipe, payload, static_cast<DWORD>(messageText.length() + 1), &numberOfBytesWritten, nullptr);
+	void NamedPipeManager::writeTextPayload(std::string_view messageText, MessageType typeOfMessage)
+	{
+		if (!_server.clientReading())
+		{
+			return;
+		}
+		// longer texts are cut off, the type byte counts towards the message size
+		_server.send(uint8_t(typeOfMessage), messageText.substr(0, IGCS_MAX_MESSAGE_SIZE - 1));
 	}
 
-	void NamedPipeManager::writeMessage(const std::string& messageText)
+	void NamedPipeManager::writeMessage(std::string_view messageText)
 	{
 		writeMessage(messageText, false, false);
 	}
 
-	void NamedPipeManager::writeMessage(const std::string& messageText, bool isError)
+	void NamedPipeManager::writeMessage(std::string_view messageText, bool isError)
 	{
 		writeMessage(messageText, isError, false);
 	}
 
-	void NamedPipeManager::writeMessage(const std::string& messageText, bool isError, bool isDebug)
+	void NamedPipeManager::writeMessage(std::string_view messageText, bool isError, bool isDebug)
 	{
 		MessageType typeOfMessage = MessageType::NormalTextMessage;
 		if(isError)
@@ -99,4 +116,20 @@ namespace IGCS
 		writeTextPayload(messageText, typeOfMessage);
 	}
 
+	void NamedPipeManager::handleMessage(uint8_t* message, uint32_t length)
+	{
+		switch (static_cast<MessageType>(message[0]))
+		{
+		case MessageType::Setting:
+			Globals::instance().handleSettingMessage(message, length);
+			break;
+		case MessageType::KeyBinding:
+			Globals::instance().handleKeybindingMessage(message, length);
+			break;
+		default:
+			MessageHandler::logDebug("Pipes: message of type %u ignored", static_cast<unsigned>(message[0]));
+			break;
+		}
+	}
+
 }
@@ -27,31 +27,43 @@
 ////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma once
 #include "stdafx.h"
-#include <string>
+#include <string_view>
 #include "Defaults.h"
+#include "MessageServer.h"
 
 namespace IGCS
 {
-	class NamedPipeManager
+	// The pipes to the client, served by a MessageServer: messages to the client are batched and sent once per frame,
+	// messages from the client are handled on the pipe reader thread.
+	class NamedPipeManager : public IMessageHandler
 	{
 	public:
 		NamedPipeManager();
-		~NamedPipeManager();
+		~NamedPipeManager() override;
 
 		static NamedPipeManager& instance();
 
-		void writeTextPayload(const std::string& messageText, MessageType typeOfMessage) const;
-		void writeMessage(const std::string& messageText);
-		void writeMessage(const std::string& messageText, bool isError);
-		void writeMessage(const std::string& messageText, bool isError, bool isDebug);
+		// Creates the pipes, the client can connect from then on.
+		void startListening();
+		// From a SAFE context (not DllMain).
+		void stop();
+		// Render thread, once per frame: sends the messages of the frame in one write.
+		void flush();
+
+		void writeTextPayload(std::string_view messageText, MessageType typeOfMessage);
+		void writeMessage(std::string_view messageText);
+		void writeMessage(std::string_view messageText, bool isError);
+		void writeMessage(std::string_view messageText, bool isError, bool isDebug);
+
+		// Pipe reader thread.
+		void handleMessage(uint8_t* message, uint32_t length) override;
 
 	private:
 		//void handlePathAction(uint8_t buffer[], DWORD bytesRead);
 
-		HANDLE _dllToClientPipe;
-		HANDLE _clientToDllPipe;
-		bool _dllToClientPipeConnected;
-		bool _clientToDllPipeConnected;
+		PipeTransport _dllToClientPipe;
+		PipeTransport _clientToDllPipe;
+		MessageServer _server;
 	};
 }
 
@@ -0,0 +1,97 @@
+#pragma once
+#include <cstdint>
+#include "FramePacer.h"
+#include "MonotonicClock.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+// MonotonicClock and the system's sleep for FramePacer. On Windows a high resolution waitable timer (Windows 10 1803+, a
+// normal waitable timer before that), elsewhere clock_nanosleep.
+namespace IGCS
+{
+#ifdef _WIN32
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+	class SystemPacingClock : public IPacingClock
+	{
+	public:
+		SystemPacingClock() noexcept
+		{
+			_timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+			if (nullptr == _timer)
+			{
+				_timer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+			}
+		}
+
+		~SystemPacingClock() override
+		{
+			if (nullptr != _timer)
+			{
+				CloseHandle(_timer);
+			}
+		}
+
+		SystemPacingClock(const SystemPacingClock&) = delete;
+		SystemPacingClock& operator=(const SystemPacingClock&) = delete;
+
+		int64_t now() noexcept override
+		{
+			return MonotonicClock::now();
+		}
+
+		void sleep(int64_t nanoseconds) noexcept override
+		{
+			if (nullptr == _timer)
+			{
+				Sleep(static_cast<DWORD>(nanoseconds / 1000000));
+				return;
+			}
+			LARGE_INTEGER dueTime;
+			dueTime.QuadPart = -(nanoseconds / 100);		// relative, in 100ns units
+			if (SetWaitableTimer(_timer, &dueTime, 0, nullptr, nullptr, FALSE))
+			{
+				WaitForSingleObject(_timer, INFINITE);
+			}
+		}
+
+		void spinPause() noexcept override
+		{
+			YieldProcessor();
+		}
+
+	private:
+		HANDLE _timer = nullptr;
+	};
+#else
+	class SystemPacingClock : public IPacingClock
+	{
+	public:
+		int64_t now() noexcept override
+		{
+			return MonotonicClock::now();
+		}
+
+		void sleep(int64_t nanoseconds) noexcept override
+		{
+			timespec duration;
+			duration.tv_sec = static_cast<time_t>(nanoseconds / 1000000000LL);
+			duration.tv_nsec = static_cast<long>(nanoseconds % 1000000000LL);
+			clock_nanosleep(CLOCK_MONOTONIC, 0, &duration, nullptr);
+		}
+
+		void spinPause() noexcept override
+		{
+#if defined(__x86_64__) || defined(__i386__)
+			__builtin_ia32_pause();
+#endif
+		}
+	};
+#endif
+}
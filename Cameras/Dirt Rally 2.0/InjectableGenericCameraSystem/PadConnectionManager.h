@@ -0,0 +1,151 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include "DeviceJob.h"
+
+// Reading a connected XInput pad is cheap, asking for the state of a slot without a pad is not (the driver looks for the device
+// every time, which can take milliseconds). Connected slots are read by the input thread every sample; disconnected slots are
+// never read there but probed on the device worker thread, right away after a device change notification and otherwise with an
+// interval which grows from kInitialProbeInterval to kMaxProbeInterval while the slot stays empty. Only watched slots are
+// probed.
+namespace IGCS
+{
+	// Same layout as XINPUT_STATE.
+	struct PadState
+	{
+		uint32_t packetNumber = 0;
+		uint16_t buttons = 0;
+		uint8_t leftTrigger = 0;
+		uint8_t rightTrigger = 0;
+		int16_t thumbLX = 0;
+		int16_t thumbLY = 0;
+		int16_t thumbRX = 0;
+		int16_t thumbRY = 0;
+	};
+
+	class IPadStateSource
+	{
+	public:
+		virtual ~IPadStateSource() = default;
+
+		// Reads the state of the pad in the slot. Returns false if there's no pad.
+		virtual bool getState(uint32_t slot, PadState& state) noexcept = 0;
+	};
+
+	class PadConnectionManager : public IDeviceJob
+	{
+	public:
+		static constexpr uint32_t kSlots = 4;
+		static constexpr int64_t kInitialProbeInterval = 1000000000LL;		// 1s
+		static constexpr int64_t kMaxProbeInterval = 8000000000LL;			// 8s
+
+		explicit PadConnectionManager(IPadStateSource& source) noexcept : _source(source)
+		{
+		}
+
+		PadConnectionManager(const PadConnectionManager&) = delete;
+		PadConnectionManager& operator=(const PadConnectionManager&) = delete;
+
+		// Probe the slot from now on. Setup, before the worker runs.
+		void watch(uint32_t slot) noexcept
+		{
+			if (slot < kSlots)
+			{
+				_slots[slot].watched.store(true, std::memory_order_release);
+				_probeRequested.store(true, std::memory_order_release);
+			}
+		}
+
+		// Reads the pad in the slot if it's connected; a disconnected slot costs nothing. A failed read marks the slot as
+		// disconnected, the worker takes over from there. Input thread.
+		bool poll(uint32_t slot, PadState& state) noexcept
+		{
+			if (slot >= kSlots || !_slots[slot].connected.load(std::memory_order_acquire))
+			{
+				return false;
+			}
+			if (_source.getState(slot, state))
+			{
+				return true;
+			}
+			_slots[slot].connected.store(false, std::memory_order_release);
+			return false;
+		}
+
+		[[nodiscard]] bool isConnected(uint32_t slot) const noexcept
+		{
+			return slot < kSlots && _slots[slot].connected.load(std::memory_order_acquire);
+		}
+
+		// Probes the watched, disconnected slots which are due. Wakes up at least every kMaxProbeInterval, to pick up slots
+		// the input thread found disconnected.
+		int64_t step(int64_t now) noexcept override
+		{
+			const bool requested = _probeRequested.exchange(false, std::memory_order_acq_rel);
+			int64_t next = now + kMaxProbeInterval;
+			for (uint32_t i = 0; i < kSlots; ++i)
+			{
+				Slot& slot = _slots[i];
+				if (!slot.watched.load(std::memory_order_acquire))
+				{
+					continue;
+				}
+				if (slot.connected.load(std::memory_order_acquire))
+				{
+					// probe right away once it's gone
+					slot.probeInterval = 0;
+					slot.nextProbe = 0;
+					continue;
+				}
+				if (requested)
+				{
+					slot.probeInterval = 0;
+					slot.nextProbe = 0;
+				}
+				if (now >= slot.nextProbe)
+				{
+					++_probes;
+					PadState state;
+					if (_source.getState(i, state))
+					{
+						slot.connected.store(true, std::memory_order_release);
+						slot.probeInterval = 0;
+						slot.nextProbe = 0;
+						continue;
+					}
+					slot.probeInterval = slot.probeInterval == 0 ? kInitialProbeInterval
+						: (slot.probeInterval >= kMaxProbeInterval / 2 ? kMaxProbeInterval : slot.probeInterval * 2);
+					slot.nextProbe = now + slot.probeInterval;
+				}
+				if (slot.nextProbe < next)
+				{
+					next = slot.nextProbe;
+				}
+			}
+			return next;
+		}
+
+		void devicesChanged() noexcept override
+		{
+			_probeRequested.store(true, std::memory_order_release);
+		}
+
+		// number of probes of disconnected slots so far
+		[[nodiscard]] uint64_t probes() const noexcept { return _probes; }
+
+	private:
+		struct Slot
+		{
+			std::atomic<bool> watched{ false };
+			std::atomic<bool> connected{ false };
+			// worker thread only
+			int64_t probeInterval = 0;
+			int64_t nextProbe = 0;
+		};
+
+		IPadStateSource& _source;
+		Slot _slots[kSlots];
+		std::atomic<bool> _probeRequested{ false };
+		uint64_t _probes = 0;		// worker thread only
+	};
+}
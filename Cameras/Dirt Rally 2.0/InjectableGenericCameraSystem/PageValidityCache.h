@@ -0,0 +1,131 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Remembers which memory regions of the host are readable, so checking a pointer the interceptors handed us doesn't cost a
+// region lookup (VirtualQuery in the game) every frame. Lookups are cached per page: the first check of an address in a
+// page asks the region provider for the readable region around it, later checks in that page are a few integer compares
+// until the entry expires after kLifetimeFrames frames, or is dropped with invalidate() after a read still faulted.
+namespace IGCS
+{
+	struct MemoryRegion
+	{
+		uintptr_t start = 0;
+		uintptr_t end = 0;
+		bool readable = false;
+	};
+
+	class IMemoryRegionProvider
+	{
+	public:
+		virtual ~IMemoryRegionProvider() = default;
+
+		// Fills region with the region containing address. Returns false if there is no such region, e.g. the address is
+		// outside the address space.
+		virtual bool queryRegion(uintptr_t address, MemoryRegion& region) noexcept = 0;
+	};
+
+	class PageValidityCache
+	{
+	public:
+		static constexpr uintptr_t kPageSize = 4096;
+		static constexpr size_t kEntryCount = 16;
+		static constexpr uint32_t kLifetimeFrames = 120;
+
+		explicit PageValidityCache(IMemoryRegionProvider& provider) noexcept : _provider(provider)
+		{
+		}
+
+		// Call once per frame, ages the cached entries.
+		void nextFrame() noexcept
+		{
+			++_frame;
+		}
+
+		// True if the size bytes at address are readable.
+		bool isReadable(const void* address, size_t size) noexcept
+		{
+			const uintptr_t start = reinterpret_cast<uintptr_t>(address);
+			if (0 == start || size == 0 || start + size < start)
+			{
+				return false;
+			}
+			const uintptr_t end = start + size;
+			uintptr_t current = start;
+			// a range crossing into the next region is checked region by region
+			while (current < end)
+			{
+				const Entry& entry = lookup(current);
+				if (!entry.readable)
+				{
+					return false;
+				}
+				current = entry.end;
+			}
+			return true;
+		}
+
+		// Drops the cached entry of the page containing address.
+		void invalidate(const void* address) noexcept
+		{
+			const uintptr_t page = reinterpret_cast<uintptr_t>(address) / kPageSize;
+			Entry& entry = _entries[page % kEntryCount];
+			if (entry.page == page)
+			{
+				entry = Entry();
+			}
+		}
+
+		void invalidateAll() noexcept
+		{
+			for (Entry& entry : _entries)
+			{
+				entry = Entry();
+			}
+		}
+
+		[[nodiscard]] uint64_t regionQueries() const noexcept { return _regionQueries; }
+
+	private:
+		struct Entry
+		{
+			uintptr_t page = 0;
+			uintptr_t end = 0;
+			uint32_t expiresAt = 0;
+			bool readable = false;
+			bool used = false;
+		};
+
+		const Entry& lookup(uintptr_t address) noexcept
+		{
+			const uintptr_t page = address / kPageSize;
+			Entry& entry = _entries[page % kEntryCount];
+			if (entry.used && entry.page == page && static_cast<int32_t>(entry.expiresAt - _frame) > 0)
+			{
+				return entry;
+			}
+
+			++_regionQueries;
+			MemoryRegion region;
+			entry.used = true;
+			entry.page = page;
+			entry.expiresAt = _frame + kLifetimeFrames;
+			if (_provider.queryRegion(address, region) && region.end > address)
+			{
+				entry.readable = region.readable;
+				entry.end = region.end;
+			}
+			else
+			{
+				entry.readable = false;
+				entry.end = (page + 1) * kPageSize;
+			}
+			return entry;
+		}
+
+		IMemoryRegionProvider& _provider;
+		Entry _entries[kEntryCount];
+		uint32_t _frame = 0;
+		uint64_t _regionQueries = 0;
+	};
+}
@@ -0,0 +1,208 @@
+#pragma once
+#include <cmath>
+#include <vector>
+#include "CameraSmoothing.h"
+#include "stb_perlin.h"
+
+// Procedural camera shake and handheld motion. The noise is multi-octave revised Perlin noise from stb_perlin, but it's never
+// evaluated per frame: all channels are baked once, when the camera is initialized, into a periodic table and looked up with
+// linear interpolation. The table is interleaved, kLanes floats per sample, so one lookup returns every channel at that phase
+// from a single cache line and the blend is a plain loop the compiler vectorizes. No trig or hashing happens per frame.
+// stb_perlin is implemented once for the whole dll, in Utils.cpp.
+namespace IGCS::CameraEffects
+{
+	using Smoothing::Vec3;
+
+	class NoiseTable
+	{
+	public:
+		static constexpr int kLanes = 8;
+		static constexpr int kPeriod = 64;				// noise units after which the table repeats, a power of two
+		static constexpr int kSamplesPerUnit = 16;
+		static constexpr int kSampleCount = kPeriod * kSamplesPerUnit;
+		static constexpr int kOctaves = 3;
+		static constexpr int kBreathingLane = 6;		// lanes 0-5 are noise channels, lane 6 a sine, lane 7 padding
+		static constexpr int kBreathingPeriod = 16;		// noise units per breathing cycle
+
+		// Bakes the table, about 18k noise evaluations: not on the render thread.
+		NoiseTable()
+		{
+			_samples.resize(static_cast<size_t>(kSampleCount + 1) * kLanes);
+			float maxAbs[kLanes] = {};
+			for (int i = 0; i < kSampleCount; ++i)
+			{
+				const float x = static_cast<float>(i) / static_cast<float>(kSamplesPerUnit);
+				for (int lane = 0; lane < kBreathingLane; ++lane)
+				{
+					const float value = fbm(x, lane);
+					_samples[static_cast<size_t>(i) * kLanes + lane] = value;
+					maxAbs[lane] = std::fmax(maxAbs[lane], std::fabs(value));
+				}
+				_samples[static_cast<size_t>(i) * kLanes + kBreathingLane] = std::sin(2.0f * 3.14159265f * x / static_cast<float>(kBreathingPeriod));
+			}
+			// normalize the noise lanes to -1..1
+			for (int i = 0; i < kSampleCount; ++i)
+			{
+				for (int lane = 0; lane < kBreathingLane; ++lane)
+				{
+					if (maxAbs[lane] > 0.0f)
+					{
+						_samples[static_cast<size_t>(i) * kLanes + lane] /= maxAbs[lane];
+					}
+				}
+			}
+			// guard sample, so interpolation never has to wrap
+			for (int lane = 0; lane < kLanes; ++lane)
+			{
+				_samples[static_cast<size_t>(kSampleCount) * kLanes + lane] = _samples[lane];
+			}
+		}
+
+		// Wraps a phase (in noise units) into [0, kPeriod).
+		static float wrap(float phase) noexcept
+		{
+			phase = std::fmod(phase, static_cast<float>(kPeriod));
+			return phase < 0.0f ? phase + static_cast<float>(kPeriod) : phase;
+		}
+
+		// The noise of a noise lane at x, before normalizing: what the table holds at x = i / kSamplesPerUnit. Each lane is a
+		// row of the noise of its own, wrapped at kPeriod in x, so the table repeats without a seam. With a lacunarity of 2 the
+		// octaves wrap at kPeriod as well.
+		static float fbm(float x, int lane) noexcept
+		{
+			return stb_perlin_fbm_noise3(x, static_cast<float>(lane) * 7.31f + 0.5f, 0.5f, 2.0f, 0.5f, kOctaves, kPeriod, 0, 0);
+		}
+
+		// All lanes at the given phase, which has to be in [0, kPeriod).
+		void sample(float phase, float (&out)[kLanes]) const noexcept
+		{
+			const float position = phase * static_cast<float>(kSamplesPerUnit);
+			int index = static_cast<int>(position);
+			index = index < 0 ? 0 : (index >= kSampleCount ? kSampleCount - 1 : index);
+			const float t = position - static_cast<float>(index);
+			const float* a = &_samples[static_cast<size_t>(index) * kLanes];
+			const float* b = a + kLanes;
+			for (int lane = 0; lane < kLanes; ++lane)
+			{
+				out[lane] = a[lane] + (b[lane] - a[lane]) * t;
+			}
+		}
+
+	private:
+		std::vector<float> _samples;
+	};
+
+	struct ShakeParams
+	{
+		bool enabled = false;
+		float amplitude = 0.0f;		// radians at full noise
+		float frequency = 0.0f;		// Hz
+	};
+
+	struct HandheldParams
+	{
+		bool enabled = false;
+		float intensity = 1.0f;
+		float driftIntensity = 1.0f;
+		float jitterIntensity = 1.0f;
+		float breathingIntensity = 0.0f;
+		float breathingRate = 0.0f;			// breaths per second
+		float driftSpeed = 0.05f;
+		float rotationDriftSpeed = 0.03f;
+		bool positionEnabled = true;
+		bool rotationEnabled = true;
+	};
+
+	// Per-frame evaluation of shake and handheld motion. Keeps a wrapped phase per effect and produces a position offset
+	// (camera space, metres) and a rotation offset (pitch, yaw, roll in radians).
+	class CameraNoise
+	{
+	public:
+		// The table to sample, built beforehand. Till it's set the offsets stay 0.
+		void setTable(const NoiseTable* table) noexcept
+		{
+			_table = table;
+		}
+
+		void reset() noexcept
+		{
+			_positionPhase = 0.0f;
+			_rotationPhase = 17.0f;		// away from the position phase, so the channels don't start in lock step
+			_jitterPhase = 33.0f;
+			_breathingPhase = 0.0f;
+			_shakePhase = 49.0f;
+			_positionOffset = {};
+			_rotationOffset = {};
+		}
+
+		void update(float dt, const ShakeParams& shake, const HandheldParams& handheld) noexcept
+		{
+			_positionOffset = {};
+			_rotationOffset = {};
+			if (!(dt > 0.0f) || nullptr == _table)
+			{
+				return;
+			}
+			const NoiseTable& table = *_table;
+			float lanes[NoiseTable::kLanes];
+			if (handheld.enabled)
+			{
+				// drift speeds are in the units the original tools used: 1.0 = 20 noise units per second
+				_positionPhase = NoiseTable::wrap(_positionPhase + dt * handheld.driftSpeed * 20.0f);
+				_rotationPhase = NoiseTable::wrap(_rotationPhase + dt * handheld.rotationDriftSpeed * 20.0f);
+				_jitterPhase = NoiseTable::wrap(_jitterPhase + dt * kJitterRate);
+				_breathingPhase = NoiseTable::wrap(_breathingPhase + dt * handheld.breathingRate * static_cast<float>(NoiseTable::kBreathingPeriod));
+
+				float jitter[NoiseTable::kLanes];
+				table.sample(_jitterPhase, jitter);
+				const float jitterScale = handheld.intensity * handheld.jitterIntensity;
+				const float driftScale = handheld.intensity * handheld.driftIntensity;
+				if (handheld.positionEnabled)
+				{
+					table.sample(_positionPhase, lanes);
+					const float drift = driftScale * kPositionDrift;
+					const float fine = jitterScale * kPositionJitter;
+					float breathingLanes[NoiseTable::kLanes];
+					table.sample(_breathingPhase, breathingLanes);
+					const float breathing = handheld.intensity * handheld.breathingIntensity * kBreathingLift * breathingLanes[NoiseTable::kBreathingLane];
+					_positionOffset = { lanes[0] * drift + jitter[0] * fine, lanes[1] * drift + jitter[1] * fine + breathing, lanes[2] * drift + jitter[2] * fine };
+				}
+				if (handheld.rotationEnabled)
+				{
+					table.sample(_rotationPhase, lanes);
+					const float drift = driftScale * kRotationDrift;
+					const float fine = jitterScale * kRotationJitter;
+					_rotationOffset = { lanes[3] * drift + jitter[3] * fine, lanes[4] * drift + jitter[4] * fine, lanes[5] * drift + jitter[5] * fine };
+				}
+			}
+			if (shake.enabled && shake.amplitude > 0.0f)
+			{
+				_shakePhase = NoiseTable::wrap(_shakePhase + dt * shake.frequency);
+				table.sample(_shakePhase, lanes);
+				_rotationOffset.x += lanes[3] * shake.amplitude;
+				_rotationOffset.y += lanes[4] * shake.amplitude;
+				_rotationOffset.z += lanes[5] * shake.amplitude * 0.5f;
+			}
+		}
+
+		[[nodiscard]] const Vec3& positionOffset() const noexcept { return _positionOffset; }
+		[[nodiscard]] const Vec3& rotationOffset() const noexcept { return _rotationOffset; }
+
+	private:
+		static constexpr float kJitterRate = 6.0f;			// noise units per second
+		static constexpr float kPositionDrift = 0.02f;		// metres
+		static constexpr float kPositionJitter = 0.002f;
+		static constexpr float kRotationDrift = 0.01f;		// radians
+		static constexpr float kRotationJitter = 0.001f;
+		static constexpr float kBreathingLift = 0.005f;		// metres
+
+		const NoiseTable* _table = nullptr;
+		float _positionPhase = 0.0f;
+		float _rotationPhase = 17.0f;
+		float _jitterPhase = 33.0f;
+		float _breathingPhase = 0.0f;
+		float _shakePhase = 49.0f;
+		Vec3 _positionOffset{};
+		Vec3 _rotationOffset{};
+	};
+}
@@ -0,0 +1,237 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Mouse and keyboard state built from raw input, written by the thread pumping the window's messages and read by the render
+// thread. Raw input records are decoded into a Batch (plain locals, no atomics), which is committed with one atomic add per
+// axis and one OR per state word, however many records the batch holds. Mouse movement accumulates till the reader takes it,
+// so nothing is lost when several reports arrive between two frames. Keys and mouse buttons are kept as bits: down, and went
+// down since the reader last reset the transitions. Fed by Input::handleMessage, see there.
+namespace IGCS
+{
+	class RawInputAccumulator
+	{
+	public:
+		// RAWMOUSE usButtonFlags bits (RI_MOUSE_*) and usFlags, RAWKEYBOARD Flags (RI_KEY_BREAK).
+		static constexpr uint16_t kMouseMoveRelative = 0x0000;		// MOUSE_MOVE_RELATIVE
+		static constexpr uint16_t kMouseMoveAbsolute = 0x0001;		// MOUSE_MOVE_ABSOLUTE
+		static constexpr uint16_t kLeftButtonDown = 0x0001;
+		static constexpr uint16_t kLeftButtonUp = 0x0002;
+		static constexpr uint16_t kRightButtonDown = 0x0004;
+		static constexpr uint16_t kRightButtonUp = 0x0008;
+		static constexpr uint16_t kMiddleButtonDown = 0x0010;
+		static constexpr uint16_t kMiddleButtonUp = 0x0020;
+		static constexpr uint16_t kWheel = 0x0400;
+		static constexpr uint16_t kKeyBreak = 0x0001;
+		static constexpr int32_t kWheelDelta = 120;					// WHEEL_DELTA
+		static constexpr uint32_t kMouseButtons = 3;
+		static constexpr uint32_t kKeys = 256;
+
+		struct MouseDelta
+		{
+			int64_t x = 0;
+			int64_t y = 0;
+			int32_t wheel = 0;		// in notches
+		};
+
+		// Records decoded from one drain of the raw input queue. Lives on the stack of the message thread.
+		class Batch
+		{
+		public:
+			// One RAWMOUSE record. Absolute movement (tablets, remote desktop) isn't a delta and is ignored, as before.
+			void mouse(uint16_t flags, uint16_t buttonFlags, uint16_t buttonData, int32_t lastX, int32_t lastY) noexcept
+			{
+				if (0 == (flags & kMouseMoveAbsolute))
+				{
+					_delta.x += lastX;
+					_delta.y += lastY;
+				}
+				if (buttonFlags & kWheel)
+				{
+					_wheelUnits += static_cast<int16_t>(buttonData);
+				}
+				button(0, buttonFlags, kLeftButtonDown, kLeftButtonUp);
+				button(1, buttonFlags, kRightButtonDown, kRightButtonUp);
+				button(2, buttonFlags, kMiddleButtonDown, kMiddleButtonUp);
+				++_records;
+			}
+
+			// One key transition, from a RAWKEYBOARD record or a key message.
+			void key(uint32_t virtualKey, bool released) noexcept
+			{
+				if (virtualKey >= kKeys)
+				{
+					return;
+				}
+				const uint64_t bit = uint64_t(1) << (virtualKey & 63);
+				uint64_t& down = _keysDown[virtualKey >> 6];
+				uint64_t& up = _keysUp[virtualKey >> 6];
+				if (released)
+				{
+					up |= bit;
+					down &= ~bit;
+				}
+				else
+				{
+					down |= bit;
+					_keysPressed[virtualKey >> 6] |= bit;
+					up &= ~bit;
+				}
+				++_records;
+			}
+
+			[[nodiscard]] uint32_t records() const noexcept { return _records; }
+
+		private:
+			friend class RawInputAccumulator;
+
+			void button(uint32_t index, uint16_t buttonFlags, uint16_t downFlag, uint16_t upFlag) noexcept
+			{
+				const uint8_t bit = static_cast<uint8_t>(1u << index);
+				if (buttonFlags & downFlag)
+				{
+					_buttonsDown |= bit;
+					_buttonsPressed |= bit;
+					_buttonsUp &= static_cast<uint8_t>(~bit);
+				}
+				if (buttonFlags & upFlag)
+				{
+					_buttonsUp |= bit;
+					_buttonsDown &= static_cast<uint8_t>(~bit);
+				}
+			}
+
+			MouseDelta _delta;
+			int32_t _wheelUnits = 0;
+			// the last transition per key/button in the batch wins: set in down or in up, never in both
+			uint64_t _keysDown[4] = {};
+			uint64_t _keysUp[4] = {};
+			uint64_t _keysPressed[4] = {};
+			uint8_t _buttonsDown = 0;
+			uint8_t _buttonsUp = 0;
+			uint8_t _buttonsPressed = 0;
+			uint32_t _records = 0;
+		};
+
+		// Publishes a batch. Message thread.
+		void commit(const Batch& batch) noexcept
+		{
+			if (0 != batch._delta.x)
+			{
+				_deltaX.fetch_add(batch._delta.x, std::memory_order_relaxed);
+			}
+			if (0 != batch._delta.y)
+			{
+				_deltaY.fetch_add(batch._delta.y, std::memory_order_relaxed);
+			}
+			if (0 != batch._wheelUnits)
+			{
+				_wheelUnits.fetch_add(batch._wheelUnits, std::memory_order_relaxed);
+			}
+			for (uint32_t word = 0; word < 4; ++word)
+			{
+				// only the message thread writes the down bits, the reader only clears pressed bits
+				if (batch._keysDown[word] | batch._keysUp[word])
+				{
+					const uint64_t down = _keysDown[word].load(std::memory_order_relaxed);
+					_keysDown[word].store((down & ~batch._keysUp[word]) | batch._keysDown[word], std::memory_order_release);
+				}
+				if (batch._keysPressed[word])
+				{
+					_keysPressed[word].fetch_or(batch._keysPressed[word], std::memory_order_release);
+				}
+			}
+			if (batch._buttonsDown | batch._buttonsUp)
+			{
+				const uint8_t down = _buttonsDown.load(std::memory_order_relaxed);
+				_buttonsDown.store(static_cast<uint8_t>((down & ~batch._buttonsUp) | batch._buttonsDown), std::memory_order_release);
+			}
+			if (batch._buttonsPressed)
+			{
+				_buttonsPressed.fetch_or(batch._buttonsPressed, std::memory_order_release);
+			}
+		}
+
+		// Movement and wheel notches since the last take. Reader, once per frame.
+		MouseDelta takeMouseDelta() noexcept
+		{
+			MouseDelta delta;
+			delta.x = _deltaX.exchange(0, std::memory_order_relaxed);
+			delta.y = _deltaY.exchange(0, std::memory_order_relaxed);
+			// whole notches only, the remainder (high resolution wheels) stays for the next take
+			const int32_t units = _wheelUnits.load(std::memory_order_relaxed);
+			delta.wheel = units / kWheelDelta;
+			if (0 != delta.wheel)
+			{
+				_wheelUnits.fetch_sub(delta.wheel * kWheelDelta, std::memory_order_relaxed);
+			}
+			return delta;
+		}
+
+		// Without taking.
+		[[nodiscard]] MouseDelta peekMouseDelta() const noexcept
+		{
+			MouseDelta delta;
+			delta.x = _deltaX.load(std::memory_order_relaxed);
+			delta.y = _deltaY.load(std::memory_order_relaxed);
+			delta.wheel = _wheelUnits.load(std::memory_order_relaxed) / kWheelDelta;
+			return delta;
+		}
+
+		void resetMouseDelta() noexcept
+		{
+			_deltaX.store(0, std::memory_order_relaxed);
+			_deltaY.store(0, std::memory_order_relaxed);
+			_wheelUnits.store(0, std::memory_order_relaxed);
+		}
+
+		void resetWheel() noexcept
+		{
+			_wheelUnits.store(0, std::memory_order_relaxed);
+		}
+
+		[[nodiscard]] bool isKeyDown(uint32_t virtualKey) const noexcept
+		{
+			return virtualKey < kKeys && 0 != (_keysDown[virtualKey >> 6].load(std::memory_order_acquire) & (uint64_t(1) << (virtualKey & 63)));
+		}
+
+		// Went down since the last resetKeyTransitions, even if it's up again.
+		[[nodiscard]] bool wasKeyPressed(uint32_t virtualKey) const noexcept
+		{
+			return virtualKey < kKeys && 0 != (_keysPressed[virtualKey >> 6].load(std::memory_order_acquire) & (uint64_t(1) << (virtualKey & 63)));
+		}
+
+		[[nodiscard]] bool isMouseButtonDown(uint32_t button) const noexcept
+		{
+			return button < kMouseButtons && 0 != (_buttonsDown.load(std::memory_order_acquire) & (1u << button));
+		}
+
+		[[nodiscard]] bool wasMouseButtonPressed(uint32_t button) const noexcept
+		{
+			return button < kMouseButtons && 0 != (_buttonsPressed.load(std::memory_order_acquire) & (1u << button));
+		}
+
+		// Reader, once per frame.
+		void resetKeyTransitions() noexcept
+		{
+			for (std::atomic<uint64_t>& word : _keysPressed)
+			{
+				word.store(0, std::memory_order_relaxed);
+			}
+		}
+
+		void resetMouseButtonTransitions() noexcept
+		{
+			_buttonsPressed.store(0, std::memory_order_relaxed);
+		}
+
+	private:
+		std::atomic<int64_t> _deltaX{ 0 };
+		std::atomic<int64_t> _deltaY{ 0 };
+		std::atomic<int32_t> _wheelUnits{ 0 };
+		std::atomic<uint64_t> _keysDown[4] = {};
+		std::atomic<uint64_t> _keysPressed[4] = {};
+		std::atomic<uint8_t> _buttonsDown{ 0 };
+		std::atomic<uint8_t> _buttonsPressed{ 0 };
+	};
+}
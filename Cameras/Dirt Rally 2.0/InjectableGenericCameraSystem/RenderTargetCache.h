@@ -0,0 +1,136 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Remembers for each render target view bound by the game whether it renders to the swap chain's backbuffer, so
+// hookedOMSetRenderTargets doesn't have to ask D3D (GetResource + QueryInterface) on every bind. The views are kept in a
+// small open addressing table keyed by their pointer. A view in the table is kept alive with a reference, so its address
+// can't be reused by another view while it's cached. Only the backbuffer views stay cached across frames: endFrame, called
+// at Present, drops the others, so the game's own render targets are never held past the frame they were bound in and are
+// freed when the game releases them. The table has to be invalidated when the backbuffer changes (ResizeBuffers, new swap
+// chain), which also drops the references to the backbuffer views. The owner invalidates the cache before the device goes
+// away, it doesn't release anything on destruction.
+namespace IGCS
+{
+	// Access to the views the cache classifies. Implemented with D3D11 in D3DHook, with fake views elsewhere.
+	class IRenderTargetViews
+	{
+	public:
+		virtual ~IRenderTargetViews() = default;
+
+		// The expensive check: does view render to the current backbuffer.
+		virtual bool isBackBuffer(void* view) noexcept = 0;
+		virtual void addRef(void* view) noexcept = 0;
+		virtual void release(void* view) noexcept = 0;
+	};
+
+	class RenderTargetCache
+	{
+	public:
+		// power of two. A game binds a few dozen different views, when the table gets too full it starts over.
+		static constexpr size_t kCapacity = 128;
+		static constexpr size_t kMaxEntries = kCapacity / 2;
+
+		explicit RenderTargetCache(IRenderTargetViews& views) noexcept : _views(views)
+		{
+		}
+
+		RenderTargetCache(const RenderTargetCache&) = delete;
+		RenderTargetCache& operator=(const RenderTargetCache&) = delete;
+
+		bool isBackBuffer(void* view) noexcept
+		{
+			if (nullptr == view)
+			{
+				return false;
+			}
+			size_t index = slotOf(view);
+			while (nullptr != _slots[index].view)
+			{
+				if (_slots[index].view == view)
+				{
+					return _slots[index].isBackBuffer;
+				}
+				index = (index + 1) & (kCapacity - 1);
+			}
+
+			const bool isBackBuffer = _views.isBackBuffer(view);
+			if (_count >= kMaxEntries)
+			{
+				invalidate();
+				index = slotOf(view);
+			}
+			_views.addRef(view);
+			_slots[index].view = view;
+			_slots[index].isBackBuffer = isBackBuffer;
+			++_count;
+			return isBackBuffer;
+		}
+
+		// Drops the views which don't render to the backbuffer and releases them, the backbuffer views stay.
+		void endFrame() noexcept
+		{
+			Slot kept[kMaxEntries];
+			size_t keptCount = 0;
+			for (Slot& slot : _slots)
+			{
+				if (nullptr != slot.view)
+				{
+					if (slot.isBackBuffer)
+					{
+						kept[keptCount++] = slot;
+					}
+					else
+					{
+						_views.release(slot.view);
+					}
+					slot = Slot();
+				}
+			}
+			// the kept views are put back, probing runs over the slots which were emptied
+			for (size_t i = 0; i < keptCount; ++i)
+			{
+				size_t index = slotOf(kept[i].view);
+				while (nullptr != _slots[index].view)
+				{
+					index = (index + 1) & (kCapacity - 1);
+				}
+				_slots[index] = kept[i];
+			}
+			_count = keptCount;
+		}
+
+		void invalidate() noexcept
+		{
+			for (Slot& slot : _slots)
+			{
+				if (nullptr != slot.view)
+				{
+					_views.release(slot.view);
+					slot = Slot();
+				}
+			}
+			_count = 0;
+		}
+
+		[[nodiscard]] size_t size() const noexcept { return _count; }
+
+	private:
+		struct Slot
+		{
+			void* view = nullptr;
+			bool isBackBuffer = false;
+		};
+
+		static size_t slotOf(const void* view) noexcept
+		{
+			// objects are 16 byte aligned, Fibonacci hashing spreads the remaining bits
+			const uint64_t key = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(view)) >> 4;
+			return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 57) & (kCapacity - 1);
+		}
+
+		IRenderTargetViews& _views;
+		Slot _slots[kCapacity];
+		size_t _count = 0;
+	};
+}
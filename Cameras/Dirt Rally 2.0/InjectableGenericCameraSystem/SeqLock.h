@@ -0,0 +1,89 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// One value written by one thread and read by any number of threads or processes, without locks, syscalls or waiting on the
+// writer's side. The writer makes the sequence odd, stores the value and makes the sequence even again; a reader copies the
+// value between two loads of the sequence and keeps the copy only if both saw the same even number, else it copies again. The
+// value is stored as 32-bit atomic words so a copy racing with a store is well defined, and nothing is ever written by a reader,
+// so it works on memory mapped read only. Lives in shared memory as is: no pointers, no constructor needed (zeroed is empty).
+namespace IGCS
+{
+	enum class SeqLockReadResult : uint8_t
+	{
+		Ok,
+		Empty,		// nothing stored yet
+		Busy,		// the writer kept storing during every attempt, try again later
+	};
+
+	template<typename T>
+	class SeqLock
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "T is copied word by word");
+		static_assert(sizeof(T) % sizeof(uint32_t) == 0, "T must be a whole number of 32-bit words");
+		// 32 bits, so even a 32-bit reader loads it without a locked instruction, which would fault on a read only mapping
+		static_assert(std::atomic<uint32_t>::is_always_lock_free, "the words must be plain loads and stores");
+
+	public:
+		static constexpr size_t kWords = sizeof(T) / sizeof(uint32_t);
+		static constexpr int kDefaultReadAttempts = 64;
+
+		// The writer, one thread only.
+		void store(const T& value) noexcept
+		{
+			uint32_t words[kWords];
+			std::memcpy(words, &value, sizeof(T));
+			// already odd if an earlier writer stopped halfway, e.g. the game crashed: readers wait for this store
+			const uint32_t sequence = _sequence.load(std::memory_order_relaxed) | 1u;
+			_sequence.store(sequence, std::memory_order_relaxed);
+			// the odd sequence is visible before any word changes
+			std::atomic_thread_fence(std::memory_order_release);
+			for (size_t i = 0; i < kWords; ++i)
+			{
+				_words[i].store(words[i], std::memory_order_relaxed);
+			}
+			// 0 means empty, skip it when wrapping around
+			_sequence.store(0 == sequence + 1 ? 2 : sequence + 1, std::memory_order_release);
+		}
+
+		// Any thread or process. Copies the last value stored into value, untouched unless Ok.
+		SeqLockReadResult load(T& value, int attempts = kDefaultReadAttempts) const noexcept
+		{
+			uint32_t words[kWords];
+			for (int attempt = 0; attempt < attempts; ++attempt)
+			{
+				const uint32_t before = _sequence.load(std::memory_order_acquire);
+				if (0 == before)
+				{
+					return SeqLockReadResult::Empty;
+				}
+				if (0 != (before & 1u))
+				{
+					continue;
+				}
+				for (size_t i = 0; i < kWords; ++i)
+				{
+					words[i] = _words[i].load(std::memory_order_relaxed);
+				}
+				// the words are read before the sequence is checked again
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (_sequence.load(std::memory_order_relaxed) == before)
+				{
+					std::memcpy(&value, words, sizeof(T));
+					return SeqLockReadResult::Ok;
+				}
+			}
+			return SeqLockReadResult::Busy;
+		}
+
+		// Odd while a store is in progress, 0 if nothing was stored. Goes up by 2 per store.
+		[[nodiscard]] uint32_t sequence() const noexcept { return _sequence.load(std::memory_order_acquire); }
+
+	private:
+		std::atomic<uint32_t> _sequence{ 0 };
+		std::atomic<uint32_t> _words[kWords] = {};
+	};
+}
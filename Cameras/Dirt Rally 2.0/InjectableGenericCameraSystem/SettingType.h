@@ -0,0 +1,82 @@
+#pragma once
+#include <cstdint>
+
+namespace IGCS
+{
+	// IDs of the settings the client sends in MessageType::Setting messages, see SettingsRegistry.
+	enum class SettingType : uint8_t
+	{
+		FastMovementMultiplier = 0,
+		SlowMovementMultiplier = 1,
+		UpMovementMultiplier = 2,
+		MovementSpeed = 3,
+		CameraControlDevice = 4,
+		RotationSpeed = 5,
+		InvertYLookDirection = 6,
+		FoVZoomSpeed = 7,
+		gameSpeed = 8,
+		MovementSmoothness = 9,
+		RotationSmoothness = 10,
+		FOVSmoothness = 11,
+		PathDuration = 12,
+		PathEasingValue = 13,
+		PathSampleCount = 14,
+		PathToggleInterpolationMode = 15,
+		PathEasingType = 16,
+		EulerOrder = 17,
+		UniformParam = 18,
+		RotationMode = 19,
+		DeltaType = 20,
+		DeltaValue = 21,
+		CameraShakeToggle = 22,
+		Amplitude = 23,
+		Frequency = 24,
+		HandheldCameraToggle = 25,
+		HandheldIntensity = 26,
+		HandheldDriftIntensity = 27,
+		HandheldJitterIntensity = 28,
+		HandheldBreathingIntensity = 29,
+		HandheldBreatingRate = 30,
+		HandheldRotationToggle = 31,
+		HandheldPositionToggle = 32,
+		PlayerRelativeToggle = 33,
+		PlayerRelativeSmoothness = 34,
+		WaitBeforePlaying = 35,
+		UnpauseOnPlay = 36,
+		HandheldDriftSpeed = 37,
+		HandheldRotationDriftSpeed = 38,
+		VisualisationToggle = 39,
+		VisualiseAllPaths = 40,
+		ScrubbingProgress = 41,
+		D3DDisabled = 42,
+		LookAtPlayer = 43,
+		PathLookAtEnabled = 44,
+		PathLookAtOffsetX = 45,
+		PathLookAtOffsetY = 46,
+		PathLookAtOffsetZ = 47,
+		PathLookAtSmoothness = 48,
+		PathSpeedMatchingEnabled = 49,
+		PathSpeedScale = 50,
+		PathSpeedSmoothness = 51,
+		PathMinSpeed = 52,
+		PathMaxSpeed = 53,
+		PathBaselineSpeed = 54,
+		CameraShakeToggleB = 55,
+		AmplitudeB = 56,
+		FrequencyB = 57,
+		HandheldCameraToggleB = 58,
+		HandheldIntensityB = 59,
+		HandheldDriftIntensityB = 60,
+		HandheldJitterIntensityB = 61,
+		HandheldBreathingIntensityB = 62,
+		HandheldBreatingRateB = 63,
+		HandheldRotationToggleB = 64,
+		HandheldPositionToggleB = 65,
+		HandheldDriftSpeedB = 66,
+		HandheldRotationDriftSpeedB = 67,
+		DOFToggle = 68,
+		MotionBlurStrength = 69,
+	};
+
+	constexpr uint32_t kSettingTypeCount = static_cast<uint32_t>(SettingType::MotionBlurStrength) + 1;
+}
@@ -0,0 +1,315 @@
+#pragma once
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include "SettingType.h"
+
+// The settings the client sends over the pipe (MessageType::Setting), one typed slot per SettingType with its valid range.
+// Messages are decoded and validated on the thread reading the pipe and staged: the latest value per setting plus a dirty bit,
+// both atomics, so staging never blocks and a slider sending a value per mouse move only costs a store. The render thread applies
+// everything staged at the start of a frame in one go and only reads the applied values, so the camera never sees a value change
+// halfway through a frame.
+//
+// Message layout: [0] MessageType::Setting, [1] SettingType, [2..] the value. Bools are one byte (0 or 1), ints an int32 and floats
+// a float, both little endian.
+namespace IGCS
+{
+	enum class SettingKind : uint8_t
+	{
+		Bool,
+		Int,
+		Float,
+	};
+
+	struct SettingInfo
+	{
+		SettingType id;
+		const char* name;
+		SettingKind kind;
+		float minValue;
+		float maxValue;
+		float defaultValue;
+	};
+
+	enum class SettingDecodeResult : uint8_t
+	{
+		Ok,
+		UnknownSetting,
+		BadLength,
+		OutOfRange,
+	};
+
+	// A decoded, validated setting value. bits is 0 or 1 for bools, the int32 or the float's bits otherwise.
+	struct SettingUpdate
+	{
+		SettingType id = SettingType::FastMovementMultiplier;
+		uint32_t bits = 0;
+	};
+
+	// Set of SettingTypes.
+	class SettingMask
+	{
+	public:
+		void set(SettingType id) noexcept { _bits[index(id) >> 6] |= bit(index(id)); }
+		[[nodiscard]] bool test(SettingType id) const noexcept { return 0 != (_bits[index(id) >> 6] & bit(index(id))); }
+		[[nodiscard]] bool any() const noexcept { return 0 != (_bits[0] | _bits[1]); }
+
+	private:
+		friend class SettingsRegistry;
+		static constexpr uint32_t index(SettingType id) noexcept { return static_cast<uint32_t>(id); }
+		static constexpr uint64_t bit(uint32_t index) noexcept { return uint64_t(1) << (index & 63); }
+
+		uint64_t _bits[2] = {};
+	};
+
+	class SettingsRegistry
+	{
+	public:
+		static constexpr SettingInfo kSettings[] = {
+			{ SettingType::FastMovementMultiplier, "FastMovementMultiplier", SettingKind::Float, 1.0f, 100.0f, 10.0f },
+			{ SettingType::SlowMovementMultiplier, "SlowMovementMultiplier", SettingKind::Float, 0.001f, 1.0f, 0.1f },
+			{ SettingType::UpMovementMultiplier, "UpMovementMultiplier", SettingKind::Float, 0.1f, 10.0f, 1.0f },
+			{ SettingType::MovementSpeed, "MovementSpeed", SettingKind::Float, 0.001f, 10.0f, 0.1f },
+			{ SettingType::CameraControlDevice, "CameraControlDevice", SettingKind::Int, 0.0f, 2.0f, 2.0f },		// DEVICE_ID_*
+			{ SettingType::RotationSpeed, "RotationSpeed", SettingKind::Float, 0.001f, 10.0f, 0.05f },
+			{ SettingType::InvertYLookDirection, "InvertYLookDirection", SettingKind::Bool, 0.0f, 1.0f, 0.0f },
+			{ SettingType::FoVZoomSpeed, "FoVZoomSpeed", SettingKind::Float, 0.001f, 10.0f, 0.1f },
+			{ SettingType::gameSpeed, "gameSpeed", SettingKind::Float, 0.01f, 10.0f, 1.0f },
+			{ SettingType::MovementSmoothness, "MovementSmoothness", SettingKind::Float, 0.0f, 1.0f, 0.5f },
+			{ SettingType::RotationSmoothness, "RotationSmoothness", SettingKind::Float, 0.0f, 1.0f, 0.5f },
+			{ SettingType::FOVSmoothness, "FOVSmoothness", SettingKind::Float, 0.0f, 1.0f, 0.5f },
+			{ SettingType::PathDuration, "PathDuration", SettingKind::Float, 0.1f, 3600.0f, 10.0f },
+			{ SettingType::PathEasingValue, "PathEasingValue", SettingKind::Float, 0.0f, 10.0f, 1.0f },
+			{ SettingType::PathSampleCount, "PathSampleCount", SettingKind::Int, 2.0f, 4096.0f, 256.0f },
+			{ SettingType::PathToggleInterpolationMode, "PathToggleInterpolationMode", SettingKind::Int, 0.0f, 15.0f, 0.0f },
+			{ SettingType::PathEasingType, "PathEasingType", SettingKind::Int, 0.0f, 15.0f, 0.0f },
+			{ SettingType::EulerOrder, "EulerOrder", SettingKind::Int, 0.0f, 5.0f, 0.0f },
+			{ SettingType::UniformParam, "UniformParam", SettingKind::Bool, 0.0f, 1.0f, 0.0f },
+			{ SettingType::RotationMode, "RotationMode", SettingKind::Int, 0.0f, 15.0f, 0.0f },
+			{ SettingType::DeltaType, "DeltaType", SettingKind::Int, 0.0f, 15.0f, 0.0f },
+			{ SettingType::DeltaValue, "DeltaValue", SettingKind::Float, 0.0f, 1000.0f, 1.0f },
+			{ SettingType::CameraShakeToggle, "CameraShakeToggle", SettingKind::Bool, 0.0f, 1.0f, 0.0f },
+			{ SettingType::Amplitude, "Amplitude", SettingKind::Float, 0.0f, 0.05f, 0.0f },		// radians, as shake_amplitude
+			{ SettingType::Frequency, "Frequency", SettingKind::Float, 0.1f, 30.0f, 2.0f },		// Hz, as shake_frequency
+			{ SettingType::HandheldCameraToggle, "HandheldCameraToggle", SettingKind::Bool, 0.0f, 1.0f, 0.0f },
+			{ SettingType::HandheldIntensity, "HandheldIntensity", SettingKind::Float, 0.0f, 5.0f, 1.0f },
+			{ SettingType::HandheldDriftIntensity, "HandheldDriftIntensity", SettingKind::Float, 0.0f, 5.0f, 1.0f },
+			{ SettingType::HandheldJitterIntensity, "HandheldJitterIntensity", SettingKind::Float, 0.0f, 5.0f, 1.0f },
+			{ SettingType::HandheldBreathingIntensity, "HandheldBreathingIntensity", SettingKind::Float, 0.0f, 5.0f, 0.0f },
+			{ SettingType::HandheldBreatingRate, "HandheldBreatingRate", SettingKind::Float, 0.0f, 5.0f, 0.0f },
+			{ SettingType::HandheldRotationToggle, "HandheldRotationToggle", SettingKind::Bool, 0.0f, 1.0f, 1.0f },
+			{ SettingType::HandheldPositionToggle, "HandheldPositionToggle", SettingKind::Bool, 0.0f, 1.0f, 1.0f },
+			{ SettingType::PlayerRelativeToggle, "PlayerRelativeToggle", SettingKind::Bool, 0.0f, 1.0f, 0.0f },
+			{ SettingType::PlayerRelativeSmoothness, "PlayerRelativeSmoothness", SettingKind::Float, 0.0f, 1.0f, 0.5f },
+			{ SettingType::WaitBeforePlaying, "WaitBeforePlaying", SettingKind::Bool, 0.0f, 1.0f, 0.0f },
+			{ SettingType::UnpauseOnPlay, "UnpauseOnPlay", SettingKind::Bool, 0.0f, 1.0f, 0.0f },
+			{ SettingType::HandheldDriftSpeed, "HandheldDriftSpeed", SettingKind::Float, 0.0f, 1.0f, 0.05f },
+			{ SettingType::HandheldRotationDriftSpeed, "HandheldRotationDriftSpeed", SettingKind::Float, 0.0f, 1.0f, 0.03f },
+			{ SettingType::VisualisationToggle, "VisualisationToggle", SettingKind::Bool, 0.0f, 1.0f, 0.0f },
+			{ SettingType::VisualiseAllPaths, "VisualiseAllPaths", SettingKind::Bool, 0.0f, 1.0f, 0.0f },
+			{ SettingType::ScrubbingProgress, "ScrubbingProgress", SettingKind::Float, 0.0f, 1.0f, 0.0f },
+			{ SettingType::D3DDisabled, "D3DDisabled", SettingKind::Bool, 0.0f, 1.0f, 0.0f },
+			{ SettingType::LookAtPlayer, "LookAtPlayer", SettingKind::Bool, 0.0f, 1.0f, 0.0f },
+			{ SettingType::PathLookAtEnabled, "PathLookAtEnabled", SettingKind::Bool, 0.0f, 1.0f, 0.0f },
+			{ SettingType::PathLookAtOffsetX, "PathLookAtOffsetX", SettingKind::Float, -100.0f, 100.0f, 0.0f },
+			{ SettingType::PathLookAtOffsetY, "PathLookAtOffsetY", SettingKind::Float, -100.0f, 100.0f, 0.0f },
+			{ SettingType::PathLookAtOffsetZ, "PathLookAtOffsetZ", SettingKind::Float, -100.0f, 100.0f, 0.0f },
+			{ SettingType::PathLookAtSmoothness, "PathLookAtSmoothness", SettingKind::Float, 0.0f, 1.0f, 0.5f },
+			{ SettingType::PathSpeedMatchingEnabled, "PathSpeedMatchingEnabled", SettingKind::Bool, 0.0f, 1.0f, 0.0f },
+			{ SettingType::PathSpeedScale, "PathSpeedScale", SettingKind::Float, 0.01f, 10.0f, 1.0f },
+			{ SettingType::PathSpeedSmoothness, "PathSpeedSmoothness", SettingKind::Float, 0.0f, 1.0f, 0.5f },
+			{ SettingType::PathMinSpeed, "PathMinSpeed", SettingKind::Float, 0.0f, 1000.0f, 0.0f },
+			{ SettingType::PathMaxSpeed, "PathMaxSpeed", SettingKind::Float, 0.0f, 1000.0f, 100.0f },
+			{ SettingType::PathBaselineSpeed, "PathBaselineSpeed", SettingKind::Float, 0.0f, 1000.0f, 10.0f },
+			{ SettingType::CameraShakeToggleB, "CameraShakeToggleB", SettingKind::Bool, 0.0f, 1.0f, 0.0f },
+			{ SettingType::AmplitudeB, "AmplitudeB", SettingKind::Float, 0.0f, 0.05f, 0.0f },
+			{ SettingType::FrequencyB, "FrequencyB", SettingKind::Float, 0.1f, 30.0f, 2.0f },
+			{ SettingType::HandheldCameraToggleB, "HandheldCameraToggleB", SettingKind::Bool, 0.0f, 1.0f, 0.0f },
+			{ SettingType::HandheldIntensityB, "HandheldIntensityB", SettingKind::Float, 0.0f, 5.0f, 1.0f },
+			{ SettingType::HandheldDriftIntensityB, "HandheldDriftIntensityB", SettingKind::Float, 0.0f, 5.0f, 1.0f },
+			{ SettingType::HandheldJitterIntensityB, "HandheldJitterIntensityB", SettingKind::Float, 0.0f, 5.0f, 1.0f },
+			{ SettingType::HandheldBreathingIntensityB, "HandheldBreathingIntensityB", SettingKind::Float, 0.0f, 5.0f, 0.0f },
+			{ SettingType::HandheldBreatingRateB, "HandheldBreatingRateB", SettingKind::Float, 0.0f, 5.0f, 0.0f },
+			{ SettingType::HandheldRotationToggleB, "HandheldRotationToggleB", SettingKind::Bool, 0.0f, 1.0f, 1.0f },
+			{ SettingType::HandheldPositionToggleB, "HandheldPositionToggleB", SettingKind::Bool, 0.0f, 1.0f, 1.0f },
+			{ SettingType::HandheldDriftSpeedB, "HandheldDriftSpeedB", SettingKind::Float, 0.0f, 1.0f, 0.05f },
+			{ SettingType::HandheldRotationDriftSpeedB, "HandheldRotationDriftSpeedB", SettingKind::Float, 0.0f, 1.0f, 0.03f },
+			{ SettingType::DOFToggle, "DOFToggle", SettingKind::Bool, 0.0f, 1.0f, 0.0f },
+			{ SettingType::MotionBlurStrength, "MotionBlurStrength", SettingKind::Float, 0.0f, 1.0f, 0.0f },
+		};
+
+		SettingsRegistry() noexcept
+		{
+			for (const SettingInfo& setting : kSettings)
+			{
+				const uint32_t bits = defaultBits(setting);
+				_values[index(setting.id)] = bits;
+				_staged[index(setting.id)].store(bits, std::memory_order_relaxed);
+			}
+		}
+		SettingsRegistry(const SettingsRegistry&) = delete;
+		SettingsRegistry& operator=(const SettingsRegistry&) = delete;
+
+		[[nodiscard]] static const SettingInfo* info(uint32_t id) noexcept
+		{
+			return id < kSettingTypeCount ? &kSettings[id] : nullptr;
+		}
+
+		[[nodiscard]] static const SettingInfo& info(SettingType id) noexcept
+		{
+			return kSettings[index(id)];
+		}
+
+		// Decodes and validates a setting message. update is only written if the result is Ok.
+		static SettingDecodeResult decode(const uint8_t* payload, size_t length, SettingUpdate& update) noexcept
+		{
+			if (length < 2)
+			{
+				return SettingDecodeResult::BadLength;
+			}
+			const SettingInfo* setting = info(payload[1]);
+			if (nullptr == setting)
+			{
+				return SettingDecodeResult::UnknownSetting;
+			}
+			uint32_t bits = 0;
+			switch (setting->kind)
+			{
+			case SettingKind::Bool:
+				if (length != 3)
+				{
+					return SettingDecodeResult::BadLength;
+				}
+				if (payload[2] > 1)
+				{
+					return SettingDecodeResult::OutOfRange;
+				}
+				bits = payload[2];
+				break;
+			case SettingKind::Int:
+			{
+				if (length != 6)
+				{
+					return SettingDecodeResult::BadLength;
+				}
+				bits = readUint32(payload + 2);
+				const int32_t value = static_cast<int32_t>(bits);
+				if (static_cast<float>(value) < setting->minValue || static_cast<float>(value) > setting->maxValue)
+				{
+					return SettingDecodeResult::OutOfRange;
+				}
+				break;
+			}
+			case SettingKind::Float:
+			{
+				if (length != 6)
+				{
+					return SettingDecodeResult::BadLength;
+				}
+				bits = readUint32(payload + 2);
+				float value;
+				std::memcpy(&value, &bits, sizeof(value));
+				// also rejects NaN, which fails both comparisons
+				if (!std::isfinite(value) || !(value >= setting->minValue && value <= setting->maxValue))
+				{
+					return SettingDecodeResult::OutOfRange;
+				}
+				break;
+			}
+			}
+			update.id = setting->id;
+			update.bits = bits;
+			return SettingDecodeResult::Ok;
+		}
+
+		// Stages a decoded value for the next applyStaged. Any thread, never blocks.
+		void stage(const SettingUpdate& update) noexcept
+		{
+			const uint32_t slot = index(update.id);
+			_staged[slot].store(update.bits, std::memory_order_relaxed);
+			_dirty[slot >> 6].fetch_or(SettingMask::bit(slot), std::memory_order_release);
+		}
+
+		// Makes everything staged so far the current values. Returns the settings whose value changed. Render thread, at the
+		// start of a frame.
+		SettingMask applyStaged() noexcept
+		{
+			SettingMask changed;
+			for (uint32_t word = 0; word < 2; ++word)
+			{
+				uint64_t dirty = _dirty[word].exchange(0, std::memory_order_acquire);
+				while (0 != dirty)
+				{
+					const uint32_t slot = word * 64 + static_cast<uint32_t>(std::countr_zero(dirty));
+					dirty &= dirty - 1;
+					const uint32_t bits = _staged[slot].load(std::memory_order_relaxed);
+					if (bits != _values[slot])
+					{
+						_values[slot] = bits;
+						changed._bits[word] |= SettingMask::bit(slot);
+					}
+				}
+			}
+			return changed;
+		}
+
+		// The applied values. Render thread. Reading a setting as another kind than its own gives garbage.
+		[[nodiscard]] bool getBool(SettingType id) const noexcept { return 0 != _values[index(id)]; }
+		[[nodiscard]] int32_t getInt(SettingType id) const noexcept { return static_cast<int32_t>(_values[index(id)]); }
+		[[nodiscard]] float getFloat(SettingType id) const noexcept
+		{
+			float value;
+			std::memcpy(&value, &_values[index(id)], sizeof(value));
+			return value;
+		}
+
+		// kSettings is in SettingType order with the defaults in range, checked at compile time below.
+		static constexpr bool isTableValid() noexcept
+		{
+			if (sizeof(kSettings) / sizeof(kSettings[0]) != kSettingTypeCount)
+			{
+				return false;
+			}
+			for (uint32_t i = 0; i < kSettingTypeCount; ++i)
+			{
+				if (index(kSettings[i].id) != i || kSettings[i].defaultValue < kSettings[i].minValue || kSettings[i].defaultValue > kSettings[i].maxValue)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+	private:
+		static constexpr uint32_t index(SettingType id) noexcept { return static_cast<uint32_t>(id); }
+
+		static uint32_t readUint32(const uint8_t* bytes) noexcept
+		{
+			return static_cast<uint32_t>(bytes[0]) | (static_cast<uint32_t>(bytes[1]) << 8) | (static_cast<uint32_t>(bytes[2]) << 16)
+				| (static_cast<uint32_t>(bytes[3]) << 24);
+		}
+
+		static uint32_t defaultBits(const SettingInfo& setting) noexcept
+		{
+			switch (setting.kind)
+			{
+			case SettingKind::Bool: return setting.defaultValue != 0.0f ? 1u : 0u;
+			case SettingKind::Int: return static_cast<uint32_t>(static_cast<int32_t>(setting.defaultValue));
+			default:
+			{
+				uint32_t bits;
+				std::memcpy(&bits, &setting.defaultValue, sizeof(bits));
+				return bits;
+			}
+			}
+		}
+
+		uint32_t _values[kSettingTypeCount] = {};					// render thread only
+		std::atomic<uint32_t> _staged[kSettingTypeCount] = {};
+		std::atomic<uint64_t> _dirty[2] = {};
+	};
+
+	static_assert(SettingsRegistry::isTableValid(), "SettingsRegistry::kSettings needs one entry per SettingType, in order, with the defaults in range");
+}
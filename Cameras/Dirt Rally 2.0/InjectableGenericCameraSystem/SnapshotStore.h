@@ -0,0 +1,84 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "MonotonicClock.h"
+
+// Holds the current version of an immutable value, e.g. the settings, for readers on any thread. Reading is one acquire load,
+// no lock and no reference count. Publishing swaps the pointer; the previous version is retired, not deleted, and only freed by
+// a later publish once it has been retired for longer than the grace period. Nothing tracks the readers, so this is only safe
+// because of a rule the readers keep: a snapshot is used for one frame or one input sample at most and never kept, take it
+// again next time. A frame or a sample lasts milliseconds, far below the grace period. A reader which holds on to a snapshot
+// across a wait, or a thread suspended for seconds while it holds one, can see it freed. Publishes must be serialized by the
+// caller. The store holds no lock and no dynamically initialized member, so a namespace scope store is constant initialized and
+// can be read during the static initialization of other files.
+namespace IGCS
+{
+	template<typename T>
+	class SnapshotStore
+	{
+	public:
+		// How long a retired version is kept. Not a guarantee by itself: it relies on readers keeping a snapshot for a frame at most.
+		static constexpr int64_t kGracePeriod = 5 * MonotonicClock::kNanosecondsPerSecond;
+
+		constexpr SnapshotStore() noexcept = default;
+		// IMPORTANT: no cleanup in the destructor, it may run under loader lock and threads which are leaked on process exit can
+		// still read the current version. The versions still held are intentionally leaked, like the singletons.
+		~SnapshotStore() = default;
+		SnapshotStore(const SnapshotStore&) = delete;
+		SnapshotStore& operator=(const SnapshotStore&) = delete;
+
+		// nullptr till the first publish. Any thread.
+		[[nodiscard]] const T* get() const noexcept
+		{
+			return _current.load(std::memory_order_acquire);
+		}
+
+		// Makes value the current version. One thread at a time.
+		void publish(std::unique_ptr<const T> value, int64_t now = MonotonicClock::now())
+		{
+			// reserve first, so a failing allocation can't lose the old version after the swap
+			_retired.reserve(_retired.size() + 1);
+			const T* previous = _current.exchange(value.release(), std::memory_order_acq_rel);
+			reclaim(now);
+			if (nullptr != previous)
+			{
+				_retired.push_back(Retired{ previous, now });
+			}
+		}
+
+		// Publishing thread only.
+		[[nodiscard]] size_t retiredCount() const noexcept
+		{
+			return _retired.size();
+		}
+
+	private:
+		struct Retired
+		{
+			const T* value;
+			int64_t retiredAt;
+		};
+
+		void reclaim(int64_t now) noexcept
+		{
+			size_t kept = 0;
+			for (size_t i = 0; i < _retired.size(); ++i)
+			{
+				if (now - _retired[i].retiredAt >= kGracePeriod)
+				{
+					delete _retired[i].value;
+				}
+				else
+				{
+					_retired[kept++] = _retired[i];
+				}
+			}
+			_retired.resize(kept);
+		}
+
+		std::atomic<const T*> _current{ nullptr };
+		std::vector<Retired> _retired;
+	};
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// Bounded queue between exactly one producer thread and one consumer thread. Both sides are wait-free: a push or pop is a
+// fixed number of loads and stores, never a lock or a retry loop. Each side keeps a cached copy of the other side's index so
+// it only touches the other side's cache line when the queue looks full (producer) or empty (consumer).
+namespace IGCS
+{
+	template<typename T, size_t Capacity>
+	class SpscQueue
+	{
+		static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+		static_assert(std::is_trivially_copyable_v<T>, "T is copied in and out of the ring");
+
+	public:
+		static constexpr size_t kCapacity = Capacity;
+
+		SpscQueue() = default;
+		SpscQueue(const SpscQueue&) = delete;
+		SpscQueue& operator=(const SpscQueue&) = delete;
+
+		// Producer thread. Returns false, leaving the queue untouched, if it's full.
+		bool tryPush(const T& value) noexcept
+		{
+			const size_t tail = _tail.load(std::memory_order_relaxed);
+			if (tail - _cachedHead == Capacity)
+			{
+				_cachedHead = _head.load(std::memory_order_acquire);
+				if (tail - _cachedHead == Capacity)
+				{
+					return false;
+				}
+			}
+			_items[tail & (Capacity - 1)] = value;
+			_tail.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Consumer thread. Returns false if it's empty.
+		bool tryPop(T& value) noexcept
+		{
+			const size_t head = _head.load(std::memory_order_relaxed);
+			if (head == _cachedTail)
+			{
+				_cachedTail = _tail.load(std::memory_order_acquire);
+				if (head == _cachedTail)
+				{
+					return false;
+				}
+			}
+			value = _items[head & (Capacity - 1)];
+			_head.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Approximate when the other side is running.
+		[[nodiscard]] size_t size() const noexcept
+		{
+			return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+		}
+
+		[[nodiscard]] bool empty() const noexcept { return 0 == size(); }
+
+	private:
+		static constexpr size_t kCacheLine = 64;
+
+		// consumer side
+		alignas(kCacheLine) std::atomic<size_t> _head{ 0 };
+		size_t _cachedTail = 0;
+		// producer side
+		alignas(kCacheLine) std::atomic<size_t> _tail{ 0 };
+		size_t _cachedHead = 0;
+		alignas(kCacheLine) T _items[Capacity] = {};
+	};
+}
@@ -44,20 +44,66 @@
 #include "Utils.h"
 #include <Xinput.h>
 #include "DirectInputPad.h"
+#include "DeviceWorker.h"
+#include "PadConnectionManager.h"
+#include "InputThread.h"
 #include "Config.h"
+#include "MonotonicClock.h"
+#include "TelemetryChannel.h"
+#include <cstddef>
+
+extern "C" {
+	// read by carPositionInterceptor: when set it calls carStateUpdated after each car update
+	uint8_t g_updateOnCarState = 0;
+}
+
+// Called from carPositionInterceptor when the camera update trigger is car_update, on the game's car update thread
+extern "C" void carStateUpdated()
+{
+	if (!IGCS::Globals::instance().systemActive())
+	{
+		return;
+	}
+	IGCS::System::instance().updateCameraOnCarState(IGCS::D3DHook::instance().frameEpoch());
+}
 
 namespace IGCS
 {
 	using namespace IGCS::GameSpecific;
 	static IGCS::DirectInputPad* s_directInput = nullptr;
 
+	// XInput behind the pad connection manager. Only ever asked for a disconnected slot on the device worker.
+	class XInputPadSource : public IPadStateSource
+	{
+	public:
+		bool getState(uint32_t slot, PadState& state) noexcept override
+		{
+			XINPUT_STATE xinputState;
+			if (XInputGetState(slot, &xinputState) != ERROR_SUCCESS)
+			{
+				return false;
+			}
+			memcpy(&state, &xinputState, sizeof(PadState));
+			return true;
+		}
+	};
+
+	static XInputPadSource s_xinputSource;
+	static PadConnectionManager s_padConnections(s_xinputSource);
+	// wheel discovery and pad probes, off the render thread
+	static DeviceWorker* s_deviceWorker = nullptr;
+	// device reads, off the render thread. The render thread only drains the events.
+	static InputEventChannel s_inputEvents;
+	static InputThread* s_inputThread = nullptr;
+	// the camera and car of every frame, in shared memory for overlays and analysis tools
+	static TelemetryPublisher* s_telemetry = nullptr;
+
 	System::System():
 		_igcscacheData(),
 		_originalData(),
 		_hostImageAddress(nullptr),
 		_hostImageSize(0),
-		_lastFrameTime(),
-		_frequency(),
+		_lastFrameTime(0),
 		_useFixedDeltaTime(false),
 		_fixedDeltaValue(0.0167f)
 	{
@@ -84,9 +130,22 @@ namespace IGCS
 		_useFixedDeltaTime = false;  // Toggle this to use fixed or real delta time
 		_fixedDeltaValue = 1.0f / 120.0f;  // Fixed delta time value at 60 FPS
 
-		// Initialize the high-precision timer only for delta time calculation
-		QueryPerformanceFrequency(&_frequency);
-		QueryPerformanceCounter(&_lastFrameTime);
+		// the messages logged so far are queued, write them and everything from here on
+		MessageHandler::startLogWriter();
+		NamedPipeManager::instance().startListening();
+		// never closed, not even on shutdown: a frame may still be publishing
+		s_telemetry = new TelemetryPublisher(); // intentionally leaked on process exit
+		if (!s_telemetry->open())
+		{
+			MessageHandler::logError("Telemetry: can't create the shared memory %s, overlays get no camera data", Telemetry::kChannelName);
+		}
+		// a restarted dll carries on from the frames the one before published
+		_telemetryFrame = s_telemetry->lastFrame();
+
+		// Switch the shared clock to the TSC if the CPU allows, before anything starts taking timestamps
+		const bool tscClock = MonotonicClock::enableTscFastPath();
+		MessageHandler::logLine("Clock: %s", tscClock ? "invariant TSC" : "system clock");
+		_lastFrameTime = MonotonicClock::now();
 
 		initialize();    // will block till camera is found
 		mainLoop();
@@ -104,6 +163,11 @@ namespace IGCS
 		// Tell the rest of the code to stop doing work
 		Globals::instance().systemActive(false);
 
+		// Stop reading devices before anything else goes away
+		if (s_inputThread) s_inputThread->stop();
+		if (s_deviceWorker) s_deviceWorker->stop();
+		Config::stopWatching();
+
 		// 1) Disable our input hooks first (so the game can tear down input cleanly)
 		try {
 			InputHooker::setXInputHook(false);
@@ -126,6 +190,11 @@ namespace IGCS
 		//    This prevents any dangling detours from calling back into our DLL during host teardown.
 		MH_DisableHook(MH_ALL_HOOKS);
 		MH_Uninitialize();
+
+		NamedPipeManager::instance().stop();
+
+		// last, so everything logged while shutting down is written
+		MessageHandler::stopLogWriter();
 	}
 
 	// Core loop of the system
@@ -144,27 +213,117 @@ namespace IGCS
 	}
 
 
+	void System::updateFrameOnce(const uint64_t frameEpoch)
+	{
+		if (_lastUpdatedFrameEpoch.exchange(frameEpoch, std::memory_order_acq_rel) != frameEpoch)
+		{
+			updateFrame(frameEpoch);
+		}
+	}
+
+	void System::updateCameraOnCarState(const uint64_t frameEpoch)
+	{
+		std::lock_guard<std::mutex> lock(_frameMutex);
+		if (_cameraPoseEpoch == frameEpoch)
+		{
+			return;
+		}
+		const int64_t start = MonotonicClock::now();
+		_cameraPoseEpoch = frameEpoch;
+		updateCameraPose();
+		D3DHook::instance().addUpdateTime(MonotonicClock::now() - start);
+	}
+
 	// updates the data and camera for a frame 
-	void System::updateFrame()
+	void System::updateFrame(const uint64_t frameEpoch)
 	{
-		//updateDeltaTime();
-		CameraManipulator::cacheGameAddresses(_addressData);
-		validateAddresses(); //needed in dirt 2
-		cameraStateProcessor();
+		std::lock_guard<std::mutex> lock(_frameMutex);
+		const int64_t start = MonotonicClock::now();
+		// settings changed by the client since the last frame, all at once before anything reads them
+		SettingsRegistry& settings = Globals::instance().settings();
+		const SettingMask changedSettings = settings.applyStaged();
+		if (changedSettings.any())
+		{
+			Camera::instance().applySettings(settings, changedSettings);
+		}
+		if (_cameraPoseEpoch != frameEpoch)
+		{
+			// not moved by the car update this frame: another trigger, or the car isn't updated (paused, menus)
+			updateCameraPose();
+		}
 		handleUserInput();
-		
+		// everything sent to the client this frame, in one write
+		NamedPipeManager::instance().flush();
+		publishTelemetry(start);
+		D3DHook::instance().addUpdateTime(MonotonicClock::now() - start);
+	}
+
+	void System::publishTelemetry(int64_t frameStart)
+	{
+		// readers get CameraToolsData as TelemetryCamera
+		static_assert(sizeof(CameraToolsData) == sizeof(TelemetryCamera), "TelemetryCamera must match CameraToolsData");
+		static_assert(offsetof(CameraToolsData, fov) == offsetof(TelemetryCamera, fov), "TelemetryCamera must match CameraToolsData");
+		static_assert(offsetof(CameraToolsData, lookQuaternion) == offsetof(TelemetryCamera, lookQuaternion), "TelemetryCamera must match CameraToolsData");
+		static_assert(offsetof(CameraToolsData, pitch) == offsetof(TelemetryCamera, pitch), "TelemetryCamera must match CameraToolsData");
+
+		if (nullptr == s_telemetry || !s_telemetry->isOpen())
+		{
+			return;
+		}
+		const Camera& camera = Camera::instance();
+		CameraToolsData toolsData{};
+		toolsData.cameraEnabled = g_cameraEnabled;
+		toolsData.cameraMovementLocked = Globals::instance().cameraMovementLocked() ? 1 : 0;
+		toolsData.fov = XMConvertToDegrees(camera.getFov());
+		toolsData.coordinates = camera.getToolsCoordinates();
+		toolsData.lookQuaternion = camera.getToolsQuaternion();
+		toolsData.rotationMatrixUpVector = camera.getUpVector();
+		toolsData.rotationMatrixRightVector = camera.getRightVector();
+		toolsData.rotationMatrixForwardVector = camera.getForwardVector();
+		toolsData.pitch = camera.getPitch();
+		toolsData.yaw = camera.getYaw();
+		toolsData.roll = camera.getRoll();
+
+		TelemetryFrame frame{};
+		frame.frame = ++_telemetryFrame;
+		frame.timestamp = frameStart;
+		frame.deltaTime = _deltaTime;
+		memcpy(&frame.camera, &toolsData, sizeof(frame.camera));
+		const GameStateSnapshot& gameState = CameraManipulator::getGameState();
+		if (gameState.carValid)
+		{
+			frame.car.valid = 1;
+			frame.car.position = { gameState.playerPosition.x, gameState.playerPosition.y, gameState.playerPosition.z };
+			frame.car.rotation = { gameState.playerRotation.x, gameState.playerRotation.y, gameState.playerRotation.z, gameState.playerRotation.w };
+		}
+		s_telemetry->publish(frame);
 	}
 
 	void System::validateAddresses()
 	{
-		isCameraStructValid = CameraManipulator::validateCameraMemory();
-		isPlayerStructValid = CameraManipulator::validatePLayerPositionMemory();
+		// one guarded read of everything the camera needs this frame, the camera code only reads from the snapshot
+		CameraManipulator::captureGameState();
+		const GameStateSnapshot& gameState = CameraManipulator::getGameState();
+		isCameraStructValid = gameState.cameraValid;
+		isPlayerStructValid = gameState.carValid;
+	}
+
+	// Reads the game state and writes the camera pose for it.
+	void System::updateCameraPose()
+	{
+		updateDeltaTime();
+		CameraManipulator::cacheGameAddresses(_addressData);
+		validateAddresses(); //needed in dirt 2
+		cameraStateProcessor();
 	}
 
 	void System::cameraStateProcessor()
 	{
 		if (!g_cameraEnabled)
 			return;
+		// without a car transform the camera isn't touched, the last pose written holds
+		if (!canPoseCamera(CameraManipulator::getGameState()))
+			return;
 
 		static auto& Camera = Camera::instance();
 		Camera.updateCamera();
@@ -174,10 +333,10 @@ namespace IGCS
 	{
 
 		// Use real-time calculation (original behavior)
-		LARGE_INTEGER currentFrameTime;
-		QueryPerformanceCounter(&currentFrameTime);
-		_deltaTime = static_cast<float>(currentFrameTime.QuadPart - _lastFrameTime.QuadPart) / static_cast<float>(_frequency.QuadPart);
+		const int64_t currentFrameTime = MonotonicClock::now();
+		_deltaTime = static_cast<float>(MonotonicClock::toSeconds(currentFrameTime - _lastFrameTime));
 		_lastFrameTime = currentFrameTime;
+		_gameClock.advance(currentFrameTime, g_timescaleValue);
 		//MessageHandler::logLine("Delta time: %.6f", _deltaTime);
 
 	}
@@ -191,35 +350,40 @@ namespace IGCS
 			return;
 		}
 
-		// Keep existing XInput update for other controls
-		Globals::instance().gamePad().update();
-
-		// DirectInput (wheel buttons)
-		if (!s_directInput)
+		// the devices are read on the input thread, here we only act on what it saw since the last frame
+		bool toggleRequested = false;
+		bool toggleFixedMountRequested = false;
+		s_inputEvents.drain([&](const InputEvent& event)
 		{
-			s_directInput = new IGCS::DirectInputPad(); // intentionally leaked on process exit
-			s_directInput->initialize(Globals::instance().mainWindowHandle());
-		}
-		else if (!s_directInput->isInitialized())
-		{
-			s_directInput->initialize(Globals::instance().mainWindowHandle());
-		}
-
-		// Guard update – if DI fails during shutdown, update() simply no-ops
-		s_directInput->update();
-
-		// Toggle on configured DirectInput button index (default 13 from config)
-		const int diIndex = IGCS::Config::get().directInputToggleButtonIndex;
-		const bool diToggle = s_directInput->isButtonJustPressed(diIndex);
-
-		// Also allow existing keybinding to toggle (optional)
-		const bool toggleRequested = diToggle || Input::isActionActivated(ActionType::CameraEnable);
+			switch (event.type)
+			{
+			case InputEventType::CameraEnable:
+				toggleRequested = true;
+				break;
+			case InputEventType::ToggleFixedCameraMount:
+				toggleFixedMountRequested = true;
+				break;
+			default:
+				break;
+			}
+		});
 
 		if (toggleRequested)
 		{
 			if (g_cameraEnabled)
 			{
 				// it's going to be disabled, make sure things are alright when we give it back to the host
+				const CameraCommitCounters counters = CameraManipulator::getCameraCommitCounters();
+				MessageHandler::logDebug("Camera writes so far: %llu values written, %llu skipped, %llu commits rejected",
+					counters.valuesWritten, counters.valuesSkipped, counters.commitsRejected);
+				const LatencyHistogram& latency = CameraManipulator::getCarStateLatency();
+				if (latency.count() > 0)
+				{
+					MessageHandler::logLine("Car update to camera write (trigger %s, %llu frames): mean %.2fms, p50 %.2fms, p95 %.2fms, p99 %.2fms, max %.2fms",
+						Config::triggerToName(Config::get().cameraUpdateTrigger), latency.count(), latency.mean() * 1000.0,
+						latency.percentile(0.5) * 1000.0, latency.percentile(0.95) * 1000.0, latency.percentile(0.99) * 1000.0, latency.max() * 1000.0);
+				}
+				CameraManipulator::resetCarStateLatency();
 				CameraManipulator::restoreGameCameraData(_originalData);
 				Globals::instance().cameraMovementLocked(false);
 				InterceptorHelper::cameraSetup(_aobBlocks, false, _addressData);
@@ -242,7 +406,7 @@ namespace IGCS
 		}
 
 
-		if (Input::isActionActivated(ActionType::ToggleFixedCameraMount))
+		if (toggleFixedMountRequested)
 		{
 			Camera::instance().toggleFixedCameraMount();
 
@@ -271,12 +435,21 @@ namespace IGCS
 	{
 		MH_Initialize();
 		checkDXHookRequired();
+		g_updateOnCarState = Config::get().cameraUpdateTrigger == CameraUpdateTrigger::CarUpdate ? 1 : 0;
+		MessageHandler::logLine("Camera update trigger: %s", Config::triggerToName(Config::get().cameraUpdateTrigger));
 
 		// first grab the window handle
 		Globals::instance().mainWindowHandle(Utils::findMainWindow(GetCurrentProcessId()));
 		HWND hWnd = Globals::instance().mainWindowHandle();
 
 		Input::registerRawInput();
+		// start looking for a wheel and pads now, so they're ready by the time the camera is
+		s_deviceWorker = new DeviceWorker(); // intentionally leaked on process exit
+		Globals::instance().gamePad().setConnectionManager(&s_padConnections);
+		s_deviceWorker->add(s_padConnections);
+		s_directInput = new IGCS::DirectInputPad(); // intentionally leaked on process exit
+		s_directInput->initialize(hWnd, *s_deviceWorker);
+		s_deviceWorker->start();
 		//Initialise hooks (D3D, window etc)
 		initializeHooks();
 
@@ -289,6 +462,12 @@ namespace IGCS
 		// camera struct found, init our own camera object now and hook into game code which uses camera.
 		_cameraStructFound = true;
 		Camera::instance().resetAngles();
+		Camera::instance().initialize();
+		// input before this point isn't acted on, so only start reading it now
+		s_inputThread = new InputThread(*s_directInput, *s_deviceWorker, s_inputEvents); // intentionally leaked on process exit
+		s_inputThread->start(Config::get().inputPollRate);
+		// from here on edits to dr2tools.cfg apply while the game runs
+		Config::startWatching();
 
 		//apply any code changes now
 		InterceptorHelper::toolsInit(_aobBlocks);
@@ -34,6 +34,8 @@
 #include "AOBBlock.h"
 #include "GameCameraData.h" //IGCSDOF
 #include "D3DHook.h"
+#include "MonotonicClock.h"
+#include <mutex>
 
 namespace IGCS
 {
@@ -63,10 +65,22 @@ namespace IGCS
 		uint8_t IGCScamenabled = 1;
 		uint8_t IGCSsessionactive = 3;
 		bool pathRun = false;
-		void updateFrame();
+		// Thread ownership: updateFrame runs on the render thread (Present or the backbuffer bind), updateCameraOnCarState on
+		// the game's car update thread. Both run under _frameMutex, so the camera, the game state snapshot, the delta time and
+		// the camera commit have one owner at a time. The settings registry, the input events, the client pipe flush and the
+		// telemetry are only touched by updateFrame, so by the render thread.
+		// The frame with the given Present epoch: settings, the camera unless the car update moved it already, input, the
+		// client pipe and telemetry.
+		void updateFrame(uint64_t frameEpoch);
+		// runs updateFrame if it didn't run yet for the frame with the given Present epoch
+		void updateFrameOnce(uint64_t frameEpoch);
+		// car_update trigger: moves the camera for the car state the game just wrote, once per frame. Nothing else.
+		void updateCameraOnCarState(uint64_t frameEpoch);
 		static void mainLoop();
 		void validateAddresses();
 		float getDT() const { return _deltaTime; }
+		// game time in nanoseconds, scaled by g_timescaleValue. Advanced once per frame, when the camera moves.
+		int64_t getGameTime() const { return _gameClock.now(); }
         map<string, AOBBlock>& getAOBBlock() { return _aobBlocks; }
 		bool blocksInit = false;
 		bool cameraStructInit = false;
@@ -89,6 +103,8 @@ namespace IGCS
 		//void toggleSlowMo(bool displaynotification = true);
 		//void handleSkipFrames();
 		void updateDeltaTime();
+		void updateCameraPose();
+		void publishTelemetry(int64_t frameStart);
 
 
 		void setIGCSsession(bool status, uint8_t type) { _IGCSConnectorSessionActive = status, _IGCSConnecterSessionType = type; }
@@ -108,14 +124,22 @@ namespace IGCS
 		std::filesystem::path _hostExeFilename;
 
 		//interpolation stuff
-		LARGE_INTEGER _lastFrameTime;
-		LARGE_INTEGER _frequency;
+		int64_t _lastFrameTime; // MonotonicClock timestamp
 		float _deltaTime = 0.0f; // In seconds
+		GameClock _gameClock;
 		float _smoothness = 25.0f; // Adjustable smoothness factor
 		// Timing configuration
 		bool _useFixedDeltaTime;
 		float _fixedDeltaValue;
 
+		// Present epoch of the frame updateFrame last ran for
+		std::atomic<uint64_t> _lastUpdatedFrameEpoch{ 0 };
+		// Present epoch of the frame the camera was last moved for by the car update. Guarded by _frameMutex.
+		uint64_t _cameraPoseEpoch = UINT64_MAX;
+		std::mutex _frameMutex;
+		// frames published to the telemetry channel
+		uint64_t _telemetryFrame = 0;
+
 		bool _visualizationEnabled = false;
 		//static void toggledepthBufferUsage();
 
@@ -0,0 +1,320 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string>
+#include "SeqLock.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// The camera and car of every frame, published by the dll in named shared memory for overlays and analysis tools: the dll
+// stores each frame with a SeqLock (see SeqLock.h), readers map the memory read only and copy the last frame whenever they like,
+// at any rate, without syscalls and without ever holding up the game. This header is all a reader needs, it doesn't depend on
+// the rest of the dll:
+//     TelemetryReader reader;
+//     if (reader.open()) { TelemetryFrame frame; if (SeqLockReadResult::Ok == reader.read(frame)) { ... } }
+// The memory is Local\IgcsTelemetry on Windows and /IgcsTelemetry (POSIX shared memory) elsewhere. It outlives the dll while a
+// reader has it open, and a dll started later carries on publishing in it, so readers don't have to reopen it.
+namespace IGCS
+{
+	namespace Telemetry
+	{
+		static constexpr const char* kChannelName = "IgcsTelemetry";
+		static constexpr uint32_t kMagic = 0x54534349;		// "ICST"
+		// bump when TelemetryFrame changes
+		static constexpr uint32_t kVersion = 1;
+	}
+
+	struct TelemetryVec3
+	{
+		float x;
+		float y;
+		float z;
+	};
+
+	struct TelemetryQuat
+	{
+		float x;
+		float y;
+		float z;
+		float w;
+	};
+
+	// Same layout as CameraToolsData, without DirectXMath so readers don't need the Windows SDK.
+	struct TelemetryCamera
+	{
+		uint8_t cameraEnabled;					// 1 is enabled 0 is not enabled
+		uint8_t cameraMovementLocked;			// 1 is camera movement is locked, 0 is camera movement isn't locked.
+		uint8_t reserved1;
+		uint8_t reserved2;
+		float fov;								// in degrees
+		TelemetryVec3 coordinates;
+		TelemetryQuat lookQuaternion;
+		TelemetryVec3 rotationMatrixUpVector;
+		TelemetryVec3 rotationMatrixRightVector;
+		TelemetryVec3 rotationMatrixForwardVector;
+		float pitch;							// in radians
+		float yaw;
+		float roll;
+	};
+
+	// The player's car, as the game had it at the start of the frame.
+	struct TelemetryCar
+	{
+		uint32_t valid;							// 0 if the car couldn't be read, e.g. in the menus: the rest is 0 then
+		TelemetryVec3 position;
+		TelemetryQuat rotation;
+	};
+
+	struct TelemetryFrame
+	{
+		uint64_t frame;							// +1 per frame published. Not changing: the game is paused, loading or gone
+		int64_t timestamp;						// start of the frame, in nanoseconds of the dll's clock, to measure intervals
+		float deltaTime;						// in seconds, since the previous frame
+		uint32_t reserved;
+		TelemetryCamera camera;
+		TelemetryCar car;
+	};
+
+	// The shared memory. Zeroed is empty.
+	struct TelemetryRegion
+	{
+		std::atomic<uint32_t> magic{ 0 };		// kMagic once the rest is filled in
+		uint32_t version = 0;
+		uint32_t frameSize = 0;
+		uint32_t reserved = 0;
+		SeqLock<TelemetryFrame> frame;
+	};
+
+	// A named block of shared memory: a page file backed file mapping on Windows, POSIX shared memory elsewhere.
+	class SharedMemory
+	{
+	public:
+		SharedMemory() = default;
+		// IMPORTANT: no cleanup in the destructor, it may run under loader lock. Use close().
+		~SharedMemory() = default;
+		SharedMemory(const SharedMemory&) = delete;
+		SharedMemory& operator=(const SharedMemory&) = delete;
+
+		// Creates the block, or opens it if it exists, at least size bytes, read and write. A new block is zeroed.
+		bool create(const std::string& name, size_t size)
+		{
+#ifdef _WIN32
+			_mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, static_cast<DWORD>(size), objectName(name).c_str());
+			return nullptr != _mapping && map(FILE_MAP_READ | FILE_MAP_WRITE, size);
+#else
+			const int fd = shm_open(objectName(name).c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0644);
+			struct stat status{};
+			const bool sized = fd >= 0 && 0 == fstat(fd, &status) && (static_cast<size_t>(status.st_size) >= size || 0 == ftruncate(fd, static_cast<off_t>(size)));
+			return map(fd, sized, PROT_READ | PROT_WRITE, size);
+#endif
+		}
+
+		// Opens an existing block read only. False if it doesn't exist or is smaller than size.
+		bool openReadOnly(const std::string& name, size_t size)
+		{
+#ifdef _WIN32
+			_mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, objectName(name).c_str());
+			return nullptr != _mapping && map(FILE_MAP_READ, size);
+#else
+			const int fd = shm_open(objectName(name).c_str(), O_RDONLY | O_CLOEXEC, 0);
+			struct stat status{};
+			const bool sized = fd >= 0 && 0 == fstat(fd, &status) && static_cast<size_t>(status.st_size) >= size;
+			return map(fd, sized, PROT_READ, size);
+#endif
+		}
+
+		void close()
+		{
+#ifdef _WIN32
+			if (nullptr != _data) { UnmapViewOfFile(_data); }
+			if (nullptr != _mapping) { CloseHandle(_mapping); _mapping = nullptr; }
+#else
+			if (nullptr != _data) { munmap(_data, _size); }
+#endif
+			_data = nullptr;
+			_size = 0;
+		}
+
+		// Removes the name, the block goes once nobody has it open. Windows does that by itself when the last handle closes.
+		static void remove([[maybe_unused]] const std::string& name)
+		{
+#ifndef _WIN32
+			shm_unlink(objectName(name).c_str());
+#endif
+		}
+
+		[[nodiscard]] void* data() const noexcept { return _data; }
+
+	private:
+		static std::string objectName(const std::string& name)
+		{
+#ifdef _WIN32
+			// the session's namespace, no privilege needed
+			return "Local\\" + name;
+#else
+			return "/" + name;
+#endif
+		}
+
+#ifdef _WIN32
+		bool map(DWORD access, size_t size)
+		{
+			_data = MapViewOfFile(_mapping, access, 0, 0, size);
+			_size = size;
+			if (nullptr == _data)
+			{
+				close();
+				return false;
+			}
+			return true;
+		}
+
+		HANDLE _mapping = nullptr;
+#else
+		// the mapping keeps the memory, fd is closed either way
+		bool map(int fd, bool sized, int protection, size_t size)
+		{
+			void* data = sized ? mmap(nullptr, size, protection, MAP_SHARED, fd, 0) : MAP_FAILED;
+			if (fd >= 0)
+			{
+				::close(fd);
+			}
+			if (MAP_FAILED == data)
+			{
+				return false;
+			}
+			_data = data;
+			_size = size;
+			return true;
+		}
+#endif
+
+		void* _data = nullptr;
+		size_t _size = 0;
+	};
+
+	// The dll's side. publish() is called by one thread, the render thread.
+	class TelemetryPublisher
+	{
+	public:
+		TelemetryPublisher() = default;
+		// IMPORTANT: no cleanup in the destructor, it may run under loader lock. Use close().
+		~TelemetryPublisher() = default;
+		TelemetryPublisher(const TelemetryPublisher&) = delete;
+		TelemetryPublisher& operator=(const TelemetryPublisher&) = delete;
+
+		// Creates the shared memory, or takes over the one an earlier dll left to its readers. False if it can't, or the one
+		// left is of another version.
+		bool open(const std::string& name = Telemetry::kChannelName)
+		{
+			if (!_memory.create(name, sizeof(TelemetryRegion)))
+			{
+				return false;
+			}
+			TelemetryRegion* region = static_cast<TelemetryRegion*>(_memory.data());
+			if (Telemetry::kMagic == region->magic.load(std::memory_order_acquire))
+			{
+				if (Telemetry::kVersion != region->version || sizeof(TelemetryFrame) != region->frameSize)
+				{
+					_memory.close();
+					return false;
+				}
+				_region = region;
+				TelemetryFrame last;
+				_lastFrame = SeqLockReadResult::Ok == _region->frame.load(last) ? last.frame : 0;
+				return true;
+			}
+			// new, so no reader looks at it till the magic is set
+			_lastFrame = 0;
+			_region = new (region) TelemetryRegion();
+			_region->version = Telemetry::kVersion;
+			_region->frameSize = sizeof(TelemetryFrame);
+			_region->magic.store(Telemetry::kMagic, std::memory_order_release);
+			return true;
+		}
+
+		// A few dozen stores, no syscall, never waits for readers.
+		void publish(const TelemetryFrame& frame) noexcept
+		{
+			if (nullptr != _region)
+			{
+				_region->frame.store(frame);
+			}
+		}
+
+		// Not while publish() may run.
+		void close()
+		{
+			_region = nullptr;
+			_memory.close();
+		}
+
+		[[nodiscard]] bool isOpen() const noexcept { return nullptr != _region; }
+
+		// The number of the last frame in the memory open() took over, 0 if it made it. Count on from it, readers take a frame
+		// number which doesn't change or goes back for a paused game.
+		[[nodiscard]] uint64_t lastFrame() const noexcept { return _lastFrame; }
+
+	private:
+		SharedMemory _memory;
+		TelemetryRegion* _region = nullptr;
+		uint64_t _lastFrame = 0;
+	};
+
+	// A reader, in any process. Can't disturb the dll: the memory is mapped read only.
+	class TelemetryReader
+	{
+	public:
+		TelemetryReader() = default;
+		~TelemetryReader() { close(); }
+		TelemetryReader(const TelemetryReader&) = delete;
+		TelemetryReader& operator=(const TelemetryReader&) = delete;
+
+		// False if the dll hasn't published yet (try again later) or publishes another version.
+		bool open(const std::string& name = Telemetry::kChannelName)
+		{
+			close();
+			if (!_memory.openReadOnly(name, sizeof(TelemetryRegion)))
+			{
+				return false;
+			}
+			const TelemetryRegion* region = static_cast<const TelemetryRegion*>(_memory.data());
+			if (Telemetry::kMagic != region->magic.load(std::memory_order_acquire) || Telemetry::kVersion != region->version
+				|| sizeof(TelemetryFrame) != region->frameSize)
+			{
+				_memory.close();
+				return false;
+			}
+			_region = region;
+			return true;
+		}
+
+		// Copies the last frame published. Empty if none was yet, Busy in the rare case the dll kept publishing during every
+		// attempt; frame is untouched unless Ok. Compare frame.frame with the previous one to see if it's new.
+		SeqLockReadResult read(TelemetryFrame& frame, int attempts = SeqLock<TelemetryFrame>::kDefaultReadAttempts) const noexcept
+		{
+			return nullptr == _region ? SeqLockReadResult::Empty : _region->frame.load(frame, attempts);
+		}
+
+		void close()
+		{
+			_region = nullptr;
+			_memory.close();
+		}
+
+		[[nodiscard]] bool isOpen() const noexcept { return nullptr != _region; }
+
+	private:
+		SharedMemory _memory;
+		const TelemetryRegion* _region = nullptr;
+	};
+}
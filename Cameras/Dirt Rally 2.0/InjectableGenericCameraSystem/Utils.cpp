@@ -29,6 +29,7 @@
 #include "Utils.h"
 #include "GameConstants.h"
 #include "AOBBlock.h"
+#include "MonotonicClock.h"
 #include <comdef.h>
 #include <codecvt>
 #include <filesystem>
@@ -37,12 +38,24 @@
 #include <Windows.h>
 #include <cmath>
 #include <string>
+// the stb_sprintf implementation, once for the whole dll. See FormatBuffer.h
+#define STB_SPRINTF_IMPLEMENTATION
+#include "stb_sprintf.h"
+#undef STB_SPRINTF_IMPLEMENTATION
+// and of stb_perlin, for the camera noise. See ProceduralNoise.h
+#define STB_PERLIN_IMPLEMENTATION
+#include "stb_perlin.h"
+#undef STB_PERLIN_IMPLEMENTATION
 
 using namespace std;
 using namespace DirectX;
 
 namespace IGCS::Utils
 {
+	// Per thread, so formatTemporary needs no lock. Thread locals of a dll exist for every thread of the game, so this stays
+	// small; formatString allocates for longer texts.
+	static constexpr size_t kFormatBufferSize = 2048;
+	static thread_local FormatBuffer<kFormatBufferSize> _formatBuffer;
 
 	// Simulates Alt+Tab (switches to the next window)
 	void simulateAltTab()
@@ -80,12 +93,8 @@ namespace IGCS::Utils
 
 	double getCurrentTimeSeconds()
 	{
-		using namespace std::chrono;
-
-		static auto start = steady_clock::now();
-		auto now = steady_clock::now();
-		auto elapsed = duration_cast<milliseconds>(now - start).count();
-		return static_cast<double>(elapsed) / 1000.0;
+		static const int64_t start = MonotonicClock::now();
+		return MonotonicClock::toSeconds(MonotonicClock::now() - start);
 	}
 
 	//--------------------------------------------------------------------------------------
@@ -769,24 +778,51 @@ namespace IGCS::Utils
 	{
 		va_list args_copy;
 		va_copy(args_copy, args);
-
-		int len = vsnprintf(NULL, 0, fmt, args_copy);
-		char* buffer = new char[len + 2];
-		vsnprintf(buffer, len + 1, fmt, args_copy);
-		string toReturn(buffer, len + 1);
+		const FormatResult result = formatTemporaryVa(fmt, args_copy);
+		va_end(args_copy);
+		if (!result.truncated)
+		{
+			return string(result.text);
+		}
+		// longer than the thread's buffer: measure, then format straight into the string
+		va_copy(args_copy, args);
+		const size_t length = formattedLengthVa(fmt, args_copy);
+		va_end(args_copy);
+		string toReturn(length, '\0');
+		va_copy(args_copy, args);
+		formatToVa(toReturn.data(), length + 1, fmt, args_copy);
+		va_end(args_copy);
 		return toReturn;
 	}
 
 
+	FormatResult formatTemporary(const char* fmt, ...)
+	{
+		va_list args;
+		va_start(args, fmt);
+		const FormatResult result = formatTemporaryVa(fmt, args);
+		va_end(args);
+		return result;
+	}
+
+
+	FormatResult formatTemporaryVa(const char* fmt, va_list args)
+	{
+		return _formatBuffer.formatVa(fmt, args);
+	}
+
+
 	bool stringStartsWith(const char *a, const char *b)
 	{
 		return strncmp(a, b, strlen(b)) == 0 ? 1 : 0;
 	}
 
 	
+	// Physical key state, so it works from any thread (GetKeyState only knows the calling thread's messages). Doesn't
+	// look at focus, callers check that themselves.
 	bool keyDown(int virtualKeyCode)
 	{
-		return (GetKeyState(virtualKeyCode) & 0x8000);
+		return (GetAsyncKeyState(virtualKeyCode) & 0x8000);
 	}
 
 	
@@ -860,19 +896,17 @@ namespace IGCS::Utils
 		return *uintInArray;
 	}
 	
-	std::string stringFromBytes(uint8_t byteArray[], DWORD arrayLength, int startIndex)
+	std::string_view stringFromBytes(uint8_t byteArray[], DWORD arrayLength, int startIndex)
 	{
 		if (arrayLength < static_cast<DWORD>(startIndex) + 4)
 		{
-			return "";
+			return {};
 		}
-		const auto charInArray = reinterpret_cast<char*>(byteArray + startIndex);
-		// copy over the bytes in our own array which has a trailing 0
-		const auto characters = new char[(arrayLength - startIndex) + 1];
-		memcpy(characters, charInArray, arrayLength - startIndex);
-		characters[(arrayLength - startIndex)] = '\0';
-		string toReturn(characters);
-		return toReturn;
+		// the text runs to the first 0 or the end of the array, which doesn't need a trailing 0
+		const auto charInArray = reinterpret_cast<const char*>(byteArray + startIndex);
+		const size_t maxLength = arrayLength - startIndex;
+		const auto terminator = static_cast<const char*>(memchr(charInArray, '\0', maxLength));
+		return std::string_view(charInArray, nullptr == terminator ? maxLength : static_cast<size_t>(terminator - charInArray));
 	}
 
 	void toggleNOPState(AOBBlock& hookData, int numberOfBytes, bool enabled)
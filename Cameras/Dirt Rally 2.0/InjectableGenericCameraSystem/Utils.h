@@ -28,6 +28,8 @@
 #pragma once
 #include "stdafx.h"
 #include <filesystem>
+#include <string_view>
+#include "FormatBuffer.h"
 #include "MessageHandler.h"
 #include "GameConstants.h"
 
@@ -131,6 +133,10 @@ namespace IGCS::Utils
 	LPBYTE calculateAbsoluteAddress(AOBBlock* locationData, int nextOpCodeOffset);
 	std::string formatString(const char* fmt, ...);
 	std::string formatStringVa(const char* fmt, va_list args);
+	// Formats into a per thread buffer without allocating. The text is valid till the next formatTemporary call on the
+	// same thread, and cut off (truncated set) at 2 KB.
+	FormatResult formatTemporary(const char* fmt, ...);
+	FormatResult formatTemporaryVa(const char* fmt, va_list args);
 	bool stringStartsWith(const char *a, const char *b);
 	bool keyDown(int virtualKeyCode);
 	bool altPressed();
@@ -142,7 +148,8 @@ namespace IGCS::Utils
 	float floatFromBytes(uint8_t byteArray[], DWORD arrayLength, int startIndex);
 	int intFromBytes(uint8_t byteArray[], DWORD arrayLength, int startIndex);
 	double doubleFromBytes(uint8_t byteArray[], DWORD arrayLength, int startIndex);
-	std::string stringFromBytes(uint8_t byteArray[], DWORD arrayLength, int startIndex);
+	// A view into byteArray, up to the first 0.
+	std::string_view stringFromBytes(uint8_t byteArray[], DWORD arrayLength, int startIndex);
 	std::filesystem::path obtainHostExeAndPath();
 	void toggleNOPState(AOBBlock& hookData, int numberOfBytes, bool enabled);
 	void saveBytesWrite(AOBBlock& hookData, int numberOfBytes, uint8_t* bytestoWrite, bool enabled);
@@ -162,6 +169,7 @@ namespace IGCS::Utils
 		bool negatePitch = false,
 		bool negateYaw = false,
 		bool negateRoll = false);
+	// seconds since the first call
 	double getCurrentTimeSeconds();
 	DirectX::XMMATRIX CreateViewMatrix(const DirectX::XMFLOAT3& cameraPos, const DirectX::XMVECTOR& orientation);
 	const char* getExecutableName();
@@ -0,0 +1,72 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include "CameraSmoothing.h"
+
+// Forward-backward (zero phase) rotation smoother for trajectories which are known ahead of time, like replays. The
+// rotations are kept in a fixed ring buffer covering lookAhead frames before and after the frame which is smoothed. Every
+// evaluation runs the same one-pole filter the live camera uses forward over the whole window and then backward to its
+// centre, so the phase lag of the two passes cancels and the result is in phase with the car. The cost per frame is
+// constant: about 3 * lookAhead slerps, no allocations.
+namespace IGCS::Smoothing
+{
+	class ZeroPhaseSmoother
+	{
+	public:
+		static constexpr size_t kMaxLookAhead = 64;
+
+		explicit ZeroPhaseSmoother(size_t lookAhead = 15) noexcept
+		{
+			setLookAhead(lookAhead);
+		}
+
+		void setLookAhead(size_t lookAhead) noexcept
+		{
+			_lookAhead = lookAhead == 0 ? 1 : (lookAhead > kMaxLookAhead ? kMaxLookAhead : lookAhead);
+		}
+
+		[[nodiscard]] size_t lookAhead() const noexcept { return _lookAhead; }
+
+		// Fills the whole window with start, e.g. when a replay starts or the camera is (re)enabled.
+		void reset(const Quat& start) noexcept
+		{
+			_ring.fill(start);
+			_newest = 0;
+		}
+
+		// Adds the rotation of the newest frame, lookAhead frames ahead of the frame evaluate() returns.
+		void push(const Quat& rotation) noexcept
+		{
+			_newest = (_newest + 1) % kCapacity;
+			_ring[_newest] = rotation;
+		}
+
+		// Smoothed rotation of the frame in the centre of the window, i.e. lookAhead frames before the newest one pushed.
+		[[nodiscard]] Quat evaluate(const SmoothingParams& params) noexcept
+		{
+			const size_t windowSize = 2 * _lookAhead + 1;
+			const size_t oldest = (_newest + kCapacity - (windowSize - 1)) % kCapacity;
+
+			Quat state = _ring[oldest];
+			for (size_t i = 0; i < windowSize; ++i)
+			{
+				state = slerp(state, _ring[(oldest + i) % kCapacity], params.blend);
+				_forward[i] = state;
+			}
+			state = _forward[windowSize - 1];
+			for (size_t i = windowSize - 1; i-- > _lookAhead;)
+			{
+				state = slerp(state, _forward[i], params.blend);
+			}
+			return state;
+		}
+
+	private:
+		static constexpr size_t kCapacity = 2 * kMaxLookAhead + 1;
+
+		std::array<Quat, kCapacity> _ring{};
+		std::array<Quat, kCapacity> _forward{};
+		size_t _newest = 0;
+		size_t _lookAhead = 1;
+	};
+}
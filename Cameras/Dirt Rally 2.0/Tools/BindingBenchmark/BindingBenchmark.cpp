@@ -0,0 +1,259 @@
+// Compares evaluating the key bindings the way ActionData::isActive used to (two map lookups per action, then a key state
+// query for the key and every modifier) with the compiled BindingTable (see BindingTable.h): one snapshot of the used keys
+// per sample and bit tests per action. The key state query is simulated with a call which can't be inlined, so the legacy
+// numbers are a lower bound: in game every query is a GetKeyState call. Also checks that both give the same result for
+// random bindings and random key states.
+//
+// Usage: BindingBenchmark [--actions <n>] [--samples <n>] [--seed <n>]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+#include "../../InjectableGenericCameraSystem/BindingTable.h"
+
+using namespace IGCS;
+
+namespace
+{
+	// simulated device state, keys are read through keyState()
+	bool g_keyDown[256] = {};
+	uint16_t g_padButtons = 0;
+	bool g_padConnected = true;
+	volatile uint64_t g_queries = 0;
+
+#if defined(_MSC_VER)
+	__declspec(noinline)
+#else
+	__attribute__((noinline))
+#endif
+	bool keyState(int key)
+	{
+		g_queries = g_queries + 1;
+		return key >= 0 && key < 256 && g_keyDown[key];
+	}
+
+	struct LegacyBinding
+	{
+		int keyCode = 0;
+		bool alt = false;
+		bool ctrl = false;
+		bool shift = false;
+		bool gamepad = false;
+
+		// ActionData::isActive as it was
+		bool isActive(bool altCtrlOptional) const
+		{
+			if (!gamepad)
+			{
+				const bool shiftDown = keyState(BindingTable::kKeyLeftShift) || keyState(BindingTable::kKeyRightShift);
+				bool result = keyState(keyCode) && shift == shiftDown;
+				if (alt || ctrl || !altCtrlOptional)
+				{
+					const bool altDown = keyState(BindingTable::kKeyLeftAlt) || keyState(BindingTable::kKeyRightAlt);
+					const bool ctrlDown = keyState(BindingTable::kKeyLeftControl) || keyState(BindingTable::kKeyRightControl);
+					result = result && altDown == alt && ctrlDown == ctrl;
+				}
+				return result;
+			}
+			if (!g_padConnected || 0 == (g_padButtons & keyCode))
+			{
+				return false;
+			}
+			const bool rb = 0 != (g_padButtons & BindingTable::kPadRightShoulder);
+			const bool lb = 0 != (g_padButtons & BindingTable::kPadLeftShoulder);
+			return rb == alt && lb == ctrl;
+		}
+	};
+
+	struct LegacyBindings
+	{
+		std::map<uint32_t, std::unique_ptr<LegacyBinding>> keyboard;
+		std::map<uint32_t, std::unique_ptr<LegacyBinding>> gamepad;
+
+		// Globals::isAnyBindingActivated as it was
+		bool isAnyBindingActivated(uint32_t action, bool altCtrlOptional) const
+		{
+			const LegacyBinding* primary = keyboard.count(action) == 1 ? keyboard.at(action).get() : nullptr;
+			const LegacyBinding* alternative = gamepad.count(action) == 1 ? gamepad.at(action).get() : nullptr;
+			return (primary && primary->isActive(altCtrlOptional)) || (alternative && alternative->isActive(altCtrlOptional));
+		}
+	};
+
+	const int kCandidateKeys[] = { 0x2D, 0x24, 0x25, 0x26, 0x27, 0x28, 0x60, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+		0x6A, 0x6B, 0x6D, 0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x7B, 0x55, 0x4F };
+	const uint16_t kPadButtons[] = { 0x0001, 0x0002, 0x0004, 0x0008, 0x0010, 0x0020, 0x0040, 0x0080, 0x1000, 0x2000, 0x4000, 0x8000 };
+
+	void makeBindings(uint32_t actions, std::mt19937& random, LegacyBindings& legacy, BindingTable& table)
+	{
+		std::uniform_int_distribution<size_t> key(0, std::size(kCandidateKeys) - 1);
+		std::uniform_int_distribution<size_t> button(0, std::size(kPadButtons) - 1);
+		std::bernoulli_distribution modifier(0.2);
+		std::bernoulli_distribution hasPad(0.5);
+		table.clear();
+		for (uint32_t action = 0; action < actions; ++action)
+		{
+			auto keyBinding = std::make_unique<LegacyBinding>();
+			keyBinding->keyCode = kCandidateKeys[key(random)];
+			keyBinding->alt = modifier(random);
+			keyBinding->ctrl = modifier(random);
+			keyBinding->shift = modifier(random);
+			table.setKeyBinding(action, keyBinding->keyCode, keyBinding->alt, keyBinding->ctrl, keyBinding->shift);
+			legacy.keyboard[action] = std::move(keyBinding);
+			if (hasPad(random))
+			{
+				auto padBinding = std::make_unique<LegacyBinding>();
+				padBinding->gamepad = true;
+				padBinding->keyCode = kPadButtons[button(random)];
+				padBinding->alt = modifier(random);
+				padBinding->ctrl = modifier(random);
+				table.setPadBinding(action, static_cast<uint16_t>(padBinding->keyCode), padBinding->alt, padBinding->ctrl);
+				legacy.gamepad[action] = std::move(padBinding);
+			}
+		}
+	}
+
+	void randomizeState(std::mt19937& random)
+	{
+		std::bernoulli_distribution down(0.08);
+		for (bool& key : g_keyDown)
+		{
+			key = down(random);
+		}
+		g_padButtons = static_cast<uint16_t>(random() & 0xFFFF);
+		g_padConnected = down(random) ? false : true;
+	}
+
+	InputSnapshot capture(const BindingTable& table)
+	{
+		InputSnapshot snapshot;
+		table.usedKeys().forEach([&snapshot](uint32_t key)
+		{
+			if (keyState(static_cast<int>(key)))
+			{
+				snapshot.keys.set(key);
+			}
+		});
+		snapshot.padButtons = g_padConnected ? g_padButtons : 0;
+		return snapshot;
+	}
+
+	void printUsage()
+	{
+		std::fprintf(stderr, "Usage: BindingBenchmark [--actions <n, 1..64, default 40>] [--samples <n, default 200000>] [--seed <n>]\n");
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	uint32_t actions = 40;
+	size_t samples = 200000;
+	uint32_t seed = std::random_device{}();
+	for (int i = 1; i < argc; ++i)
+	{
+		const bool hasValue = i + 1 < argc;
+		if (hasValue && 0 == std::strcmp(argv[i], "--actions")) { actions = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)); }
+		else if (hasValue && 0 == std::strcmp(argv[i], "--samples")) { samples = std::strtoul(argv[++i], nullptr, 10); }
+		else if (hasValue && 0 == std::strcmp(argv[i], "--seed")) { seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)); }
+		else
+		{
+			printUsage();
+			return 1;
+		}
+	}
+	if (actions < 1 || actions > BindingTable::kMaxActions || samples < 100)
+	{
+		printUsage();
+		return 1;
+	}
+
+	std::mt19937 random(seed);
+	LegacyBindings legacy;
+	BindingTable table;
+	makeBindings(actions, random, legacy, table);
+
+	// same answers for every action, both modes
+	size_t mismatches = 0;
+	for (size_t sample = 0; sample < 20000; ++sample)
+	{
+		randomizeState(random);
+		const InputSnapshot snapshot = capture(table);
+		for (const bool altCtrlOptional : { false, true })
+		{
+			const uint64_t active = table.activeActions(snapshot, altCtrlOptional);
+			for (uint32_t action = 0; action < actions; ++action)
+			{
+				if (legacy.isAnyBindingActivated(action, altCtrlOptional) != (0 != (active & (uint64_t(1) << action))))
+				{
+					++mismatches;
+				}
+			}
+		}
+	}
+
+	// pre-generated states, so both loops see the same input
+	std::vector<std::vector<bool>> states;
+	std::vector<uint16_t> pads;
+	const size_t stateCount = 1024;
+	for (size_t i = 0; i < stateCount; ++i)
+	{
+		randomizeState(random);
+		states.emplace_back(std::begin(g_keyDown), std::end(g_keyDown));
+		pads.push_back(g_padConnected ? g_padButtons : 0);
+	}
+	auto applyState = [&](size_t sample)
+	{
+		const std::vector<bool>& state = states[sample % stateCount];
+		for (size_t key = 0; key < 256; ++key)
+		{
+			g_keyDown[key] = state[key];
+		}
+		g_padButtons = pads[sample % stateCount];
+		g_padConnected = true;
+	};
+
+	uint64_t sink = 0;
+	double legacyNs = 0.0;
+	uint64_t legacyQueries = 0;
+	double tableNs = 0.0;
+	uint64_t tableQueries = 0;
+	for (size_t sample = 0; sample < samples; ++sample)
+	{
+		applyState(sample);
+		uint64_t queriesBefore = g_queries;
+		auto start = std::chrono::steady_clock::now();
+		uint64_t active = 0;
+		for (uint32_t action = 0; action < actions; ++action)
+		{
+			if (legacy.isAnyBindingActivated(action, false))
+			{
+				active |= uint64_t(1) << action;
+			}
+		}
+		auto end = std::chrono::steady_clock::now();
+		legacyNs += static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+		legacyQueries += g_queries - queriesBefore;
+		sink += active;
+
+		queriesBefore = g_queries;
+		start = std::chrono::steady_clock::now();
+		const InputSnapshot snapshot = capture(table);
+		active = table.activeActions(snapshot, false);
+		end = std::chrono::steady_clock::now();
+		tableNs += static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+		tableQueries += g_queries - queriesBefore;
+		sink += active;
+	}
+
+	std::printf("%u actions, %zu samples, seed %u\n\n", actions, samples, seed);
+	std::printf("%-30s %10s %18s\n", "", "ns/sample", "key queries/sample");
+	std::printf("%-30s %10.1f %18.1f\n", "map lookups + key queries", legacyNs / static_cast<double>(samples), static_cast<double>(legacyQueries) / static_cast<double>(samples));
+	std::printf("%-30s %10.1f %18.1f\n", "snapshot + compiled table", tableNs / static_cast<double>(samples), static_cast<double>(tableQueries) / static_cast<double>(samples));
+	std::printf("\n%s: %zu mismatches between both evaluations (checksum %llu)\n", 0 == mismatches ? "OK" : "FAILED", mismatches, static_cast<unsigned long long>(sink & 0xFFFF));
+	return 0 == mismatches ? 0 : 1;
+}
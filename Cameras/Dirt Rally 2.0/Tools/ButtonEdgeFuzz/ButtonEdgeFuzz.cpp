@@ -0,0 +1,221 @@
+// Fuzzes the button edge tracker the DirectInput pad reads its buttons with (see ButtonEdgeTracker.h). A fake device with 128
+// buttons plus a few out of range numbers produces random event streams: presses and releases, repeated presses of a held
+// button, bursts of many events. Each frame the events go through a buffer of fixed size like DirectInput's; when it overflows
+// the events past it are lost and the tracker is resynchronized from the device's full state, and now and then it's reset.
+// After every frame the tracker is compared with a naive reference model of 128 bools per set, and with the device: the buttons
+// down must be the device's, and a button which went down during the frame must be just pressed, even if its events were lost.
+// Exits with 1 if a check fails.
+//
+// Usage: ButtonEdgeFuzz [--frames 1000000] [--buffer 16] [--seed <n>]
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "../Common/TestReport.h"
+#include "../../InjectableGenericCameraSystem/ButtonEdgeTracker.h"
+
+using namespace IGCS;
+using namespace IGCS::Tools;
+
+namespace
+{
+	constexpr uint32_t kButtons = ButtonSet::kButtons;
+	// the device reports a few buttons the tracker has no room for
+	constexpr uint32_t kDeviceButtons = kButtons + 4;
+
+	// The tracker as the header describes it, one bool per button.
+	struct ReferenceModel
+	{
+		bool down[kButtons] = {};
+		bool justPressed[kButtons] = {};
+		uint32_t lastPressTimestamp = 0;
+
+		void beginFrame()
+		{
+			for (bool& pressed : justPressed)
+			{
+				pressed = false;
+			}
+		}
+
+		void apply(const ButtonEvent& event)
+		{
+			if (event.button >= kButtons)
+			{
+				return;
+			}
+			if (event.pressed && !down[event.button])
+			{
+				justPressed[event.button] = true;
+				lastPressTimestamp = event.timestamp;
+			}
+			down[event.button] = event.pressed;
+		}
+
+		void resync(const bool* state)
+		{
+			for (uint32_t button = 0; button < kButtons; ++button)
+			{
+				justPressed[button] = justPressed[button] || (state[button] && !down[button]);
+				down[button] = state[button];
+			}
+		}
+
+		void reset()
+		{
+			*this = ReferenceModel();
+		}
+	};
+
+	bool matches(const ButtonEdgeTracker& tracker, const ReferenceModel& model)
+	{
+		ButtonSet down;
+		ButtonSet justPressed;
+		for (uint32_t button = 0; button < kButtons; ++button)
+		{
+			if (tracker.isDown(button) != model.down[button] || tracker.isJustPressed(button) != model.justPressed[button])
+			{
+				return false;
+			}
+			if (model.down[button]) { down.set(button); }
+			if (model.justPressed[button]) { justPressed.set(button); }
+		}
+		return tracker.down() == down && tracker.justPressed() == justPressed && tracker.lastPressTimestamp() == model.lastPressTimestamp
+			&& down.any() == tracker.down().any() && justPressed.any() == tracker.justPressed().any();
+	}
+
+	void printUsage()
+	{
+		std::fprintf(stderr, "Usage: ButtonEdgeFuzz [--frames <default 1000000>] [--buffer <events, default 16>] [--seed <n>]\n");
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	int frames = 1000000;
+	int bufferSize = 16;
+	unsigned seed = std::random_device{}();
+	Options options;
+	options.add("--frames", frames);
+	options.add("--buffer", bufferSize);
+	options.add("--seed", seed);
+	if (!options.parse(argc, argv))
+	{
+		printUsage();
+		return 1;
+	}
+	if (frames < 1 || bufferSize < 1)
+	{
+		printUsage();
+		return 1;
+	}
+	std::printf("Seed %u\n", seed);
+
+	// out of range buttons are never set
+	ButtonSet outOfRange;
+	for (uint32_t button = kButtons; button < kDeviceButtons; ++button)
+	{
+		outOfRange.set(button);
+	}
+	bool ok = report("buttons past the last one are ignored by the set", !outOfRange.any() && !outOfRange.test(kButtons));
+
+	std::mt19937 random(seed);
+	// most buttons are rarely touched, a few (the ones bound) often
+	std::uniform_int_distribution<uint32_t> anyButton(0, kDeviceButtons - 1);
+	std::uniform_int_distribution<uint32_t> hotButton(0, 7);
+	ButtonEdgeTracker tracker;
+	ReferenceModel model;
+	bool device[kDeviceButtons] = {};
+	bool frameStart[kDeviceButtons] = {};
+	uint32_t clock = 0;
+	std::vector<ButtonEvent> events;
+	uint64_t eventCount = 0;
+	uint64_t lostEvents = 0;
+	uint64_t overflows = 0;
+	uint64_t resets = 0;
+	bool modelMatches = true;
+	bool deviceMatches = true;
+	bool pressesSeen = true;
+	int firstBadFrame = -1;
+	for (int frame = 0; frame < frames; ++frame)
+	{
+		tracker.beginFrame();
+		model.beginFrame();
+		std::memcpy(frameStart, device, sizeof(device));
+		if (0 == random() % 5000)
+		{
+			// the device changed: the tracker forgets, the new device starts with nothing down
+			tracker.reset();
+			model.reset();
+			std::memset(device, 0, sizeof(device));
+			std::memset(frameStart, 0, sizeof(frameStart));
+			++resets;
+		}
+
+		// the events since the last frame: mostly a few, sometimes a burst
+		events.clear();
+		const uint32_t count = 0 == random() % 50 ? random() % (4 * static_cast<uint32_t>(bufferSize)) : random() % 4;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			ButtonEvent event;
+			event.button = 0 == random() % 3 ? anyButton(random) : hotButton(random);
+			// usually a change, sometimes a repeated press or a release of a button which isn't down
+			event.pressed = 0 == random() % 8 ? 0 != random() % 2 : !device[event.button];
+			clock += 1 + random() % 3;
+			event.timestamp = clock;
+			device[event.button] = event.pressed;
+			events.push_back(event);
+		}
+		eventCount += events.size();
+
+		// what fits in the buffer is delivered, the rest is lost and the state read in full
+		const size_t delivered = events.size() > static_cast<size_t>(bufferSize) ? static_cast<size_t>(bufferSize) : events.size();
+		for (size_t i = 0; i < delivered; ++i)
+		{
+			tracker.apply(events[i]);
+			model.apply(events[i]);
+		}
+		if (delivered < events.size())
+		{
+			ButtonSet state;
+			for (uint32_t button = 0; button < kDeviceButtons; ++button)
+			{
+				if (device[button]) { state.set(button); }
+			}
+			tracker.resync(state);
+			model.resync(device);
+			lostEvents += events.size() - delivered;
+			++overflows;
+		}
+
+		const bool matched = matches(tracker, model);
+		bool sameAsDevice = true;
+		bool pressed = true;
+		for (uint32_t button = 0; button < kButtons; ++button)
+		{
+			sameAsDevice = sameAsDevice && tracker.isDown(button) == device[button];
+			pressed = pressed && (!device[button] || frameStart[button] || tracker.isJustPressed(button));
+		}
+		modelMatches = modelMatches && matched;
+		deviceMatches = deviceMatches && sameAsDevice;
+		pressesSeen = pressesSeen && pressed;
+		if (firstBadFrame < 0 && !(matched && sameAsDevice && pressed))
+		{
+			firstBadFrame = frame;
+		}
+	}
+	std::printf("        %d frames, %llu events, %llu overflows losing %llu events, %llu resets\n", frames,
+		static_cast<unsigned long long>(eventCount), static_cast<unsigned long long>(overflows), static_cast<unsigned long long>(lostEvents),
+		static_cast<unsigned long long>(resets));
+	if (firstBadFrame >= 0)
+	{
+		std::printf("        first difference in frame %d\n", firstBadFrame);
+	}
+	ok = report("the tracker matches the reference model every frame", modelMatches) && ok;
+	ok = report("the buttons down are the device's, events lost or not", deviceMatches) && ok;
+	ok = report("a button which went down in a frame is just pressed", pressesSeen && overflows > 0) && ok;
+
+	return finish(ok);
+}
@@ -0,0 +1,96 @@
+// Measures the call cost of the clock all subsystems share (see MonotonicClock.h): the system clock (QueryPerformanceCounter
+// on Windows, clock_gettime(CLOCK_MONOTONIC) elsewhere), the calibrated TSC fast path and, for reference, std::chrono's
+// steady_clock and a bare rdtsc. Also reports how far the TSC fast path drifts from the system clock.
+//
+// Usage: ClockBenchmark [--calls <n per clock>] [--drift <seconds>]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "../../InjectableGenericCameraSystem/MonotonicClock.h"
+
+using namespace IGCS;
+
+namespace
+{
+	// keeps the compiler from dropping the calls
+	volatile int64_t sink = 0;
+
+	template<typename Read>
+	double nanosecondsPerCall(size_t calls, Read read)
+	{
+		// best of a few runs, to leave out preemption
+		double best = 1e30;
+		for (int run = 0; run < 5; ++run)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			int64_t sum = 0;
+			for (size_t i = 0; i < calls; ++i)
+			{
+				sum += read();
+			}
+			const auto end = std::chrono::steady_clock::now();
+			sink = sum;
+			const double perCall = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()) / static_cast<double>(calls);
+			if (perCall < best)
+			{
+				best = perCall;
+			}
+		}
+		return best;
+	}
+
+	void printUsage()
+	{
+		std::fprintf(stderr, "Usage: ClockBenchmark [--calls <n per clock, default 10000000>] [--drift <seconds, default 2>]\n");
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	size_t calls = 10000000;
+	double driftSeconds = 2.0;
+	for (int i = 1; i < argc; ++i)
+	{
+		const bool hasValue = i + 1 < argc;
+		if (hasValue && 0 == std::strcmp(argv[i], "--calls")) { calls = std::strtoul(argv[++i], nullptr, 10); }
+		else if (hasValue && 0 == std::strcmp(argv[i], "--drift")) { driftSeconds = std::strtod(argv[++i], nullptr); }
+		else
+		{
+			printUsage();
+			return 1;
+		}
+	}
+	if (calls < 1000 || driftSeconds < 0.0)
+	{
+		printUsage();
+		return 1;
+	}
+
+	std::printf("%zu calls per clock, best of 5 runs\n\n", calls);
+	std::printf("%-28s %10.1f ns/call\n", "system clock", nanosecondsPerCall(calls, [] { return MonotonicClock::systemNow(); }));
+	std::printf("%-28s %10.1f ns/call\n", "std::chrono::steady_clock", nanosecondsPerCall(calls, [] { return static_cast<int64_t>(std::chrono::steady_clock::now().time_since_epoch().count()); }));
+
+	if (!MonotonicClock::enableTscFastPath())
+	{
+		std::printf("\nNo invariant TSC, MonotonicClock::now() uses the system clock.\n");
+		return 0;
+	}
+	std::printf("%-28s %10.1f ns/call\n", "MonotonicClock::now (TSC)", nanosecondsPerCall(calls, [] { return MonotonicClock::now(); }));
+	std::printf("%-28s %10.1f ns/call\n", "rdtsc", nanosecondsPerCall(calls, [] { return static_cast<int64_t>(MonotonicClock::readTsc()); }));
+	std::printf("\nTSC: %.3f MHz\n", MonotonicClock::tscTicksPerSecond() / 1e6);
+
+	if (driftSeconds > 0.0)
+	{
+		const int64_t startDifference = MonotonicClock::now() - MonotonicClock::systemNow();
+		const int64_t start = MonotonicClock::systemNow();
+		while (MonotonicClock::systemNow() - start < MonotonicClock::fromSeconds(driftSeconds))
+		{
+		}
+		const int64_t endDifference = MonotonicClock::now() - MonotonicClock::systemNow();
+		const double drift = static_cast<double>(endDifference - startDifference);
+		std::printf("TSC drift against the system clock: %.0f ns over %.1f s (%.2f ppm)\n", drift, driftSeconds, drift / (driftSeconds * 1e3));
+	}
+	return 0;
+}
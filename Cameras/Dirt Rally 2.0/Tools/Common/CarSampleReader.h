@@ -0,0 +1,119 @@
+#pragma once
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "../../InjectableGenericCameraSystem/CameraSmoothing.h"
+
+// Streaming reader for recorded car transforms. The format is plain text, one sample per line:
+//
+//		time,posX,posY,posZ,rotX,rotY,rotZ,rotW
+//
+// time is in seconds, the position is the car position and the rotation the car quaternion as read by
+// CameraManipulator::getCurrentPlayerPosition / getCurrentPlayerRotation. Empty lines, lines starting with '#' and a
+// header line starting with a letter are skipped. Samples are handed out in caller-sized blocks so files of any length
+// can be processed in constant memory.
+namespace IGCS::Tools
+{
+	struct CarSample
+	{
+		double time = 0.0;
+		Smoothing::Vec3 position;
+		Smoothing::Quat rotation;
+	};
+
+	class CarSampleReader
+	{
+	public:
+		CarSampleReader() = default;
+		~CarSampleReader() { close(); }
+
+		CarSampleReader(const CarSampleReader&) = delete;
+		CarSampleReader& operator=(const CarSampleReader&) = delete;
+
+		bool open(const std::string& path)
+		{
+			close();
+			_file = std::fopen(path.c_str(), "rb");
+			_lineNumber = 0;
+			_malformedLines = 0;
+			return nullptr != _file;
+		}
+
+		void close()
+		{
+			if (nullptr != _file)
+			{
+				std::fclose(_file);
+				_file = nullptr;
+			}
+		}
+
+		// Reads up to maxSamples samples into destination. Returns the number read; 0 means end of file.
+		size_t readBlock(CarSample* destination, size_t maxSamples)
+		{
+			if (nullptr == _file)
+			{
+				return 0;
+			}
+			size_t count = 0;
+			while (count < maxSamples && std::fgets(_line, sizeof(_line), _file))
+			{
+				++_lineNumber;
+				if (parseLine(_line, destination[count]))
+				{
+					++count;
+				}
+			}
+			return count;
+		}
+
+		[[nodiscard]] size_t malformedLines() const { return _malformedLines; }
+
+	private:
+		bool parseLine(char* line, CarSample& sample)
+		{
+			while (*line == ' ' || *line == '\t')
+			{
+				++line;
+			}
+			if (*line == '\0' || *line == '\r' || *line == '\n' || *line == '#')
+			{
+				return false;
+			}
+			if ((*line >= 'a' && *line <= 'z') || (*line >= 'A' && *line <= 'Z'))
+			{
+				// column header
+				return false;
+			}
+
+			double values[8];
+			char* cursor = line;
+			for (int i = 0; i < 8; ++i)
+			{
+				char* end = nullptr;
+				values[i] = std::strtod(cursor, &end);
+				if (end == cursor)
+				{
+					++_malformedLines;
+					return false;
+				}
+				cursor = end;
+				while (*cursor == ',' || *cursor == ';' || *cursor == ' ' || *cursor == '\t')
+				{
+					++cursor;
+				}
+			}
+			sample.time = values[0];
+			sample.position = { static_cast<float>(values[1]), static_cast<float>(values[2]), static_cast<float>(values[3]) };
+			sample.rotation = Smoothing::normalize({ static_cast<float>(values[4]), static_cast<float>(values[5]),
+													 static_cast<float>(values[6]), static_cast<float>(values[7]) });
+			return true;
+		}
+
+		std::FILE* _file = nullptr;
+		char _line[512] = {};
+		size_t _lineNumber = 0;
+		size_t _malformedLines = 0;
+	};
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// In-place iterative radix-2 FFT for the offline tools. Twiddles and the bit reversal permutation are computed once per
+// size, so transforming many equally sized segments costs no trigonometry.
+namespace IGCS::Tools
+{
+	class Fft
+	{
+	public:
+		// size has to be a power of two.
+		explicit Fft(size_t size) : _size(size), _twiddles(size / 2), _reversed(size)
+		{
+			const double pi = 3.14159265358979323846;
+			for (size_t i = 0; i < size / 2; ++i)
+			{
+				const double angle = -2.0 * pi * static_cast<double>(i) / static_cast<double>(size);
+				_twiddles[i] = { std::cos(angle), std::sin(angle) };
+			}
+			size_t bits = 0;
+			while ((size_t(1) << bits) < size)
+			{
+				++bits;
+			}
+			for (size_t i = 0; i < size; ++i)
+			{
+				size_t reversed = 0;
+				for (size_t b = 0; b < bits; ++b)
+				{
+					reversed |= ((i >> b) & 1) << (bits - 1 - b);
+				}
+				_reversed[i] = reversed;
+			}
+		}
+
+		[[nodiscard]] size_t size() const { return _size; }
+
+		static bool isPowerOfTwo(size_t value) { return value >= 2 && (value & (value - 1)) == 0; }
+
+		void transform(std::vector<std::complex<double>>& data) const
+		{
+			for (size_t i = 0; i < _size; ++i)
+			{
+				if (i < _reversed[i])
+				{
+					std::swap(data[i], data[_reversed[i]]);
+				}
+			}
+			for (size_t length = 2; length <= _size; length <<= 1)
+			{
+				const size_t half = length / 2;
+				const size_t stride = _size / length;
+				for (size_t start = 0; start < _size; start += length)
+				{
+					for (size_t k = 0; k < half; ++k)
+					{
+						const std::complex<double> t = _twiddles[k * stride] * data[start + k + half];
+						data[start + k + half] = data[start + k] - t;
+						data[start + k] += t;
+					}
+				}
+			}
+		}
+
+	private:
+		size_t _size;
+		std::vector<std::complex<double>> _twiddles;
+		std::vector<size_t> _reversed;
+	};
+}
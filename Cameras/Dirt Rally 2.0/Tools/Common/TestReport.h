@@ -0,0 +1,101 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// What the test tools share: a line per check with its outcome, the verdict of the whole run as the exit code, and the
+// "--name value" options they take. Checks chain, so every one runs and prints even after one failed:
+//
+//		bool ok = report("first check", ...);
+//		ok = report("second check", ...) && ok;
+//		return finish(ok);
+namespace IGCS::Tools
+{
+	// Prints the check and OK or FAILED in a column. Returns ok. Keep the check at 60 characters at most.
+	inline bool report(const char* check, bool ok)
+	{
+		std::printf("%-60s %s\n", check, ok ? "OK" : "FAILED");
+		return ok;
+	}
+
+	// Prints the verdict. Returns the exit code: 1 if a check failed.
+	inline int finish(bool ok)
+	{
+		std::printf("%s\n", ok ? "OK" : "FAILED");
+		return ok ? 0 : 1;
+	}
+
+	// "--name value" options. The variables hold the defaults, parse overwrites the ones given.
+	class Options
+	{
+	public:
+		static constexpr int kMaxOptions = 8;
+
+		void add(const char* name, int& value) { push(name, Kind::Int, &value); }
+		void add(const char* name, unsigned& value) { push(name, Kind::Unsigned, &value); }
+		void add(const char* name, uint64_t& value) { push(name, Kind::Unsigned64, &value); }
+		void add(const char* name, double& value) { push(name, Kind::Double, &value); }
+
+		// The arguments from first on. False if one isn't an option added or has no value, print the usage then.
+		[[nodiscard]] bool parse(int argc, char** argv, int first = 1) const
+		{
+			for (int i = first; i < argc; ++i)
+			{
+				const Option* option = find(argv[i]);
+				if (nullptr == option || i + 1 >= argc)
+				{
+					return false;
+				}
+				const char* value = argv[++i];
+				switch (option->kind)
+				{
+				case Kind::Int: *static_cast<int*>(option->value) = std::atoi(value); break;
+				case Kind::Unsigned: *static_cast<unsigned*>(option->value) = static_cast<unsigned>(std::strtoul(value, nullptr, 10)); break;
+				case Kind::Unsigned64: *static_cast<uint64_t*>(option->value) = std::strtoull(value, nullptr, 10); break;
+				case Kind::Double: *static_cast<double*>(option->value) = std::strtod(value, nullptr); break;
+				}
+			}
+			return true;
+		}
+
+	private:
+		enum class Kind
+		{
+			Int,
+			Unsigned,
+			Unsigned64,
+			Double,
+		};
+
+		struct Option
+		{
+			const char* name;
+			Kind kind;
+			void* value;
+		};
+
+		void push(const char* name, Kind kind, void* value)
+		{
+			if (_count < kMaxOptions)
+			{
+				_options[_count++] = Option{ name, kind, value };
+			}
+		}
+
+		[[nodiscard]] const Option* find(const char* name) const
+		{
+			for (int i = 0; i < _count; ++i)
+			{
+				if (0 == std::strcmp(_options[i].name, name))
+				{
+					return &_options[i];
+				}
+			}
+			return nullptr;
+		}
+
+		Option _options[kMaxOptions] = {};
+		int _count = 0;
+	};
+}
@@ -0,0 +1,170 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Small work-stealing thread pool for the offline tools. Every worker owns a deque: it takes work from the back of its
+// own deque and, when that runs dry, steals from the front of the other workers' deques. Tasks submitted from outside
+// the pool are spread round-robin over the workers.
+namespace IGCS::Tools
+{
+	class WorkStealingPool
+	{
+	public:
+		using Task = std::function<void()>;
+
+		explicit WorkStealingPool(unsigned threadCount = 0)
+		{
+			if (threadCount == 0)
+			{
+				threadCount = std::max(1u, std::thread::hardware_concurrency());
+			}
+			_queues.reserve(threadCount);
+			for (unsigned i = 0; i < threadCount; ++i)
+			{
+				_queues.emplace_back(std::make_unique<WorkerQueue>());
+			}
+			_workers.reserve(threadCount);
+			for (unsigned i = 0; i < threadCount; ++i)
+			{
+				_workers.emplace_back([this, i] { workerLoop(i); });
+			}
+		}
+
+		~WorkStealingPool()
+		{
+			{
+				std::lock_guard<std::mutex> lock(_signalMutex);
+				_stopping = true;
+			}
+			_workAvailable.notify_all();
+			for (auto& worker : _workers)
+			{
+				worker.join();
+			}
+		}
+
+		WorkStealingPool(const WorkStealingPool&) = delete;
+		WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+		[[nodiscard]] size_t threadCount() const { return _workers.size(); }
+
+		void submit(Task task)
+		{
+			const size_t target = _nextQueue.fetch_add(1, std::memory_order_relaxed) % _queues.size();
+			_outstanding.fetch_add(1, std::memory_order_relaxed);
+			{
+				// counted before it's visible, so a worker which grabs it early never sees the counter go below zero
+				std::lock_guard<std::mutex> lock(_signalMutex);
+				++_queuedTasks;
+			}
+			{
+				std::lock_guard<std::mutex> lock(_queues[target]->mutex);
+				_queues[target]->tasks.push_back(std::move(task));
+			}
+			_workAvailable.notify_one();
+		}
+
+		// Runs body(begin, end) over [0, count) in chunks of at most grainSize and blocks till all chunks are done.
+		void parallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& body)
+		{
+			grainSize = std::max<size_t>(1, grainSize);
+			for (size_t begin = 0; begin < count; begin += grainSize)
+			{
+				const size_t end = std::min(count, begin + grainSize);
+				submit([&body, begin, end] { body(begin, end); });
+			}
+			waitIdle();
+		}
+
+		void waitIdle()
+		{
+			std::unique_lock<std::mutex> lock(_signalMutex);
+			_idle.wait(lock, [this] { return _outstanding.load(std::memory_order_acquire) == 0; });
+		}
+
+	private:
+		struct WorkerQueue
+		{
+			std::mutex mutex;
+			std::deque<Task> tasks;
+		};
+
+		bool tryPopOwn(size_t index, Task& task)
+		{
+			auto& queue = *_queues[index];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (queue.tasks.empty())
+			{
+				return false;
+			}
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+			return true;
+		}
+
+		bool trySteal(size_t thief, Task& task)
+		{
+			const size_t queueCount = _queues.size();
+			for (size_t offset = 1; offset < queueCount; ++offset)
+			{
+				auto& victim = *_queues[(thief + offset) % queueCount];
+				std::lock_guard<std::mutex> lock(victim.mutex);
+				if (!victim.tasks.empty())
+				{
+					task = std::move(victim.tasks.front());
+					victim.tasks.pop_front();
+					return true;
+				}
+			}
+			return false;
+		}
+
+		void workerLoop(size_t index)
+		{
+			while (true)
+			{
+				Task task;
+				if (tryPopOwn(index, task) || trySteal(index, task))
+				{
+					{
+						std::lock_guard<std::mutex> lock(_signalMutex);
+						--_queuedTasks;
+					}
+					task();
+					if (_outstanding.fetch_sub(1, std::memory_order_acq_rel) == 1)
+					{
+						std::lock_guard<std::mutex> lock(_signalMutex);
+						_idle.notify_all();
+					}
+					continue;
+				}
+
+				std::unique_lock<std::mutex> lock(_signalMutex);
+				_workAvailable.wait(lock, [this] { return _stopping || _queuedTasks > 0; });
+				if (_stopping && _queuedTasks == 0)
+				{
+					return;
+				}
+			}
+		}
+
+		std::vector<std::unique_ptr<WorkerQueue>> _queues;
+		std::vector<std::thread> _workers;
+		std::atomic<size_t> _nextQueue{ 0 };
+		std::atomic<size_t> _outstanding{ 0 };
+
+		std::mutex _signalMutex;
+		std::condition_variable _workAvailable;
+		std::condition_variable _idle;
+		size_t _queuedTasks = 0;
+		bool _stopping = false;
+	};
+}
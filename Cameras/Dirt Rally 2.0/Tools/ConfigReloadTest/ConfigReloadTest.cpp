@@ -0,0 +1,305 @@
+// Tests the hot reload of dr2tools.cfg (see FileWatcher.h and SnapshotStore.h) against a file in a temporary directory. A
+// writer edits the file the ways editors do: rewriting it in place, writing a temporary file and renaming it over the
+// original, saving without changes, writing an invalid value and deleting and recreating it. A listener parses it the way
+// Config does (invalid values keep the previous one) and publishes snapshots, while a render thread reads a snapshot per
+// frame and checks it's never torn. Checks that every real change is reported once, unchanged saves aren't reported at all,
+// the last value wins and retired snapshots are freed after the grace period, and prints the change to publish latency.
+// Exits with 1 if a check fails. Build it with the address sanitizer to catch a snapshot freed too early; the thread sanitizer
+// reports every reclamation, as the grace period is an ordering in time it can't see.
+//
+// Usage: ConfigReloadTest [--edits <n>] [--fps <frame rate>] [--seed <n>]
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../../InjectableGenericCameraSystem/FileWatcher.h"
+#include "../../InjectableGenericCameraSystem/MonotonicClock.h"
+#include "../../InjectableGenericCameraSystem/SnapshotStore.h"
+
+using namespace IGCS;
+namespace fs = std::filesystem;
+
+namespace
+{
+	// two copies of the value, a torn or freed snapshot shows up as a mismatch
+	struct TestSettings
+	{
+		int blend = 12;
+		int blendCheck = -12;
+		uint32_t generation = 0;
+	};
+
+	class Listener : public IFileChangeListener
+	{
+	public:
+		void fileChanged(const std::string& contents) override
+		{
+			const TestSettings* current = store.get();
+			auto next = std::make_unique<TestSettings>(*current);
+			next->generation = current->generation + 1;
+			const size_t position = contents.find("blend=");
+			if (std::string::npos != position)
+			{
+				const int parsed = std::atoi(contents.c_str() + position + 6);
+				if (parsed > 0 && parsed <= 100)
+				{
+					next->blend = parsed;
+					next->blendCheck = -parsed;
+				}
+			}
+			store.publish(std::move(next));
+			lastPublish.store(MonotonicClock::now(), std::memory_order_release);
+		}
+
+		SnapshotStore<TestSettings> store;
+		std::atomic<int64_t> lastPublish{ 0 };
+	};
+
+	enum class Edit
+	{
+		InPlace,
+		Rename,
+		Unchanged,
+		Invalid,
+		Recreate,
+		Count,
+	};
+
+	const char* editName(Edit edit)
+	{
+		switch (edit)
+		{
+		case Edit::InPlace: return "in place";
+		case Edit::Rename: return "rename";
+		case Edit::Unchanged: return "unchanged";
+		case Edit::Invalid: return "invalid";
+		case Edit::Recreate: return "recreate";
+		default: return "unknown";
+		}
+	}
+
+	void writeFile(const fs::path& path, const std::string& contents)
+	{
+		std::ofstream out(path, std::ios::binary | std::ios::trunc);
+		out << contents;
+	}
+
+	std::string configText(int blend)
+	{
+		return "# DR2Tools Configuration\r\nblend=" + std::to_string(blend) + "\r\nshake_amplitude=0.0\r\n";
+	}
+
+	bool waitFor(const FileWatcher& watcher, uint32_t reports, int64_t timeout)
+	{
+		const int64_t end = MonotonicClock::now() + timeout;
+		while (watcher.changesReported() < reports)
+		{
+			if (MonotonicClock::now() > end)
+			{
+				return false;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		}
+		return true;
+	}
+
+	double percentile(std::vector<double>& values, double fraction)
+	{
+		if (values.empty())
+		{
+			return 0.0;
+		}
+		const size_t index = static_cast<size_t>(fraction * static_cast<double>(values.size() - 1) + 0.5);
+		std::nth_element(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(index), values.end());
+		return values[index];
+	}
+
+	void printUsage()
+	{
+		std::fprintf(stderr, "Usage: ConfigReloadTest [--edits <n, default 40>] [--fps <default 60>] [--seed <n>]\n");
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	int edits = 40;
+	double fps = 60.0;
+	uint32_t seed = std::random_device{}();
+	for (int i = 1; i < argc; ++i)
+	{
+		const bool hasValue = i + 1 < argc;
+		if (hasValue && 0 == std::strcmp(argv[i], "--edits")) { edits = std::atoi(argv[++i]); }
+		else if (hasValue && 0 == std::strcmp(argv[i], "--fps")) { fps = std::strtod(argv[++i], nullptr); }
+		else if (hasValue && 0 == std::strcmp(argv[i], "--seed")) { seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)); }
+		else
+		{
+			printUsage();
+			return 1;
+		}
+	}
+	if (edits < 1 || fps < 1.0)
+	{
+		printUsage();
+		return 1;
+	}
+
+	const fs::path directory = fs::temp_directory_path() / ("ConfigReloadTest-" + std::to_string(seed));
+	fs::create_directories(directory);
+	const fs::path path = directory / "dr2tools.cfg";
+	std::string contents = configText(12);
+	writeFile(path, contents);
+
+	// the store leaks what it holds, like Config's, so the listener lives on in a static for the leak checker
+	static Listener* const s_listener = new Listener();
+	Listener& listener = *s_listener;
+	listener.store.publish(std::make_unique<TestSettings>());
+	FileWatcher watcher;
+	if (!watcher.start(path, listener, contents))
+	{
+		std::fprintf(stderr, "Can't watch %s\n", path.string().c_str());
+		return 1;
+	}
+
+	// render thread: one snapshot per frame
+	std::atomic<bool> done{ false };
+	uint64_t frames = 0;
+	uint64_t torn = 0;
+	uint64_t generationsSeen = 0;
+	std::thread render([&]
+	{
+		uint32_t lastGeneration = 0;
+		const auto framePeriod = std::chrono::nanoseconds(static_cast<int64_t>(1e9 / fps));
+		while (!done.load(std::memory_order_acquire))
+		{
+			const TestSettings& settings = *listener.store.get();
+			if (settings.blend != -settings.blendCheck)
+			{
+				++torn;
+			}
+			if (settings.generation != lastGeneration)
+			{
+				++generationsSeen;
+				lastGeneration = settings.generation;
+			}
+			++frames;
+			std::this_thread::sleep_for(framePeriod);
+		}
+	});
+
+	std::mt19937 random(seed);
+	std::uniform_int_distribution<int> editKind(0, static_cast<int>(Edit::Count) - 1);
+	int expectedBlend = 12;
+	uint32_t expectedReports = 0;
+	uint64_t missed = 0;
+	uint64_t spurious = 0;
+	uint64_t wrongValue = 0;
+	std::vector<double> latencies;
+	for (int i = 0; i < edits; ++i)
+	{
+		const Edit edit = static_cast<Edit>(editKind(random));
+		const int blend = 1 + (expectedBlend + 1 + static_cast<int>(random() % 98)) % 100;
+		std::string next = configText(blend);
+		const int64_t editTime = MonotonicClock::now();
+		switch (edit)
+		{
+		case Edit::InPlace:
+			writeFile(path, next);
+			break;
+		case Edit::Rename:
+		{
+			const fs::path temporary = directory / "dr2tools.cfg.tmp";
+			writeFile(temporary, next);
+			fs::rename(temporary, path);
+			break;
+		}
+		case Edit::Unchanged:
+			next = contents;
+			writeFile(path, next);
+			break;
+		case Edit::Invalid:
+			next = "# DR2Tools Configuration\r\nblend=-5\r\n";
+			writeFile(path, next);
+			break;
+		case Edit::Recreate:
+			fs::remove(path);
+			std::this_thread::sleep_for(std::chrono::milliseconds(FileWatcher::kSettleTimeMs * 2));
+			writeFile(path, next);
+			break;
+		default:
+			break;
+		}
+
+		if (next == contents)
+		{
+			// nothing may be reported, give the watcher time to get it wrong
+			std::this_thread::sleep_for(std::chrono::milliseconds(FileWatcher::kSettleTimeMs * 3));
+			if (watcher.changesReported() != expectedReports)
+			{
+				++spurious;
+				expectedReports = watcher.changesReported();
+			}
+			continue;
+		}
+		contents = next;
+		++expectedReports;
+		if (!waitFor(watcher, expectedReports, MonotonicClock::fromSeconds(3.0)))
+		{
+			std::printf("edit %d (%s): not reported\n", i, editName(edit));
+			++missed;
+			expectedReports = watcher.changesReported();
+			continue;
+		}
+		if (watcher.changesReported() > expectedReports)
+		{
+			++spurious;
+			expectedReports = watcher.changesReported();
+		}
+		if (Edit::Invalid != edit)
+		{
+			expectedBlend = blend;
+		}
+		if (listener.store.get()->blend != expectedBlend)
+		{
+			std::printf("edit %d (%s): blend %d, expected %d\n", i, editName(edit), listener.store.get()->blend, expectedBlend);
+			++wrongValue;
+		}
+		latencies.push_back(MonotonicClock::toSeconds(listener.lastPublish.load(std::memory_order_acquire) - editTime) * 1000.0);
+	}
+
+	// a little while for late, spurious reports
+	std::this_thread::sleep_for(std::chrono::milliseconds(FileWatcher::kSettleTimeMs * 3));
+	if (watcher.changesReported() != expectedReports)
+	{
+		++spurious;
+	}
+	watcher.stop();
+	done.store(true, std::memory_order_release);
+	render.join();
+
+	// everything retired so far is past the grace period for this publish
+	const size_t retiredBefore = listener.store.retiredCount();
+	listener.store.publish(std::make_unique<TestSettings>(), MonotonicClock::now() + SnapshotStore<TestSettings>::kGracePeriod);
+	const size_t retiredAfter = listener.store.retiredCount();
+	std::error_code error;
+	fs::remove_all(directory, error);
+
+	std::printf("%d edits, %u reported, %llu snapshots seen in %llu frames, seed %u\n", edits, expectedReports,
+		static_cast<unsigned long long>(generationsSeen), static_cast<unsigned long long>(frames), seed);
+	std::printf("change to publish latency p50 %.1f ms, max %.1f ms (settle time %d ms)\n", percentile(latencies, 0.5),
+		latencies.empty() ? 0.0 : *std::max_element(latencies.begin(), latencies.end()), FileWatcher::kSettleTimeMs);
+	std::printf("retired snapshots %zu, %zu after the grace period\n", retiredBefore, retiredAfter);
+	const bool ok = 0 == missed && 0 == spurious && 0 == wrongValue && 0 == torn && 1 == retiredAfter;
+	std::printf("%s: %llu missed, %llu spurious, %llu wrong values, %llu torn reads\n", ok ? "OK" : "FAILED",
+		static_cast<unsigned long long>(missed), static_cast<unsigned long long>(spurious), static_cast<unsigned long long>(wrongValue),
+		static_cast<unsigned long long>(torn));
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,227 @@
+// Tests the device discovery the DirectInput pad is opened with (see DeviceDiscovery.h), with a fake device provider and a fake
+// clock: the worker is stepped at the deadlines step() returns. Checks a search at startup, the backoff doubling from 0.5s to
+// 30s while no device is found, a device change notification searching right away and starting the backoff over, and a device
+// the reader reports lost being closed on the worker and searched again. Then a reader thread which keeps losing devices runs
+// against a worker thread, every device must be closed exactly once and never handed out after it was lost. Exits with 1 if a
+// check fails.
+//
+// Usage: DeviceDiscoveryTest [--rounds 200000] [--seed <n>]
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+#include "../Common/TestReport.h"
+#include "../../InjectableGenericCameraSystem/DeviceDiscovery.h"
+
+using namespace IGCS;
+using namespace IGCS::Tools;
+
+namespace
+{
+	constexpr int64_t kSecond = 1000000000LL;
+
+	struct FakeDevice
+	{
+		std::atomic<int> closes{ 0 };
+		std::atomic<bool> lost{ false };
+	};
+
+	// Hands out devices from a pool when available is set, counts what's called.
+	class FakeProvider : public IDeviceProvider
+	{
+	public:
+		explicit FakeProvider(size_t poolSize) : _pool(poolSize)
+		{
+		}
+
+		void* open() noexcept override
+		{
+			++opens;
+			const size_t next = _next.load(std::memory_order_relaxed);
+			if (!available.load(std::memory_order_relaxed) || next >= _pool.size())
+			{
+				return nullptr;
+			}
+			_next.store(next + 1, std::memory_order_relaxed);
+			return &_pool[next];
+		}
+
+		void close(void* device) noexcept override
+		{
+			++closes;
+			lastClosed = device;
+			static_cast<FakeDevice*>(device)->closes.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		void shutdown() noexcept override
+		{
+			++shutdowns;
+		}
+
+		// every device handed out was closed exactly once
+		[[nodiscard]] bool allClosedOnce() const
+		{
+			for (size_t i = 0; i < handedOut(); ++i)
+			{
+				if (1 != _pool[i].closes.load(std::memory_order_relaxed))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		// any thread
+		[[nodiscard]] size_t handedOut() const noexcept { return _next.load(std::memory_order_relaxed); }
+
+		std::atomic<bool> available{ false };
+		int opens = 0;
+		int closes = 0;
+		int shutdowns = 0;
+		void* lastClosed = nullptr;
+
+	private:
+		std::vector<FakeDevice> _pool;
+		std::atomic<size_t> _next{ 0 };
+	};
+
+	void printUsage()
+	{
+		std::fprintf(stderr, "Usage: DeviceDiscoveryTest [--rounds <default 200000>] [--seed <n>]\n");
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	int rounds = 200000;
+	unsigned seed = std::random_device{}();
+	Options options;
+	options.add("--rounds", rounds);
+	options.add("--seed", seed);
+	if (!options.parse(argc, argv))
+	{
+		printUsage();
+		return 1;
+	}
+	if (rounds < 1)
+	{
+		printUsage();
+		return 1;
+	}
+	std::printf("Seed %u\n", seed);
+
+	// startup: a search right away, none found
+	FakeProvider provider(16);
+	DeviceDiscovery discovery(provider);
+	int64_t now = 10 * kSecond;
+	int64_t deadline = discovery.step(now);
+	bool ok = report("searches at startup", 1 == provider.opens && nullptr == discovery.device()
+		&& now + DeviceDiscovery::kInitialBackoff == deadline);
+
+	// nothing found: 0.5s, 1s, 2s ... up to 30s between attempts
+	const int64_t expected[] = { 1, 2, 4, 8, 16, 30, 30, 30 };
+	bool backoff = true;
+	for (const int64_t seconds : expected)
+	{
+		// a step before the deadline, e.g. woken for another job, doesn't search
+		const int opensBefore = provider.opens;
+		backoff = backoff && deadline == discovery.step(deadline - 1) && opensBefore == provider.opens;
+		now = deadline;
+		deadline = discovery.step(now);
+		backoff = backoff && opensBefore + 1 == provider.opens && seconds * kSecond == deadline - now && seconds * kSecond == discovery.backoff();
+	}
+	ok = report("the backoff doubles from 0.5s to 30s", backoff && 1 + 8 == provider.opens) && ok;
+
+	// a device is attached halfway through a 30s wait: searched right away, the backoff starts over if it's not ready yet
+	now += 12 * kSecond;
+	discovery.devicesChanged();
+	deadline = discovery.step(now);
+	ok = report("a device change searches right away", 10 == provider.opens && now + DeviceDiscovery::kInitialBackoff == deadline
+		&& DeviceDiscovery::kInitialBackoff == discovery.backoff()) && ok;
+	provider.available = true;
+	now = deadline;
+	deadline = discovery.step(now);
+	void* first = discovery.device();
+	ok = report("and the device is picked up at the next attempt", 11 == provider.opens && nullptr != first
+		&& IDeviceJob::kNoDeadline == deadline && 0 == discovery.backoff()) && ok;
+	discovery.devicesChanged();
+	ok = report("with a device nothing is searched", IDeviceJob::kNoDeadline == discovery.step(now + kSecond) && 11 == provider.opens
+		&& first == discovery.device()) && ok;
+
+	// the reader loses the device: closed on the worker, then searched again in the same step
+	FakeDevice other;
+	const bool wrongDevice = !discovery.reportLost(&other) && !discovery.reportLost(nullptr) && first == discovery.device();
+	const bool lostReported = discovery.reportLost(first);
+	ok = report("only the current device can be reported lost", wrongDevice && lostReported && nullptr == discovery.device()
+		&& !discovery.reportLost(first) && 0 == provider.closes) && ok;
+	now += kSecond;
+	deadline = discovery.step(now);
+	void* second = discovery.device();
+	ok = report("a lost device is closed and another one opened", 1 == provider.closes && first == provider.lastClosed
+		&& 12 == provider.opens && nullptr != second && second != first && IDeviceJob::kNoDeadline == deadline) && ok;
+	provider.available = false;
+	discovery.reportLost(second);
+	now += kSecond;
+	deadline = discovery.step(now);
+	ok = report("if there's none, the backoff starts over", 2 == provider.closes && second == provider.lastClosed && 13 == provider.opens
+		&& now + DeviceDiscovery::kInitialBackoff == deadline) && ok;
+	provider.available = true;
+	discovery.step(deadline);
+	discovery.stop();
+	ok = report("stop closes the device and shuts the provider down", nullptr == discovery.device() && 3 == provider.closes
+		&& 1 == provider.shutdowns && provider.allClosedOnce()) && ok;
+
+	// a reader thread losing devices against a worker thread which finds one now and then
+	FakeProvider threadedProvider(static_cast<size_t>(rounds) + 1);
+	DeviceDiscovery threaded(threadedProvider);
+	std::atomic<bool> done{ false };
+	std::atomic<bool> wake{ false };
+	std::thread worker([&]
+	{
+		std::mt19937 random(seed);
+		int64_t clock = 0;
+		while (!done.load(std::memory_order_acquire))
+		{
+			threadedProvider.available.store(0 != random() % 3, std::memory_order_relaxed);
+			const int64_t next = threaded.step(clock);
+			// sleeps till the deadline or till woken, whichever comes first
+			clock = wake.exchange(false, std::memory_order_acq_rel) || IDeviceJob::kNoDeadline == next ? clock + 1 : next;
+			std::this_thread::yield();
+		}
+		threaded.stop();
+	});
+	std::mt19937 random(seed + 1);
+	int lost = 0;
+	bool neverStale = true;
+	while (lost < rounds && threadedProvider.handedOut() <= static_cast<size_t>(rounds))
+	{
+		void* device = threaded.device();
+		if (nullptr == device)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+		FakeDevice* fake = static_cast<FakeDevice*>(device);
+		// the reader uses it: it must be neither closed nor one it already gave up
+		neverStale = neverStale && 0 == fake->closes.load(std::memory_order_relaxed) && !fake->lost.load(std::memory_order_relaxed);
+		if (0 == random() % 4)
+		{
+			fake->lost.store(true, std::memory_order_relaxed);
+			if (threaded.reportLost(device))
+			{
+				wake.store(true, std::memory_order_release);
+				++lost;
+			}
+		}
+	}
+	done.store(true, std::memory_order_release);
+	worker.join();
+	std::printf("        %d devices lost, %zu opened in %d attempts\n", lost, threadedProvider.handedOut(), threadedProvider.opens);
+	ok = report("a device is never used after it was lost or closed", neverStale && lost > 0) && ok;
+	ok = report("every device opened is closed exactly once", threadedProvider.allClosedOnce() && 1 == threadedProvider.shutdowns) && ok;
+
+	return finish(ok);
+}
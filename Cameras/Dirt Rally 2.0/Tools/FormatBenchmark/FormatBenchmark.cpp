@@ -0,0 +1,372 @@
+// Benchmark for the formatting the camera uses for log lines and pipe messages (see FormatBuffer.h). First checks that formatting
+// into a fixed buffer through stb_sprintf gives the same text as vsnprintf, at every buffer size from too small to more than
+// enough, reports truncation exactly (a text which just fits isn't truncated) and measures lengths right. Then compares the cost
+// per message and the heap allocations per message of:
+// 1. old: the way Utils::formatStringVa and MessageHandler::logLine used to build a line: vsnprintf to measure, a new[] buffer,
+//    vsnprintf again, a std::string, and the timestamp through an ostringstream concatenated in front.
+// 2. vsnprintf: the CRT formatting into a fixed per thread buffer, the timestamp prefix copied in front.
+// 3. stb: the same through formatToVa.
+// and of decoding a string from a pipe message the old way (new[] copy and a std::string) and as a view (Utils::stringFromBytes).
+// Exits with 1 if a check fails or the new paths allocate.
+//
+// Usage: FormatBenchmark [--messages 1000000]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <new>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include "../../InjectableGenericCameraSystem/FormatBuffer.h"
+#include "../../InjectableGenericCameraSystem/MonotonicClock.h"
+// the dll compiles the stb_sprintf implementation in Utils.cpp
+#define STB_SPRINTF_IMPLEMENTATION
+#include "stb_sprintf.h"
+#undef STB_SPRINTF_IMPLEMENTATION
+
+using namespace IGCS;
+
+namespace
+{
+	std::atomic<uint64_t> allocations{ 0 };
+
+	// Every form of new allocates here and every form of delete frees with the matching function directly, so the compiler
+	// sees each pointer freed the way it was allocated (an array new forwarding to the scalar one trips -Wmismatched-new-delete).
+	void* allocate(size_t size)
+	{
+		allocations.fetch_add(1, std::memory_order_relaxed);
+		void* memory = std::malloc(0 == size ? 1 : size);
+		if (nullptr == memory)
+		{
+			throw std::bad_alloc();
+		}
+		return memory;
+	}
+
+	void* allocateAligned(size_t size, std::align_val_t alignment)
+	{
+		allocations.fetch_add(1, std::memory_order_relaxed);
+		const size_t align = static_cast<size_t>(alignment);
+#ifdef _MSC_VER
+		void* memory = _aligned_malloc(0 == size ? 1 : size, align);
+#else
+		// aligned_alloc wants a multiple of the alignment
+		void* memory = std::aligned_alloc(align, 0 == size ? align : (size + align - 1) / align * align);
+#endif
+		if (nullptr == memory)
+		{
+			throw std::bad_alloc();
+		}
+		return memory;
+	}
+
+	void freeAligned(void* memory) noexcept
+	{
+#ifdef _MSC_VER
+		_aligned_free(memory);
+#else
+		std::free(memory);
+#endif
+	}
+}
+
+// Counts every heap allocation made through new.
+void* operator new(size_t size) { return allocate(size); }
+void* operator new[](size_t size) { return allocate(size); }
+void* operator new(size_t size, std::align_val_t alignment) { return allocateAligned(size, alignment); }
+void* operator new[](size_t size, std::align_val_t alignment) { return allocateAligned(size, alignment); }
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory, size_t) noexcept { std::free(memory); }
+void operator delete(void* memory, std::align_val_t) noexcept { freeAligned(memory); }
+void operator delete(void* memory, size_t, std::align_val_t) noexcept { freeAligned(memory); }
+void operator delete[](void* memory, std::align_val_t) noexcept { freeAligned(memory); }
+void operator delete[](void* memory, size_t, std::align_val_t) noexcept { freeAligned(memory); }
+
+namespace
+{
+	constexpr size_t kLineSize = 2048;		// Utils' per thread buffer
+	constexpr const char* kMessageFormat = "Camera: blend %.4f, fov %.2f, mode %s, frame %d, keys 0x%04X";
+
+	// Formats with vsnprintf and with formatToVa into buffers of every size from 1 to past the length and compares.
+	bool checkFormat(const char* fmt, ...)
+	{
+		va_list args;
+		va_start(args, fmt);
+		va_list copy;
+		va_copy(copy, args);
+		char expected[kLineSize];
+		const int expectedLength = std::vsnprintf(expected, sizeof(expected), fmt, copy);
+		va_end(copy);
+		bool ok = expectedLength >= 0 && static_cast<size_t>(expectedLength) < sizeof(expected);
+		va_copy(copy, args);
+		const size_t measured = formattedLengthVa(fmt, copy);
+		va_end(copy);
+		if (ok && measured != static_cast<size_t>(expectedLength))
+		{
+			std::printf("format \"%s\": measured %zu characters, expected %d\n", fmt, measured, expectedLength);
+			ok = false;
+		}
+		const size_t length = static_cast<size_t>(expectedLength);
+		for (size_t size = 1; ok && size <= length + 2; ++size)
+		{
+			char formatted[kLineSize];
+			std::memset(formatted, '#', sizeof(formatted));
+			va_copy(copy, args);
+			const FormatResult result = formatToVa(formatted, size, fmt, copy);
+			va_end(copy);
+			const size_t expectedSize = length < size - 1 ? length : size - 1;
+			const bool expectedTruncated = length >= size;
+			if (result.text.data() != formatted || result.text.size() != expectedSize || result.truncated != expectedTruncated
+				|| 0 != std::memcmp(formatted, expected, expectedSize) || '\0' != formatted[expectedSize] || '#' != formatted[size])
+			{
+				std::printf("format \"%s\" into %zu bytes: \"%.*s\" (truncated %d), expected \"%.*s\" (truncated %d)\n", fmt, size,
+					static_cast<int>(result.text.size()), result.text.data(), result.truncated ? 1 : 0, static_cast<int>(expectedSize), expected,
+					expectedTruncated ? 1 : 0);
+				ok = false;
+			}
+		}
+		va_end(args);
+		return ok;
+	}
+
+	int checkFormats()
+	{
+		const std::string longText(1500, 'x');
+		int failures = 0;
+		failures += !checkFormat(kMessageFormat, 0.12, 75.0, "cockpit", 123456, 0x80u);
+		failures += !checkFormat("Config: %s value '%s' out of range (%g..%g). Keeping default (%.6f).", "blend", "2.5", 0.0001, 1.0, 0.12);
+		failures += !checkFormat("%d %i %u %x %X %o %c %%", -42, 17, 4000000000u, 0xbeefu, 0xbeefu, 8u, 'A');
+		failures += !checkFormat("%010x|%-6d|%+d|% d|%#x|%5.1f|%-8.3f|%e|%G|%.0f", 0x1234u, 5, 5, 5, 255u, 3.14159, -2.5, 12345.678, 0.000012, 0.7);
+		failures += !checkFormat("%llu %lld %zu", 18446744073709551615ull, -9223372036854775807ll - 1, sizeof(int));
+		failures += !checkFormat("%s|%10s|%-10s|%.3s", "abc", "right", "left", "truncate");
+		failures += !checkFormat("no conversions at all");
+		failures += !checkFormat("");
+		// longer than stb_sprintf's chunk, so it writes in place and through the chunk
+		failures += !checkFormat("%s and %d more", longText.c_str(), 1500);
+
+		// a conversion cut off by the end of the format string is left out instead of reading past the end
+		char formatted[64];
+		const FormatResult cutOff = formatTo(formatted, sizeof(formatted), "done 100%");
+		if (cutOff.text != "done 100" || cutOff.truncated)
+		{
+			std::printf("format \"done 100%%\": \"%s\", expected \"done 100\"\n", formatted);
+			++failures;
+		}
+		const FormatResult empty = formatTo(formatted, 0, "text");
+		if (!empty.text.empty() || !empty.truncated)
+		{
+			std::printf("format into 0 bytes: not reported as truncated\n");
+			++failures;
+		}
+		return failures;
+	}
+
+	// What Utils::formatStringVa did (without leaking the buffer, so the benchmark doesn't run out of memory).
+	std::string formatStringVaOld(const char* fmt, va_list args)
+	{
+		va_list copy;
+		va_copy(copy, args);
+		const int length = std::vsnprintf(nullptr, 0, fmt, copy);
+		va_end(copy);
+		char* buffer = new char[length + 2];
+		va_copy(copy, args);
+		std::vsnprintf(buffer, length + 1, fmt, copy);
+		va_end(copy);
+		std::string toReturn(buffer, length + 1);
+		delete[] buffer;
+		return toReturn;
+	}
+
+	void localTime(std::time_t seconds, std::tm& local)
+	{
+#ifdef _WIN32
+		localtime_s(&local, &seconds);
+#else
+		localtime_r(&seconds, &local);
+#endif
+	}
+
+	// The old line: formatted text, timestamp through an ostringstream, concatenated.
+	size_t lineOld(const char* fmt, ...)
+	{
+		va_list args;
+		va_start(args, fmt);
+		const std::string text = formatStringVaOld(fmt, args);
+		va_end(args);
+		std::tm local{};
+		localTime(std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()), local);
+		std::ostringstream stream;
+		stream << std::put_time(&local, "%H:%M:%S");
+		const std::string line = "[" + stream.str() + "] " + text;
+		return line.size();
+	}
+
+	// A per thread line buffer with the "[HH:MM:SS] " prefix, converted when the second changes, like the log writer does.
+	struct Line
+	{
+		char buffer[kLineSize] = {};
+		size_t prefixLength = 0;
+		std::time_t prefixSecond = -1;
+
+		size_t prefix()
+		{
+			const std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+			if (now != prefixSecond)
+			{
+				std::tm local{};
+				localTime(now, local);
+				prefixLength = std::strftime(buffer, sizeof(buffer), "[%H:%M:%S] ", &local);
+				prefixSecond = now;
+			}
+			return prefixLength;
+		}
+	};
+
+	thread_local Line line;
+
+	size_t lineVsnprintf(const char* fmt, ...)
+	{
+		const size_t prefix = line.prefix();
+		va_list args;
+		va_start(args, fmt);
+		const int length = std::vsnprintf(line.buffer + prefix, kLineSize - prefix, fmt, args);
+		va_end(args);
+		return prefix + static_cast<size_t>(std::min(length, static_cast<int>(kLineSize - prefix - 1)));
+	}
+
+	size_t lineStb(const char* fmt, ...)
+	{
+		const size_t prefix = line.prefix();
+		va_list args;
+		va_start(args, fmt);
+		const FormatResult result = formatToVa(line.buffer + prefix, kLineSize - prefix, fmt, args);
+		va_end(args);
+		return prefix + result.text.size();
+	}
+
+	// How Utils::stringFromBytes decoded a string from a pipe message (without the leak).
+	size_t stringFromBytesOld(uint8_t byteArray[], uint32_t arrayLength, int startIndex)
+	{
+		if (arrayLength < static_cast<uint32_t>(startIndex) + 4)
+		{
+			return 0;
+		}
+		const auto charInArray = reinterpret_cast<char*>(byteArray + startIndex);
+		const auto characters = new char[(arrayLength - startIndex) + 1];
+		std::memcpy(characters, charInArray, arrayLength - startIndex);
+		characters[(arrayLength - startIndex)] = '\0';
+		std::string toReturn(characters);
+		delete[] characters;
+		return toReturn.size();
+	}
+
+	// Utils::stringFromBytes now.
+	std::string_view stringFromBytes(uint8_t byteArray[], uint32_t arrayLength, int startIndex)
+	{
+		if (arrayLength < static_cast<uint32_t>(startIndex) + 4)
+		{
+			return {};
+		}
+		const auto charInArray = reinterpret_cast<const char*>(byteArray + startIndex);
+		const size_t maxLength = arrayLength - startIndex;
+		const auto terminator = static_cast<const char*>(std::memchr(charInArray, '\0', maxLength));
+		return std::string_view(charInArray, nullptr == terminator ? maxLength : static_cast<size_t>(terminator - charInArray));
+	}
+
+	struct Result
+	{
+		double nsPerCall;
+		double allocationsPerCall;
+		size_t checksum;
+	};
+
+	template<typename Call>
+	Result measure(int calls, Call&& call)
+	{
+		size_t checksum = 0;
+		const uint64_t allocationsBefore = allocations.load(std::memory_order_relaxed);
+		const int64_t start = MonotonicClock::now();
+		for (int i = 0; i < calls; ++i)
+		{
+			checksum += call(i);
+		}
+		const int64_t elapsed = MonotonicClock::now() - start;
+		const uint64_t allocated = allocations.load(std::memory_order_relaxed) - allocationsBefore;
+		return Result{ static_cast<double>(elapsed) / calls, static_cast<double>(allocated) / calls, checksum };
+	}
+
+	void printResult(const char* name, const Result& result, const Result& baseline)
+	{
+		std::printf("%-18s %8.1f ns per call, %5.2f allocations per call, %5.2fx\n", name, result.nsPerCall, result.allocationsPerCall,
+			baseline.nsPerCall / result.nsPerCall);
+	}
+
+	void printUsage()
+	{
+		std::fprintf(stderr, "Usage: FormatBenchmark [--messages <n, default 1000000>]\n");
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	int messages = 1000000;
+	for (int i = 1; i < argc; ++i)
+	{
+		const bool hasValue = i + 1 < argc;
+		if (hasValue && 0 == std::strcmp(argv[i], "--messages")) { messages = std::atoi(argv[++i]); }
+		else
+		{
+			printUsage();
+			return 1;
+		}
+	}
+	if (messages < 1)
+	{
+		printUsage();
+		return 1;
+	}
+	const int formatFailures = checkFormats();
+	std::printf("format  matches vsnprintf at every buffer size, truncation reported exactly: %s\n", 0 == formatFailures ? "OK" : "FAILED");
+	bool ok = 0 == formatFailures;
+
+	const char* modes[] = { "cockpit", "bonnet", "chase far" };
+	const Result old = measure(messages, [&](int i) { return lineOld(kMessageFormat, 0.12 + i * 1e-7, 75.0, modes[i % 3], i, 0x80u); });
+	const Result crt = measure(messages, [&](int i) { return lineVsnprintf(kMessageFormat, 0.12 + i * 1e-7, 75.0, modes[i % 3], i, 0x80u); });
+	const Result stb = measure(messages, [&](int i) { return lineStb(kMessageFormat, 0.12 + i * 1e-7, 75.0, modes[i % 3], i, 0x80u); });
+	std::printf("log line, \"%s\" with a timestamp:\n", kMessageFormat);
+	printResult("old", old, old);
+	printResult("vsnprintf", crt, old);
+	printResult("stb", stb, old);
+	// the old string included the terminating zero
+	const bool linesOk = old.checksum == stb.checksum + static_cast<size_t>(messages) && crt.checksum == stb.checksum;
+	const bool lineAllocationsOk = 0.0 == stb.allocationsPerCall;
+	std::printf("        same lengths on every path: %s, stb path allocation free: %s\n", linesOk ? "OK" : "FAILED", lineAllocationsOk ? "OK" : "FAILED");
+	ok = ok && linesOk && lineAllocationsOk;
+
+	// a pipe message: type byte, then the text, zero padded
+	uint8_t message[256] = {};
+	message[0] = 3;
+	std::memcpy(message + 1, "Camera: cockpit view, smoothing 0.12", 36);
+	uint8_t* volatile payload = message;		// read per call, so the decoding isn't hoisted out of the loop
+	const Result bytesOld = measure(messages, [&](int) { return stringFromBytesOld(payload, sizeof(message), 1); });
+	const Result bytesView = measure(messages, [&](int) { return stringFromBytes(payload, sizeof(message), 1).size(); });
+	std::printf("string from a %zu byte pipe message:\n", sizeof(message));
+	printResult("old", bytesOld, bytesOld);
+	printResult("view", bytesView, bytesOld);
+	const bool bytesOk = bytesOld.checksum == bytesView.checksum && 0.0 == bytesView.allocationsPerCall;
+	std::printf("        same text, view allocation free: %s\n", bytesOk ? "OK" : "FAILED");
+	ok = ok && bytesOk;
+
+	std::printf("%s\n", ok ? "OK" : "FAILED");
+	return ok ? 0 : 1;
+}
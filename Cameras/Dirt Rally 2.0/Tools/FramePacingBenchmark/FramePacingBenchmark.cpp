@@ -0,0 +1,175 @@
+// Measures how precisely the frame pacer used in the hooked Present (see FramePacer.h) releases frames on this machine.
+// For every target rate it runs the pacer with simulated render work of random length per frame and reports the
+// distribution of the pacing error, i.e. how far after its deadline each frame was released, plus the interval jitter.
+//
+// Usage: FramePacingBenchmark [--frames <n per rate>] [--rates <hz,hz,...>] [--work <max fraction of a frame>] [--seed <n>]
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include "../../InjectableGenericCameraSystem/FramePacer.h"
+#include "../../InjectableGenericCameraSystem/PacingClock.h"
+
+using namespace IGCS;
+
+namespace
+{
+	// upper bounds of the error distribution buckets, microseconds
+	const double kBucketLimits[] = { 10.0, 50.0, 100.0, 250.0, 500.0, 1000.0 };
+
+	struct RateResult
+	{
+		double rate = 0.0;
+		std::vector<double> errors;		// microseconds past the deadline
+		std::vector<double> intervals;	// microseconds between releases
+		size_t missed = 0;				// frames whose work took longer than the period
+		double overshoot = 0.0;
+	};
+
+	double percentile(const std::vector<double>& sorted, double fraction)
+	{
+		if (sorted.empty())
+		{
+			return 0.0;
+		}
+		const size_t index = static_cast<size_t>(fraction * static_cast<double>(sorted.size() - 1) + 0.5);
+		return sorted[index];
+	}
+
+	void spinFor(IPacingClock& clock, int64_t nanoseconds)
+	{
+		const int64_t end = clock.now() + nanoseconds;
+		while (clock.now() < end)
+		{
+		}
+	}
+
+	RateResult run(SystemPacingClock& clock, double rate, size_t frames, double workFraction, std::mt19937& random)
+	{
+		RateResult result;
+		result.rate = rate;
+		FramePacer pacer(clock);
+		pacer.setTargetRate(rate);
+		std::uniform_real_distribution<double> work(0.0, workFraction);
+		// first wait starts the schedule, a few frames let the overshoot estimate settle
+		constexpr size_t warmupFrames = 30;
+		int64_t previousRelease = 0;
+		for (size_t frame = 0; frame < frames + warmupFrames; ++frame)
+		{
+			const int64_t workTime = static_cast<int64_t>(work(random) * static_cast<double>(pacer.period()));
+			spinFor(clock, workTime);
+			const int64_t lateness = pacer.wait();
+			const int64_t release = clock.now();
+			if (frame > warmupFrames)
+			{
+				if (lateness > pacer.period() / 2 && workTime >= pacer.period())
+				{
+					++result.missed;
+				}
+				result.errors.push_back(static_cast<double>(lateness) / 1000.0);
+				result.intervals.push_back(static_cast<double>(release - previousRelease) / 1000.0);
+			}
+			previousRelease = release;
+		}
+		result.overshoot = pacer.sleepOvershoot() / 1000.0;
+		return result;
+	}
+
+	void printResult(RateResult& result)
+	{
+		std::sort(result.errors.begin(), result.errors.end());
+		const double period = 1e6 / result.rate;
+		double jitterSum = 0.0;
+		for (double interval : result.intervals)
+		{
+			jitterSum += (interval - period) * (interval - period);
+		}
+		const double jitter = std::sqrt(jitterSum / static_cast<double>(result.intervals.size()));
+		double mean = 0.0;
+		for (double error : result.errors)
+		{
+			mean += error;
+		}
+		mean /= static_cast<double>(result.errors.size());
+
+		std::printf("%6.1f Hz  %8.1f %8.1f %8.1f %8.1f %8.1f %9.1f %10.1f\n", result.rate, mean, percentile(result.errors, 0.5),
+			percentile(result.errors, 0.99), percentile(result.errors, 0.999), result.errors.back(), jitter, result.overshoot);
+		std::printf("           ");
+		size_t previous = 0;
+		for (double limit : kBucketLimits)
+		{
+			const size_t upTo = static_cast<size_t>(std::upper_bound(result.errors.begin(), result.errors.end(), limit) - result.errors.begin());
+			std::printf(" <%gus %5.1f%%", limit, 100.0 * static_cast<double>(upTo - previous) / static_cast<double>(result.errors.size()));
+			previous = upTo;
+		}
+		std::printf(" >1ms %5.1f%%\n", 100.0 * static_cast<double>(result.errors.size() - previous) / static_cast<double>(result.errors.size()));
+	}
+
+	void printUsage()
+	{
+		std::fprintf(stderr, "Usage: FramePacingBenchmark [--frames <n per rate, default 600>] [--rates <hz,hz,... default 60,90,120>] [--work <max fraction of a frame, default 0.6>] [--seed <n>]\n");
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	size_t frames = 600;
+	double workFraction = 0.6;
+	unsigned seed = 1;
+	std::vector<double> rates = { 60.0, 90.0, 120.0 };
+	for (int i = 1; i < argc; ++i)
+	{
+		const bool hasValue = i + 1 < argc;
+		if (hasValue && 0 == std::strcmp(argv[i], "--frames")) { frames = std::strtoul(argv[++i], nullptr, 10); }
+		else if (hasValue && 0 == std::strcmp(argv[i], "--work")) { workFraction = std::strtod(argv[++i], nullptr); }
+		else if (hasValue && 0 == std::strcmp(argv[i], "--seed")) { seed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10)); }
+		else if (hasValue && 0 == std::strcmp(argv[i], "--rates"))
+		{
+			rates.clear();
+			const std::string list = argv[++i];
+			size_t start = 0;
+			while (start < list.size())
+			{
+				const size_t end = std::min(list.find(',', start), list.size());
+				const double rate = std::strtod(list.substr(start, end - start).c_str(), nullptr);
+				if (rate > 0.0)
+				{
+					rates.push_back(rate);
+				}
+				start = end + 1;
+			}
+		}
+		else
+		{
+			printUsage();
+			return 1;
+		}
+	}
+	if (frames < 10 || rates.empty() || workFraction < 0.0)
+	{
+		printUsage();
+		return 1;
+	}
+
+	SystemPacingClock clock;
+	std::mt19937 random(seed);
+	std::printf("%zu frames per rate, simulated work up to %.0f%% of a frame. Times in microseconds.\n\n", frames, workFraction * 100.0);
+	std::printf("%9s  %8s %8s %8s %8s %8s %9s %10s\n", "rate", "mean", "p50", "p99", "p99.9", "max", "jitter", "overshoot");
+	for (double rate : rates)
+	{
+		RateResult result = run(clock, rate, frames, workFraction, random);
+		printResult(result);
+		if (result.missed > 0)
+		{
+			std::printf("           %zu frames had more work than fits in a frame\n", result.missed);
+		}
+	}
+	std::printf("\nerror: time a frame was released after its deadline. jitter: RMS deviation of the release interval from the period.\n"
+		"overshoot: the pacer's estimate of how much a sleep overshoots on this machine.\n");
+	return 0;
+}
@@ -0,0 +1,213 @@
+// Tests the frame timing statistics (see FrameStats.h). Checks the P-square estimates against the exact percentiles of log-normal
+// frame times with spikes, that a window is published once it's complete, that copyRecent gives the newest records oldest
+// first before and after the ring went round, and that a reader copying while the render thread adds records flat out never
+// gets a record which was overwritten during the copy or one from the slot being written. Every record is derived from its
+// frame number, so a torn or out of order copy is caught. Exits with 1 if a check fails.
+//
+// Usage: FrameStatsTest [--frames 2000000] [--seed <n>]
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+#include "../Common/TestReport.h"
+#include "../../InjectableGenericCameraSystem/FrameStats.h"
+
+using namespace IGCS;
+using namespace IGCS::Tools;
+
+namespace
+{
+	// exact in a float, as are the quarters added to it. More than the frames of a default run, so they don't wrap around
+	constexpr uint64_t kNumberRange = 1 << 22;
+
+	FrameRecord numberedRecord(uint64_t frame)
+	{
+		const float number = static_cast<float>(frame % kNumberRange);
+		FrameRecord record;
+		record.presentInterval = number;
+		record.updateTime = number + 0.25f;
+		record.hookTime = number + 0.5f;
+		return record;
+	}
+
+	// Whether records holds count whole records with consecutive numbers. first gets the number of the first one.
+	bool isConsecutive(const FrameRecord* records, size_t count, uint64_t& first)
+	{
+		first = count > 0 ? static_cast<uint64_t>(records[0].presentInterval) : 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			const FrameRecord expected = numberedRecord(first + i);
+			if (expected.presentInterval != records[i].presentInterval || expected.updateTime != records[i].updateTime
+				|| expected.hookTime != records[i].hookTime)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	double exactPercentile(std::vector<double> values, double quantile)
+	{
+		std::sort(values.begin(), values.end());
+		return values[static_cast<size_t>(quantile * static_cast<double>(values.size() - 1) + 0.5)];
+	}
+
+	// The share of values below value.
+	double rank(const std::vector<double>& values, double value)
+	{
+		return static_cast<double>(std::count_if(values.begin(), values.end(), [value](double v) { return v < value; })) / static_cast<double>(values.size());
+	}
+
+	void printUsage()
+	{
+		std::fprintf(stderr, "Usage: FrameStatsTest [--frames <at least 100000, default 2000000>] [--seed <n>]\n");
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	uint64_t frames = 2000000;
+	unsigned seed = std::random_device{}();
+	Options options;
+	options.add("--frames", frames);
+	options.add("--seed", seed);
+	if (!options.parse(argc, argv))
+	{
+		printUsage();
+		return 1;
+	}
+	// enough for the reader to get going before the writer is done
+	if (frames < 100000)
+	{
+		printUsage();
+		return 1;
+	}
+	std::printf("Seed %u\n", seed);
+
+	// percentiles of windows of frame times around 60fps with a spike now and then, fewer than 1% so p99 isn't on the step
+	// between the two
+	constexpr int kWindows = 50;
+	std::mt19937 random(seed);
+	std::lognormal_distribution<double> frameTime(std::log(1.0 / 60.0), 0.1);
+	std::uniform_int_distribution<int> spike(0, 199);
+	FrameStats stats;
+	bool published = true;
+	bool p50Close = true;
+	bool derived = true;
+	double p99RankSum = 0.0;
+	double p99RankWorst = 0.99;
+	for (int w = 0; w < kWindows; ++w)
+	{
+		std::vector<double> intervals;
+		bool early = false;
+		for (uint32_t i = 0; i < FrameStats::kWindowFrames; ++i)
+		{
+			const double interval = frameTime(random) * (0 == spike(random) ? 3.0 : 1.0);
+			intervals.push_back(interval);
+			FrameRecord record;
+			record.presentInterval = static_cast<float>(interval);
+			record.updateTime = static_cast<float>(interval * 0.01);
+			record.hookTime = static_cast<float>(interval * 0.001);
+			FrameStatistics before;
+			stats.read(before);
+			early = early || (0 == w ? 0 != before.windowFrames : before.frames / FrameStats::kWindowFrames != static_cast<uint64_t>(w));
+			stats.add(record);
+		}
+		FrameStatistics window;
+		stats.read(window);
+		published = published && !early && FrameStats::kWindowFrames * static_cast<uint64_t>(w + 1) == window.frames
+			&& FrameStats::kWindowFrames == window.windowFrames;
+		const double p50 = exactPercentile(intervals, 0.5);
+		p50Close = p50Close && std::fabs(window.intervalP50 - p50) < p50 * 0.01;
+		const double p99Rank = rank(intervals, window.intervalP99);
+		p99RankSum += p99Rank;
+		p99RankWorst = std::fabs(p99Rank - 0.99) > std::fabs(p99RankWorst - 0.99) ? p99Rank : p99RankWorst;
+		double sum = 0.0;
+		for (const double interval : intervals)
+		{
+			sum += interval;
+		}
+		// update and hook times are proportional to the intervals, so their estimates are the same ones scaled
+		derived = derived && std::fabs(window.averageFps - intervals.size() / sum) < 0.01 && std::fabs(window.onePercentLowFps - 1.0f / window.intervalP99) < 0.01f
+			&& std::fabs(window.updateP50 - window.intervalP50 * 0.01f) < window.intervalP50 * 0.0001f
+			&& std::fabs(window.hookP99 - window.intervalP99 * 0.001f) < window.intervalP99 * 0.0001f;
+	}
+	const double p99RankAverage = p99RankSum / kWindows;
+	std::printf("        p99 estimates: %.2f%% of the frames are shorter on average, %.2f%% in the worst window\n", p99RankAverage * 100.0,
+		p99RankWorst * 100.0);
+	bool ok = report("every window is published once it's complete", published);
+	ok = report("p50 is within 1% of the exact percentile", p50Close) && ok;
+	// only 6 of 600 frames are above the p99, a single window's estimate can be a few frames off
+	ok = report("p99 is within 0.5% of the frames on average", std::fabs(p99RankAverage - 0.99) <= 0.005) && ok;
+	ok = report("fps, update and hook times follow from the estimates", derived) && ok;
+
+	// copies, no writer running
+	FrameStats ring;
+	std::vector<FrameRecord> copy(FrameStats::kRingSize);
+	for (uint64_t frame = 0; frame < 100; ++frame)
+	{
+		ring.add(numberedRecord(frame));
+	}
+	uint64_t first = 0;
+	size_t copied = ring.copyRecent(copy.data(), copy.size());
+	ok = report("before the ring is full every record is copied", 100 == copied && isConsecutive(copy.data(), copied, first) && 0 == first) && ok;
+	copied = ring.copyRecent(copy.data(), 10);
+	ok = report("fewer asked for: the newest ones", 10 == copied && isConsecutive(copy.data(), copied, first) && 90 == first) && ok;
+	for (uint64_t frame = 100; frame < 3 * FrameStats::kRingSize + 7; ++frame)
+	{
+		ring.add(numberedRecord(frame));
+	}
+	copied = ring.copyRecent(copy.data(), copy.size());
+	ok = report("once it went round, all but the slot written next", FrameStats::kRingSize - 1 == copied && isConsecutive(copy.data(), copied, first)
+		&& 3 * FrameStats::kRingSize + 7 - copied == first) && ok;
+
+	// a reader copying while the render thread adds records
+	FrameStats shared;
+	std::atomic<bool> done{ false };
+	uint64_t copies = 0;
+	uint64_t emptyCopies = 0;
+	uint64_t bad = 0;
+	uint64_t backwards = 0;
+	std::thread reader([&]
+	{
+		std::vector<FrameRecord> records(FrameStats::kRingSize);
+		uint64_t lastNewest = 0;
+		while (!done.load(std::memory_order_acquire))
+		{
+			const size_t count = shared.copyRecent(records.data(), records.size());
+			++copies;
+			if (0 == count)
+			{
+				++emptyCopies;
+				continue;
+			}
+			uint64_t oldest = 0;
+			if (!isConsecutive(records.data(), count, oldest))
+			{
+				++bad;
+				continue;
+			}
+			// numbers wrap at kNumberRange, far more than the writer adds between two copies
+			const uint64_t newest = (oldest + count - 1) % kNumberRange;
+			backwards += (lastNewest - newest) % kNumberRange < kNumberRange / 2 && lastNewest != newest ? 1 : 0;
+			lastNewest = newest;
+		}
+	});
+	for (uint64_t frame = 0; frame < frames; ++frame)
+	{
+		shared.add(numberedRecord(frame));
+	}
+	done.store(true, std::memory_order_release);
+	reader.join();
+	std::printf("        %llu records added, %llu copies, %llu empty, %llu torn or out of order, %llu going back\n",
+		static_cast<unsigned long long>(frames), static_cast<unsigned long long>(copies), static_cast<unsigned long long>(emptyCopies),
+		static_cast<unsigned long long>(bad), static_cast<unsigned long long>(backwards));
+	ok = report("copies racing the writer are whole and in order", copies > emptyCopies && 0 == bad && 0 == backwards) && ok;
+
+	return finish(ok);
+}
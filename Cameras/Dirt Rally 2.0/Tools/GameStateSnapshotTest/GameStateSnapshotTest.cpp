@@ -0,0 +1,230 @@
+// Tests the per frame snapshot of the game state (see GameStateSnapshot.h) against fake game memory (MemoryImage in
+// GameMemory.h): the car, camera and view structs are laid out in a buffer like the game has them. Checks a capture takes
+// every value from one read per struct, that a camera struct which can't be read any more is marked invalid and its address
+// dropped like the dll does, that a car struct of which only a part can be read or which holds no usable transform is marked
+// invalid with the defaults in place, that nothing of an earlier frame is left in the snapshot, and that a frame without a car
+// leaves the last camera pose in place. Exits with 1 if a check fails.
+//
+// Usage: GameStateSnapshotTest
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <vector>
+#include "../Common/TestReport.h"
+#include "../../InjectableGenericCameraSystem/GameStateSnapshot.h"
+
+using namespace IGCS;
+using namespace IGCS::Tools;
+using namespace IGCS::GameSpecific;
+
+namespace
+{
+	// where the structs sit in the fake memory
+	constexpr size_t kCarStruct = 0x1000;
+	constexpr size_t kCameraStruct = 0x2000;
+	constexpr size_t kViewStruct = 0x3000;
+	constexpr size_t kImageSize = 0x4000;
+
+	const Smoothing::Vec3 kCarPosition = { 1250.5f, 32.25f, -880.75f };
+	const Smoothing::Quat kCarRotation = { 0.0f, 0.6f, 0.0f, 0.8f };
+	const Smoothing::Quat kCameraQuaternion = { 0.5f, 0.5f, 0.5f, 0.5f };
+	const Smoothing::Vec3 kCameraCoords = { 1251.0f, 33.5f, -879.0f };
+	constexpr float kFov = 1.2f;
+	constexpr float kNearZ = 0.05f;
+	constexpr float kMotionBlur = 0.3f;
+
+	// The game's memory: the image is served at the start of gameSpace, which is never touched. The rest of gameSpace is
+	// memory which can't be read.
+	struct FakeGame
+	{
+		std::vector<uint8_t> gameSpace = std::vector<uint8_t>(2 * kImageSize);
+		std::vector<uint8_t> image = std::vector<uint8_t>(kImageSize);
+
+		template<typename T>
+		void put(size_t address, const T& value)
+		{
+			std::memcpy(&image[address], &value, sizeof(T));
+		}
+
+		[[nodiscard]] const uint8_t* address(size_t offset) const { return gameSpace.data() + offset; }
+	};
+
+	// Counts the reads, so a test can see a capture reads each struct once and skips structs it has no address of.
+	class CountingMemory : public IGameMemory
+	{
+	public:
+		explicit CountingMemory(IGameMemory& memory) : _memory(memory) {}
+
+		bool read(const uint8_t* source, void* destination, size_t size) noexcept override
+		{
+			++reads;
+			return _memory.read(source, destination, size);
+		}
+
+		int reads = 0;
+
+	private:
+		IGameMemory& _memory;
+	};
+
+	FakeGame makeGame()
+	{
+		FakeGame game;
+		game.put(kCarStruct + PLAYER_POSITION_IN_STRUCT_OFFSET, kCarPosition);
+		game.put(kCarStruct + PLAYER_ROTATION_IN_STRUCT_OFFSET, kCarRotation);
+		game.put(kCameraStruct + QUATERNION_IN_STRUCT_OFFSET, kCameraQuaternion);
+		game.put(kCameraStruct + COORDS_IN_STRUCT_OFFSET, kCameraCoords);
+		game.put(kCameraStruct + FOV_IN_STRUCT_OFFSET, kFov);
+		game.put(kViewStruct + NEAR_Z_FROM_QUATERNION_OFFSET, kNearZ);
+		game.put(kViewStruct + MOTION_BLUR_STRENGTH_FROM_CAMQUATERNION_OFFSET, kMotionBlur);
+		return game;
+	}
+
+	GameStateAddresses addressesIn(const FakeGame& game)
+	{
+		GameStateAddresses addresses;
+		addresses.carAddress = game.address(kCarStruct);
+		addresses.cameraAddress = game.address(kCameraStruct);
+		addresses.cameraQuaternionAddress = game.address(kViewStruct);
+		return addresses;
+	}
+
+	bool same(const Smoothing::Vec3& a, const Smoothing::Vec3& b) { return a.x == b.x && a.y == b.y && a.z == b.z; }
+	bool same(const Smoothing::Quat& a, const Smoothing::Quat& b) { return a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w; }
+
+	bool carIsDefault(const GameStateSnapshot& snapshot)
+	{
+		const GameStateSnapshot defaults;
+		return !snapshot.carValid && same(snapshot.playerPosition, defaults.playerPosition) && same(snapshot.playerRotation, defaults.playerRotation);
+	}
+
+	bool cameraIsDefault(const GameStateSnapshot& snapshot)
+	{
+		const GameStateSnapshot defaults;
+		return !snapshot.cameraValid && same(snapshot.cameraQuaternion, defaults.cameraQuaternion) && same(snapshot.cameraCoords, defaults.cameraCoords)
+			&& snapshot.fov == defaults.fov;
+	}
+
+	// The snapshot of a game whose car struct holds position and rotation, everything else as made by makeGame.
+	GameStateSnapshot captureCar(const Smoothing::Vec3& position, const Smoothing::Quat& rotation)
+	{
+		FakeGame game = makeGame();
+		game.put(kCarStruct + PLAYER_POSITION_IN_STRUCT_OFFSET, position);
+		game.put(kCarStruct + PLAYER_ROTATION_IN_STRUCT_OFFSET, rotation);
+		MemoryImage memory(game.gameSpace.data(), game.image.data(), game.image.size());
+		GameStateSnapshot snapshot;
+		captureGameState(memory, addressesIn(game), snapshot);
+		return snapshot;
+	}
+
+	bool carAccepted(const Smoothing::Vec3& position, const Smoothing::Quat& rotation)
+	{
+		const GameStateSnapshot snapshot = captureCar(position, rotation);
+		return snapshot.carValid && same(snapshot.playerPosition, position) && same(snapshot.playerRotation, rotation);
+	}
+
+	bool carRejected(const Smoothing::Vec3& position, const Smoothing::Quat& rotation)
+	{
+		const GameStateSnapshot snapshot = captureCar(position, rotation);
+		return carIsDefault(snapshot) && snapshot.cameraValid;
+	}
+
+	// The pose the camera writes, like Camera::updateCamera does it: posed from the car if the snapshot allows it.
+	struct CameraPose
+	{
+		Smoothing::Vec3 position;
+		Smoothing::Quat rotation;
+		int commits = 0;
+
+		void update(const GameStateSnapshot& snapshot)
+		{
+			if (!canPoseCamera(snapshot))
+			{
+				return;
+			}
+			position = snapshot.playerPosition;
+			rotation = snapshot.playerRotation;
+			++commits;
+		}
+	};
+}
+
+
+int main(int argc, char**)
+{
+	if (argc > 1)
+	{
+		std::fprintf(stderr, "Usage: GameStateSnapshotTest\n");
+		return 1;
+	}
+
+	// a frame with everything in place
+	FakeGame game = makeGame();
+	MemoryImage image(game.gameSpace.data(), game.image.data(), game.image.size());
+	CountingMemory memory(image);
+	GameStateAddresses addresses = addressesIn(game);
+	GameStateSnapshot snapshot;
+	captureGameState(memory, addresses, snapshot);
+	bool ok = report("a capture takes every value", snapshot.carValid && snapshot.cameraValid && snapshot.viewValid
+		&& same(snapshot.playerPosition, kCarPosition) && same(snapshot.playerRotation, kCarRotation)
+		&& same(snapshot.cameraQuaternion, kCameraQuaternion) && same(snapshot.cameraCoords, kCameraCoords)
+		&& kFov == snapshot.fov && kNearZ == snapshot.nearZ && kMotionBlur == snapshot.motionBlur);
+	ok = report("with one read per struct", 3 == memory.reads) && ok;
+	ok = report("a camera struct which can be read isn't lost", !cameraStructLost(addresses, snapshot)) && ok;
+
+	// the game frees the camera struct: its address is now past the readable memory
+	addresses.cameraAddress = game.address(kImageSize - 0x10);
+	const uint8_t* cameraStructAddress = addresses.cameraAddress;
+	captureGameState(memory, addresses, snapshot);
+	// what CameraManipulator::captureGameState does with it
+	if (cameraStructLost(addresses, snapshot))
+	{
+		cameraStructAddress = nullptr;
+	}
+	ok = report("an unreadable camera struct is invalid, no old values kept", cameraIsDefault(snapshot) && snapshot.carValid && snapshot.viewValid) && ok;
+	ok = report("and its address is dropped", nullptr == cameraStructAddress) && ok;
+	// the next frame, till the interceptor finds the new one
+	addresses.cameraAddress = cameraStructAddress;
+	memory.reads = 0;
+	captureGameState(memory, addresses, snapshot);
+	ok = report("without an address it's not read, and not lost again", cameraIsDefault(snapshot) && 2 == memory.reads
+		&& !cameraStructLost(addresses, snapshot)) && ok;
+
+	// no addresses at all, e.g. before the interceptors ran
+	memory.reads = 0;
+	captureGameState(memory, GameStateAddresses(), snapshot);
+	const GameStateSnapshot defaults;
+	ok = report("without addresses nothing is read, everything is invalid", 0 == memory.reads && carIsDefault(snapshot) && cameraIsDefault(snapshot)
+		&& !snapshot.viewValid && defaults.nearZ == snapshot.nearZ && defaults.motionBlur == snapshot.motionBlur) && ok;
+
+	// the car struct runs off the end of the readable memory: the position could be read, the rotation can't
+	addresses = addressesIn(game);
+	addresses.carAddress = game.address(kImageSize - PLAYER_ROTATION_IN_STRUCT_OFFSET - 8);
+	captureGameState(memory, addresses, snapshot);
+	ok = report("a car struct which can only partly be read is invalid", carIsDefault(snapshot) && snapshot.cameraValid) && ok;
+
+	// car structs which can be read but hold no transform
+	const float nan = std::numeric_limits<float>::quiet_NaN();
+	const float infinity = std::numeric_limits<float>::infinity();
+	const bool rejected = carRejected({ nan, 0.0f, 0.0f }, kCarRotation) && carRejected({ 0.0f, infinity, 0.0f }, kCarRotation)
+		&& carRejected(kCarPosition, { 0.0f, 0.0f, 0.0f, 0.0f }) && carRejected(kCarPosition, { 0.0f, nan, 0.0f, 1.0f })
+		&& carRejected(kCarPosition, { 1.0f, 1.0f, 0.0f, 0.0f });
+	ok = report("a car with a NaN, infinite or non unit transform is invalid", rejected) && ok;
+	// a quaternion the game stored in floats isn't exactly unit length
+	const bool accepted = carAccepted({ 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f, 1.0f }) && carAccepted(kCarPosition, { 0.0f, 0.6f, 0.0f, 0.799f });
+	ok = report("a car at the origin or with a rounded rotation is valid", accepted) && ok;
+
+	// the camera follows the car, then the car struct is freed for a frame, e.g. on a restart of the stage
+	CameraPose pose;
+	pose.update(captureCar(kCarPosition, kCarRotation));
+	pose.update(captureCar({ nan, 0.0f, 0.0f }, kCarRotation));
+	ok = report("a frame without a car writes nothing, the last pose holds", 1 == pose.commits && same(pose.position, kCarPosition)
+		&& same(pose.rotation, kCarRotation)) && ok;
+	const Smoothing::Vec3 movedPosition = { 1300.0f, 30.0f, -900.0f };
+	pose.update(captureCar(movedPosition, kCarRotation));
+	ok = report("and the camera follows the car again once it's back", 2 == pose.commits && same(pose.position, movedPosition)) && ok;
+
+	return finish(ok);
+}
@@ -0,0 +1,204 @@
+// Tests the head motion model (see HeadMotionModel.h). Drives a car along a winding, braking and accelerating path and runs the
+// model at 30, 60 and 144 fps, and checks the head offset follows the one of a 240 fps run (one substep per frame) at the
+// times all rates share, and that a steady 1 g brake settles at the same offset at every rate. Then checks the substep budget:
+// a frame longer than kMaxSubsteps substeps runs kMaxSubsteps of them and drops the rest instead of carrying it into the next
+// frame, a frame up to kMaxFrameTime is integrated, and a longer one restarts the model. Exits with 1 if a check fails.
+//
+// Usage: HeadMotionTest [--seconds 12] [--tolerance 0.05 (of the largest offset)]
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "../Common/TestReport.h"
+#include "../../InjectableGenericCameraSystem/HeadMotionModel.h"
+
+using namespace IGCS;
+using namespace IGCS::Tools;
+using namespace IGCS::Smoothing;
+
+namespace
+{
+	constexpr int kReferenceRate = 240;
+	// every rate tested has a frame at each multiple of 1/kSharedRate seconds
+	constexpr int kSharedRate = 6;
+	constexpr int kRates[] = { 30, 60, 144 };
+
+	struct CarPose
+	{
+		Vec3 position;
+		Quat rotation;
+	};
+
+	// Weaving, with the speed going up and down, over a small bump. Faces where it's going.
+	CarPose windingPath(double t)
+	{
+		const double x = 6.0 * std::sin(0.9 * t) + 3.0 * std::sin(0.35 * t);
+		const double y = 0.3 * std::sin(1.1 * t);
+		const double z = 20.0 * t + 15.0 * std::sin(0.4 * t);
+		const double dx = 5.4 * std::cos(0.9 * t) + 1.05 * std::cos(0.35 * t);
+		const double dz = 20.0 + 6.0 * std::cos(0.4 * t);
+		const double heading = std::atan2(dx, dz);
+		CarPose pose;
+		pose.position = { static_cast<float>(x), static_cast<float>(y), static_cast<float>(z) };
+		pose.rotation = { 0.0f, static_cast<float>(std::sin(heading * 0.5)), 0.0f, static_cast<float>(std::cos(heading * 0.5)) };
+		return pose;
+	}
+
+	// Braking at 1 g from 40 m/s, along z.
+	CarPose braking(double t)
+	{
+		CarPose pose;
+		pose.position = { 0.0f, 0.0f, static_cast<float>(40.0 * t - 0.5 * 9.81 * t * t) };
+		return pose;
+	}
+
+	HeadMotionParams testParams()
+	{
+		HeadMotionParams params;
+		params.strength = 0.05f;
+		params.maxOffset = 1.0f;		// never reached, so the clamp doesn't hide differences
+		return params;
+	}
+
+	// Runs the model at rate fps for the given time and returns the offset at each multiple of 1/kSharedRate seconds.
+	template<typename Path>
+	std::vector<Vec3> run(Path path, int rate, double seconds)
+	{
+		HeadMotionModel model;
+		const HeadMotionParams params = testParams();
+		const float frameTime = 1.0f / static_cast<float>(rate);
+		const int frames = static_cast<int>(seconds * rate);
+		std::vector<Vec3> offsets;
+		for (int frame = 0; frame <= frames; ++frame)
+		{
+			const CarPose pose = path(static_cast<double>(frame) / rate);
+			model.update(pose.position, pose.rotation, frameTime, params);
+			if (0 == frame % (rate / kSharedRate))
+			{
+				offsets.push_back(model.offset());
+			}
+		}
+		return offsets;
+	}
+
+	float largestAxis(const Vec3& v)
+	{
+		return std::max({ std::fabs(v.x), std::fabs(v.y), std::fabs(v.z) });
+	}
+
+	Vec3 difference(const Vec3& a, const Vec3& b)
+	{
+		return { a.x - b.x, a.y - b.y, a.z - b.z };
+	}
+
+	// A model fed three frames at 60 fps of a car braking at 1 g, so it has a drive and the next frames integrate it.
+	HeadMotionModel warmedUp(double& time)
+	{
+		HeadMotionModel model;
+		for (int frame = 0; frame < 3; ++frame)
+		{
+			time = frame / 60.0;
+			model.update(braking(time).position, {}, 1.0f / 60.0f, testParams());
+		}
+		return model;
+	}
+
+	void update(HeadMotionModel& model, double& time, float frameTime)
+	{
+		time += frameTime;
+		model.update(braking(time).position, {}, frameTime, testParams());
+	}
+
+	bool same(const Vec3& a, const Vec3& b)
+	{
+		return largestAxis(difference(a, b)) <= 1e-6f;
+	}
+
+	void printUsage()
+	{
+		std::fprintf(stderr, "Usage: HeadMotionTest [--seconds <default 12>] [--tolerance <fraction of the largest offset, default 0.05>]\n");
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	double seconds = 12.0;
+	double tolerance = 0.05;
+	Options options;
+	options.add("--seconds", seconds);
+	options.add("--tolerance", tolerance);
+	if (!options.parse(argc, argv))
+	{
+		printUsage();
+		return 1;
+	}
+	if (seconds < 1.0 || tolerance <= 0.0)
+	{
+		printUsage();
+		return 1;
+	}
+
+	// frame rate invariance, against one substep per frame
+	bool ok = true;
+	const std::vector<Vec3> reference = run(windingPath, kReferenceRate, seconds);
+	float largest = 0.0f;
+	for (const Vec3& offset : reference)
+	{
+		largest = std::max(largest, largestAxis(offset));
+	}
+	std::printf("        largest offset at %d fps: %.1f mm\n", kReferenceRate, largest * 1000.0f);
+	for (const int rate : kRates)
+	{
+		const std::vector<Vec3> offsets = run(windingPath, rate, seconds);
+		float worst = 0.0f;
+		for (size_t i = 0; i < std::min(offsets.size(), reference.size()); ++i)
+		{
+			worst = std::max(worst, largestAxis(difference(offsets[i], reference[i])));
+		}
+		std::printf("        %3d fps: largest difference %.2f mm (%.1f%%)\n", rate, worst * 1000.0f, 100.0f * worst / largest);
+		char check[64];
+		std::snprintf(check, sizeof(check), "%d fps follows the %d fps offset", rate, kReferenceRate);
+		ok = report(check, largest > 0.0f && offsets.size() == reference.size() && worst <= tolerance * largest) && ok;
+	}
+	// 1 g against z, so the head settles at strength metres forward
+	bool settled = true;
+	for (const int rate : kRates)
+	{
+		const Vec3 offset = run(braking, rate, 4.0).back();
+		settled = settled && std::fabs(offset.z - testParams().strength) <= 0.01f * testParams().strength && std::fabs(offset.x) < 1e-6f;
+	}
+	ok = report("a 1 g brake settles at the same offset at every rate", settled) && ok;
+
+	// a 0.1 s frame is 24 substeps, only kMaxSubsteps run
+	double timeA = 0.0;
+	double timeB = 0.0;
+	HeadMotionModel capped = warmedUp(timeA);
+	HeadMotionModel budget = warmedUp(timeB);
+	update(capped, timeA, 0.1f);
+	update(budget, timeB, HeadMotionModel::kMaxSubsteps * HeadMotionModel::kTimestep);
+	// the car moved further for capped, but the drive of a steady brake is the same
+	ok = report("a long frame runs kMaxSubsteps substeps", largestAxis(capped.offset()) > 0.0f && same(capped.offset(), budget.offset())) && ok;
+	// carried over, the 8 substeps left would run now
+	update(capped, timeA, HeadMotionModel::kTimestep);
+	update(budget, timeB, HeadMotionModel::kTimestep);
+	ok = report("the substeps over budget are dropped, not carried over", same(capped.offset(), budget.offset())) && ok;
+
+	// up to kMaxFrameTime a frame is integrated, longer ones restart the model
+	double time = 0.0;
+	HeadMotionModel integrated = warmedUp(time);
+	update(integrated, time, HeadMotionModel::kMaxFrameTime);
+	ok = report("a frame of kMaxFrameTime is integrated", largestAxis(integrated.offset()) > 0.0f) && ok;
+	HeadMotionModel restarted = warmedUp(time);
+	update(restarted, time, 1.0f / 60.0f);
+	const bool moving = largestAxis(restarted.offset()) > 0.0f;
+	update(restarted, time, HeadMotionModel::kMaxFrameTime + 0.05f);
+	bool atRest = largestAxis(restarted.offset()) == 0.0f;
+	// it needs three samples again before it moves
+	update(restarted, time, 1.0f / 60.0f);
+	atRest = atRest && largestAxis(restarted.offset()) == 0.0f;
+	update(restarted, time, 1.0f / 60.0f);
+	ok = report("a longer frame restarts the model", moving && atRest && largestAxis(restarted.offset()) > 0.0f) && ok;
+
+	return finish(ok);
+}
@@ -0,0 +1,234 @@
+// Stress test for the queue between the input thread and the render thread (see SpscQueue.h and InputEvents.h). Runs two
+// phases, each with a real producer and consumer thread:
+// 1. queue: the producer pushes a numbered sequence as fast as it can, the consumer checks that every item arrives exactly
+//    once and in order, and reports the throughput and the push to pop latency.
+// 2. events: an input thread samples random bindings at the input rate through the InputEventTranslator, a render thread
+//    drains at the frame rate with random stalls (loading screens). Checks that every event was either drained, in order,
+//    or counted as dropped, and that held bindings never fire more often than the repeat window allows.
+// Exits with 1 if a check fails.
+//
+// Usage: InputQueueStress [--items <n>] [--seconds <event phase length>] [--rate <input hz>] [--fps <frame rate>] [--seed <n>]
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+#include "../../InjectableGenericCameraSystem/InputEvents.h"
+#include "../../InjectableGenericCameraSystem/MonotonicClock.h"
+#include "../../InjectableGenericCameraSystem/PacingClock.h"
+
+using namespace IGCS;
+
+namespace
+{
+	struct Item
+	{
+		uint64_t sequence = 0;
+		int64_t pushTime = 0;
+	};
+
+	double percentile(std::vector<double>& values, double fraction)
+	{
+		if (values.empty())
+		{
+			return 0.0;
+		}
+		const size_t index = static_cast<size_t>(fraction * static_cast<double>(values.size() - 1) + 0.5);
+		std::nth_element(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(index), values.end());
+		return values[index];
+	}
+
+	bool runQueuePhase(uint64_t items)
+	{
+		// small on purpose, so both sides keep running into full and empty
+		static SpscQueue<Item, 64> queue;
+		std::vector<double> latencies;
+		latencies.reserve(static_cast<size_t>(items / 64 + 1));
+		uint64_t outOfOrder = 0;
+
+		const int64_t start = MonotonicClock::now();
+		std::thread producer([&]
+		{
+			for (uint64_t i = 0; i < items; ++i)
+			{
+				Item item{ i, MonotonicClock::now() };
+				while (!queue.tryPush(item))
+				{
+					std::this_thread::yield();
+				}
+			}
+		});
+		uint64_t expected = 0;
+		Item item;
+		while (expected < items)
+		{
+			if (!queue.tryPop(item))
+			{
+				std::this_thread::yield();
+				continue;
+			}
+			if (item.sequence != expected)
+			{
+				++outOfOrder;
+			}
+			if (0 == (expected & 63))
+			{
+				latencies.push_back(static_cast<double>(MonotonicClock::now() - item.pushTime) / 1000.0);
+			}
+			expected = item.sequence + 1;
+		}
+		producer.join();
+		const double seconds = MonotonicClock::toSeconds(MonotonicClock::now() - start);
+
+		std::printf("queue: %llu items in %.2f s, %.1f M items/s\n", static_cast<unsigned long long>(items), seconds, static_cast<double>(items) / seconds / 1e6);
+		std::printf("       push to pop latency p50 %.2f us, p99 %.2f us, max %.2f us\n", percentile(latencies, 0.5), percentile(latencies, 0.99),
+			latencies.empty() ? 0.0 : *std::max_element(latencies.begin(), latencies.end()));
+		const bool ok = 0 == outOfOrder && queue.empty();
+		std::printf("       %s: %llu out of order\n\n", ok ? "OK" : "FAILED", static_cast<unsigned long long>(outOfOrder));
+		return ok;
+	}
+
+	bool runEventPhase(double seconds, double rate, double fps, uint32_t seed)
+	{
+		InputEventChannel channel;
+		std::atomic<bool> done{ false };
+		uint64_t pushed = 0;
+		uint64_t tooEarly = 0;
+
+		std::thread input([&]
+		{
+			SystemPacingClock clock;
+			std::mt19937 random(seed);
+			std::bernoulli_distribution toggleHeld(0.02);
+			std::bernoulli_distribution press(0.05);
+			const int64_t period = static_cast<int64_t>(1e9 / rate);
+			const int64_t end = clock.now() + MonotonicClock::fromSeconds(seconds);
+			InputEventTranslator translator;
+			uint32_t held = 0;
+			int64_t lastHeldOnlyFire[static_cast<size_t>(InputEventType::Amount)] = {};
+			for (int64_t now = clock.now(); now < end; now = clock.now())
+			{
+				uint32_t pressed = 0;
+				for (uint32_t i = 0; i < static_cast<uint32_t>(InputEventType::Amount); ++i)
+				{
+					if (toggleHeld(random)) held ^= uint32_t(1) << i;
+					if (press(random)) pressed |= uint32_t(1) << i;
+				}
+				const uint32_t fired = translator.translate(held, pressed, now);
+				for (uint32_t i = 0; i < static_cast<uint32_t>(InputEventType::Amount); ++i)
+				{
+					const uint32_t mask = uint32_t(1) << i;
+					if (0 == (fired & mask))
+					{
+						continue;
+					}
+					++pushed;
+					if (0 == (pressed & mask))
+					{
+						if (0 != lastHeldOnlyFire[i] && now - lastHeldOnlyFire[i] < InputEventTranslator::kRepeatWindow)
+						{
+							++tooEarly;
+						}
+						lastHeldOnlyFire[i] = now;
+					}
+					else
+					{
+						// a press restarts the window
+						lastHeldOnlyFire[i] = now;
+					}
+				}
+				channel.pushFired(fired, now);
+				const int64_t remaining = now + period - clock.now();
+				if (remaining > 0)
+				{
+					clock.sleep(remaining);
+				}
+			}
+			done.store(true, std::memory_order_release);
+		});
+
+		SystemPacingClock clock;
+		std::mt19937 random(seed + 1);
+		std::bernoulli_distribution stall(0.002);
+		const int64_t framePeriod = static_cast<int64_t>(1e9 / fps);
+		uint64_t drained = 0;
+		uint64_t outOfOrder = 0;
+		uint64_t frames = 0;
+		size_t mostPerFrame = 0;
+		int64_t lastTimestamp = 0;
+		while (true)
+		{
+			// read done before draining, so the last drain sees everything
+			const bool finished = done.load(std::memory_order_acquire);
+			const size_t count = channel.drain([&](const InputEvent& event)
+			{
+				if (event.timestamp < lastTimestamp)
+				{
+					++outOfOrder;
+				}
+				lastTimestamp = event.timestamp;
+			});
+			drained += count;
+			mostPerFrame = std::max(mostPerFrame, count);
+			++frames;
+			if (finished)
+			{
+				break;
+			}
+			// a stall is a loading screen, long enough to fill the queue at the input rate
+			clock.sleep(stall(random) ? MonotonicClock::fromSeconds(2.0) : framePeriod);
+		}
+		input.join();
+
+		const uint64_t dropped = channel.dropped();
+		std::printf("events: %.1f s at %.0f Hz input, %.0f fps, %llu frames\n", seconds, rate, fps, static_cast<unsigned long long>(frames));
+		std::printf("        %llu pushed, %llu drained, %llu dropped, at most %zu in a frame\n", static_cast<unsigned long long>(pushed),
+			static_cast<unsigned long long>(drained), static_cast<unsigned long long>(dropped), mostPerFrame);
+		const bool ok = pushed == drained + dropped && 0 == outOfOrder && 0 == tooEarly;
+		std::printf("        %s: %llu out of order, %llu repeats inside the window\n", ok ? "OK" : "FAILED",
+			static_cast<unsigned long long>(outOfOrder), static_cast<unsigned long long>(tooEarly));
+		return ok;
+	}
+
+	void printUsage()
+	{
+		std::fprintf(stderr, "Usage: InputQueueStress [--items <n, default 50000000>] [--seconds <default 10>] [--rate <input hz, default 1000>] [--fps <default 60>] [--seed <n>]\n");
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	uint64_t items = 50000000;
+	double seconds = 10.0;
+	double rate = 1000.0;
+	double fps = 60.0;
+	uint32_t seed = std::random_device{}();
+	for (int i = 1; i < argc; ++i)
+	{
+		const bool hasValue = i + 1 < argc;
+		if (hasValue && 0 == std::strcmp(argv[i], "--items")) { items = std::strtoull(argv[++i], nullptr, 10); }
+		else if (hasValue && 0 == std::strcmp(argv[i], "--seconds")) { seconds = std::strtod(argv[++i], nullptr); }
+		else if (hasValue && 0 == std::strcmp(argv[i], "--rate")) { rate = std::strtod(argv[++i], nullptr); }
+		else if (hasValue && 0 == std::strcmp(argv[i], "--fps")) { fps = std::strtod(argv[++i], nullptr); }
+		else if (hasValue && 0 == std::strcmp(argv[i], "--seed")) { seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)); }
+		else
+		{
+			printUsage();
+			return 1;
+		}
+	}
+	if (items < 1 || seconds <= 0.0 || rate < 1.0 || fps < 1.0)
+	{
+		printUsage();
+		return 1;
+	}
+
+	std::printf("seed %u\n\n", seed);
+	const bool queueOk = runQueuePhase(items);
+	const bool eventsOk = runEventPhase(seconds, rate, fps, seed);
+	return queueOk && eventsOk ? 0 : 1;
+}
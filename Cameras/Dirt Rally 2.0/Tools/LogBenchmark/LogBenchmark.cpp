@@ -0,0 +1,384 @@
+// Benchmark for the asynchronous logger (see AsyncLogger.h, LogFormat.h and MpscQueue.h). First checks that deferred formatting
+// gives the same text as formatting on the caller for the conversions the camera uses, and that wide strings show a notice
+// instead of their first character. Then measures what a log call costs the calling thread, in three phases:
+// 1. sync: the way MessageHandler used to log, timestamp through an ostringstream and a flushed write on the calling thread.
+// 2. steady: several threads log at a rate the writer keeps up with, into a sink writing a file. Checks every message arrives
+//    exactly once, whole and in order per thread, and none is dropped.
+// 3. burst: the same threads log as fast as they can into a sink which stalls on every flush. Checks the queue drops instead of
+//    blocking, that every message is either written or counted as dropped and the writer reports the drops.
+// Prints the caller side latency percentiles per phase. Exits with 1 if a check fails.
+//
+// Usage: LogBenchmark [--threads <n>] [--messages <per thread>] [--rate <messages per second per thread>]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../../InjectableGenericCameraSystem/AsyncLogger.h"
+#include "../../InjectableGenericCameraSystem/MonotonicClock.h"
+// the dll compiles the stb_sprintf implementation in Utils.cpp
+#define STB_SPRINTF_IMPLEMENTATION
+#include "stb_sprintf.h"
+#undef STB_SPRINTF_IMPLEMENTATION
+
+using namespace IGCS;
+namespace fs = std::filesystem;
+
+namespace
+{
+	constexpr int kMaxThreads = 16;
+
+	// Checks the lines "... thread <t> message <n> ..." arrive in order per thread and writes them to a file.
+	class CheckingSink : public ILogSink
+	{
+	public:
+		explicit CheckingSink(const fs::path& path, int stallMs) : _stallMs(stallMs)
+		{
+			_file = std::fopen(path.string().c_str(), "w");
+		}
+
+		~CheckingSink() override
+		{
+			if (nullptr != _file)
+			{
+				std::fclose(_file);
+			}
+		}
+
+		void write(LogLevel level, const char* line, size_t length) override
+		{
+			if (nullptr != _file)
+			{
+				std::fwrite(line, 1, length, _file);
+				std::fputc('\n', _file);
+			}
+			if (std::strlen(line) != length)
+			{
+				++_bad;
+				return;
+			}
+			if (LogLevel::Error == level)
+			{
+				unsigned long long dropped = 0;
+				if (1 == std::sscanf(line, "Log: %llu message(s) dropped", &dropped))
+				{
+					_reportedDropped += dropped;
+					return;
+				}
+			}
+			int thread = -1;
+			unsigned long long message = 0;
+			const char* text = std::strstr(line, "thread ");
+			if (nullptr == text || 2 != std::sscanf(text, "thread %d message %llu", &thread, &message) || thread < 0 || thread >= kMaxThreads
+				|| nullptr == std::strstr(line, " end"))
+			{
+				++_bad;
+				return;
+			}
+			if (message < _next[thread])
+			{
+				++_outOfOrder;
+			}
+			_next[thread] = message + 1;
+			++_received;
+		}
+
+		void flush() override
+		{
+			if (nullptr != _file)
+			{
+				std::fflush(_file);
+			}
+			if (_stallMs > 0)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(_stallMs));
+			}
+		}
+
+		uint64_t received() const { return _received; }
+		uint64_t bad() const { return _bad; }
+		uint64_t outOfOrder() const { return _outOfOrder; }
+		uint64_t reportedDropped() const { return _reportedDropped; }
+
+	private:
+		std::FILE* _file = nullptr;
+		int _stallMs;
+		uint64_t _next[kMaxThreads] = {};
+		uint64_t _received = 0;
+		uint64_t _bad = 0;
+		uint64_t _outOfOrder = 0;
+		uint64_t _reportedDropped = 0;
+	};
+
+	// Formats through LogFormat and compares with formatting on the caller (formatToVa, what the logger falls back to).
+	// deferrable: whether capture() should take it.
+	bool checkFormat(bool deferrable, const char* fmt, ...)
+	{
+		va_list args;
+		va_start(args, fmt);
+		// capture() leaves args as it was, so formatToVa can use it after
+		uint8_t buffer[AsyncLogger::kTextSize];
+		size_t used = 0;
+		const bool captured = LogFormat::capture(fmt, args, buffer, sizeof(buffer), used);
+		char expected[AsyncLogger::kTextSize];
+		formatToVa(expected, sizeof(expected), fmt, args);
+		va_end(args);
+		if (captured != deferrable)
+		{
+			std::printf("format \"%s\": %s, expected %s\n", fmt, captured ? "deferred" : "not deferred", deferrable ? "deferred" : "not deferred");
+			return false;
+		}
+		if (!captured)
+		{
+			return true;
+		}
+		char formatted[AsyncLogger::kTextSize];
+		bool truncated = false;
+		LogFormat::format(fmt, buffer, formatted, sizeof(formatted), truncated);
+		if (0 != std::strcmp(expected, formatted) || truncated)
+		{
+			std::printf("format \"%s\": \"%s\", expected \"%s\"\n", fmt, formatted, expected);
+			return false;
+		}
+		return true;
+	}
+
+	// Wide strings and characters are taken by capture(), but formatted as LogFormat::kWideText. expected: fmt with the wide
+	// conversions replaced by that text.
+	bool checkWide(const char* expected, const char* fmt, ...)
+	{
+		va_list args;
+		va_start(args, fmt);
+		uint8_t buffer[AsyncLogger::kTextSize];
+		size_t used = 0;
+		const bool captured = LogFormat::capture(fmt, args, buffer, sizeof(buffer), used);
+		va_end(args);
+		char formatted[AsyncLogger::kTextSize];
+		bool truncated = false;
+		if (captured)
+		{
+			LogFormat::format(fmt, buffer, formatted, sizeof(formatted), truncated);
+		}
+		if (!captured || 0 != std::strcmp(expected, formatted) || truncated)
+		{
+			std::printf("format \"%s\": \"%s\", expected \"%s\"\n", fmt, captured ? formatted : "not deferred", expected);
+			return false;
+		}
+		return true;
+	}
+
+	int checkFormats()
+	{
+		const char* nullString = nullptr;
+		int failures = 0;
+		failures += !checkFormat(true, "Config: %s value '%s' out of range (%g..%g). Keeping default (%.6f).", "blend", "2.5", 0.0001, 1.0, 0.12);
+		failures += !checkFormat(true, "Config: read camera_enable_gamepad=%s (0x%04X) from ini", "RightThumb", 0x80u);
+		failures += !checkFormat(true, "Setting message with wrong length %lu ignored", 7ul);
+		failures += !checkFormat(true, "%d %i %u %x %X %o %c %%", -42, 17, 4000000000u, 0xbeefu, 0xbeefu, 8u, 'A');
+		failures += !checkFormat(true, "%010x|%-6d|%+d|% d|%#x|%5.1f|%-8.3f|%e|%G|%.0f", 0x1234u, 5, 5, 5, 255u, 3.14159, -2.5, 12345.678, 0.000012, 0.5);
+		// no h and hh: capture() narrows those, stb_sprintf ignores them
+		failures += !checkFormat(true, "%llu %lld %zu %lu %ld", 18446744073709551615ull, -9223372036854775807ll - 1, sizeof(int), 1ul, -1l);
+		failures += !checkFormat(true, "%s|%10s|%-10s|%.3s|%s", "abc", "right", "left", "truncate", nullString);
+		failures += !checkFormat(true, "no conversions at all");
+		failures += !checkFormat(true, "%p", static_cast<void*>(&failures));
+		failures += !checkFormat(false, "%*d", 5, 42);
+		const std::string wide = std::string("pad '") + LogFormat::kWideText + "' " + LogFormat::kWideText + " 3 after";
+		failures += !checkWide(wide.c_str(), "pad '%ls' %lc %d %s", L"wide", L'w', 3, "after");
+		failures += !checkFormat(false, "%Lf", 1.0L);
+		failures += !checkFormat(false, "trailing %");
+		// arguments which don't fit make capture() decline, the logger then formats on the caller
+		std::string longText(AsyncLogger::kTextSize, 'x');
+		failures += !checkFormat(false, "%s", longText.c_str());
+		return failures;
+	}
+
+	double percentile(std::vector<double>& values, double fraction)
+	{
+		if (values.empty())
+		{
+			return 0.0;
+		}
+		const size_t index = static_cast<size_t>(fraction * static_cast<double>(values.size() - 1) + 0.5);
+		std::nth_element(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(index), values.end());
+		return values[index];
+	}
+
+	void printLatencies(const char* phase, std::vector<double>& latencies)
+	{
+		const double p50 = percentile(latencies, 0.5);
+		const double p99 = percentile(latencies, 0.99);
+		const double p999 = percentile(latencies, 0.999);
+		const double max = latencies.empty() ? 0.0 : *std::max_element(latencies.begin(), latencies.end());
+		std::printf("%-7s %9zu calls, per call p50 %8.0f ns, p99 %8.0f ns, p99.9 %8.0f ns, max %9.0f ns\n", phase, latencies.size(), p50, p99, p999, max);
+	}
+
+	// Log calls from threads threads, each messages long, paced at rate per second (0: as fast as possible). Returns the
+	// per call latencies in nanoseconds.
+	template<typename Log>
+	std::vector<double> runThreads(int threads, int messages, double rate, Log&& log)
+	{
+		std::vector<std::vector<double>> perThread(static_cast<size_t>(threads));
+		std::vector<std::thread> workers;
+		for (int t = 0; t < threads; ++t)
+		{
+			workers.emplace_back([&, t]
+			{
+				std::vector<double>& latencies = perThread[static_cast<size_t>(t)];
+				latencies.reserve(static_cast<size_t>(messages));
+				const int64_t period = rate > 0.0 ? static_cast<int64_t>(1e9 / rate) : 0;
+				int64_t next = MonotonicClock::now();
+				for (int i = 0; i < messages; ++i)
+				{
+					const int64_t start = MonotonicClock::now();
+					log(t, i);
+					latencies.push_back(static_cast<double>(MonotonicClock::now() - start));
+					if (period > 0)
+					{
+						next += period;
+						const int64_t wait = next - MonotonicClock::now();
+						if (wait > 0)
+						{
+							std::this_thread::sleep_for(std::chrono::nanoseconds(wait));
+						}
+					}
+				}
+			});
+		}
+		for (std::thread& worker : workers)
+		{
+			worker.join();
+		}
+		std::vector<double> all;
+		for (const std::vector<double>& latencies : perThread)
+		{
+			all.insert(all.end(), latencies.begin(), latencies.end());
+		}
+		return all;
+	}
+
+	// What MessageHandler::logLine did before: format, timestamp through an ostringstream, write and flush.
+	void logSynchronously(std::FILE* file, int thread, int message)
+	{
+		char text[256];
+		std::snprintf(text, sizeof(text), "Camera: thread %d message %d, blend %.4f, fov %.2f end", thread, message, 0.12, 75.0);
+		const std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+		std::tm local{};
+#ifdef _WIN32
+		localtime_s(&local, &now);
+#else
+		localtime_r(&now, &local);
+#endif
+		std::ostringstream stream;
+		stream << std::put_time(&local, "%H:%M:%S");
+		const std::string line = "[" + stream.str() + "] " + text;
+		std::fprintf(file, "%s\n", line.c_str());
+		std::fflush(file);
+	}
+
+	void printUsage()
+	{
+		std::fprintf(stderr, "Usage: LogBenchmark [--threads <n, default 4>] [--messages <per thread, default 20000>] [--rate <per thread, default 2000>]\n");
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	int threads = 4;
+	int messages = 20000;
+	double rate = 2000.0;
+	for (int i = 1; i < argc; ++i)
+	{
+		const bool hasValue = i + 1 < argc;
+		if (hasValue && 0 == std::strcmp(argv[i], "--threads")) { threads = std::atoi(argv[++i]); }
+		else if (hasValue && 0 == std::strcmp(argv[i], "--messages")) { messages = std::atoi(argv[++i]); }
+		else if (hasValue && 0 == std::strcmp(argv[i], "--rate")) { rate = std::strtod(argv[++i], nullptr); }
+		else
+		{
+			printUsage();
+			return 1;
+		}
+	}
+	if (threads < 1 || threads > kMaxThreads || messages < 1 || rate <= 0.0)
+	{
+		printUsage();
+		return 1;
+	}
+	const int formatFailures = checkFormats();
+	std::printf("format  deferred formatting matches caller side formatting: %s\n", 0 == formatFailures ? "OK" : "FAILED");
+	bool ok = 0 == formatFailures;
+
+	const fs::path directory = fs::temp_directory_path();
+	const fs::path path = directory / "LogBenchmark.log";
+
+	// 1. sync
+	{
+		std::FILE* file = std::fopen(path.string().c_str(), "w");
+		if (nullptr == file)
+		{
+			std::fprintf(stderr, "Can't write %s\n", path.string().c_str());
+			return 1;
+		}
+		std::vector<double> latencies = runThreads(threads, messages, rate, [file](int thread, int message) { logSynchronously(file, thread, message); });
+		std::fclose(file);
+		printLatencies("sync", latencies);
+	}
+
+	// 2. steady
+	{
+		AsyncLogger* logger = new AsyncLogger();
+		CheckingSink sink(path, 0);
+		ILogSink* sinks[] = { &sink };
+		logger->start(sinks, 1);
+		std::vector<double> latencies = runThreads(threads, messages, rate, [logger](int thread, int message)
+		{
+			logger->logf(LogLevel::Line, "Camera: thread %d message %d, blend %.4f, fov %.2f end", thread, message, 0.12, 75.0);
+		});
+		logger->stop();
+		printLatencies("steady", latencies);
+		const uint64_t sent = static_cast<uint64_t>(threads) * static_cast<uint64_t>(messages);
+		const bool steadyOk = sink.received() == sent && 0 == sink.bad() && 0 == sink.outOfOrder() && 0 == logger->dropped();
+		std::printf("        %llu sent, %llu written, %llu dropped, %llu malformed, %llu out of order: %s\n", static_cast<unsigned long long>(sent),
+			static_cast<unsigned long long>(sink.received()), static_cast<unsigned long long>(logger->dropped()),
+			static_cast<unsigned long long>(sink.bad()), static_cast<unsigned long long>(sink.outOfOrder()), steadyOk ? "OK" : "FAILED");
+		ok = ok && steadyOk;
+		delete logger;
+	}
+
+	// 3. burst
+	{
+		AsyncLogger* logger = new AsyncLogger();
+		CheckingSink sink(path, 20);
+		ILogSink* sinks[] = { &sink };
+		logger->start(sinks, 1);
+		std::vector<double> latencies = runThreads(threads, messages, 0.0, [logger](int thread, int message)
+		{
+			logger->logf(LogLevel::Line, "Camera: thread %d message %d, blend %.4f, fov %.2f end", thread, message, 0.12, 75.0);
+		});
+		logger->stop();
+		printLatencies("burst", latencies);
+		const uint64_t sent = static_cast<uint64_t>(threads) * static_cast<uint64_t>(messages);
+		const bool burstOk = sink.received() + logger->dropped() == sent && logger->dropped() == sink.reportedDropped() && 0 == sink.bad()
+			&& 0 == sink.outOfOrder();
+		std::printf("        %llu sent, %llu written, %llu dropped, %llu reported dropped, %llu malformed, %llu out of order: %s\n",
+			static_cast<unsigned long long>(sent), static_cast<unsigned long long>(sink.received()), static_cast<unsigned long long>(logger->dropped()),
+			static_cast<unsigned long long>(sink.reportedDropped()), static_cast<unsigned long long>(sink.bad()),
+			static_cast<unsigned long long>(sink.outOfOrder()), burstOk ? "OK" : "FAILED");
+		ok = ok && burstOk;
+		delete logger;
+	}
+
+	std::error_code error;
+	fs::remove(path, error);
+	std::printf("%s\n", ok ? "OK" : "FAILED");
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,425 @@
+// Offline spectral analysis of recorded car motion. Computes the angular rate of the car in its own frame from consecutive
+// rotations, estimates its power spectrum per axis with Welch's method (Hann window, 50% overlapping segments) and prints
+// how the power is distributed over the frequency bands which cause cockpit shake, together with a suggested cutoff for
+// the rotation smoother in Camera::updateCamera. The telemetry is streamed in fixed-size blocks, so memory use only
+// depends on the segment length, not on the length of the recording. --self-test analyzes a generated recording and checks
+// the suggested blend is one the camera can use.
+//
+// Usage: MotionSpectrum <telemetry.csv> [--segment <power of two>] [--keep <fraction>]
+//        MotionSpectrum --self-test [--seed <n>]
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+#include "../Common/CarSampleReader.h"
+#include "../Common/Fft.h"
+#include "../Common/TestReport.h"
+#include "../../InjectableGenericCameraSystem/CameraSmoothing.h"
+
+using namespace IGCS;
+using namespace IGCS::Tools;
+
+namespace
+{
+	constexpr double kPi = 3.14159265358979323846;
+	constexpr double kRadToDeg = 57.29577951308232;
+	constexpr size_t kReadBlockSize = 4096;
+	constexpr int kAxisCount = 3;
+
+	const char* const kAxisNames[kAxisCount] = { "X (pitch)", "Y (yaw)", "Z (roll)" };
+
+	struct Band
+	{
+		const char* name;
+		double lowHz;
+		double highHz;
+	};
+
+	// Any usable smoother passes the cornering, the motion above it is what the cutoff is chosen from
+	constexpr double kBodyMotionLowHz = 0.5;
+	// Where the shake starts: road surface and engine vibration are what the smoother should take out, not the body motion.
+	constexpr double kShakeLowHz = 2.0;
+	// Blend values the camera can use: below, it lags the car by seconds, above, it barely smooths at all.
+	constexpr double kUsableBlendMin = 0.02;
+	constexpr double kUsableBlendMax = 0.5;
+
+	// Rough split of the motion sources seen from the cockpit. The last band runs to the Nyquist frequency.
+	const Band kBands[] = {
+		{ "driver input / cornering", 0.0, 0.5 },
+		{ "body roll / suspension", 0.5, 2.0 },
+		{ "road surface", 2.0, 8.0 },
+		{ "engine / vibration", 8.0, 1e9 },
+	};
+
+	// Welch power spectral density estimate over a stream of samples, one axis.
+	class WelchEstimator
+	{
+	public:
+		WelchEstimator(const Fft& fft, const std::vector<double>& window)
+			: _fft(fft), _window(window), _history(fft.size()), _buffer(fft.size()), _power(fft.size() / 2 + 1)
+		{
+		}
+
+		void add(double value)
+		{
+			_history[_writeIndex] = value;
+			_writeIndex = (_writeIndex + 1) % _history.size();
+			++_samplesSeen;
+			++_samplesSinceSegment;
+			// first segment once the history is full, then every half segment
+			const bool segmentReady = _segments == 0 ? _samplesSeen == _history.size() : _samplesSinceSegment >= _history.size() / 2;
+			if (segmentReady)
+			{
+				processSegment();
+				_samplesSinceSegment = 0;
+			}
+		}
+
+		[[nodiscard]] size_t segments() const { return _segments; }
+		[[nodiscard]] const std::vector<double>& accumulatedPower() const { return _power; }
+
+	private:
+		void processSegment()
+		{
+			const size_t size = _history.size();
+			double mean = 0.0;
+			for (double value : _history)
+			{
+				mean += value;
+			}
+			mean /= static_cast<double>(size);
+			// _writeIndex points at the oldest sample
+			for (size_t i = 0; i < size; ++i)
+			{
+				_buffer[i] = { (_history[(_writeIndex + i) % size] - mean) * _window[i], 0.0 };
+			}
+			_fft.transform(_buffer);
+			for (size_t k = 0; k < _power.size(); ++k)
+			{
+				_power[k] += std::norm(_buffer[k]);
+			}
+			++_segments;
+		}
+
+		const Fft& _fft;
+		const std::vector<double>& _window;
+		std::vector<double> _history;
+		std::vector<std::complex<double>> _buffer;
+		std::vector<double> _power;
+		size_t _writeIndex = 0;
+		size_t _samplesSeen = 0;
+		size_t _samplesSinceSegment = 0;
+		size_t _segments = 0;
+	};
+
+	struct Analysis
+	{
+		double sampleRate = 0.0;
+		double cutoff = 0.0;
+		double blend = 0.0;
+		double shakePeak = 0.0;		// the frequency of the strongest shake
+	};
+
+	// Gain of the camera's smoother, a one-pole low-pass filter y += blend * (x - y) running at sampleRate, at frequency.
+	double smootherGain(double blend, double frequency, double sampleRate)
+	{
+		const std::complex<double> delay = std::polar(1.0, -2.0 * kPi * frequency / sampleRate);
+		return std::abs(blend / (1.0 - (1.0 - blend) * delay));
+	}
+
+	void printUsage()
+	{
+		std::fprintf(stderr, "Usage: MotionSpectrum <telemetry.csv> [--segment <power of two, default 1024>] [--keep <fraction, default 0.9>]\n"
+			"       MotionSpectrum --self-test [--seed <n>]\n");
+	}
+
+	// Analyzes the recording at path and prints the spectrum and the suggested cutoff. False if there's nothing to analyze.
+	bool analyze(const std::string& path, size_t segmentLength, double keepFraction, Analysis& analysis)
+	{
+		CarSampleReader reader;
+		if (!reader.open(path))
+		{
+			std::fprintf(stderr, "Can't open '%s'\n", path.c_str());
+			return false;
+		}
+
+		const Fft fft(segmentLength);
+		std::vector<double> window(segmentLength);
+		double windowPower = 0.0;
+		for (size_t i = 0; i < segmentLength; ++i)
+		{
+			window[i] = 0.5 - 0.5 * std::cos(2.0 * kPi * static_cast<double>(i) / static_cast<double>(segmentLength));
+			windowPower += window[i] * window[i];
+		}
+		std::vector<WelchEstimator> estimators;
+		estimators.reserve(kAxisCount);
+		for (int axis = 0; axis < kAxisCount; ++axis)
+		{
+			estimators.emplace_back(fft, window);
+		}
+
+		std::vector<CarSample> block(kReadBlockSize);
+		CarSample previous;
+		bool havePrevious = false;
+		size_t rateSamples = 0;
+		double totalTime = 0.0;
+		size_t read;
+		while ((read = reader.readBlock(block.data(), block.size())) > 0)
+		{
+			for (size_t i = 0; i < read; ++i)
+			{
+				const CarSample& sample = block[i];
+				if (havePrevious)
+				{
+					const double dt = sample.time - previous.time;
+					if (dt <= 0.0)
+					{
+						// duplicated or out of order frame
+						continue;
+					}
+					const Smoothing::Vec3 step = Smoothing::relativeRotationVector(previous.rotation, sample.rotation);
+					estimators[0].add(step.x / dt * kRadToDeg);
+					estimators[1].add(step.y / dt * kRadToDeg);
+					estimators[2].add(step.z / dt * kRadToDeg);
+					totalTime += dt;
+					++rateSamples;
+				}
+				previous = sample;
+				havePrevious = true;
+			}
+		}
+		if (reader.malformedLines() > 0)
+		{
+			std::fprintf(stderr, "Skipped %zu malformed lines\n", reader.malformedLines());
+		}
+		const size_t segments = estimators[0].segments();
+		if (segments == 0)
+		{
+			std::fprintf(stderr, "Not enough samples for a single segment of %zu frames\n", segmentLength);
+			return false;
+		}
+
+		// The recording is treated as uniformly sampled at the mean frame rate, which is what the camera sees as well: it
+		// blends once per frame.
+		const double sampleRate = static_cast<double>(rateSamples) / totalTime;
+		const double binWidth = sampleRate / static_cast<double>(segmentLength);
+		const double nyquist = sampleRate / 2.0;
+		const size_t binCount = segmentLength / 2 + 1;
+
+		// One-sided PSD in (deg/s)^2 / Hz.
+		std::vector<std::vector<double>> psd(kAxisCount, std::vector<double>(binCount));
+		for (int axis = 0; axis < kAxisCount; ++axis)
+		{
+			const auto& power = estimators[axis].accumulatedPower();
+			for (size_t k = 0; k < binCount; ++k)
+			{
+				const double oneSided = (k == 0 || k == binCount - 1) ? 1.0 : 2.0;
+				psd[axis][k] = oneSided * power[k] / (sampleRate * windowPower * static_cast<double>(segments));
+			}
+		}
+
+		std::printf("Analyzed %zu frames (%.1f s) at %.2f Hz, %zu segments of %zu frames, resolution %.4f Hz\n\n",
+			rateSamples, totalTime, sampleRate, segments, segmentLength, binWidth);
+		std::printf("Angular rate power per band, (deg/s)^2 and share of the axis total\n");
+		std::printf("%-26s %17s", "band", "range Hz");
+		for (int axis = 0; axis < kAxisCount; ++axis)
+		{
+			std::printf(" %22s", kAxisNames[axis]);
+		}
+		std::printf("\n");
+
+		double axisTotal[kAxisCount] = {};
+		for (int axis = 0; axis < kAxisCount; ++axis)
+		{
+			for (size_t k = 1; k < binCount; ++k)
+			{
+				axisTotal[axis] += psd[axis][k] * binWidth;
+			}
+		}
+		for (const auto& band : kBands)
+		{
+			if (band.lowHz >= nyquist)
+			{
+				break;
+			}
+			const double high = std::min(band.highHz, nyquist);
+			std::printf("%-26s %7.2f - %7.2f", band.name, band.lowHz, high);
+			for (int axis = 0; axis < kAxisCount; ++axis)
+			{
+				double bandPower = 0.0;
+				// the DC bin only holds what the per-segment mean removal left over
+				for (size_t k = 1; k < binCount; ++k)
+				{
+					const double frequency = static_cast<double>(k) * binWidth;
+					if (frequency >= band.lowHz && (frequency < high || high >= nyquist))
+					{
+						bandPower += psd[axis][k] * binWidth;
+					}
+				}
+				const double share = axisTotal[axis] > 0.0 ? 100.0 * bandPower / axisTotal[axis] : 0.0;
+				std::printf(" %12.3f (%5.1f%%)", bandPower, share);
+			}
+			std::printf("\n");
+		}
+
+		// Suggested cutoff. Rate power grows with the square of the frequency, so the vibration dominates it; the angle
+		// spectrum, the rate spectrum divided by (2 pi f)^2, shows the motion itself. The cornering dominates that in turn and
+		// passes any usable smoother, so the cutoff is the frequency below which keepFraction of the angle power above the
+		// cornering band lies, at most the start of the shake bands: what's above is shake the smoother should take out. The
+		// camera's slerp is a one-pole low-pass filter running at the frame rate, so its blend factor follows from the cutoff
+		// as 1 - exp(-2 pi fc / fs).
+		const size_t firstBin = std::max<size_t>(1, static_cast<size_t>(std::ceil(kBodyMotionLowHz / binWidth)));
+		std::vector<double> anglePower(binCount);
+		double totalAnglePower = 0.0;
+		double shakePeakPower = 0.0;
+		for (size_t k = firstBin; k < binCount; ++k)
+		{
+			const double frequency = static_cast<double>(k) * binWidth;
+			const double omega = 2.0 * kPi * frequency;
+			for (int axis = 0; axis < kAxisCount; ++axis)
+			{
+				anglePower[k] += psd[axis][k] * binWidth / (omega * omega);
+			}
+			totalAnglePower += anglePower[k];
+			if (frequency >= kShakeLowHz && anglePower[k] > shakePeakPower)
+			{
+				shakePeakPower = anglePower[k];
+				analysis.shakePeak = frequency;
+			}
+		}
+		double cumulative = 0.0;
+		double keptBelow = nyquist;
+		for (size_t k = firstBin; k < binCount; ++k)
+		{
+			cumulative += anglePower[k];
+			if (cumulative >= keepFraction * totalAnglePower)
+			{
+				keptBelow = static_cast<double>(k) * binWidth;
+				break;
+			}
+		}
+		analysis.sampleRate = sampleRate;
+		analysis.cutoff = std::min(keptBelow, kShakeLowHz);
+		analysis.blend = 1.0 - std::exp(-2.0 * kPi * analysis.cutoff / sampleRate);
+		std::printf("\n%.0f%% of the angle power above %.2f Hz is below %.2f Hz, the shake bands start at %.2f Hz.\n", keepFraction * 100.0,
+			kBodyMotionLowHz, keptBelow, kShakeLowHz);
+		std::printf("Suggested smoother cutoff: %.2f Hz, at %.2f fps that's\nblend=%.4f\n", analysis.cutoff, sampleRate, analysis.blend);
+		std::printf("It leaves %.0f%% of the shake at %.2f Hz and %.0f%% of the strongest shake, at %.2f Hz.\n",
+			100.0 * smootherGain(analysis.blend, kShakeLowHz, sampleRate), kShakeLowHz, 100.0 * smootherGain(analysis.blend, analysis.shakePeak, sampleRate),
+			analysis.shakePeak);
+		if (analysis.blend < kUsableBlendMin || analysis.blend > kUsableBlendMax)
+		{
+			std::printf("That's outside of what the camera can use (%.2f - %.2f), check the recording.\n", kUsableBlendMin, kUsableBlendMax);
+		}
+		return true;
+	}
+
+	// Rotation by angle radians around a unit axis.
+	Smoothing::Quat axisAngle(double x, double y, double z, double angle)
+	{
+		const double s = std::sin(angle / 2.0);
+		return { static_cast<float>(x * s), static_cast<float>(y * s), static_cast<float>(z * s), static_cast<float>(std::cos(angle / 2.0)) };
+	}
+
+	// Writes seconds of generated car motion at 60 fps: cornering and body roll of several degrees, road surface and engine
+	// vibration of fractions of a degree. Small as it is, the vibration has more angular rate power than the cornering, as in
+	// recordings.
+	bool writeSample(const std::string& path, double seconds, unsigned seed)
+	{
+		std::FILE* file = std::fopen(path.c_str(), "wb");
+		if (nullptr == file)
+		{
+			return false;
+		}
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<double> phase(0.0, 2.0 * kPi);
+		std::normal_distribution<double> gravel(0.0, 0.1);
+		const double cornerPhase = phase(random);
+		const double rollPhase = phase(random);
+		const double roadPhase = phase(random);
+		const double enginePhase = phase(random);
+		const double degrees = 1.0 / kRadToDeg;
+		std::fprintf(file, "time,posX,posY,posZ,rotX,rotY,rotZ,rotW\n");
+		for (int frame = 0; frame < static_cast<int>(seconds * 60.0); ++frame)
+		{
+			const double t = frame / 60.0;
+			const double yaw = 40.0 * degrees * std::sin(2.0 * kPi * 0.1 * t + cornerPhase);
+			const double pitch = (1.5 * std::sin(2.0 * kPi * 1.2 * t + rollPhase) + 0.4 * std::sin(2.0 * kPi * 5.3 * t + roadPhase)
+				+ gravel(random)) * degrees;
+			const double roll = (3.0 * std::sin(2.0 * kPi * 0.7 * t + rollPhase) + 0.1 * std::sin(2.0 * kPi * 23.0 * t + enginePhase)
+				+ gravel(random)) * degrees;
+			using Smoothing::multiply;
+			const Smoothing::Quat rotation = multiply(multiply(axisAngle(0, 0, 1, roll), axisAngle(1, 0, 0, pitch)), axisAngle(0, 1, 0, yaw));
+			std::fprintf(file, "%.6f,%.3f,%.3f,%.3f,%.7f,%.7f,%.7f,%.7f\n", t, 0.0, 0.0, 20.0 * t, rotation.x, rotation.y, rotation.z, rotation.w);
+		}
+		return 0 == std::fclose(file);
+	}
+
+	int selfTest(unsigned seed)
+	{
+		std::printf("Seed %u\n", seed);
+		const std::filesystem::path path = std::filesystem::temp_directory_path() / ("MotionSpectrum-" + std::to_string(seed) + ".csv");
+		bool ok = report("the sample recording is written", writeSample(path.string(), 300.0, seed));
+		Analysis analysis;
+		ok = report("the sample recording is analyzed", ok && analyze(path.string(), 1024, 0.9, analysis)) && ok;
+		std::error_code error;
+		std::filesystem::remove(path, error);
+		// the body motion is at 0.7 and 1.2 Hz
+		ok = report("the cutoff is between the body motion and the shake", analysis.cutoff > 1.1 && analysis.cutoff < kShakeLowHz) && ok;
+		ok = report("the suggested blend is in the usable range", analysis.blend >= kUsableBlendMin && analysis.blend <= kUsableBlendMax) && ok;
+		ok = report("the strongest shake is the road surface's", std::fabs(analysis.shakePeak - 5.3) < 0.2) && ok;
+		ok = report("and it is at least halved", smootherGain(analysis.blend, analysis.shakePeak, analysis.sampleRate) <= 0.5) && ok;
+		return finish(ok);
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		printUsage();
+		return 1;
+	}
+	if (0 == std::strcmp(argv[1], "--self-test"))
+	{
+		unsigned seed = std::random_device{}();
+		Options options;
+		options.add("--seed", seed);
+		if (!options.parse(argc, argv, 2))
+		{
+			printUsage();
+			return 1;
+		}
+		return selfTest(seed);
+	}
+	size_t segmentLength = 1024;
+	double keepFraction = 0.9;
+	const std::string path = argv[1];
+	for (int i = 2; i < argc; ++i)
+	{
+		const bool hasValue = i + 1 < argc;
+		if (hasValue && 0 == std::strcmp(argv[i], "--segment")) { segmentLength = std::strtoul(argv[++i], nullptr, 10); }
+		else if (hasValue && 0 == std::strcmp(argv[i], "--keep")) { keepFraction = std::strtod(argv[++i], nullptr); }
+		else
+		{
+			printUsage();
+			return 1;
+		}
+	}
+	if (!Fft::isPowerOfTwo(segmentLength))
+	{
+		std::fprintf(stderr, "--segment has to be a power of two\n");
+		return 1;
+	}
+	keepFraction = std::clamp(keepFraction, 0.01, 0.999);
+
+	Analysis analysis;
+	return analyze(path, segmentLength, keepFraction, analysis) ? 0 : 1;
+}
@@ -0,0 +1,235 @@
+// Benchmark and determinism test for the camera noise (see ProceduralNoise.h). Checks the table holds the stb_perlin noise of
+// each lane at every sample, normalized to -1..1, repeats after kPeriod without a seam, is the same bit for bit every time it's
+// built, and that CameraNoise gives the same offsets for the same frame times, again after a reset, and none without a table.
+// Then measures what building the table costs and what a CameraNoise update with every effect on costs, against evaluating the
+// same noise with stb_perlin every frame. Exits with 1 if a check fails.
+//
+// Usage: NoiseTableBenchmark [--frames 2000000] [--builds 20]
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#define STB_PERLIN_IMPLEMENTATION
+#include "../Common/TestReport.h"
+#include "stb_perlin.h"
+#undef STB_PERLIN_IMPLEMENTATION
+#include "../../InjectableGenericCameraSystem/ProceduralNoise.h"
+
+using namespace IGCS;
+using namespace IGCS::Tools;
+using namespace IGCS::CameraEffects;
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+	constexpr int kNoiseLanes = NoiseTable::kBreathingLane;
+
+	// Every lane at every sample.
+	std::vector<float> allSamples(const NoiseTable& table)
+	{
+		std::vector<float> samples;
+		for (int i = 0; i < NoiseTable::kSampleCount; ++i)
+		{
+			float lanes[NoiseTable::kLanes];
+			table.sample(static_cast<float>(i) / NoiseTable::kSamplesPerUnit, lanes);
+			samples.insert(samples.end(), lanes, lanes + NoiseTable::kLanes);
+		}
+		return samples;
+	}
+
+	ShakeParams shakeOn()
+	{
+		ShakeParams shake;
+		shake.enabled = true;
+		shake.amplitude = 0.02f;
+		shake.frequency = 8.0f;
+		return shake;
+	}
+
+	HandheldParams handheldOn()
+	{
+		HandheldParams handheld;
+		handheld.enabled = true;
+		handheld.breathingIntensity = 1.0f;
+		handheld.breathingRate = 0.25f;
+		return handheld;
+	}
+
+	// Varying frame times, the same for every run.
+	float frameTime(int frame)
+	{
+		return 1.0f / 60.0f + 0.004f * static_cast<float>((frame * 7919) % 13) / 13.0f;
+	}
+
+	// The offsets of a run, position and rotation per frame.
+	std::vector<float> run(CameraNoise& noise, int frames)
+	{
+		std::vector<float> offsets;
+		for (int frame = 0; frame < frames; ++frame)
+		{
+			noise.update(frameTime(frame), shakeOn(), handheldOn());
+			const Vec3& position = noise.positionOffset();
+			const Vec3& rotation = noise.rotationOffset();
+			offsets.insert(offsets.end(), { position.x, position.y, position.z, rotation.x, rotation.y, rotation.z });
+		}
+		return offsets;
+	}
+
+	// What CameraNoise would cost without the table: the same lookups, each evaluating the noise of its lanes.
+	class DirectNoise
+	{
+	public:
+		void update(float dt)
+		{
+			_positionPhase = NoiseTable::wrap(_positionPhase + dt);
+			_rotationPhase = NoiseTable::wrap(_rotationPhase + dt * 0.6f);
+			_jitterPhase = NoiseTable::wrap(_jitterPhase + dt * 6.0f);
+			_shakePhase = NoiseTable::wrap(_shakePhase + dt * 8.0f);
+			float sum = 0.0f;
+			for (int lane = 0; lane < kNoiseLanes; ++lane)
+			{
+				sum += NoiseTable::fbm(_jitterPhase, lane);
+			}
+			for (int lane = 0; lane < 3; ++lane)
+			{
+				sum += NoiseTable::fbm(_positionPhase, lane) + NoiseTable::fbm(_rotationPhase, 3 + lane) + NoiseTable::fbm(_shakePhase, 3 + lane);
+			}
+			sum += std::sin(_positionPhase);
+			_result = sum;
+		}
+
+		[[nodiscard]] float result() const noexcept { return _result; }
+
+	private:
+		float _positionPhase = 0.0f;
+		float _rotationPhase = 17.0f;
+		float _jitterPhase = 33.0f;
+		float _shakePhase = 49.0f;
+		float _result = 0.0f;
+	};
+
+	double seconds(Clock::time_point start)
+	{
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	void printUsage()
+	{
+		std::fprintf(stderr, "Usage: NoiseTableBenchmark [--frames <default 2000000>] [--builds <default 20>]\n");
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	int frames = 2000000;
+	int builds = 20;
+	Options options;
+	options.add("--frames", frames);
+	options.add("--builds", builds);
+	if (!options.parse(argc, argv))
+	{
+		printUsage();
+		return 1;
+	}
+	if (frames < 1000 || builds < 1)
+	{
+		printUsage();
+		return 1;
+	}
+
+	const NoiseTable table;
+	const std::vector<float> samples = allSamples(table);
+
+	// the table is the normalized stb_perlin noise
+	float maxAbs[kNoiseLanes] = {};
+	for (int i = 0; i < NoiseTable::kSampleCount; ++i)
+	{
+		for (int lane = 0; lane < kNoiseLanes; ++lane)
+		{
+			maxAbs[lane] = std::max(maxAbs[lane], std::fabs(NoiseTable::fbm(static_cast<float>(i) / NoiseTable::kSamplesPerUnit, lane)));
+		}
+	}
+	bool matches = true;
+	bool inRange = true;
+	bool periodic = true;
+	for (int i = 0; i < NoiseTable::kSampleCount; ++i)
+	{
+		const float x = static_cast<float>(i) / NoiseTable::kSamplesPerUnit;
+		for (int lane = 0; lane < kNoiseLanes; ++lane)
+		{
+			const float value = samples[static_cast<size_t>(i) * NoiseTable::kLanes + lane];
+			matches = matches && std::fabs(value - NoiseTable::fbm(x, lane) / maxAbs[lane]) <= 1e-6f;
+			inRange = inRange && value >= -1.0f && value <= 1.0f;
+			// x + kPeriod is exact, so the wrapped lattice gives the very same value
+			periodic = periodic && NoiseTable::fbm(x, lane) == NoiseTable::fbm(x + NoiseTable::kPeriod, lane);
+		}
+	}
+	bool ok = report("the table holds the normalized stb_perlin noise", matches && inRange);
+	// right before kPeriod the lookup is all but the guard sample, which has to be the first
+	float end[NoiseTable::kLanes];
+	table.sample(std::nextafter(static_cast<float>(NoiseTable::kPeriod), 0.0f), end);
+	bool seamless = true;
+	for (int lane = 0; lane < NoiseTable::kLanes; ++lane)
+	{
+		seamless = seamless && std::fabs(end[lane] - samples[static_cast<size_t>(lane)]) <= 1e-4f;
+	}
+	ok = report("the noise repeats after kPeriod without a seam", periodic && seamless) && ok;
+	bool distinct = true;
+	for (int lane = 1; lane < kNoiseLanes; ++lane)
+	{
+		distinct = distinct && samples[static_cast<size_t>(NoiseTable::kSamplesPerUnit / 2) * NoiseTable::kLanes + lane]
+			!= samples[static_cast<size_t>(NoiseTable::kSamplesPerUnit / 2) * NoiseTable::kLanes];
+	}
+	ok = report("every noise lane is a noise of its own", distinct) && ok;
+
+	// determinism
+	const NoiseTable rebuilt;
+	ok = report("a table built again is the same bit for bit", allSamples(rebuilt) == samples) && ok;
+	CameraNoise first;
+	CameraNoise second;
+	first.setTable(&table);
+	second.setTable(&rebuilt);
+	const std::vector<float> firstRun = run(first, 10000);
+	ok = report("the same frame times give the same offsets", firstRun == run(second, 10000)) && ok;
+	first.reset();
+	ok = report("after a reset the offsets start over", firstRun == run(first, 10000)) && ok;
+	CameraNoise withoutTable;
+	const std::vector<float> idle = run(withoutTable, 100);
+	ok = report("without a table the offsets stay 0", std::all_of(idle.begin(), idle.end(), [](float value) { return 0.0f == value; })) && ok;
+
+	// what it costs. The checksum keeps the compiler from dropping the work.
+	float checksum = 0.0f;
+	Clock::time_point start = Clock::now();
+	for (int build = 0; build < builds; ++build)
+	{
+		const NoiseTable built;
+		float lanes[NoiseTable::kLanes];
+		built.sample(1.0f, lanes);
+		checksum += lanes[0];
+	}
+	std::printf("        building the table: %.2f ms, %zu bytes\n", seconds(start) * 1000.0 / builds,
+		static_cast<size_t>(NoiseTable::kSampleCount + 1) * NoiseTable::kLanes * sizeof(float));
+	CameraNoise noise;
+	noise.setTable(&table);
+	start = Clock::now();
+	for (int frame = 0; frame < frames; ++frame)
+	{
+		noise.update(frameTime(frame), shakeOn(), handheldOn());
+		checksum += noise.positionOffset().x + noise.rotationOffset().z;
+	}
+	const double tableNs = seconds(start) * 1e9 / frames;
+	DirectNoise direct;
+	start = Clock::now();
+	for (int frame = 0; frame < frames; ++frame)
+	{
+		direct.update(frameTime(frame));
+		checksum += direct.result();
+	}
+	const double directNs = seconds(start) * 1e9 / frames;
+	std::printf("        update with every effect on: %.1f ns from the table, %.1f ns evaluating stb_perlin (%.1fx)  [%g]\n",
+		tableNs, directNs, directNs / tableNs, static_cast<double>(checksum));
+
+	return finish(ok);
+}
@@ -0,0 +1,225 @@
+// Tests the XInput pad connection handling (see PadConnectionManager.h) with a fake XInput whose reads of an empty slot are slow,
+// like the real driver's. With a fake clock: poll never reads a disconnected slot, a watched empty slot is probed at intervals
+// growing from 1s to 8s, unwatched slots are never probed, a device change probes right away and starts the intervals over, and a
+// pad which goes away is found disconnected by the one read which fails and probed again right away. Then an input thread polls
+// flat out while pads come and go and a worker thread probes: the input thread may read an empty slot only once for each time a
+// pad was found, the read which finds it gone. Exits with 1 if a check fails.
+//
+// Usage: PadConnectionTest [--seconds 2] [--delay 200 (microseconds per read of an empty slot)] [--seed <n>]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include "../Common/TestReport.h"
+#include "../../InjectableGenericCameraSystem/PadConnectionManager.h"
+
+using namespace IGCS;
+using namespace IGCS::Tools;
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+	constexpr int64_t kSecond = 1000000000LL;
+
+	thread_local bool t_inputThread = false;
+
+	// XInputGetState with pads to plug in and out. Reading an empty slot takes delay, counted per slot and thread.
+	class FakeXInput : public IPadStateSource
+	{
+	public:
+		bool getState(uint32_t slot, PadState& state) noexcept override
+		{
+			if (slot >= PadConnectionManager::kSlots)
+			{
+				return false;
+			}
+			if (plugged[slot].load(std::memory_order_relaxed))
+			{
+				(t_inputThread ? inputReads : probeReads)[slot].fetch_add(1, std::memory_order_relaxed);
+				state.packetNumber = ++_packet;
+				return true;
+			}
+			(t_inputThread ? inputEmptyReads : probeEmptyReads)[slot].fetch_add(1, std::memory_order_relaxed);
+			const Clock::time_point end = Clock::now() + delay;
+			while (Clock::now() < end)
+			{
+			}
+			return false;
+		}
+
+		std::atomic<bool> plugged[PadConnectionManager::kSlots] = {};
+		std::chrono::microseconds delay{ 0 };
+		std::atomic<uint64_t> inputReads[PadConnectionManager::kSlots] = {};
+		std::atomic<uint64_t> probeReads[PadConnectionManager::kSlots] = {};
+		std::atomic<uint64_t> inputEmptyReads[PadConnectionManager::kSlots] = {};
+		std::atomic<uint64_t> probeEmptyReads[PadConnectionManager::kSlots] = {};
+
+	private:
+		std::atomic<uint32_t> _packet{ 0 };
+	};
+
+	void printUsage()
+	{
+		std::fprintf(stderr, "Usage: PadConnectionTest [--seconds <default 2>] [--delay <microseconds per read of an empty slot, default 200>] [--seed <n>]\n");
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	double seconds = 2.0;
+	int delay = 200;
+	unsigned seed = std::random_device{}();
+	Options options;
+	options.add("--seconds", seconds);
+	options.add("--delay", delay);
+	options.add("--seed", seed);
+	if (!options.parse(argc, argv))
+	{
+		printUsage();
+		return 1;
+	}
+	if (seconds <= 0.0 || delay < 0)
+	{
+		printUsage();
+		return 1;
+	}
+	std::printf("Seed %u\n", seed);
+
+	// slot 0 watched and empty, slot 1 not watched
+	FakeXInput xinput;
+	PadConnectionManager manager(xinput);
+	manager.watch(0);
+	t_inputThread = true;
+	PadState state;
+	bool ok = report("poll never reads a disconnected slot", !manager.poll(0, state) && !manager.poll(1, state) && !manager.poll(7, state)
+		&& 0 == xinput.inputEmptyReads[0] && 0 == xinput.inputEmptyReads[1]);
+	t_inputThread = false;
+
+	// probed right away once watched, then at 1s, 2s, 4s, 8s, 8s
+	int64_t now = 100 * kSecond;
+	int64_t deadline = manager.step(now);
+	bool intervals = 1 == xinput.probeEmptyReads[0] && now + PadConnectionManager::kInitialProbeInterval == deadline;
+	for (const int64_t interval : { 2, 4, 8, 8, 8 })
+	{
+		const uint64_t probesBefore = manager.probes();
+		// woken early, e.g. for another job: not due yet
+		intervals = intervals && deadline == manager.step(deadline - 1) && probesBefore == manager.probes();
+		now = deadline;
+		deadline = manager.step(now);
+		intervals = intervals && probesBefore + 1 == manager.probes() && interval * kSecond == deadline - now;
+	}
+	ok = report("an empty slot is probed at intervals growing from 1s to 8s", intervals && 6 == xinput.probeEmptyReads[0]) && ok;
+	ok = report("unwatched slots are never probed", 0 == xinput.probeEmptyReads[1] + xinput.probeEmptyReads[2] + xinput.probeEmptyReads[3]) && ok;
+
+	// a pad is plugged in halfway through an 8s wait: the notification probes right away
+	now += 3 * kSecond;
+	xinput.plugged[0] = true;
+	manager.devicesChanged();
+	deadline = manager.step(now);
+	ok = report("a device change probes right away", 1 == xinput.probeReads[0] && manager.isConnected(0)
+		&& now + PadConnectionManager::kMaxProbeInterval == deadline) && ok;
+	t_inputThread = true;
+	const bool read = manager.poll(0, state) && manager.poll(0, state);
+	ok = report("a connected slot is read by poll", read && 2 == xinput.inputReads[0] && 0 == xinput.inputEmptyReads[0]) && ok;
+
+	// it's pulled out: one failed read, then poll leaves the slot alone
+	xinput.plugged[0] = false;
+	bool gone = !manager.poll(0, state) && !manager.isConnected(0);
+	for (int i = 0; i < 1000; ++i)
+	{
+		gone = gone && !manager.poll(0, state);
+	}
+	t_inputThread = false;
+	ok = report("a pad which is gone is read once, then not any more", gone && 1 == xinput.inputEmptyReads[0]) && ok;
+	now += kSecond;
+	const uint64_t emptyProbes = xinput.probeEmptyReads[0];
+	deadline = manager.step(now);
+	ok = report("and probed again right away, starting at 1s", emptyProbes + 1 == xinput.probeEmptyReads[0]
+		&& now + PadConnectionManager::kInitialProbeInterval == deadline) && ok;
+
+	// a device change while the slot waits starts the intervals over
+	now = deadline;
+	deadline = manager.step(now);
+	now += kSecond;
+	manager.devicesChanged();
+	deadline = manager.step(now);
+	ok = report("a device change starts the intervals over", now + PadConnectionManager::kInitialProbeInterval == deadline) && ok;
+
+	// an input thread polling every slot flat out while pads come and go, a worker probing
+	FakeXInput threadedXInput;
+	threadedXInput.delay = std::chrono::microseconds(delay);
+	PadConnectionManager threaded(threadedXInput);
+	for (uint32_t slot = 0; slot < PadConnectionManager::kSlots; ++slot)
+	{
+		threaded.watch(slot);
+	}
+	std::atomic<bool> done{ false };
+	std::thread worker([&]
+	{
+		int64_t clock = 0;
+		while (!done.load(std::memory_order_acquire))
+		{
+			// the fake clock moves a second per step at most, so the intervals run their course quickly
+			const int64_t next = threaded.step(clock);
+			clock = std::min(next, clock + kSecond);
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+	});
+	uint64_t polls = 0;
+	uint64_t padReads = 0;
+	int64_t worstPoll = 0;
+	std::thread input([&]
+	{
+		t_inputThread = true;
+		PadState padState;
+		while (!done.load(std::memory_order_acquire))
+		{
+			for (uint32_t slot = 0; slot < PadConnectionManager::kSlots; ++slot)
+			{
+				const Clock::time_point start = Clock::now();
+				padReads += threaded.poll(slot, padState) ? 1 : 0;
+				worstPoll = std::max<int64_t>(worstPoll, std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+				++polls;
+			}
+		}
+	});
+	std::mt19937 random(seed);
+	uint64_t changes = 0;
+	const Clock::time_point end = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+	while (Clock::now() < end)
+	{
+		const uint32_t slot = random() % PadConnectionManager::kSlots;
+		threadedXInput.plugged[slot].store(!threadedXInput.plugged[slot].load());
+		if (0 == random() % 2)
+		{
+			threaded.devicesChanged();
+		}
+		++changes;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1 + random() % 5));
+	}
+	done.store(true, std::memory_order_release);
+	input.join();
+	worker.join();
+	uint64_t inputEmpty = 0;
+	uint64_t probeEmpty = 0;
+	// the worker only reads disconnected slots, so each of its reads which finds a pad connects the slot
+	uint64_t connects = 0;
+	for (uint32_t slot = 0; slot < PadConnectionManager::kSlots; ++slot)
+	{
+		inputEmpty += threadedXInput.inputEmptyReads[slot];
+		probeEmpty += threadedXInput.probeEmptyReads[slot];
+		connects += threadedXInput.probeReads[slot];
+	}
+	std::printf("        %llu polls, %llu pad reads; %llu pads plugged or pulled, %llu found by the worker\n",
+		static_cast<unsigned long long>(polls), static_cast<unsigned long long>(padReads), static_cast<unsigned long long>(changes),
+		static_cast<unsigned long long>(connects));
+	std::printf("        empty slot reads: %llu by the input thread, %llu by the worker; slowest poll %.3fms\n",
+		static_cast<unsigned long long>(inputEmpty), static_cast<unsigned long long>(probeEmpty), worstPoll / 1e6);
+	ok = report("the input thread reads empty slots once per pad found", padReads > 0 && connects > 0 && inputEmpty <= connects) && ok;
+
+	return finish(ok);
+}
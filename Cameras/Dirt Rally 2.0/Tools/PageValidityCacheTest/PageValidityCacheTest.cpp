@@ -0,0 +1,267 @@
+// Tests the page validity cache (see PageValidityCache.h) on real memory: maps a few pages, asks the operating system for the
+// regions like the dll does (VirtualQuery on Windows, /proc/self/maps on Linux) and changes the protection of pages while
+// the cache has them. Checks repeated checks of a page are served from the cache, an entry is looked up again after
+// kLifetimeFrames frames and sees a page which became unreadable, a read which faults on a page the cache still has as
+// readable drops the entry so the next check sees it, and pages sharing an entry replace each other. Reads go through a
+// guarded copy like HostGameMemory's. Exits with 1 if a check fails.
+//
+// Usage: PageValidityCacheTest
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include "../Common/TestReport.h"
+#include "../../InjectableGenericCameraSystem/PageValidityCache.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <csetjmp>
+#include <csignal>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace IGCS;
+using namespace IGCS::Tools;
+
+namespace
+{
+	constexpr size_t kPages = PageValidityCache::kEntryCount + 4;
+	constexpr size_t kMappingSize = kPages * PageValidityCache::kPageSize;
+
+#ifdef _WIN32
+	class SystemRegionProvider : public IMemoryRegionProvider
+	{
+	public:
+		bool queryRegion(uintptr_t address, MemoryRegion& region) noexcept override
+		{
+			++queries;
+			MEMORY_BASIC_INFORMATION info;
+			if (0 == VirtualQuery(reinterpret_cast<LPCVOID>(address), &info, sizeof(info)))
+			{
+				return false;
+			}
+			const DWORD readableFlags = PAGE_READONLY | PAGE_READWRITE | PAGE_WRITECOPY | PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY;
+			region.start = reinterpret_cast<uintptr_t>(info.BaseAddress);
+			region.end = region.start + info.RegionSize;
+			region.readable = MEM_COMMIT == info.State && 0 != (info.Protect & readableFlags) && 0 == (info.Protect & (PAGE_GUARD | PAGE_NOACCESS));
+			return true;
+		}
+
+		int queries = 0;
+	};
+
+	uint8_t* mapPages()
+	{
+		return static_cast<uint8_t*>(VirtualAlloc(nullptr, kMappingSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+	}
+
+	void unmapPages(uint8_t* pages)
+	{
+		VirtualFree(pages, 0, MEM_RELEASE);
+	}
+
+	bool setReadable(uint8_t* page, bool readable)
+	{
+		DWORD previous;
+		return FALSE != VirtualProtect(page, PageValidityCache::kPageSize, readable ? PAGE_READWRITE : PAGE_NOACCESS, &previous);
+	}
+
+	bool guardedCopy(const uint8_t* source, void* destination, size_t size)
+	{
+		__try
+		{
+			memcpy(destination, source, size);
+			return true;
+		}
+		__except (EXCEPTION_EXECUTE_HANDLER)
+		{
+			return false;
+		}
+	}
+#else
+	// /proc/self/maps lists every mapping with its protection, a changed protection splits the mapping.
+	class SystemRegionProvider : public IMemoryRegionProvider
+	{
+	public:
+		bool queryRegion(uintptr_t address, MemoryRegion& region) noexcept override
+		{
+			++queries;
+			FILE* maps = std::fopen("/proc/self/maps", "r");
+			if (nullptr == maps)
+			{
+				return false;
+			}
+			bool found = false;
+			char line[512];
+			while (!found && nullptr != std::fgets(line, sizeof(line), maps))
+			{
+				unsigned long long start = 0;
+				unsigned long long end = 0;
+				char permissions[5] = {};
+				if (3 == std::sscanf(line, "%llx-%llx %4s", &start, &end, permissions) && address >= start && address < end)
+				{
+					region.start = static_cast<uintptr_t>(start);
+					region.end = static_cast<uintptr_t>(end);
+					region.readable = 'r' == permissions[0];
+					found = true;
+				}
+			}
+			std::fclose(maps);
+			return found;
+		}
+
+		int queries = 0;
+	};
+
+	uint8_t* mapPages()
+	{
+		void* pages = mmap(nullptr, kMappingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		return MAP_FAILED == pages ? nullptr : static_cast<uint8_t*>(pages);
+	}
+
+	void unmapPages(uint8_t* pages)
+	{
+		munmap(pages, kMappingSize);
+	}
+
+	bool setReadable(uint8_t* page, bool readable)
+	{
+		return 0 == mprotect(page, PageValidityCache::kPageSize, readable ? PROT_READ | PROT_WRITE : PROT_NONE);
+	}
+
+	sigjmp_buf s_faultJump;
+
+	void onFault(int)
+	{
+		siglongjmp(s_faultJump, 1);
+	}
+
+	// what __try / __except does for the dll
+	bool guardedCopy(const uint8_t* source, void* destination, size_t size)
+	{
+		struct sigaction action{};
+		struct sigaction previousSegv{};
+		struct sigaction previousBus{};
+		action.sa_handler = onFault;
+		sigemptyset(&action.sa_mask);
+		sigaction(SIGSEGV, &action, &previousSegv);
+		sigaction(SIGBUS, &action, &previousBus);
+		bool copied = false;
+		if (0 == sigsetjmp(s_faultJump, 1))
+		{
+			const volatile uint8_t* from = source;
+			uint8_t* to = static_cast<uint8_t*>(destination);
+			for (size_t i = 0; i < size; ++i)
+			{
+				to[i] = from[i];
+			}
+			copied = true;
+		}
+		sigaction(SIGSEGV, &previousSegv, nullptr);
+		sigaction(SIGBUS, &previousBus, nullptr);
+		return copied;
+	}
+#endif
+
+	// HostGameMemory::read
+	bool read(PageValidityCache& cache, const uint8_t* source, void* destination, size_t size)
+	{
+		if (!cache.isReadable(source, size))
+		{
+			return false;
+		}
+		if (!guardedCopy(source, destination, size))
+		{
+			cache.invalidate(source);
+			cache.invalidate(source + size - 1);
+			return false;
+		}
+		return true;
+	}
+
+	uint8_t* page(uint8_t* pages, size_t index)
+	{
+		return pages + index * PageValidityCache::kPageSize;
+	}
+}
+
+
+int main(int argc, char**)
+{
+	if (argc > 1)
+	{
+		std::fprintf(stderr, "Usage: PageValidityCacheTest\n");
+		return 1;
+	}
+	uint8_t* pages = mapPages();
+	if (nullptr == pages)
+	{
+		std::printf("Can't map %zu pages\n", kPages);
+		return 1;
+	}
+	std::memset(pages, 0x5A, kMappingSize);
+
+	SystemRegionProvider provider;
+	PageValidityCache cache(provider);
+	uint8_t buffer[64];
+
+	// hits
+	bool ok = report("a mapped page is readable", cache.isReadable(page(pages, 0), 16) && 1 == provider.queries);
+	bool hits = true;
+	for (uint32_t frame = 0; frame < PageValidityCache::kLifetimeFrames - 1; ++frame)
+	{
+		cache.nextFrame();
+		hits = read(cache, page(pages, 0) + frame % 64, buffer, sizeof(buffer)) && hits;
+	}
+	ok = report("checks of it in the next frames are served from the cache", hits && 1 == provider.queries) && ok;
+	// expiry: the entry was made in frame 0, kLifetimeFrames - 1 frames have passed
+	cache.nextFrame();
+	ok = report("after kLifetimeFrames frames it's looked up again", cache.isReadable(page(pages, 0), 16) && 2 == provider.queries) && ok;
+
+	// a page which becomes unreadable while cached is found on expiry
+	const int queriesBefore = provider.queries;
+	ok = report("another page is cached", cache.isReadable(page(pages, 1), 16) && queriesBefore + 1 == provider.queries) && ok;
+	setReadable(page(pages, 1), false);
+	cache.nextFrame();
+	const bool stale = cache.isReadable(page(pages, 1), 16);
+	for (uint32_t frame = 1; frame < PageValidityCache::kLifetimeFrames; ++frame)
+	{
+		cache.nextFrame();
+	}
+	ok = report("a page made unreadable is seen once the entry expired", stale && !cache.isReadable(page(pages, 1), 16)) && ok;
+
+	// a read which faults drops the entry
+	ok = report("a third page is cached", read(cache, page(pages, 2), buffer, sizeof(buffer))) && ok;
+	setReadable(page(pages, 2), false);
+	const bool faultedRead = read(cache, page(pages, 2), buffer, sizeof(buffer));
+	const int queriesAfterFault = provider.queries;
+	ok = report("a read of it faulting fails and drops the entry", !faultedRead && !cache.isReadable(page(pages, 2), 16)
+		&& queriesAfterFault + 1 == provider.queries) && ok;
+	setReadable(page(pages, 2), true);
+	cache.invalidate(page(pages, 2));
+	ok = report("readable again, it's readable after an invalidate", read(cache, page(pages, 2), buffer, sizeof(buffer))) && ok;
+
+	// a read crossing into an unreadable page
+	setReadable(page(pages, 4), false);
+	cache.invalidateAll();
+	ok = report("a read running into an unreadable page fails", !read(cache, page(pages, 4) - 8, buffer, 16)
+		&& read(cache, page(pages, 4) - 16, buffer, 16)) && ok;
+	setReadable(page(pages, 4), true);
+
+	// pages kEntryCount apart share an entry
+	cache.invalidateAll();
+	cache.isReadable(page(pages, 3), 16);
+	cache.isReadable(page(pages, 3 + PageValidityCache::kEntryCount), 16);
+	const int queriesShared = provider.queries;
+	cache.isReadable(page(pages, 3), 16);
+	ok = report("pages sharing an entry replace each other", queriesShared + 1 == provider.queries) && ok;
+
+	// nothing to look up
+	const int queriesInvalid = provider.queries;
+	ok = report("null, empty and wrapping ranges aren't readable", !cache.isReadable(nullptr, 4) && !cache.isReadable(pages, 0)
+		&& !cache.isReadable(reinterpret_cast<const void*>(UINTPTR_MAX - 8), 16) && queriesInvalid == provider.queries) && ok;
+
+	unmapPages(pages);
+	return finish(ok);
+}
@@ -0,0 +1,590 @@
+// Test for the protocol between the dll and the client (see MessageFraming.h, MessageTransport.h and MessageServer.h), over the
+// same transport the dll uses: named pipes on Windows, Unix domain sockets elsewhere. Checks, in order:
+// 1. framing: batches hold exactly the frames appended and refuse what doesn't fit; a stream of random frames fed to the ring
+//    buffer reader in random pieces comes out whole and in order, including frames wrapping around the end of the ring, and
+//    invalid lengths are reported.
+// 2. client to dll: the client writes random messages in random pieces, the handler gets every one whole and in order.
+// 3. dll to client: producer threads send numbered messages while a render thread flushes at the frame rate; the client gets
+//    every message whole and in order per producer, or it's counted as dropped. Prints how many messages went out per write,
+//    then the time per message when every message is written on its own, as before, for comparison.
+// 4. an invalid frame drops the client, which can reconnect and carry on.
+// 5. stopping the server with a client connected returns promptly.
+// Exits with 1 if a check fails.
+//
+// Usage: PipeProtocolTest [--messages 20000] [--producers 3] [--fps 60] [--seed <n>]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../Common/TestReport.h"
+#include "../../InjectableGenericCameraSystem/MessageFraming.h"
+#include "../../InjectableGenericCameraSystem/MessageServer.h"
+#include "../../InjectableGenericCameraSystem/MessageTransport.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace IGCS;
+using namespace IGCS::Tools;
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+	constexpr uint8_t kTestMessageType = 4;
+	constexpr size_t kMessageHeader = 1 + 1 + 4;		// type, producer, sequence number
+
+	uint8_t patternByte(uint32_t sequence, size_t index)
+	{
+		return static_cast<uint8_t>(sequence * 31u + index * 7u);
+	}
+
+	// A test message body: type, producer, sequence number, then a pattern derived from the sequence number.
+	std::vector<uint8_t> makeMessage(uint8_t producer, uint32_t sequence, size_t length)
+	{
+		std::vector<uint8_t> message(std::max(length, kMessageHeader));
+		message[0] = kTestMessageType;
+		message[1] = producer;
+		MessageFraming::writeLength(message.data() + 2, sequence);
+		for (size_t i = kMessageHeader; i < message.size(); ++i)
+		{
+			message[i] = patternByte(sequence, i);
+		}
+		return message;
+	}
+
+	// Checks a message made by makeMessage. Returns its producer and sequence number.
+	bool checkMessage(const uint8_t* message, uint32_t length, uint8_t& producer, uint32_t& sequence)
+	{
+		if (length < kMessageHeader || kTestMessageType != message[0])
+		{
+			return false;
+		}
+		producer = message[1];
+		sequence = MessageFraming::readLength(message + 2);
+		for (size_t i = kMessageHeader; i < length; ++i)
+		{
+			if (message[i] != patternByte(sequence, i))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	size_t randomLength(std::mt19937_64& random)
+	{
+		// mostly short, like text messages, some up to the maximum
+		std::uniform_int_distribution<int> kind(0, 9);
+		if (0 == kind(random))
+		{
+			return std::uniform_int_distribution<size_t>(kMessageHeader, MessageFraming::kMaxMessageSize)(random);
+		}
+		return std::uniform_int_distribution<size_t>(kMessageHeader, 200)(random);
+	}
+
+	void appendFrame(std::vector<uint8_t>& stream, const std::vector<uint8_t>& message)
+	{
+		uint8_t header[MessageFraming::kHeaderSize];
+		MessageFraming::writeLength(header, static_cast<uint32_t>(message.size()));
+		stream.insert(stream.end(), header, header + sizeof(header));
+		stream.insert(stream.end(), message.begin(), message.end());
+	}
+
+	// The client end of a stream.
+	class Client
+	{
+	public:
+		~Client() { close(); }
+
+		bool connect(const std::string& endpoint, bool writing)
+		{
+			const Clock::time_point deadline = Clock::now() + std::chrono::seconds(5);
+			while (Clock::now() < deadline)
+			{
+#ifdef _WIN32
+				_handle = CreateFileA(endpoint.c_str(), writing ? GENERIC_WRITE : GENERIC_READ, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+				if (INVALID_HANDLE_VALUE != _handle)
+				{
+					return true;
+				}
+				WaitNamedPipeA(endpoint.c_str(), 100);
+#else
+				(void)writing;
+				sockaddr_un address{};
+				address.sun_family = AF_UNIX;
+				std::snprintf(address.sun_path, sizeof(address.sun_path), "%s", endpoint.c_str());
+				_socket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+				if (_socket >= 0 && 0 == ::connect(_socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)))
+				{
+					return true;
+				}
+				close();
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+#endif
+			}
+			return false;
+		}
+
+		// Blocks. 0 when the server went away.
+		size_t read(uint8_t* buffer, size_t capacity)
+		{
+#ifdef _WIN32
+			DWORD bytes = 0;
+			return ReadFile(_handle, buffer, static_cast<DWORD>(capacity), &bytes, nullptr) ? bytes : 0;
+#else
+			const ssize_t bytes = recv(_socket, buffer, capacity, 0);
+			return bytes > 0 ? static_cast<size_t>(bytes) : 0;
+#endif
+		}
+
+		bool write(const uint8_t* data, size_t size)
+		{
+#ifdef _WIN32
+			DWORD bytes = 0;
+			return WriteFile(_handle, data, static_cast<DWORD>(size), &bytes, nullptr) && bytes == size;
+#else
+			while (size > 0)
+			{
+				const ssize_t sent = send(_socket, data, size, MSG_NOSIGNAL);
+				if (sent <= 0)
+				{
+					return false;
+				}
+				data += sent;
+				size -= static_cast<size_t>(sent);
+			}
+			return true;
+#endif
+		}
+
+		void close()
+		{
+#ifdef _WIN32
+			if (INVALID_HANDLE_VALUE != _handle) { CloseHandle(_handle); _handle = INVALID_HANDLE_VALUE; }
+#else
+			if (_socket >= 0) { ::close(_socket); _socket = -1; }
+#endif
+		}
+
+	private:
+#ifdef _WIN32
+		HANDLE _handle = INVALID_HANDLE_VALUE;
+#else
+		int _socket = -1;
+#endif
+	};
+
+	// Checks the messages the server's reader thread hands over arrive whole and numbered 0, 1, 2...
+	class CheckingHandler : public IMessageHandler
+	{
+	public:
+		void handleMessage(uint8_t* message, uint32_t length) override
+		{
+			uint8_t producer = 0;
+			uint32_t sequence = 0;
+			if (!checkMessage(message, length, producer, sequence))
+			{
+				_bad.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			if (sequence != _next)
+			{
+				_outOfOrder.fetch_add(1, std::memory_order_relaxed);
+			}
+			_next = sequence + 1;
+			_received.fetch_add(1, std::memory_order_release);
+		}
+
+		void restart(uint32_t next) { _next = next; }
+		uint64_t received() const { return _received.load(std::memory_order_acquire); }
+		uint64_t bad() const { return _bad.load(std::memory_order_relaxed); }
+		uint64_t outOfOrder() const { return _outOfOrder.load(std::memory_order_relaxed); }
+
+	private:
+		uint32_t _next = 0;		// reader thread only
+		std::atomic<uint64_t> _received{ 0 };
+		std::atomic<uint64_t> _bad{ 0 };
+		std::atomic<uint64_t> _outOfOrder{ 0 };
+	};
+
+	template<typename Condition>
+	bool waitUntil(Condition&& condition, int timeoutMs = 10000)
+	{
+		const Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+		while (!condition())
+		{
+			if (Clock::now() > deadline)
+			{
+				return false;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		return true;
+	}
+
+	bool checkBatch()
+	{
+		auto batch = std::make_unique<FrameBatch<64>>();
+		const char* text = "hello";
+		const uint8_t number[] = { 1, 2, 3 };
+		const ConstBuffer parts[] = { { text, 5 }, { number, sizeof(number) } };
+		bool ok = batch->append(7, parts, 2) && 1 == batch->frames() && MessageFraming::kHeaderSize + 1 + 8 == batch->size();
+		ok = ok && 9 == MessageFraming::readLength(batch->data()) && 7 == batch->data()[4] && 0 == std::memcmp(batch->data() + 5, "hello\x01\x02\x03", 8);
+		// 64 - 13 = 51 bytes left: a 46 byte payload fits exactly, after that nothing
+		const std::vector<uint8_t> payload(46, 0xAB);
+		const ConstBuffer exact{ payload.data(), payload.size() };
+		ok = ok && batch->append(8, &exact, 1) && 64 == batch->size();
+		const ConstBuffer empty{ nullptr, 0 };
+		ok = ok && !batch->append(9, &empty, 1) && 2 == batch->frames() && 64 == batch->size();
+		batch->clear();
+		const std::vector<uint8_t> tooLarge(MessageFraming::kMaxMessageSize, 0);
+		auto large = std::make_unique<FrameBatch<2 * MessageFraming::kMaxMessageSize>>();
+		const ConstBuffer tooLargePart{ tooLarge.data(), tooLarge.size() };
+		const ConstBuffer largestPart{ tooLarge.data(), tooLarge.size() - 1 };
+		ok = ok && !large->append(1, &tooLargePart, 1) && large->append(1, &largestPart, 1);
+		return report("framing: batches hold the frames appended, refuse the rest", ok);
+	}
+
+	bool checkReader(std::mt19937_64& random, int messages)
+	{
+		std::vector<uint8_t> stream;
+		for (int i = 0; i < messages; ++i)
+		{
+			appendFrame(stream, makeMessage(0, static_cast<uint32_t>(i), randomLength(random)));
+		}
+		auto reader = std::make_unique<FrameReader<MessageServer::kReadBufferSize>>();
+		uint32_t next = 0;
+		uint64_t bad = 0;
+		uint64_t wrapped = 0;
+		size_t position = 0;
+		size_t framePosition = 0;		// of the next frame in the stream, to tell which ones wrap around the ring
+		bool valid = true;
+		std::uniform_int_distribution<size_t> piece(1, 3000);
+		while (position < stream.size() && valid)
+		{
+			const auto space = reader->writable();
+			if (0 == space.size)
+			{
+				valid = false;
+				break;
+			}
+			const size_t count = std::min({ piece(random), space.size, stream.size() - position });
+			std::memcpy(space.data, stream.data() + position, count);
+			position += count;
+			reader->commit(count);
+			valid = reader->dispatch([&](uint8_t* message, uint32_t length)
+			{
+				uint8_t producer = 0;
+				uint32_t sequence = 0;
+				const size_t bodyOffset = (framePosition + MessageFraming::kHeaderSize) % MessageServer::kReadBufferSize;
+				wrapped += bodyOffset + length > MessageServer::kReadBufferSize ? 1 : 0;
+				framePosition += MessageFraming::kHeaderSize + length;
+				if (!checkMessage(message, length, producer, sequence) || sequence != next)
+				{
+					++bad;
+				}
+				next = sequence + 1;
+			});
+		}
+		const bool streamOk = valid && 0 == bad && next == static_cast<uint32_t>(messages) && 0 == reader->pending() && wrapped > 0;
+		std::printf("        %d frames in random pieces, %llu wrapped around the ring, %llu bad\n", messages,
+			static_cast<unsigned long long>(wrapped), static_cast<unsigned long long>(bad));
+
+		// invalid lengths: 0, and more than the largest message
+		bool invalidOk = true;
+		for (const uint32_t length : { 0u, MessageFraming::kMaxMessageSize + 1 })
+		{
+			reader->reset();
+			const auto space = reader->writable();
+			MessageFraming::writeLength(space.data, length);
+			reader->commit(MessageFraming::kHeaderSize);
+			invalidOk = invalidOk && !reader->dispatch([](uint8_t*, uint32_t) {});
+		}
+		return report("framing: random pieces come out whole, in order", streamOk) && report("framing: invalid lengths are reported", invalidOk);
+	}
+
+	// Reads frames from the client's read stream and checks them per producer.
+	struct ClientReader
+	{
+		static constexpr int kMaxProducers = 16;
+
+		Client client;
+		std::atomic<uint64_t> received{ 0 };
+		std::atomic<uint64_t> bad{ 0 };
+		std::atomic<uint64_t> outOfOrder{ 0 };
+		uint32_t next[kMaxProducers] = {};
+		std::thread thread;
+
+		void start()
+		{
+			thread = std::thread([this]
+			{
+				auto frames = std::make_unique<FrameReader<MessageServer::kReadBufferSize>>();
+				while (true)
+				{
+					const auto space = frames->writable();
+					const size_t bytes = client.read(space.data, space.size);
+					if (0 == bytes)
+					{
+						return;
+					}
+					frames->commit(bytes);
+					const bool valid = frames->dispatch([this](uint8_t* message, uint32_t length)
+					{
+						uint8_t producer = 0;
+						uint32_t sequence = 0;
+						if (!checkMessage(message, length, producer, sequence) || producer >= kMaxProducers)
+						{
+							bad.fetch_add(1, std::memory_order_relaxed);
+							return;
+						}
+						// a message may be dropped, never reordered
+						if (sequence < next[producer])
+						{
+							outOfOrder.fetch_add(1, std::memory_order_relaxed);
+						}
+						next[producer] = sequence + 1;
+						received.fetch_add(1, std::memory_order_release);
+					});
+					if (!valid)
+					{
+						bad.fetch_add(1, std::memory_order_relaxed);
+						return;
+					}
+				}
+			});
+		}
+	};
+
+	struct SendResult
+	{
+		uint64_t sent = 0;
+		uint64_t dropped = 0;
+		uint64_t writes = 0;
+		double seconds = 0.0;
+	};
+
+	// producers threads send messages each while a render thread flushes at fps.
+	SendResult sendBatched(MessageServer& server, int producers, int messages, double fps, uint64_t seed)
+	{
+		const uint64_t sentBefore = server.sent();
+		const uint64_t droppedBefore = server.dropped();
+		const uint64_t writesBefore = server.writes();
+		std::atomic<int> running{ producers };
+		const Clock::time_point start = Clock::now();
+		std::thread render([&]
+		{
+			const auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / fps));
+			Clock::time_point next = Clock::now();
+			while (running.load(std::memory_order_acquire) > 0)
+			{
+				next += period;
+				std::this_thread::sleep_until(next);
+				server.flush();
+			}
+		});
+		std::vector<std::thread> threads;
+		for (int p = 0; p < producers; ++p)
+		{
+			threads.emplace_back([&, p]
+			{
+				std::mt19937_64 random(seed + static_cast<uint64_t>(p));
+				// a frame's worth of messages at a time, like a busy frame of log lines
+				const int perFrame = 100;
+				for (int i = 0; i < messages; ++i)
+				{
+					const std::vector<uint8_t> message = makeMessage(static_cast<uint8_t>(p), static_cast<uint32_t>(i), std::min<size_t>(randomLength(random), 400));
+					const ConstBuffer part{ message.data() + 1, message.size() - 1 };
+					server.send(message[0], &part, 1);
+					if (perFrame - 1 == i % perFrame)
+					{
+						std::this_thread::sleep_for(std::chrono::duration<double>(1.0 / fps));
+					}
+				}
+				running.fetch_sub(1, std::memory_order_acq_rel);
+			});
+		}
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+		render.join();
+		server.flush();
+		SendResult result;
+		result.sent = server.sent() - sentBefore;
+		result.dropped = server.dropped() - droppedBefore;
+		result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		waitUntil([&] { return server.writes() > writesBefore; });
+		result.writes = server.writes() - writesBefore;
+		return result;
+	}
+
+	// For comparison, a write per message as the dll did before: every message is flushed and written before the next one.
+	SendResult sendOneByOne(MessageServer& server, int messages, uint64_t seed)
+	{
+		std::mt19937_64 random(seed);
+		const uint64_t sentBefore = server.sent();
+		const uint64_t droppedBefore = server.dropped();
+		const uint64_t writesBefore = server.writes();
+		const Clock::time_point start = Clock::now();
+		for (int i = 0; i < messages; ++i)
+		{
+			const std::vector<uint8_t> message = makeMessage(0, static_cast<uint32_t>(i), std::min<size_t>(randomLength(random), 400));
+			const ConstBuffer part{ message.data() + 1, message.size() - 1 };
+			const uint64_t writes = server.writes();
+			server.send(message[0], &part, 1);
+			server.flush();
+			// spin, a sleep would measure the scheduler
+			const Clock::time_point deadline = Clock::now() + std::chrono::seconds(1);
+			while (server.writes() == writes && Clock::now() < deadline)
+			{
+				std::this_thread::yield();
+			}
+		}
+		SendResult result;
+		result.sent = server.sent() - sentBefore;
+		result.dropped = server.dropped() - droppedBefore;
+		result.writes = server.writes() - writesBefore;
+		result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		return result;
+	}
+
+	void printUsage()
+	{
+		std::fprintf(stderr, "Usage: PipeProtocolTest [--messages <per producer, default 20000>] [--producers <n, default 3>] [--fps 60] [--seed <n>]\n");
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	int messages = 20000;
+	int producers = 3;
+	double fps = 60.0;
+	uint64_t seed = std::random_device{}();
+	Options options;
+	options.add("--messages", messages);
+	options.add("--producers", producers);
+	options.add("--fps", fps);
+	options.add("--seed", seed);
+	if (!options.parse(argc, argv))
+	{
+		printUsage();
+		return 1;
+	}
+	if (messages < 1 || producers < 1 || producers > ClientReader::kMaxProducers || fps <= 0.0)
+	{
+		printUsage();
+		return 1;
+	}
+	std::printf("seed %llu\n", static_cast<unsigned long long>(seed));
+	std::mt19937_64 random(seed);
+
+	// 1. framing
+	bool ok = checkBatch();
+	ok = checkReader(random, messages) && ok;
+
+	// names unique per run, so runs side by side don't meet
+	const std::string suffix = std::to_string(seed % 1000000);
+	auto outbound = std::make_unique<PipeTransport>("PipeProtocolTestOut" + suffix, PipeTransport::Direction::Outbound);
+	auto inbound = std::make_unique<PipeTransport>("PipeProtocolTestIn" + suffix, PipeTransport::Direction::Inbound);
+	auto server = std::make_unique<MessageServer>();
+	CheckingHandler handler;
+	if (!server->start(*outbound, *inbound, handler))
+	{
+		std::printf("Can't open the endpoints\n");
+		return 1;
+	}
+	const std::string outboundName = PipeTransport::endpoint("PipeProtocolTestOut" + suffix);
+	const std::string inboundName = PipeTransport::endpoint("PipeProtocolTestIn" + suffix);
+
+	// 2. client to dll
+	{
+		Client writer;
+		bool connected = writer.connect(inboundName, true);
+		std::vector<uint8_t> stream;
+		for (int i = 0; i < messages; ++i)
+		{
+			appendFrame(stream, makeMessage(0, static_cast<uint32_t>(i), randomLength(random)));
+		}
+		std::uniform_int_distribution<size_t> piece(1, 5000);
+		const Clock::time_point start = Clock::now();
+		for (size_t position = 0; connected && position < stream.size();)
+		{
+			const size_t count = std::min(piece(random), stream.size() - position);
+			connected = writer.write(stream.data() + position, count);
+			position += count;
+		}
+		const bool allReceived = connected && waitUntil([&] { return handler.received() >= static_cast<uint64_t>(messages); });
+		const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		std::printf("        %d messages, %.1f MB in %.3f s, %llu bad, %llu out of order\n", messages, stream.size() / 1e6, seconds,
+			static_cast<unsigned long long>(handler.bad()), static_cast<unsigned long long>(handler.outOfOrder()));
+		ok = report("client to dll: every message whole and in order", allReceived && handler.received() == static_cast<uint64_t>(messages)
+			&& 0 == handler.bad() && 0 == handler.outOfOrder()) && ok;
+
+		// 4. an invalid frame drops the client, which reconnects
+		const uint8_t invalid[MessageFraming::kHeaderSize] = {};
+		writer.write(invalid, sizeof(invalid));
+		const bool dropped = waitUntil([&] { return 1 == server->protocolErrors() && !server->clientWriting(); });
+		writer.close();
+		Client again;
+		handler.restart(0);
+		const uint64_t before = handler.received();
+		std::vector<uint8_t> frame;
+		appendFrame(frame, makeMessage(0, 0, 10));
+		const bool reconnected = again.connect(inboundName, true) && again.write(frame.data(), frame.size())
+			&& waitUntil([&] { return handler.received() == before + 1; });
+		ok = report("invalid frame drops the client, it can reconnect", dropped && reconnected && 0 == handler.bad()) && ok;
+	}
+
+	// 3. dll to client
+	{
+		auto reader = std::make_unique<ClientReader>();
+		const bool connected = reader->client.connect(outboundName, false) && waitUntil([&] { return server->clientReading(); });
+		reader->start();
+		const SendResult batched = sendBatched(*server, producers, messages, fps, seed);
+		bool arrived = connected && waitUntil([&] { return reader->received.load() >= batched.sent; });
+		std::printf("        batched per frame: %llu messages in %llu writes (%.1f per write), %llu dropped, %.3f s\n",
+			static_cast<unsigned long long>(batched.sent), static_cast<unsigned long long>(batched.writes),
+			static_cast<double>(batched.sent) / static_cast<double>(std::max<uint64_t>(batched.writes, 1)),
+			static_cast<unsigned long long>(batched.dropped), batched.seconds);
+		const uint64_t total = static_cast<uint64_t>(producers) * static_cast<uint64_t>(messages);
+		const bool batchedOk = arrived && batched.sent + batched.dropped == total && reader->received.load() == batched.sent
+			&& 0 == reader->bad.load() && 0 == reader->outOfOrder.load() && batched.writes < batched.sent;
+
+		// for comparison: a write per message
+		std::fill(std::begin(reader->next), std::end(reader->next), 0u);
+		const uint64_t receivedBefore = reader->received.load();
+		const int oneByOneCount = std::max(messages / 10, 1);
+		const SendResult single = sendOneByOne(*server, oneByOneCount, seed + 100);
+		arrived = waitUntil([&] { return reader->received.load() - receivedBefore >= single.sent; });
+		std::printf("        write per message: %llu messages in %llu writes, %.3f s (%.1f us per message)\n",
+			static_cast<unsigned long long>(single.sent), static_cast<unsigned long long>(single.writes), single.seconds,
+			single.seconds * 1e6 / static_cast<double>(std::max<uint64_t>(single.sent, 1)));
+		const bool singleOk = arrived && single.sent == static_cast<uint64_t>(oneByOneCount) && 0 == single.dropped
+			&& 0 == reader->bad.load() && 0 == reader->outOfOrder.load();
+		ok = report("dll to client: every message whole, in order or dropped", batchedOk && singleOk) && ok;
+
+		// 5. stop with the client connected
+		const Clock::time_point start = Clock::now();
+		server->stop();
+		const double stopMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		reader->thread.join();
+		std::printf("        stopped in %.1f ms\n", stopMs);
+		ok = report("stop with a client connected", stopMs < 1000.0) && ok;
+	}
+
+	return finish(ok);
+}
@@ -0,0 +1,169 @@
+// Tests the raw input accumulator (see RawInputAccumulator.h) with a synthetic 8 kHz mouse: a message thread decodes the reports
+// queued since its last pump into a batch and commits it, several reports per pump, while a reader thread takes the movement
+// once per frame at 60 fps. Every count of movement and every whole wheel notch must arrive, where keeping only the last report
+// of a pump (what the old WM_INPUT handling did) loses most of it. Also checks the decoding on its own: absolute movement is
+// ignored, high resolution wheel remainders carry over, a press and release between two frames still counts as a press, and the
+// last transition of a key in a batch wins. Exits with 1 if a check fails.
+//
+// Usage: RawInputStreamTest [--seconds 2] [--rate 8000] [--fps 60] [--seed <n>]
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include "../Common/TestReport.h"
+#include "../../InjectableGenericCameraSystem/RawInputAccumulator.h"
+
+using namespace IGCS;
+using namespace IGCS::Tools;
+using Clock = std::chrono::steady_clock;
+using Accumulator = RawInputAccumulator;
+
+namespace
+{
+	constexpr uint32_t kVirtualKeyW = 0x57;
+
+	void printUsage()
+	{
+		std::fprintf(stderr, "Usage: RawInputStreamTest [--seconds <default 2>] [--rate <reports per second, default 8000>] [--fps <default 60>] [--seed <n>]\n");
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	double seconds = 2.0;
+	double rate = 8000.0;
+	double fps = 60.0;
+	unsigned seed = std::random_device{}();
+	Options options;
+	options.add("--seconds", seconds);
+	options.add("--rate", rate);
+	options.add("--fps", fps);
+	options.add("--seed", seed);
+	if (!options.parse(argc, argv))
+	{
+		printUsage();
+		return 1;
+	}
+	if (seconds <= 0.0 || rate < 1.0 || fps < 1.0)
+	{
+		printUsage();
+		return 1;
+	}
+	std::printf("Seed %u\n", seed);
+
+	// decoding
+	Accumulator single;
+	Accumulator::Batch batch;
+	batch.mouse(Accumulator::kMouseMoveRelative, 0, 0, 5, -3);
+	batch.mouse(Accumulator::kMouseMoveAbsolute, 0, 0, 30000, 30000);
+	batch.mouse(Accumulator::kMouseMoveRelative, Accumulator::kWheel, static_cast<uint16_t>(200), 1, 1);
+	single.commit(batch);
+	Accumulator::MouseDelta delta = single.takeMouseDelta();
+	bool ok = report("absolute movement is ignored, relative adds up", 6 == delta.x && -2 == delta.y && 3 == batch.records());
+	Accumulator::Batch wheel;
+	wheel.mouse(Accumulator::kMouseMoveRelative, Accumulator::kWheel, static_cast<uint16_t>(-100), 0, 0);
+	single.commit(wheel);
+	const int32_t firstNotches = delta.wheel;
+	const Accumulator::MouseDelta afterRemainder = single.takeMouseDelta();
+	ok = report("wheel remainders carry over to the next take", 1 == firstNotches && 0 == afterRemainder.wheel
+		&& 0 == single.peekMouseDelta().wheel) && ok;
+	Accumulator::Batch click;
+	click.mouse(Accumulator::kMouseMoveRelative, Accumulator::kLeftButtonDown, 0, 0, 0);
+	click.mouse(Accumulator::kMouseMoveRelative, Accumulator::kLeftButtonUp, 0, 0, 0);
+	click.key(kVirtualKeyW, false);
+	click.key(kVirtualKeyW, true);
+	click.key(kVirtualKeyW, false);
+	click.key(Accumulator::kKeys + 10, false);
+	single.commit(click);
+	ok = report("a press and release in one batch is still a press", single.wasMouseButtonPressed(0) && !single.isMouseButtonDown(0)) && ok;
+	ok = report("the last transition of a key in a batch wins", single.wasKeyPressed(kVirtualKeyW) && single.isKeyDown(kVirtualKeyW)
+		&& 5 == click.records() && !single.isKeyDown(Accumulator::kKeys + 10)) && ok;
+	single.resetKeyTransitions();
+	single.resetMouseButtonTransitions();
+	ok = report("transitions reset, the state stays", !single.wasKeyPressed(kVirtualKeyW) && single.isKeyDown(kVirtualKeyW)
+		&& !single.wasMouseButtonPressed(0)) && ok;
+
+	// the stream: the message thread pumps every millisecond or so, the reports of that time at once
+	Accumulator accumulator;
+	std::atomic<bool> done{ false };
+	int64_t sentX = 0;
+	int64_t sentY = 0;
+	int64_t sentWheelUnits = 0;
+	int64_t lastOnlyX = 0;
+	uint64_t reports = 0;
+	uint64_t pumps = 0;
+	std::thread messages([&]
+	{
+		std::mt19937 random(seed);
+		// drifting to the right, so what's lost shows
+		std::uniform_int_distribution<int32_t> moveX(-10, 40);
+		std::uniform_int_distribution<int32_t> moveY(-40, 40);
+		const Clock::time_point start = Clock::now();
+		const Clock::time_point end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+		double reportsDue = 0.0;
+		Clock::time_point lastPump = start;
+		while (Clock::now() < end)
+		{
+			std::this_thread::sleep_for(std::chrono::microseconds(500 + random() % 1000));
+			const Clock::time_point now = Clock::now();
+			reportsDue += std::chrono::duration<double>(now - lastPump).count() * rate;
+			lastPump = now;
+			Accumulator::Batch pump;
+			int32_t lastX = 0;
+			for (; reportsDue >= 1.0; reportsDue -= 1.0)
+			{
+				const int32_t x = moveX(random);
+				const int32_t y = moveY(random);
+				// a high resolution wheel: a fraction of a notch now and then
+				const bool wheelMoved = 0 == random() % 50;
+				const int16_t units = wheelMoved ? static_cast<int16_t>(30) : static_cast<int16_t>(0);
+				pump.mouse(Accumulator::kMouseMoveRelative, wheelMoved ? Accumulator::kWheel : 0, static_cast<uint16_t>(units), x, y);
+				sentX += x;
+				sentY += y;
+				sentWheelUnits += units;
+				lastX = x;
+				++reports;
+			}
+			if (pump.records() > 0)
+			{
+				accumulator.commit(pump);
+				lastOnlyX += lastX;
+				++pumps;
+			}
+		}
+		done.store(true, std::memory_order_release);
+	});
+	int64_t takenX = 0;
+	int64_t takenY = 0;
+	int64_t takenNotches = 0;
+	uint64_t frames = 0;
+	const auto frameTime = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / fps));
+	Clock::time_point nextFrame = Clock::now();
+	while (!done.load(std::memory_order_acquire))
+	{
+		nextFrame += frameTime;
+		std::this_thread::sleep_until(nextFrame);
+		const Accumulator::MouseDelta frame = accumulator.takeMouseDelta();
+		takenX += frame.x;
+		takenY += frame.y;
+		takenNotches += frame.wheel;
+		++frames;
+	}
+	messages.join();
+	const Accumulator::MouseDelta rest = accumulator.takeMouseDelta();
+	takenX += rest.x;
+	takenY += rest.y;
+	takenNotches += rest.wheel;
+	std::printf("        %llu reports in %llu pumps (%.1f per pump), %llu frames\n", static_cast<unsigned long long>(reports),
+		static_cast<unsigned long long>(pumps), pumps > 0 ? static_cast<double>(reports) / static_cast<double>(pumps) : 0.0,
+		static_cast<unsigned long long>(frames));
+	std::printf("        x moved %lld, taken %lld; keeping the last report of each pump would have given %lld\n",
+		static_cast<long long>(sentX), static_cast<long long>(takenX), static_cast<long long>(lastOnlyX));
+	ok = report("every count of movement arrives", reports > 0 && frames > 0 && sentX == takenX && sentY == takenY) && ok;
+	ok = report("every whole wheel notch arrives", sentWheelUnits / Accumulator::kWheelDelta == takenNotches) && ok;
+
+	return finish(ok);
+}
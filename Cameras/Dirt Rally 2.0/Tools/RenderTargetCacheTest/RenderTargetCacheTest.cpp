@@ -0,0 +1,245 @@
+// Tests the render target view cache (see RenderTargetCache.h) with fake views which count their references. Checks a view
+// is classified once and then answered from the table, views which hash to the same slot (including the last one, where
+// probing wraps around) are all found, the table starts over when it's half full, the end of a frame gives back every view but
+// the backbuffer views, and after a random run of frames, backbuffer changes and invalidations every reference the cache took
+// is given back. Exits with 1 if a check fails.
+//
+// Usage: RenderTargetCacheTest [--binds 200000] [--views 300] [--seed <n>]
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "../Common/TestReport.h"
+#include "../../InjectableGenericCameraSystem/RenderTargetCache.h"
+
+using namespace IGCS;
+using namespace IGCS::Tools;
+
+namespace
+{
+	// 16 byte aligned like the views D3D hands out
+	struct alignas(16) FakeView
+	{
+		int references = 0;
+		bool backBuffer = false;
+	};
+
+	class FakeViews : public IRenderTargetViews
+	{
+	public:
+		bool isBackBuffer(void* view) noexcept override
+		{
+			++queries;
+			return static_cast<FakeView*>(view)->backBuffer;
+		}
+
+		void addRef(void* view) noexcept override
+		{
+			++static_cast<FakeView*>(view)->references;
+		}
+
+		void release(void* view) noexcept override
+		{
+			FakeView* fake = static_cast<FakeView*>(view);
+			--fake->references;
+			if (fake->references < 0)
+			{
+				++overReleased;
+			}
+		}
+
+		int queries = 0;
+		int overReleased = 0;
+	};
+
+	// The slot the cache starts probing at for a view, same hash as RenderTargetCache.
+	size_t homeSlot(const void* view)
+	{
+		const uint64_t key = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(view)) >> 4;
+		return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 57) & (RenderTargetCache::kCapacity - 1);
+	}
+
+	// Up to count views of pool which hash to slot.
+	std::vector<FakeView*> viewsInSlot(std::vector<FakeView>& pool, size_t slot, size_t count)
+	{
+		std::vector<FakeView*> views;
+		for (FakeView& view : pool)
+		{
+			if (views.size() < count && homeSlot(&view) == slot)
+			{
+				views.push_back(&view);
+			}
+		}
+		return views;
+	}
+
+	bool noReferences(const std::vector<FakeView>& pool)
+	{
+		for (const FakeView& view : pool)
+		{
+			if (0 != view.references)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Whether only the backbuffer views of pool are held, once each at most.
+	bool onlyBackBuffersHeld(const std::vector<FakeView>& pool)
+	{
+		for (const FakeView& view : pool)
+		{
+			if (view.references < 0 || view.references > (view.backBuffer ? 1 : 0))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void printUsage()
+	{
+		std::fprintf(stderr, "Usage: RenderTargetCacheTest [--binds <default 200000>] [--views <default 300>] [--seed <n>]\n");
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	int binds = 200000;
+	int viewCount = 300;
+	unsigned seed = std::random_device{}();
+	Options options;
+	options.add("--binds", binds);
+	options.add("--views", viewCount);
+	options.add("--seed", seed);
+	if (!options.parse(argc, argv))
+	{
+		printUsage();
+		return 1;
+	}
+	if (binds < 1 || viewCount < static_cast<int>(RenderTargetCache::kMaxEntries) + 1)
+	{
+		printUsage();
+		return 1;
+	}
+	std::printf("Seed %u\n", seed);
+
+	// plenty of views, so there are some for every slot
+	std::vector<FakeView> pool(RenderTargetCache::kCapacity * 64);
+	FakeViews views;
+	RenderTargetCache cache(views);
+
+	// lookup
+	pool[0].backBuffer = true;
+	bool ok = report("a view is classified", cache.isBackBuffer(&pool[0]) && !cache.isBackBuffer(&pool[1]) && 2 == views.queries);
+	bool cached = true;
+	for (int i = 0; i < 100; ++i)
+	{
+		cached = cached && cache.isBackBuffer(&pool[0]) && !cache.isBackBuffer(&pool[1]);
+	}
+	ok = report("and answered from the table from then on", cached && 2 == views.queries && 2 == cache.size()
+		&& 1 == pool[0].references && 1 == pool[1].references) && ok;
+	ok = report("a null view is no backbuffer and isn't cached", !cache.isBackBuffer(nullptr) && 2 == views.queries && 2 == cache.size()) && ok;
+	cache.invalidate();
+	ok = report("invalidate releases the views", 0 == cache.size() && noReferences(pool)) && ok;
+
+	// collisions, also in the last slot where probing wraps around to the first
+	for (const size_t slot : { size_t(5), RenderTargetCache::kCapacity - 1 })
+	{
+		std::vector<FakeView*> colliding = viewsInSlot(pool, slot, 6);
+		colliding[2]->backBuffer = true;
+		views.queries = 0;
+		bool found = colliding.size() == 6;
+		for (int pass = 0; pass < 3; ++pass)
+		{
+			for (size_t i = 0; i < colliding.size(); ++i)
+			{
+				found = found && (2 == i) == cache.isBackBuffer(colliding[i]);
+			}
+		}
+		char check[64];
+		std::snprintf(check, sizeof(check), "views colliding in slot %zu are all found", slot);
+		ok = report(check, found && 6 == views.queries && 6 == cache.size()) && ok;
+		colliding[2]->backBuffer = false;
+		cache.invalidate();
+	}
+
+	// half full: the next new view starts the table over
+	views.queries = 0;
+	for (size_t i = 0; i < RenderTargetCache::kMaxEntries; ++i)
+	{
+		cache.isBackBuffer(&pool[i]);
+	}
+	const bool filled = RenderTargetCache::kMaxEntries == cache.size() && static_cast<int>(RenderTargetCache::kMaxEntries) == views.queries;
+	cache.isBackBuffer(&pool[RenderTargetCache::kMaxEntries]);
+	bool restarted = filled && 1 == cache.size() && 1 == pool[RenderTargetCache::kMaxEntries].references;
+	for (size_t i = 0; i < RenderTargetCache::kMaxEntries; ++i)
+	{
+		restarted = restarted && 0 == pool[i].references;
+	}
+	cache.isBackBuffer(&pool[0]);
+	ok = report("when half full the table starts over", restarted && static_cast<int>(RenderTargetCache::kMaxEntries) + 2 == views.queries) && ok;
+	cache.invalidate();
+
+	// end of a frame: two backbuffer views (one colliding with a game view) and some of the game's render targets
+	std::vector<FakeView*> frameViews = viewsInSlot(pool, 9, 3);
+	frameViews.push_back(&pool[1]);
+	frameViews.push_back(&pool[2]);
+	frameViews[1]->backBuffer = true;
+	pool[0].backBuffer = true;
+	frameViews.push_back(&pool[0]);
+	for (FakeView* view : frameViews)
+	{
+		cache.isBackBuffer(view);
+	}
+	cache.endFrame();
+	ok = report("the end of a frame releases all views but the backbuffer", 2 == cache.size() && onlyBackBuffersHeld(pool)
+		&& 1 == pool[0].references && 1 == frameViews[1]->references) && ok;
+	views.queries = 0;
+	bool kept = cache.isBackBuffer(&pool[0]) && cache.isBackBuffer(frameViews[1]) && 0 == views.queries;
+	kept = kept && !cache.isBackBuffer(frameViews[0]) && !cache.isBackBuffer(frameViews[2]) && 2 == views.queries;
+	ok = report("the backbuffer views are still found, the others asked again", kept && 4 == cache.size()) && ok;
+	frameViews[1]->backBuffer = false;
+	pool[0].backBuffer = false;
+	cache.invalidate();
+
+	// random frames of binds, the backbuffer changing now and then
+	std::mt19937 random(seed);
+	std::uniform_int_distribution<int> pick(0, viewCount - 1);
+	int backBuffer = 0;
+	pool[0].backBuffer = true;
+	bool correct = true;
+	bool balanced = true;
+	bool frameReleased = true;
+	for (int bind = 0; bind < binds; ++bind)
+	{
+		if (0 == random() % 40)
+		{
+			// Present
+			cache.endFrame();
+			frameReleased = frameReleased && onlyBackBuffersHeld(pool);
+		}
+		if (0 == random() % 5000)
+		{
+			// ResizeBuffers: a new backbuffer view
+			pool[static_cast<size_t>(backBuffer)].backBuffer = false;
+			backBuffer = pick(random);
+			pool[static_cast<size_t>(backBuffer)].backBuffer = true;
+			cache.invalidate();
+		}
+		const int view = 0 == bind % 3 ? backBuffer : pick(random);
+		correct = correct && (view == backBuffer) == cache.isBackBuffer(&pool[static_cast<size_t>(view)]);
+		// a view is held once while it's cached
+		balanced = balanced && 1 == pool[static_cast<size_t>(view)].references;
+	}
+	std::printf("        %d binds, %d classified through the views\n", binds, views.queries);
+	ok = report("random binds are classified right", correct) && ok;
+	ok = report("a cached view is held once", balanced && cache.size() <= RenderTargetCache::kMaxEntries) && ok;
+	ok = report("at the end of every frame only the backbuffer is held", frameReleased) && ok;
+	cache.invalidate();
+	ok = report("after invalidate every reference is given back", noReferences(pool) && 0 == views.overReleased) && ok;
+
+	return finish(ok);
+}
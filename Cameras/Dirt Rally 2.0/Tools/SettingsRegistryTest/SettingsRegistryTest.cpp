@@ -0,0 +1,289 @@
+// Tests the settings registry (see SettingsRegistry.h). First decodes, for every SettingType, the minimum, maximum and default
+// value and checks they're accepted, then out of range values, NaN, infinity, wrong lengths, unknown IDs and bools other than 0
+// and 1 and checks they're rejected. Then a client thread decodes and stages random valid values as fast as it can while a render
+// thread applies them at the start of every frame and checks the values don't change during the frame, and once the client is
+// done, that every setting has the last value staged for it. Prints how many updates were coalesced and the cost of a stage and
+// an apply. Exits with 1 if a check fails.
+//
+// Usage: SettingsRegistryTest [--updates <n>] [--fps <frame rate>] [--seed <n>]
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <thread>
+#include <vector>
+#include "../../InjectableGenericCameraSystem/MonotonicClock.h"
+#include "../../InjectableGenericCameraSystem/SettingsRegistry.h"
+
+using namespace IGCS;
+
+namespace
+{
+	struct Message
+	{
+		uint8_t bytes[8] = {};
+		size_t length = 0;
+	};
+
+	Message boolMessage(uint32_t id, uint8_t value)
+	{
+		Message message;
+		message.bytes[0] = 1;		// MessageType::Setting
+		message.bytes[1] = static_cast<uint8_t>(id);
+		message.bytes[2] = value;
+		message.length = 3;
+		return message;
+	}
+
+	Message wordMessage(uint32_t id, uint32_t bits)
+	{
+		Message message;
+		message.bytes[0] = 1;
+		message.bytes[1] = static_cast<uint8_t>(id);
+		for (int i = 0; i < 4; ++i)
+		{
+			message.bytes[2 + i] = static_cast<uint8_t>(bits >> (8 * i));
+		}
+		message.length = 6;
+		return message;
+	}
+
+	uint32_t floatBits(float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+
+	// A message carrying value, in the encoding of the setting's kind.
+	Message valueMessage(const SettingInfo& setting, float value)
+	{
+		const uint32_t id = static_cast<uint32_t>(setting.id);
+		switch (setting.kind)
+		{
+		case SettingKind::Bool: return boolMessage(id, value != 0.0f ? 1 : 0);
+		case SettingKind::Int: return wordMessage(id, static_cast<uint32_t>(static_cast<int32_t>(value)));
+		default: return wordMessage(id, floatBits(value));
+		}
+	}
+
+	class Checker
+	{
+	public:
+		void expect(const char* what, const SettingInfo& setting, const Message& message, SettingDecodeResult expected)
+		{
+			SettingUpdate update;
+			const SettingDecodeResult result = SettingsRegistry::decode(message.bytes, message.length, update);
+			++_checks;
+			if (result != expected || (SettingDecodeResult::Ok == result && update.id != setting.id))
+			{
+				std::printf("%s: %s gave %d, expected %d\n", setting.name, what, static_cast<int>(result), static_cast<int>(expected));
+				++_failures;
+			}
+		}
+
+		void expectUnknown(uint32_t id)
+		{
+			SettingUpdate update;
+			const Message message = wordMessage(id, 0);
+			++_checks;
+			if (SettingDecodeResult::UnknownSetting != SettingsRegistry::decode(message.bytes, message.length, update))
+			{
+				std::printf("setting %u: not rejected as unknown\n", id);
+				++_failures;
+			}
+		}
+
+		[[nodiscard]] uint32_t checks() const { return _checks; }
+		[[nodiscard]] uint32_t failures() const { return _failures; }
+
+	private:
+		uint32_t _checks = 0;
+		uint32_t _failures = 0;
+	};
+
+	void checkDecoding(Checker& checker)
+	{
+		const float infinity = std::numeric_limits<float>::infinity();
+		for (const SettingInfo& setting : SettingsRegistry::kSettings)
+		{
+			checker.expect("min", setting, valueMessage(setting, setting.minValue), SettingDecodeResult::Ok);
+			checker.expect("max", setting, valueMessage(setting, setting.maxValue), SettingDecodeResult::Ok);
+			checker.expect("default", setting, valueMessage(setting, setting.defaultValue), SettingDecodeResult::Ok);
+			const uint32_t id = static_cast<uint32_t>(setting.id);
+			if (SettingKind::Bool == setting.kind)
+			{
+				checker.expect("2", setting, boolMessage(id, 2), SettingDecodeResult::OutOfRange);
+				checker.expect("4 bytes", setting, wordMessage(id, 1), SettingDecodeResult::BadLength);
+				continue;
+			}
+			Message shortMessage = wordMessage(id, 0);
+			shortMessage.length = 5;
+			checker.expect("5 bytes", setting, shortMessage, SettingDecodeResult::BadLength);
+			checker.expect("1 byte", setting, boolMessage(id, 0), SettingDecodeResult::BadLength);
+			const float step = SettingKind::Int == setting.kind ? 1.0f : std::fmax(std::fabs(setting.maxValue) * 0.01f, 0.001f);
+			checker.expect("below min", setting, valueMessage(setting, setting.minValue - step), SettingDecodeResult::OutOfRange);
+			checker.expect("above max", setting, valueMessage(setting, setting.maxValue + step), SettingDecodeResult::OutOfRange);
+			if (SettingKind::Float == setting.kind)
+			{
+				checker.expect("NaN", setting, wordMessage(id, floatBits(std::numeric_limits<float>::quiet_NaN())), SettingDecodeResult::OutOfRange);
+				checker.expect("+inf", setting, wordMessage(id, floatBits(infinity)), SettingDecodeResult::OutOfRange);
+				checker.expect("-inf", setting, wordMessage(id, floatBits(-infinity)), SettingDecodeResult::OutOfRange);
+			}
+		}
+		for (uint32_t id = kSettingTypeCount; id < 256; ++id)
+		{
+			checker.expectUnknown(id);
+		}
+	}
+
+	// A random valid message for a random setting.
+	Message randomMessage(std::mt19937& random)
+	{
+		const SettingInfo& setting = SettingsRegistry::kSettings[random() % kSettingTypeCount];
+		const float fraction = std::uniform_real_distribution<float>(0.0f, 1.0f)(random);
+		float value = setting.minValue + fraction * (setting.maxValue - setting.minValue);
+		if (SettingKind::Float != setting.kind)
+		{
+			value = std::round(value);
+		}
+		return valueMessage(setting, std::fmin(std::fmax(value, setting.minValue), setting.maxValue));
+	}
+
+	void printUsage()
+	{
+		std::fprintf(stderr, "Usage: SettingsRegistryTest [--updates <n, default 2000000>] [--fps <default 60>] [--seed <n>]\n");
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	long long updates = 2000000;
+	double fps = 60.0;
+	uint32_t seed = std::random_device{}();
+	for (int i = 1; i < argc; ++i)
+	{
+		const bool hasValue = i + 1 < argc;
+		if (hasValue && 0 == std::strcmp(argv[i], "--updates")) { updates = std::atoll(argv[++i]); }
+		else if (hasValue && 0 == std::strcmp(argv[i], "--fps")) { fps = std::strtod(argv[++i], nullptr); }
+		else if (hasValue && 0 == std::strcmp(argv[i], "--seed")) { seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)); }
+		else
+		{
+			printUsage();
+			return 1;
+		}
+	}
+	if (updates < 1 || fps < 1.0)
+	{
+		printUsage();
+		return 1;
+	}
+
+	Checker checker;
+	checkDecoding(checker);
+	std::printf("decoding: %u checks, %u failed\n", checker.checks(), checker.failures());
+
+	SettingsRegistry registry;
+	uint32_t defaultsWrong = 0;
+	for (const SettingInfo& setting : SettingsRegistry::kSettings)
+	{
+		const float value = SettingKind::Float == setting.kind ? registry.getFloat(setting.id)
+			: SettingKind::Int == setting.kind ? static_cast<float>(registry.getInt(setting.id)) : (registry.getBool(setting.id) ? 1.0f : 0.0f);
+		if (value != setting.defaultValue && !(SettingKind::Bool == setting.kind && (value != 0.0f) == (setting.defaultValue != 0.0f)))
+		{
+			std::printf("%s: default %g, expected %g\n", setting.name, value, setting.defaultValue);
+			++defaultsWrong;
+		}
+	}
+
+	// client: decode and stage, remembering the last value per setting
+	std::vector<uint32_t> lastStaged(kSettingTypeCount);
+	std::vector<bool> staged(kSettingTypeCount, false);
+	std::atomic<bool> clientDone{ false };
+	uint64_t rejected = 0;
+	int64_t stageTime = 0;
+	std::thread client([&]
+	{
+		std::mt19937 random(seed);
+		const int64_t start = MonotonicClock::now();
+		for (long long i = 0; i < updates; ++i)
+		{
+			const Message message = randomMessage(random);
+			SettingUpdate update;
+			if (SettingDecodeResult::Ok != SettingsRegistry::decode(message.bytes, message.length, update))
+			{
+				++rejected;
+				continue;
+			}
+			registry.stage(update);
+			lastStaged[static_cast<uint32_t>(update.id)] = update.bits;
+			staged[static_cast<uint32_t>(update.id)] = true;
+		}
+		stageTime = MonotonicClock::now() - start;
+		clientDone.store(true, std::memory_order_release);
+	});
+
+	// render thread: apply at the start of the frame, then the values must hold till the next frame
+	uint64_t frames = 0;
+	uint64_t applied = 0;
+	uint64_t changedDuringFrame = 0;
+	int64_t applyTime = 0;
+	const auto framePeriod = std::chrono::nanoseconds(static_cast<int64_t>(1e9 / fps));
+	auto snapshot = [&registry](std::vector<uint32_t>& values)
+	{
+		for (uint32_t i = 0; i < kSettingTypeCount; ++i)
+		{
+			values[i] = floatBits(registry.getFloat(static_cast<SettingType>(i)));
+		}
+	};
+	std::vector<uint32_t> frameStart(kSettingTypeCount);
+	std::vector<uint32_t> frameEnd(kSettingTypeCount);
+	bool last = false;
+	while (!last)
+	{
+		last = clientDone.load(std::memory_order_acquire);
+		const int64_t start = MonotonicClock::now();
+		const SettingMask changed = registry.applyStaged();
+		applyTime += MonotonicClock::now() - start;
+		for (uint32_t i = 0; i < kSettingTypeCount; ++i)
+		{
+			applied += changed.test(static_cast<SettingType>(i)) ? 1 : 0;
+		}
+		snapshot(frameStart);
+		std::this_thread::sleep_for(framePeriod);
+		snapshot(frameEnd);
+		if (frameStart != frameEnd)
+		{
+			++changedDuringFrame;
+		}
+		++frames;
+	}
+	client.join();
+
+	uint32_t wrongFinal = 0;
+	for (uint32_t i = 0; i < kSettingTypeCount; ++i)
+	{
+		if (staged[i] && frameEnd[i] != lastStaged[i])
+		{
+			std::printf("%s: %08x after the last frame, last staged %08x\n", SettingsRegistry::kSettings[i].name, frameEnd[i], lastStaged[i]);
+			++wrongFinal;
+		}
+	}
+
+	const uint64_t stagedUpdates = static_cast<uint64_t>(updates) - rejected;
+	std::printf("%llu updates staged, %llu changes applied in %llu frames (%.1f%% coalesced), seed %u\n",
+		static_cast<unsigned long long>(stagedUpdates), static_cast<unsigned long long>(applied), static_cast<unsigned long long>(frames),
+		stagedUpdates > 0 ? 100.0 * static_cast<double>(stagedUpdates - applied) / static_cast<double>(stagedUpdates) : 0.0, seed);
+	std::printf("decode and stage %.1f ns per update, apply %.2f us per frame\n",
+		MonotonicClock::toSeconds(stageTime) * 1e9 / static_cast<double>(updates), MonotonicClock::toSeconds(applyTime) * 1e6 / static_cast<double>(frames));
+	const bool ok = 0 == checker.failures() && 0 == defaultsWrong && 0 == rejected && 0 == changedDuringFrame && 0 == wrongFinal;
+	std::printf("%s: %u decode failures, %u wrong defaults, %llu valid updates rejected, %llu frames with changing values, %u wrong final values\n",
+		ok ? "OK" : "FAILED", checker.failures(), defaultsWrong, static_cast<unsigned long long>(rejected),
+		static_cast<unsigned long long>(changedDuringFrame), wrongFinal);
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,352 @@
+// Offline parameter sweep for the cockpit camera smoothing. Replays recorded car transforms through the same smoothing
+// the camera uses in game (see CameraSmoothing.h), for many parameter sets in parallel, and reports the Pareto front of
+// jitter versus lag together with the recommended dr2tools.cfg values. With --zero-phase the forward-backward smoother
+// meant for replays (see ZeroPhaseSmoother.h) is evaluated instead of the live camera smoothing.
+//
+// Usage: SmoothingOptimizer <telemetry.csv> [--grid <points per parameter>] [--random <count>] [--seed <n>]
+//                           [--threads <n>] [--blend-min <v>] [--blend-max <v>] [--zero-phase <look-ahead frames>]
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include "../Common/CarSampleReader.h"
+#include "../Common/WorkStealingPool.h"
+#include "../../InjectableGenericCameraSystem/CameraSmoothing.h"
+#include "../../InjectableGenericCameraSystem/ZeroPhaseSmoother.h"
+
+using namespace IGCS;
+using namespace IGCS::Tools;
+
+namespace
+{
+	constexpr double kRadToDeg = 57.29577951308232;
+	constexpr size_t kReadBlockSize = 4096;
+
+	// A parameter the sweep can vary, with the key it has in dr2tools.cfg and the range Config accepts.
+	struct ParameterRange
+	{
+		const char* cfgKey;
+		float Smoothing::SmoothingParams::* member;
+		float minValue;
+		float maxValue;
+	};
+
+	struct Trajectory
+	{
+		std::vector<double> time;
+		std::vector<Smoothing::Quat> rotation;
+	};
+
+	struct Evaluation
+	{
+		Smoothing::SmoothingParams params;
+		double jitter = 0.0;	// RMS angular acceleration of the camera, deg/s^2
+		double lag = 0.0;		// RMS angle between camera and mounted target rotation, degrees
+	};
+
+	bool loadTrajectory(const std::string& path, Trajectory& trajectory)
+	{
+		CarSampleReader reader;
+		if (!reader.open(path))
+		{
+			std::fprintf(stderr, "Can't open '%s'\n", path.c_str());
+			return false;
+		}
+		std::vector<CarSample> block(kReadBlockSize);
+		size_t read;
+		while ((read = reader.readBlock(block.data(), block.size())) > 0)
+		{
+			for (size_t i = 0; i < read; ++i)
+			{
+				// the sweep needs strictly increasing timestamps, duplicated frames carry no information
+				if (!trajectory.time.empty() && block[i].time <= trajectory.time.back())
+				{
+					continue;
+				}
+				trajectory.time.push_back(block[i].time);
+				trajectory.rotation.push_back(block[i].rotation);
+			}
+		}
+		if (reader.malformedLines() > 0)
+		{
+			std::fprintf(stderr, "Skipped %zu malformed lines\n", reader.malformedLines());
+		}
+		return trajectory.time.size() >= 3;
+	}
+
+	// Produces the smoothed rotation for every frame of the trajectory, in order.
+	class LiveSmoothing
+	{
+	public:
+		LiveSmoothing(const Trajectory& trajectory, const Smoothing::SmoothingParams& params) : _trajectory(trajectory), _params(params)
+		{
+			_smoother.reset(trajectory.rotation[0]);
+		}
+
+		Smoothing::Quat next(size_t frame) { return _smoother.update(_trajectory.rotation[frame], _params); }
+
+	private:
+		const Trajectory& _trajectory;
+		const Smoothing::SmoothingParams& _params;
+		Smoothing::RotationSmoother _smoother;
+	};
+
+	// The whole trajectory is known up front, so frame i is smoothed with the window up to frame i + lookAhead, like in
+	// a replay. The window is clamped at the end of the recording.
+	class ZeroPhaseSmoothing
+	{
+	public:
+		ZeroPhaseSmoothing(const Trajectory& trajectory, const Smoothing::SmoothingParams& params, size_t lookAhead)
+			: _trajectory(trajectory), _params(params), _smoother(lookAhead)
+		{
+			_smoother.reset(trajectory.rotation[0]);
+			for (size_t i = 0; i < _smoother.lookAhead(); ++i)
+			{
+				_smoother.push(rotationAt(i));
+			}
+		}
+
+		Smoothing::Quat next(size_t frame)
+		{
+			_smoother.push(rotationAt(frame + _smoother.lookAhead()));
+			return _smoother.evaluate(_params);
+		}
+
+	private:
+		const Smoothing::Quat& rotationAt(size_t frame) const
+		{
+			return _trajectory.rotation[std::min(frame, _trajectory.rotation.size() - 1)];
+		}
+
+		const Trajectory& _trajectory;
+		const Smoothing::SmoothingParams& _params;
+		Smoothing::ZeroPhaseSmoother _smoother;
+	};
+
+	// Runs the smoothing over the whole trajectory. The mounted relative rotation is a constant left factor, which
+	// doesn't change either metric, so the car rotation itself is used as target.
+	template<typename Smoothing_t>
+	Evaluation evaluate(const Trajectory& trajectory, const Smoothing::SmoothingParams& params, Smoothing_t& smoother)
+	{
+		Smoothing::Quat previous = smoother.next(0);
+		Smoothing::Vec3 previousRate{};
+		bool havePreviousRate = false;
+		double jitterSum = 0.0;
+		double lagSum = 0.0;
+		size_t jitterCount = 0;
+		const size_t count = trajectory.time.size();
+		for (size_t i = 1; i < count; ++i)
+		{
+			const Smoothing::Quat& target = trajectory.rotation[i];
+			const Smoothing::Quat current = smoother.next(i);
+			const double lagAngle = Smoothing::angleBetween(current, target);
+			lagSum += lagAngle * lagAngle;
+
+			const double dt = trajectory.time[i] - trajectory.time[i - 1];
+			const Smoothing::Vec3 step = Smoothing::relativeRotationVector(previous, current);
+			const Smoothing::Vec3 rate{ static_cast<float>(step.x / dt), static_cast<float>(step.y / dt), static_cast<float>(step.z / dt) };
+			if (havePreviousRate)
+			{
+				const double ax = (rate.x - previousRate.x) / dt;
+				const double ay = (rate.y - previousRate.y) / dt;
+				const double az = (rate.z - previousRate.z) / dt;
+				jitterSum += ax * ax + ay * ay + az * az;
+				++jitterCount;
+			}
+			previousRate = rate;
+			havePreviousRate = true;
+			previous = current;
+		}
+
+		Evaluation result;
+		result.params = params;
+		result.jitter = std::sqrt(jitterSum / static_cast<double>(std::max<size_t>(1, jitterCount))) * kRadToDeg;
+		result.lag = std::sqrt(lagSum / static_cast<double>(count - 1)) * kRadToDeg;
+		return result;
+	}
+
+	std::vector<Smoothing::SmoothingParams> buildGrid(const std::vector<ParameterRange>& ranges, int pointsPerParameter)
+	{
+		std::vector<Smoothing::SmoothingParams> candidates(1);
+		for (const auto& range : ranges)
+		{
+			std::vector<Smoothing::SmoothingParams> expanded;
+			expanded.reserve(candidates.size() * pointsPerParameter);
+			for (const auto& base : candidates)
+			{
+				for (int i = 0; i < pointsPerParameter; ++i)
+				{
+					const float t = pointsPerParameter > 1 ? static_cast<float>(i) / static_cast<float>(pointsPerParameter - 1) : 0.5f;
+					auto candidate = base;
+					candidate.*range.member = range.minValue + t * (range.maxValue - range.minValue);
+					expanded.push_back(candidate);
+				}
+			}
+			candidates.swap(expanded);
+		}
+		return candidates;
+	}
+
+	std::vector<Smoothing::SmoothingParams> buildRandom(const std::vector<ParameterRange>& ranges, int count, unsigned seed)
+	{
+		std::mt19937 generator(seed);
+		std::vector<Smoothing::SmoothingParams> candidates(count);
+		for (auto& candidate : candidates)
+		{
+			for (const auto& range : ranges)
+			{
+				std::uniform_real_distribution<float> distribution(range.minValue, range.maxValue);
+				candidate.*range.member = distribution(generator);
+			}
+		}
+		return candidates;
+	}
+
+	// Non-dominated evaluations, sorted by increasing lag (and therefore decreasing jitter).
+	std::vector<Evaluation> paretoFront(std::vector<Evaluation> evaluations)
+	{
+		std::sort(evaluations.begin(), evaluations.end(), [](const Evaluation& a, const Evaluation& b)
+		{
+			return a.lag < b.lag || (a.lag == b.lag && a.jitter < b.jitter);
+		});
+		std::vector<Evaluation> front;
+		double bestJitter = INFINITY;
+		for (const auto& evaluation : evaluations)
+		{
+			if (evaluation.jitter < bestJitter)
+			{
+				front.push_back(evaluation);
+				bestJitter = evaluation.jitter;
+			}
+		}
+		return front;
+	}
+
+	// The knee of the front: the point closest to the utopia point after normalizing both axes to the front's extent.
+	size_t recommendedIndex(const std::vector<Evaluation>& front)
+	{
+		const double lagMin = front.front().lag;
+		const double lagSpan = std::max(1e-12, front.back().lag - lagMin);
+		const double jitterMin = front.back().jitter;
+		const double jitterSpan = std::max(1e-12, front.front().jitter - jitterMin);
+		size_t best = 0;
+		double bestDistance = INFINITY;
+		for (size_t i = 0; i < front.size(); ++i)
+		{
+			const double l = (front[i].lag - lagMin) / lagSpan;
+			const double j = (front[i].jitter - jitterMin) / jitterSpan;
+			const double distance = l * l + j * j;
+			if (distance < bestDistance)
+			{
+				bestDistance = distance;
+				best = i;
+			}
+		}
+		return best;
+	}
+
+	void printUsage()
+	{
+		std::fprintf(stderr,
+			"Usage: SmoothingOptimizer <telemetry.csv> [--grid <points per parameter>] [--random <count>] [--seed <n>]\n"
+			"                          [--threads <n>] [--blend-min <v>] [--blend-max <v>] [--zero-phase <look-ahead frames>]\n");
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		printUsage();
+		return 1;
+	}
+
+	std::vector<ParameterRange> ranges = {
+		{ "blend", &Smoothing::SmoothingParams::blend, 0.01f, 1.0f },
+	};
+	int gridPoints = 0;
+	int randomCount = 0;
+	unsigned seed = 1;
+	unsigned threads = 0;
+	size_t zeroPhaseLookAhead = 0;
+	const std::string path = argv[1];
+	for (int i = 2; i < argc; ++i)
+	{
+		const bool hasValue = i + 1 < argc;
+		if (hasValue && 0 == std::strcmp(argv[i], "--grid")) { gridPoints = std::atoi(argv[++i]); }
+		else if (hasValue && 0 == std::strcmp(argv[i], "--random")) { randomCount = std::atoi(argv[++i]); }
+		else if (hasValue && 0 == std::strcmp(argv[i], "--seed")) { seed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10)); }
+		else if (hasValue && 0 == std::strcmp(argv[i], "--threads")) { threads = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10)); }
+		else if (hasValue && 0 == std::strcmp(argv[i], "--blend-min")) { ranges[0].minValue = std::strtof(argv[++i], nullptr); }
+		else if (hasValue && 0 == std::strcmp(argv[i], "--blend-max")) { ranges[0].maxValue = std::strtof(argv[++i], nullptr); }
+		else if (hasValue && 0 == std::strcmp(argv[i], "--zero-phase")) { zeroPhaseLookAhead = std::strtoul(argv[++i], nullptr, 10); }
+		else
+		{
+			printUsage();
+			return 1;
+		}
+	}
+	// same bounds Config applies to blend: larger than 0.0, at most 1.0
+	ranges[0].minValue = std::clamp(ranges[0].minValue, 0.0001f, 1.0f);
+	ranges[0].maxValue = std::clamp(ranges[0].maxValue, ranges[0].minValue, 1.0f);
+	if (gridPoints <= 0 && randomCount <= 0)
+	{
+		gridPoints = 1000;
+	}
+
+	Trajectory trajectory;
+	if (!loadTrajectory(path, trajectory))
+	{
+		std::fprintf(stderr, "Not enough samples in '%s'\n", path.c_str());
+		return 1;
+	}
+
+	std::vector<Smoothing::SmoothingParams> candidates = gridPoints > 0 ? buildGrid(ranges, gridPoints) : buildRandom(ranges, randomCount, seed);
+	std::vector<Evaluation> evaluations(candidates.size());
+
+	const auto start = std::chrono::steady_clock::now();
+	{
+		WorkStealingPool pool(threads);
+		pool.parallelFor(candidates.size(), 4, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				if (zeroPhaseLookAhead > 0)
+				{
+					ZeroPhaseSmoothing smoother(trajectory, candidates[i], zeroPhaseLookAhead);
+					evaluations[i] = evaluate(trajectory, candidates[i], smoother);
+				}
+				else
+				{
+					LiveSmoothing smoother(trajectory, candidates[i]);
+					evaluations[i] = evaluate(trajectory, candidates[i], smoother);
+				}
+			}
+		});
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::printf("Evaluated %zu configurations over %zu frames (%.1f s of telemetry) on %zu threads in %.3f s\n\n",
+			candidates.size(), trajectory.time.size(), trajectory.time.back() - trajectory.time.front(), pool.threadCount(), seconds);
+	}
+
+	const std::vector<Evaluation> front = paretoFront(evaluations);
+	std::printf("Pareto front (jitter = RMS angular acceleration, lag = RMS angle behind the car)\n");
+	std::printf("%12s %16s %12s\n", "blend", "jitter deg/s^2", "lag deg");
+	for (const auto& evaluation : front)
+	{
+		std::printf("%12.4f %16.2f %12.4f\n", evaluation.params.blend, evaluation.jitter, evaluation.lag);
+	}
+
+	const Evaluation& recommended = front[recommendedIndex(front)];
+	std::printf("\nRecommended dr2tools.cfg values:\n");
+	for (const auto& range : ranges)
+	{
+		std::printf("%s=%.4f\n", range.cfgKey, recommended.params.*range.member);
+	}
+	return 0;
+}
@@ -0,0 +1,308 @@
+// Stress test for the telemetry channel (see TelemetryChannel.h and SeqLock.h): a writer thread publishes frames as fast as it
+// can (or at --rate) while reader threads, each with its own read only mapping, copy the last frame flat out. Every field of a
+// frame is derived from its frame number, so a copy mixing two frames is caught. Also checks a reader can't open the channel
+// before the dll created it, sees nothing before the first frame, and keeps reading when the dll is restarted, which counts the
+// frames on from where the one before stopped. On Linux a forked process reads along too, through POSIX shared memory. For
+// comparison, counts how many copies made without the sequence check would have been torn. Exits with 1 if a check fails.
+//
+// Usage: TelemetryStressTest [--seconds 3] [--readers 3] [--rate 0 (flat out)]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../Common/TestReport.h"
+#include "../../InjectableGenericCameraSystem/TelemetryChannel.h"
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace IGCS;
+using namespace IGCS::Tools;
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+	constexpr size_t kFrameWords = sizeof(TelemetryFrame) / sizeof(uint32_t);
+
+	// exact in a float for every frame number
+	float fieldValue(uint64_t frame, int field)
+	{
+		return static_cast<float>((frame * 7 + static_cast<uint64_t>(field) * 1009) % 1000003);
+	}
+
+	TelemetryFrame makeFrame(uint64_t number)
+	{
+		TelemetryFrame frame;
+		std::memset(&frame, 0, sizeof(frame));
+		frame.frame = number;
+		frame.timestamp = static_cast<int64_t>(number) * 1000;
+		frame.deltaTime = fieldValue(number, 0);
+		frame.camera.cameraEnabled = static_cast<uint8_t>(number);
+		frame.camera.cameraMovementLocked = static_cast<uint8_t>(number >> 8);
+		// the floats of the camera from fov on and of the car from position on follow each other without padding
+		float cameraFloats[(sizeof(TelemetryCamera) - offsetof(TelemetryCamera, fov)) / sizeof(float)];
+		for (size_t i = 0; i < std::size(cameraFloats); ++i)
+		{
+			cameraFloats[i] = fieldValue(number, 1 + static_cast<int>(i));
+		}
+		std::memcpy(&frame.camera.fov, cameraFloats, sizeof(cameraFloats));
+		frame.car.valid = static_cast<uint32_t>(number);
+		float carFloats[(sizeof(TelemetryCar) - offsetof(TelemetryCar, position)) / sizeof(float)];
+		for (size_t i = 0; i < std::size(carFloats); ++i)
+		{
+			carFloats[i] = fieldValue(number, 100 + static_cast<int>(i));
+		}
+		std::memcpy(&frame.car.position, carFloats, sizeof(carFloats));
+		return frame;
+	}
+
+	// Whether frame is the one makeFrame made for its number.
+	bool isWhole(const TelemetryFrame& frame)
+	{
+		const TelemetryFrame expected = makeFrame(frame.frame);
+		return expected.timestamp == frame.timestamp && expected.deltaTime == frame.deltaTime
+			&& 0 == std::memcmp(&expected.camera, &frame.camera, sizeof(frame.camera)) && 0 == std::memcmp(&expected.car, &frame.car, sizeof(frame.car));
+	}
+
+	struct ReaderStats
+	{
+		uint64_t reads = 0;
+		uint64_t busy = 0;
+		uint64_t torn = 0;
+		uint64_t backwards = 0;
+		uint64_t newFrames = 0;
+		uint64_t unguardedCopies = 0;
+		uint64_t unguardedTorn = 0;
+		double seconds = 0.0;
+	};
+
+	// Reads till stop is set. naive is written like the channel but without a sequence, copies of it show what the check saves.
+	void readUntil(const TelemetryReader& reader, const std::atomic<bool>& stop, const std::atomic<uint32_t>* naive, ReaderStats& stats)
+	{
+		uint64_t last = 0;
+		const Clock::time_point start = Clock::now();
+		while (!stop.load(std::memory_order_relaxed))
+		{
+			TelemetryFrame frame;
+			const SeqLockReadResult result = reader.read(frame);
+			++stats.reads;
+			if (SeqLockReadResult::Busy == result)
+			{
+				++stats.busy;
+			}
+			else if (SeqLockReadResult::Ok == result)
+			{
+				stats.torn += isWhole(frame) ? 0 : 1;
+				stats.backwards += frame.frame < last ? 1 : 0;
+				stats.newFrames += frame.frame > last ? 1 : 0;
+				last = std::max(last, frame.frame);
+			}
+			if (nullptr != naive && 0 == (stats.reads & 15))
+			{
+				uint32_t words[kFrameWords];
+				for (size_t i = 0; i < kFrameWords; ++i)
+				{
+					words[i] = naive[i].load(std::memory_order_relaxed);
+				}
+				TelemetryFrame copy;
+				std::memcpy(&copy, words, sizeof(copy));
+				++stats.unguardedCopies;
+				stats.unguardedTorn += 0 != copy.frame && !isWhole(copy) ? 1 : 0;
+			}
+		}
+		stats.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+#ifndef _WIN32
+	// The forked reader: reads till no new frame came for a second. Exit code 0 all whole, 1 torn or out of order, 2 nothing read.
+	int runChildReader(const std::string& name)
+	{
+		TelemetryReader reader;
+		const Clock::time_point openDeadline = Clock::now() + std::chrono::seconds(5);
+		while (!reader.open(name))
+		{
+			if (Clock::now() > openDeadline)
+			{
+				return 2;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		uint64_t last = 0;
+		uint64_t whole = 0;
+		Clock::time_point lastNew = Clock::now();
+		while (Clock::now() - lastNew < std::chrono::seconds(1))
+		{
+			TelemetryFrame frame;
+			if (SeqLockReadResult::Ok != reader.read(frame))
+			{
+				continue;
+			}
+			if (!isWhole(frame) || frame.frame < last)
+			{
+				return 1;
+			}
+			if (frame.frame > last)
+			{
+				last = frame.frame;
+				lastNew = Clock::now();
+			}
+			++whole;
+		}
+		return whole > 0 ? 0 : 2;
+	}
+#endif
+
+	void printUsage()
+	{
+		std::fprintf(stderr, "Usage: TelemetryStressTest [--seconds <default 3>] [--readers <default 3>] [--rate <frames per second, default 0: flat out>]\n");
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	double seconds = 3.0;
+	int readers = 3;
+	double rate = 0.0;
+	Options options;
+	options.add("--seconds", seconds);
+	options.add("--readers", readers);
+	options.add("--rate", rate);
+	if (!options.parse(argc, argv))
+	{
+		printUsage();
+		return 1;
+	}
+	if (seconds <= 0.0 || readers < 1 || rate < 0.0)
+	{
+		printUsage();
+		return 1;
+	}
+
+	const std::string name = "IgcsTelemetryTest" + std::to_string(static_cast<unsigned long long>(Clock::now().time_since_epoch().count() % 1000000));
+	SharedMemory::remove(name);
+
+	// before the dll, a reader finds nothing
+	TelemetryReader early;
+	bool ok = report("no channel before the dll creates it", !early.open(name));
+
+#ifndef _WIN32
+	// forked before any thread starts
+	const pid_t child = fork();
+	if (0 == child)
+	{
+		std::_Exit(runChildReader(name));
+	}
+#endif
+
+	TelemetryPublisher publisher;
+	if (!publisher.open(name))
+	{
+		std::printf("Can't create the shared memory %s\n", name.c_str());
+		return 1;
+	}
+	std::vector<TelemetryReader> mapped(static_cast<size_t>(readers));
+	bool opened = true;
+	for (TelemetryReader& reader : mapped)
+	{
+		opened = reader.open(name) && opened;
+	}
+	TelemetryFrame frame;
+	ok = report("readers open it, nothing to read before the first frame", opened && SeqLockReadResult::Empty == mapped[0].read(frame)) && ok;
+
+	// the stress run
+	std::atomic<bool> stop{ false };
+	std::atomic<uint32_t> naive[kFrameWords] = {};
+	std::vector<ReaderStats> stats(static_cast<size_t>(readers));
+	std::vector<std::thread> threads;
+	for (int r = 0; r < readers; ++r)
+	{
+		threads.emplace_back([&, r] { readUntil(mapped[static_cast<size_t>(r)], stop, naive, stats[static_cast<size_t>(r)]); });
+	}
+	uint64_t published = 0;
+	double publishSeconds = 0.0;
+	{
+		const Clock::time_point start = Clock::now();
+		const Clock::time_point end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+		const auto period = rate > 0.0 ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rate)) : Clock::duration::zero();
+		Clock::time_point next = start;
+		while (Clock::now() < end)
+		{
+			const TelemetryFrame toPublish = makeFrame(++published);
+			const Clock::time_point before = Clock::now();
+			publisher.publish(toPublish);
+			publishSeconds += std::chrono::duration<double>(Clock::now() - before).count();
+			uint32_t words[kFrameWords];
+			std::memcpy(words, &toPublish, sizeof(toPublish));
+			for (size_t i = 0; i < kFrameWords; ++i)
+			{
+				naive[i].store(words[i], std::memory_order_relaxed);
+			}
+			if (rate > 0.0)
+			{
+				next += period;
+				std::this_thread::sleep_until(next);
+			}
+		}
+	}
+	stop.store(true);
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+	ReaderStats total;
+	for (const ReaderStats& reader : stats)
+	{
+		total.reads += reader.reads;
+		total.busy += reader.busy;
+		total.torn += reader.torn;
+		total.backwards += reader.backwards;
+		total.newFrames += reader.newFrames;
+		total.unguardedCopies += reader.unguardedCopies;
+		total.unguardedTorn += reader.unguardedTorn;
+		total.seconds += reader.seconds;
+	}
+	std::printf("        %llu frames published, %.0f ns per publish\n", static_cast<unsigned long long>(published),
+		publishSeconds * 1e9 / static_cast<double>(std::max<uint64_t>(published, 1)));
+	std::printf("        %llu reads by %d readers, %.0f ns per read, %llu busy, %llu new frames seen\n",
+		static_cast<unsigned long long>(total.reads), readers, total.seconds * 1e9 / static_cast<double>(std::max<uint64_t>(total.reads, 1)),
+		static_cast<unsigned long long>(total.busy), static_cast<unsigned long long>(total.newFrames));
+	std::printf("        %llu torn, %llu out of order; without the sequence check %llu of %llu copies would have been torn\n",
+		static_cast<unsigned long long>(total.torn), static_cast<unsigned long long>(total.backwards),
+		static_cast<unsigned long long>(total.unguardedTorn), static_cast<unsigned long long>(total.unguardedCopies));
+	ok = report("every frame read is whole and none goes back", published > 0 && total.newFrames > 0 && 0 == total.torn && 0 == total.backwards) && ok;
+
+	// the dll restarts: the readers keep their mapping and see the new frames
+	publisher.close();
+	TelemetryPublisher restarted;
+	const bool reopened = restarted.open(name);
+	ok = report("a restarted dll counts on from the last frame", reopened && 0 == publisher.lastFrame() && published == restarted.lastFrame()) && ok;
+	restarted.publish(makeFrame(restarted.lastFrame() + 1));
+	ok = report("readers carry on when the dll restarts", reopened && SeqLockReadResult::Ok == mapped[0].read(frame) && published + 1 == frame.frame
+		&& isWhole(frame)) && ok;
+
+#ifndef _WIN32
+	int status = 0;
+	waitpid(child, &status, 0);
+	const int childResult = WIFEXITED(status) ? WEXITSTATUS(status) : 3;
+	ok = report("another process reads whole frames", 0 == childResult) && ok;
+#endif
+
+	restarted.close();
+	for (TelemetryReader& reader : mapped)
+	{
+		reader.close();
+	}
+	SharedMemory::remove(name);
+
+	return finish(ok);
+}